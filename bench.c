@@ -0,0 +1,1795 @@
+/*
+ * Throughput benchmark: times the validators, their batch entry points, the
+ * formatters and their libc counterparts over synthetic corpora and prints
+ * the results as JSON.
+ *
+ * Every corpus is generated from a fixed seed, so runs on the same machine
+ * are directly comparable. Each case is calibrated to run for at least
+ * BENCH_MIN_ROUND_NS per round and the fastest of several rounds is
+ * reported, which filters out most scheduler and frequency noise.
+ *
+ * With -p every round is also measured with hardware performance counters
+ * from perf_event_open(), and the round with the fewest cycles reports its
+ * cycles, instructions, branch misses and L1 data cache misses per address.
+ *
+ * With -L single calls are timed instead, per input class, into latency
+ * histograms; -b compares their p99 with a recorded baseline and the exit
+ * status reports a regression.
+ */
+
+/* syscall() is outside POSIX. */
+#define _DEFAULT_SOURCE
+
+#include "ip_validator.h"
+#include "ip_cache.h"
+#include "ip_classify.h"
+#include "ip_scan.h"
+#include "ip_set.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>             /* getopt */
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>          /* __rdtsc, __rdtscp, _mm_lfence */
+#endif
+
+/* Default number of addresses in each corpus. */
+#define BENCH_DEFAULT_COUNT 100000
+
+/* Default number of timed rounds per case; the fastest one is reported. */
+#define BENCH_DEFAULT_ROUNDS 7
+
+/* Shortest acceptable round; passes over the corpus are added to reach it. */
+#define BENCH_MIN_ROUND_NS 20000000ULL
+
+/* Longest generated entry, plus its terminator. */
+#define BENCH_MAX_ENTRY 64
+
+/* Distinct hot addresses in the skewed corpus, and the parse cache budget. */
+#define BENCH_HOT_ADDRESSES 512
+#define BENCH_CACHE_BYTES (64 * 1024)
+
+/* Addresses of each family in the membership set, well past the L2 cache. */
+#define BENCH_SET_SIZE (1 << 20)
+
+/* Counters read in -p mode, in output order; see bench_events. */
+#define BENCH_EVENTS 5
+
+/* Input classes of -L mode, and distinct inputs generated for each. */
+#define BENCH_LATENCY_CLASSES 8
+#define BENCH_LATENCY_ENTRIES 4096
+
+/* Records read from a -b baseline, at most. */
+#define BENCH_BASELINE_MAX 64
+
+/*
+ * With -b, a p99 may grow by BENCH_DEFAULT_THRESHOLD percent (or -t) before
+ * it counts as a regression, and the limit is never below
+ * BENCH_LATENCY_FLOOR_NS: classes rejected within a few timer ticks are
+ * mostly timer jitter. One over the limit is measured again
+ * BENCH_LATENCY_RETRIES times, BENCH_LATENCY_PAUSE_NS apart, before the
+ * check fails.
+ */
+#define BENCH_DEFAULT_THRESHOLD 50.0
+#define BENCH_LATENCY_FLOOR_NS 50.0
+#define BENCH_LATENCY_RETRIES 3
+#define BENCH_LATENCY_PAUSE_NS 200000000L
+
+/* Latency histogram layout; see struct bench_hist. */
+#define BENCH_HIST_BITS 6
+#define BENCH_HIST_HALF (1 << BENCH_HIST_BITS)
+#define BENCH_HIST_BUCKETS ((64 - BENCH_HIST_BITS + 1) * BENCH_HIST_HALF)
+
+/* Output formats of the records. */
+enum bench_format {
+    BENCH_JSON,
+    BENCH_CSV
+};
+
+/* A set of candidate strings, stored for every calling convention. */
+struct bench_corpus {
+    const char *name;
+    size_t count;
+    char *text;                 /* NUL-terminated entries, back to back */
+    size_t text_len;
+    const char **bufs;          /* Start of each entry in @text */
+    size_t *lens;
+    char *arrow_data;           /* Entries without separators */
+    int32_t *arrow_offsets;
+    uint8_t *validity;
+    struct in_addr *addrs4;     /* Parsed entries, 0.0.0.0 where rejected */
+    struct in6_addr *addrs6;    /* Parsed entries, :: where rejected */
+    char *format_data;          /* Output of the formatters */
+    int32_t *format_offsets;
+};
+
+/* One timed function; returns how many candidates it accepted. */
+struct bench_case {
+    const char *name;
+    size_t (*run)(const struct bench_corpus *corpus);
+    const char *kernel;         /* NULL: timed with and without the vector
+                                   path; otherwise the label to report */
+};
+
+/* xorshift64* state for the corpus generators. */
+static uint64_t bench_rng_state = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * Returns the next pseudo-random 32-bit value from the shared generator.
+ */
+static uint32_t bench_rand(void)
+{
+    bench_rng_state ^= bench_rng_state >> 12;
+    bench_rng_state ^= bench_rng_state << 25;
+    bench_rng_state ^= bench_rng_state >> 27;
+    return (uint32_t)((bench_rng_state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+/**
+ * Returns a pseudo-random value in [0, n).
+ */
+static uint32_t bench_below(uint32_t n)
+{
+    return (uint32_t)(((uint64_t)bench_rand() * n) >> 32);
+}
+
+/**
+ * gen_ipv4 - Write a random dotted quad.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv4(char *out)
+{
+    return (size_t)snprintf(out, BENCH_MAX_ENTRY, "%u.%u.%u.%u",
+                            bench_below(256), bench_below(256),
+                            bench_below(256), bench_below(256));
+}
+
+/**
+ * gen_ipv4_skewed - Write a dotted quad drawn mostly from a small hot set.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Nine entries in ten repeat one of BENCH_HOT_ADDRESSES fixed addresses, as
+ * in flow logs dominated by a few busy hosts; the rest are random.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv4_skewed(char *out)
+{
+    if (bench_below(10) == 0)
+        return gen_ipv4(out);
+
+    uint32_t hot = bench_below(BENCH_HOT_ADDRESSES) * 2654435761u;
+
+    return (size_t)snprintf(out, BENCH_MAX_ENTRY, "%u.%u.%u.%u", hot >> 24,
+                            (hot >> 16) & 0xff, (hot >> 8) & 0xff,
+                            hot & 0xff);
+}
+
+/**
+ * gen_group - Pick a random IPv6 group value, biased towards zero.
+ *
+ * Return: 16-bit group value.
+ */
+static unsigned int gen_group(void)
+{
+    switch (bench_below(4)) {
+    case 0:
+        return 0;
+    case 1:
+        return bench_below(256);
+    default:
+        return bench_below(65536);
+    }
+}
+
+/**
+ * gen_ipv6_full - Write a random IPv6 address with all eight groups present.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv6_full(char *out)
+{
+    size_t len = 0;
+
+    for (int i = 0; i < 8; i++)
+        len += (size_t)snprintf(out + len, BENCH_MAX_ENTRY - len,
+                                i == 0 ? "%x" : ":%x", gen_group());
+    return len;
+}
+
+/**
+ * gen_ipv6_compressed - Write a random IPv6 address with one "::" run.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv6_compressed(char *out)
+{
+    int run = 2 + (int)bench_below(7);  /* 2 to 8 zero groups */
+    int head = (int)bench_below((uint32_t)(9 - run));
+    int tail = 8 - run - head;
+    size_t len = 0;
+
+    for (int i = 0; i < head; i++)
+        len += (size_t)snprintf(out + len, BENCH_MAX_ENTRY - len,
+                                i == 0 ? "%x" : ":%x", gen_group());
+    len += (size_t)snprintf(out + len, BENCH_MAX_ENTRY - len, "::");
+    for (int i = 0; i < tail; i++)
+        len += (size_t)snprintf(out + len, BENCH_MAX_ENTRY - len,
+                                i == 0 ? "%x" : ":%x", gen_group());
+    return len;
+}
+
+/**
+ * gen_ipv6_mapped - Write an IPv6 address ending in a dotted quad.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Mixes IPv4-mapped (::ffff:a.b.c.d), NAT64 (64:ff9b::a.b.c.d) and
+ * six-group full forms.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv6_mapped(char *out)
+{
+    size_t len;
+
+    switch (bench_below(3)) {
+    case 0:
+        len = (size_t)snprintf(out, BENCH_MAX_ENTRY, "::ffff:");
+        break;
+    case 1:
+        len = (size_t)snprintf(out, BENCH_MAX_ENTRY, "64:ff9b::");
+        break;
+    default:
+        len = 0;
+        for (int i = 0; i < 6; i++)
+            len += (size_t)snprintf(out + len, BENCH_MAX_ENTRY - len, "%x:",
+                                    gen_group());
+        break;
+    }
+    return len + gen_ipv4(out + len);
+}
+
+/**
+ * gen_mostly_invalid - Write a near-miss address, mostly rejected.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Starts from a valid IPv4 or IPv6 address and, nine times in ten,
+ * corrupts it the way real log noise does: a stray byte, a truncation, an
+ * extra component or a second "::".
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_mostly_invalid(char *out)
+{
+    static const char stray[] = "g:.%-x 1/";
+    size_t len;
+
+    switch (bench_below(3)) {
+    case 0:
+        len = gen_ipv4(out);
+        break;
+    case 1:
+        len = gen_ipv6_compressed(out);
+        break;
+    default:
+        len = gen_ipv6_full(out);
+        break;
+    }
+    if (bench_below(10) == 0)
+        return len;
+
+    switch (bench_below(4)) {
+    case 0:
+        out[bench_below((uint32_t)len)] = stray[bench_below(sizeof(stray) -
+                                                            1)];
+        break;
+    case 1:
+        len = 1 + bench_below((uint32_t)len - 1);
+        out[len] = '\0';
+        break;
+    case 2:
+        len += (size_t)snprintf(out + len, BENCH_MAX_ENTRY - len,
+                                strchr(out, ':') ? ":1" : ".1");
+        break;
+    default:
+        len += (size_t)snprintf(out + len, BENCH_MAX_ENTRY - len, "::1");
+        break;
+    }
+    return len;
+}
+
+/**
+ * gen_garbage - Write a run of random printable bytes.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_garbage(char *out)
+{
+    size_t len = 1 + bench_below(40);
+
+    for (size_t i = 0; i < len; i++)
+        out[i] = (char)(' ' + bench_below(95));
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * gen_pick - Copy one entry of a fixed list.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ * @list: Entries, each shorter than BENCH_MAX_ENTRY.
+ * @count: Number of entries in @list.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_pick(char *out, const char *const *list, size_t count)
+{
+    const char *s = list[bench_below((uint32_t)count)];
+    size_t len = strlen(s);
+
+    memcpy(out, s, len + 1);
+    return len;
+}
+
+/*
+ * Rejected inputs of the latency classes, taken from the "Invalid" and
+ * "Adversarial" groups of run_ipv4_tests() and run_ipv6_tests() in demo.c.
+ */
+static const char *const bench_ipv4_invalid[] = {
+    "256.1.1.1", "999.1.1.1", "300.300.300.300", "192.168.1",
+    "192.168.1.1.1", "192", "192.168..1", "192.168.1.1.", ".192.168.1.1",
+    "", "192.168.a.1", "192.168.1.1!", "192.168. 1.1", "192.168.-1.1",
+    "255.1.1.0.", "255.255.255.255.",
+};
+
+static const char *const bench_ipv4_adversarial[] = {
+    "255.255.255.256", "99999999999.1.1.1", "0xC0.0xA8.0x01.0x01",
+    "0777.0777.0777.0777", "192'; DROP TABLE--", "192<script>",
+    "\xef\xbc\x91\xef\xbc\x99\xef\xbc\x92.\xef\xbc\x91\xef\xbc\x96"
+    "\xef\xbc\x98.\xef\xbc\x91.\xef\xbc\x91",
+    "192..168.1.1", "192...168.1.1",
+};
+
+static const char *const bench_ipv6_invalid[] = {
+    "2001:db8:::1", "2001::::1", "2001::db8::1", "1:2:3:4:5:6:7:8:9",
+    "2001:0db8:0000:0000:0000:0000:0000:0000:0001",
+    "2001:0db8:0g00:0000:0000:0000:0000:0001",
+    "2001:0db8:0000:0000:0000:0000:0000:0001!",
+    "2001:0db8:00000:0000:0000:0000:0000:0001",
+    "20011:0db8:0000:0000:0000:0000:0000:0001", "", "::ffff:999.0.2.128",
+    "2001:db8:192.168.1.1::", ":2001:db8::1", "2001:db8::1:",
+};
+
+static const char *const bench_ipv6_adversarial[] = {
+    "aBcD:EfGh:0000:0000:0000:0000:0000:0001", "ffffffff:0:0:0:0:0:0:1",
+    "192.168.1.1", "2001:db8:192.168.1", ":::", ":1:2:3:4:5:6:7:8",
+    "2001::db8:::1", "2001:db8\xe2\x88\xb6:1", "2001:db8<script>::1",
+    "'; DROP TABLE--",
+};
+
+/**
+ * gen_ipv4_invalid - Write a malformed dotted quad from the demo suite.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv4_invalid(char *out)
+{
+    return gen_pick(out, bench_ipv4_invalid,
+                    sizeof(bench_ipv4_invalid) / sizeof(bench_ipv4_invalid[0]));
+}
+
+/**
+ * gen_ipv4_adversarial - Write a hostile IPv4 input from the demo suite.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv4_adversarial(char *out)
+{
+    return gen_pick(out, bench_ipv4_adversarial,
+                    sizeof(bench_ipv4_adversarial) /
+                    sizeof(bench_ipv4_adversarial[0]));
+}
+
+/**
+ * gen_ipv6_invalid - Write a malformed IPv6 address from the demo suite.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv6_invalid(char *out)
+{
+    return gen_pick(out, bench_ipv6_invalid,
+                    sizeof(bench_ipv6_invalid) / sizeof(bench_ipv6_invalid[0]));
+}
+
+/**
+ * gen_ipv6_adversarial - Write a hostile IPv6 input from the demo suite.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv6_adversarial(char *out)
+{
+    return gen_pick(out, bench_ipv6_adversarial,
+                    sizeof(bench_ipv6_adversarial) /
+                    sizeof(bench_ipv6_adversarial[0]));
+}
+
+/**
+ * gen_ipv6_valid - Write a full, compressed or dotted-quad IPv6 address.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_ipv6_valid(char *out)
+{
+    switch (bench_below(3)) {
+    case 0:
+        return gen_ipv6_full(out);
+    case 1:
+        return gen_ipv6_compressed(out);
+    default:
+        return gen_ipv6_mapped(out);
+    }
+}
+
+/**
+ * gen_long_garbage - Write a long run of address characters.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Like "Edge: Very long invalid" in demo.c: 46 to 63 hex digits, dots and
+ * colons, longer than any address, as a crafted header value would be.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_long_garbage(char *out)
+{
+    static const char chars[] = "0123456789abcdef1111:.";
+    size_t len = INET6_ADDRSTRLEN + bench_below(BENCH_MAX_ENTRY -
+                                                INET6_ADDRSTRLEN);
+
+    for (size_t i = 0; i < len; i++)
+        out[i] = chars[bench_below(sizeof(chars) - 1)];
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * gen_many_colons - Write a colon-heavy near miss.
+ * @out: Buffer of BENCH_MAX_ENTRY bytes.
+ *
+ * Like "IPv6 Adversarial: Many colons" in demo.c: runs of 3 to 40 colons,
+ * half of them with a hex digit between some of the colons.
+ *
+ * Return: length of the text written.
+ */
+static size_t gen_many_colons(char *out)
+{
+    size_t len = 3 + bench_below(38);
+    bool digits = bench_below(2);
+
+    for (size_t i = 0; i < len; i++)
+        out[i] = digits && bench_below(3) == 0 ? "0123456789abcdef"
+            [bench_below(16)] : ':';
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * corpus_build - Generate a corpus and lay it out for every entry point.
+ * @corpus: Corpus to fill; @corpus->name is set by the caller.
+ * @count: Number of entries to generate.
+ * @gen: Generator writing one entry and returning its length.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+static bool corpus_build(struct bench_corpus *corpus, size_t count,
+                         size_t (*gen)(char *out))
+{
+    corpus->count = count;
+    corpus->text = malloc(count * BENCH_MAX_ENTRY);
+    corpus->bufs = malloc(count * sizeof(*corpus->bufs));
+    corpus->lens = malloc(count * sizeof(*corpus->lens));
+    corpus->arrow_data = malloc(count * BENCH_MAX_ENTRY);
+    corpus->arrow_offsets = malloc((count + 1) *
+                                   sizeof(*corpus->arrow_offsets));
+    corpus->validity = malloc((count + 7) / 8);
+    corpus->addrs4 = calloc(count, sizeof(*corpus->addrs4));
+    corpus->addrs6 = calloc(count, sizeof(*corpus->addrs6));
+    corpus->format_data = malloc(count * INET6_ADDRSTRLEN);
+    corpus->format_offsets = malloc((count + 1) *
+                                    sizeof(*corpus->format_offsets));
+    if (corpus->text == NULL || corpus->bufs == NULL ||
+        corpus->lens == NULL || corpus->arrow_data == NULL ||
+        corpus->arrow_offsets == NULL || corpus->validity == NULL ||
+        corpus->addrs4 == NULL || corpus->addrs6 == NULL ||
+        corpus->format_data == NULL || corpus->format_offsets == NULL)
+        return false;
+
+    char *text = corpus->text;
+    int32_t offset = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t len = gen(text);
+
+        corpus->bufs[i] = text;
+        corpus->lens[i] = len;
+        corpus->arrow_offsets[i] = offset;
+        memcpy(corpus->arrow_data + offset, text, len);
+        inet_pton(AF_INET, text, &corpus->addrs4[i]);
+        inet_pton(AF_INET6, text, &corpus->addrs6[i]);
+        offset += (int32_t)len;
+        text += len + 1;
+    }
+    corpus->arrow_offsets[count] = offset;
+    corpus->text_len = (size_t)(text - corpus->text);
+    return true;
+}
+
+/**
+ * corpus_free - Release the buffers of a corpus.
+ * @corpus: Corpus filled by corpus_build().
+ */
+static void corpus_free(struct bench_corpus *corpus)
+{
+    free(corpus->text);
+    free(corpus->bufs);
+    free(corpus->lens);
+    free(corpus->arrow_data);
+    free(corpus->arrow_offsets);
+    free(corpus->validity);
+    free(corpus->addrs4);
+    free(corpus->addrs6);
+    free(corpus->format_data);
+    free(corpus->format_offsets);
+}
+
+static size_t run_ipv4(const struct bench_corpus *corpus)
+{
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        accepted += is_valid_ipv4_address(corpus->bufs[i]);
+    return accepted;
+}
+
+static size_t run_ipv6(const struct bench_corpus *corpus)
+{
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        accepted += is_valid_ipv6_address(corpus->bufs[i]);
+    return accepted;
+}
+
+/* Loops compiled with IP_VALIDATOR_INLINE; see bench_inline.c. */
+size_t bench_inline_ipv4(const char *const *bufs, const size_t *lens,
+                         size_t count);
+size_t bench_inline_ipv6(const char *const *bufs, const size_t *lens,
+                         size_t count);
+
+static size_t run_parse4(const struct bench_corpus *corpus)
+{
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++) {
+        struct in_addr addr;
+
+        accepted += parse_ipv4_address(corpus->bufs[i], corpus->lens[i],
+                                       &addr);
+    }
+    return accepted;
+}
+
+static size_t run_parse6(const struct bench_corpus *corpus)
+{
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++) {
+        struct in6_addr addr;
+
+        accepted += parse_ipv6_address(corpus->bufs[i], corpus->lens[i],
+                                       &addr);
+    }
+    return accepted;
+}
+
+static size_t run_parse4_inline(const struct bench_corpus *corpus)
+{
+    return bench_inline_ipv4(corpus->bufs, corpus->lens, corpus->count);
+}
+
+static size_t run_parse6_inline(const struct bench_corpus *corpus)
+{
+    return bench_inline_ipv6(corpus->bufs, corpus->lens, corpus->count);
+}
+
+static size_t run_stream(const struct bench_corpus *corpus)
+{
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++) {
+        struct ip_stream ctx;
+
+        ip_stream_init(&ctx, AF_UNSPEC);
+        ip_stream_feed(&ctx, corpus->bufs[i], corpus->lens[i]);
+        accepted += ip_stream_finish(&ctx, NULL);
+    }
+    return accepted;
+}
+
+static size_t run_pton4(const struct bench_corpus *corpus)
+{
+    struct in_addr addr;
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        accepted += inet_pton(AF_INET, corpus->bufs[i], &addr) == 1;
+    return accepted;
+}
+
+static size_t run_pton6(const struct bench_corpus *corpus)
+{
+    struct in6_addr addr;
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        accepted += inet_pton(AF_INET6, corpus->bufs[i], &addr) == 1;
+    return accepted;
+}
+
+static size_t run_ipv4_batch(const struct bench_corpus *corpus)
+{
+    return is_valid_ipv4_batch(corpus->bufs, corpus->lens, corpus->count,
+                               corpus->validity, NULL);
+}
+
+static size_t run_ipv6_batch(const struct bench_corpus *corpus)
+{
+    return is_valid_ipv6_batch(corpus->bufs, corpus->lens, corpus->count,
+                               corpus->validity, NULL);
+}
+
+static size_t run_ipv4_arrow(const struct bench_corpus *corpus)
+{
+    return is_valid_ipv4_batch_arrow(corpus->arrow_offsets,
+                                     corpus->arrow_data, corpus->count,
+                                     corpus->validity, NULL);
+}
+
+static size_t run_ipv6_arrow(const struct bench_corpus *corpus)
+{
+    return is_valid_ipv6_batch_arrow(corpus->arrow_offsets,
+                                     corpus->arrow_data, corpus->count,
+                                     corpus->validity, NULL);
+}
+
+static size_t run_scan(const struct bench_corpus *corpus)
+{
+    struct ip_match matches[256];
+    size_t pos = 0, accepted = 0, n;
+
+    /* The NUL separators between entries act as plain delimiters. */
+    do {
+        n = ip_scan(corpus->text, corpus->text_len, &pos, AF_UNSPEC, matches,
+                    sizeof(matches) / sizeof(matches[0]));
+        accepted += n;
+    } while (pos < corpus->text_len);
+    return accepted;
+}
+
+static size_t run_format4(const struct bench_corpus *corpus)
+{
+    char text[INET_ADDRSTRLEN];
+    size_t formatted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        formatted += format_ipv4_address(&corpus->addrs4[i], text,
+                                         sizeof(text)) != 0;
+    return formatted;
+}
+
+static size_t run_ntop4(const struct bench_corpus *corpus)
+{
+    char text[INET_ADDRSTRLEN];
+    size_t formatted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        formatted += inet_ntop(AF_INET, &corpus->addrs4[i], text,
+                               sizeof(text)) != NULL;
+    return formatted;
+}
+
+static size_t run_format4_arrow(const struct bench_corpus *corpus)
+{
+    format_ipv4_batch_arrow(corpus->addrs4, corpus->count,
+                            corpus->format_offsets, corpus->format_data);
+    return corpus->count;
+}
+
+static size_t run_format6(const struct bench_corpus *corpus)
+{
+    char text[INET6_ADDRSTRLEN];
+    size_t formatted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        formatted += format_ipv6_address(&corpus->addrs6[i], text,
+                                         sizeof(text)) != 0;
+    return formatted;
+}
+
+static size_t run_ntop6(const struct bench_corpus *corpus)
+{
+    char text[INET6_ADDRSTRLEN];
+    size_t formatted = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        formatted += inet_ntop(AF_INET6, &corpus->addrs6[i], text,
+                               sizeof(text)) != NULL;
+    return formatted;
+}
+
+static size_t run_format6_arrow(const struct bench_corpus *corpus)
+{
+    format_ipv6_batch_arrow(corpus->addrs6, corpus->count,
+                            corpus->format_offsets, corpus->format_data);
+    return corpus->count;
+}
+
+/* Parse cache shared by the cached case; the benchmark is single-threaded. */
+static struct ip_cache bench_cache;
+
+static size_t run_parse_classify(const struct bench_corpus *corpus)
+{
+    size_t classified = 0;
+
+    for (size_t i = 0; i < corpus->count; i++) {
+        struct ip_address addr;
+
+        if (parse_ipv4_address(corpus->bufs[i], corpus->lens[i], &addr.v4))
+            addr.family = AF_INET;
+        else if (parse_ipv6_address(corpus->bufs[i], corpus->lens[i],
+                                    &addr.v6))
+            addr.family = AF_INET6;
+        else
+            continue;
+        classified += ip_classify(&addr) != 0;
+    }
+    return classified;
+}
+
+static size_t run_cache_parse(const struct bench_corpus *corpus)
+{
+    size_t classified = 0;
+
+    for (size_t i = 0; i < corpus->count; i++) {
+        struct ip_cache_result res;
+
+        if (ip_cache_parse(&bench_cache, corpus->bufs[i], corpus->lens[i],
+                           &res))
+            classified += res.classes != 0;
+    }
+    return classified;
+}
+
+/* Membership set searched by the set cases, from its own seed. */
+static struct ip_set bench_set;
+
+/**
+ * bench_set_build - Fill the membership set with pseudo-random addresses.
+ *
+ * Uses a generator separate from bench_rand() so the corpora stay the same
+ * as without the set cases.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+static bool bench_set_build(void)
+{
+    struct in_addr *v4 = malloc(BENCH_SET_SIZE * sizeof(*v4));
+    struct in6_addr *v6 = malloc(BENCH_SET_SIZE * sizeof(*v6));
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    bool ok = v4 != NULL && v6 != NULL;
+
+    for (size_t i = 0; ok && i < BENCH_SET_SIZE; i++) {
+        for (int b = 0; b < 16; b++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            v6[i].s6_addr[b] = (unsigned char)(state >> 56);
+        }
+        v4[i].s_addr = (uint32_t)(state >> 32);
+    }
+    ok = ok && ip_set_build(&bench_set, v4, BENCH_SET_SIZE, v6,
+                            BENCH_SET_SIZE);
+    free(v4);
+    free(v6);
+    return ok;
+}
+
+static size_t run_set4(const struct bench_corpus *corpus)
+{
+    size_t found = 0;
+
+    for (size_t i = 0; i < corpus->count; i++)
+        found += ip_set_contains_ipv4(&bench_set, &corpus->addrs4[i]);
+    return found;
+}
+
+static size_t run_set4_batch(const struct bench_corpus *corpus)
+{
+    return ip_set_contains_ipv4_batch(&bench_set, corpus->addrs4,
+                                      corpus->count, corpus->validity);
+}
+
+static size_t run_set6_batch(const struct bench_corpus *corpus)
+{
+    return ip_set_contains_ipv6_batch(&bench_set, corpus->addrs6,
+                                      corpus->count, corpus->validity);
+}
+
+static const struct bench_case bench_cases[] = {
+    { "is_valid_ipv4_address", run_ipv4, NULL },
+    { "is_valid_ipv6_address", run_ipv6, NULL },
+    { "parse_ipv4_address", run_parse4, NULL },
+    { "parse_ipv4_address_inline", run_parse4_inline, NULL },
+    { "parse_ipv6_address", run_parse6, NULL },
+    { "parse_ipv6_address_inline", run_parse6_inline, NULL },
+    { "inet_pton_ipv4", run_pton4, "libc" },
+    { "inet_pton_ipv6", run_pton6, "libc" },
+    { "ip_stream", run_stream, "dfa" },
+    { "is_valid_ipv4_batch", run_ipv4_batch, NULL },
+    { "is_valid_ipv6_batch", run_ipv6_batch, NULL },
+    { "is_valid_ipv4_batch_arrow", run_ipv4_arrow, NULL },
+    { "is_valid_ipv6_batch_arrow", run_ipv6_arrow, NULL },
+    { "ip_scan", run_scan, NULL },
+    { "format_ipv4_address", run_format4, "scalar" },
+    { "inet_ntop_ipv4", run_ntop4, "libc" },
+    { "format_ipv4_batch_arrow", run_format4_arrow, "scalar" },
+    { "format_ipv6_address", run_format6, "scalar" },
+    { "inet_ntop_ipv6", run_ntop6, "libc" },
+    { "format_ipv6_batch_arrow", run_format6_arrow, "scalar" },
+    { "parse_and_classify", run_parse_classify, NULL },
+    { "ip_cache_parse", run_cache_parse, NULL },
+    { "ip_set_contains_ipv4", run_set4, "scalar" },
+    { "ip_set_contains_ipv4_batch", run_set4_batch, NULL },
+    { "ip_set_contains_ipv6_batch", run_set6_batch, "scalar" },
+};
+
+static const struct {
+    const char *name;
+    size_t (*gen)(char *out);
+} bench_corpora[] = {
+    { "ipv4_valid", gen_ipv4 },
+    { "ipv4_skewed", gen_ipv4_skewed },
+    { "ipv6_full", gen_ipv6_full },
+    { "ipv6_compressed", gen_ipv6_compressed },
+    { "ipv6_mapped", gen_ipv6_mapped },
+    { "mostly_invalid", gen_mostly_invalid },
+    { "garbage", gen_garbage },
+};
+
+/**
+ * Returns the current monotonic time in nanoseconds.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Keeps the compiler from discarding the timed calls. */
+static volatile size_t bench_sink;
+
+/**
+ * time_passes - Time repeated passes of one case over a corpus.
+ * @bc: Case to run.
+ * @corpus: Corpus to run it over.
+ * @passes: Number of back-to-back passes.
+ *
+ * Return: elapsed nanoseconds.
+ */
+static uint64_t time_passes(const struct bench_case *bc,
+                            const struct bench_corpus *corpus, size_t passes)
+{
+    uint64_t start = now_ns();
+
+    for (size_t p = 0; p < passes; p++)
+        bench_sink += bc->run(corpus);
+    return now_ns() - start;
+}
+
+/* Output name, perf type and config of each counter read with -p. */
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} bench_events[BENCH_EVENTS] = {
+#ifdef __linux__
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    /* Software event: nanoseconds on the CPU, even without a PMU. */
+    { "task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+#else
+    { "cycles", 0, 0 },
+    { "instructions", 0, 0 },
+    { "branch_misses", 0, 0 },
+    { "l1d_misses", 0, 0 },
+    { "task_clock_ns", 0, 0 },
+#endif
+};
+
+/*
+ * One perf event group counting the calling thread in user space. Events
+ * the machine cannot count, such as hardware events in most virtual
+ * machines, are left out and reported as missing.
+ */
+struct bench_counters {
+    int leader;                 /* Group leader's descriptor, or -1 */
+    int fds[BENCH_EVENTS];      /* -1 where the event could not be opened */
+    int slot[BENCH_EVENTS];     /* Position of each event in a group read */
+    int opened;
+};
+
+/**
+ * counters_open - Open a group with every event the machine supports.
+ * @pc: Group to set up.
+ *
+ * Return: true if at least one event was opened; otherwise false with a
+ * message printed for each event.
+ */
+static bool counters_open(struct bench_counters *pc)
+{
+    pc->leader = -1;
+    pc->opened = 0;
+    for (int e = 0; e < BENCH_EVENTS; e++) {
+        pc->fds[e] = -1;
+        pc->slot[e] = -1;
+#ifdef __linux__
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = bench_events[e].type;
+        attr.config = bench_events[e].config;
+        attr.disabled = pc->leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP |
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+                              pc->leader, 0);
+
+        if (fd < 0) {
+            fprintf(stderr, "%s: %s\n", bench_events[e].name,
+                    strerror(errno));
+            continue;
+        }
+        if (pc->leader < 0)
+            pc->leader = fd;
+        pc->fds[e] = fd;
+        pc->slot[e] = pc->opened++;
+#endif
+    }
+    return pc->leader >= 0;
+}
+
+/**
+ * counters_close - Close every event of a group.
+ * @pc: Group from counters_open().
+ */
+static void counters_close(struct bench_counters *pc)
+{
+    for (int e = 0; e < BENCH_EVENTS; e++)
+        if (pc->fds[e] >= 0)
+            close(pc->fds[e]);
+}
+
+/**
+ * count_passes - Count events over repeated passes of one case.
+ * @pc: Open group.
+ * @bc: Case to run.
+ * @corpus: Corpus to run it over.
+ * @passes: Number of back-to-back passes.
+ * @values: Output count per event, scaled up if the kernel multiplexed the
+ *          group; untouched for events that are not open.
+ *
+ * Return: true on success, false if the counters could not be read.
+ */
+static bool count_passes(struct bench_counters *pc,
+                         const struct bench_case *bc,
+                         const struct bench_corpus *corpus, size_t passes,
+                         double values[BENCH_EVENTS])
+{
+#ifdef __linux__
+    uint64_t buf[3 + BENCH_EVENTS];
+
+    ioctl(pc->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pc->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    for (size_t p = 0; p < passes; p++)
+        bench_sink += bc->run(corpus);
+    ioctl(pc->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    /* { nr, time_enabled, time_running, value[nr] } */
+    ssize_t want = (ssize_t)((3 + (size_t)pc->opened) * sizeof(uint64_t));
+
+    if (read(pc->leader, buf, sizeof(buf)) != want || buf[2] == 0)
+        return false;
+
+    double scale = (double)buf[1] / (double)buf[2];
+
+    for (int e = 0; e < BENCH_EVENTS; e++)
+        if (pc->slot[e] >= 0)
+            values[e] = (double)buf[3 + pc->slot[e]] * scale;
+    return true;
+#else
+    (void)pc;
+    (void)bc;
+    (void)corpus;
+    (void)passes;
+    (void)values;
+    return false;
+#endif
+}
+
+/* How to run the cases and print their records. */
+struct bench_options {
+    long rounds;
+    enum bench_format format;
+    struct bench_counters *counters;    /* NULL unless -p */
+};
+
+/**
+ * print_header - Start the output.
+ * @opts: Run options.
+ * @count: Addresses per corpus.
+ */
+static void print_header(const struct bench_options *opts, long count)
+{
+    if (opts->format == BENCH_CSV) {
+        printf("corpus,function,kernel,accepted,ns_per_address,"
+               "addresses_per_second");
+        for (int e = 0; opts->counters != NULL && e < BENCH_EVENTS; e++)
+            printf(",%s_per_address", bench_events[e].name);
+        printf("\n");
+        return;
+    }
+    printf("{\n  \"benchmark\": \"%s\",\n  \"addresses\": %ld,\n"
+           "  \"rounds\": %ld,\n  \"simd\": \"%s\",\n  \"results\": [",
+           opts->counters != NULL ? "counters" : "throughput", count,
+           opts->rounds, ip_validator_simd_name());
+}
+
+/**
+ * bench_run - Calibrate and time one case, then print its record.
+ * @bc: Case to run.
+ * @corpus: Corpus to run it over.
+ * @opts: Run options.
+ * @kernel: Name of the kernel set in use, for the record.
+ * @first: true for the first record, which is not preceded by a comma.
+ */
+static void bench_run(const struct bench_case *bc,
+                      const struct bench_corpus *corpus,
+                      const struct bench_options *opts, const char *kernel,
+                      bool first)
+{
+    size_t passes = 1;
+    uint64_t best;
+    double counts[BENCH_EVENTS], best_counts[BENCH_EVENTS];
+    bool have_counts = false;
+
+    /* Warm up caches and the branch predictor while calibrating. */
+    while ((best = time_passes(bc, corpus, passes)) < BENCH_MIN_ROUND_NS &&
+           passes < ((size_t)1 << 20))
+        passes *= 2;
+    for (long r = 0; r < opts->rounds; r++) {
+        uint64_t ns = time_passes(bc, corpus, passes);
+
+        if (ns < best)
+            best = ns;
+    }
+    /* Counted rounds are separate, so the timings exclude the ioctls. */
+    for (long r = 0; opts->counters != NULL && r < opts->rounds; r++) {
+        int lead = 0;
+
+        if (!count_passes(opts->counters, bc, corpus, passes, counts))
+            continue;
+        while (opts->counters->slot[lead] != 0)
+            lead++;
+        if (!have_counts || counts[lead] < best_counts[lead])
+            memcpy(best_counts, counts, sizeof(counts));
+        have_counts = true;
+    }
+
+    double addresses = (double)corpus->count * (double)passes;
+    double ns_per_address = (double)best / addresses;
+    size_t accepted = bc->run(corpus);
+
+    if (opts->format == BENCH_CSV) {
+        printf("%s,%s,%s,%zu,%.3f,%.0f", corpus->name, bc->name, kernel,
+               accepted, ns_per_address, 1e9 / ns_per_address);
+        for (int e = 0; opts->counters != NULL && e < BENCH_EVENTS; e++) {
+            if (have_counts && opts->counters->slot[e] >= 0)
+                printf(",%.3f", best_counts[e] / addresses);
+            else
+                printf(",");
+        }
+        printf("\n");
+        return;
+    }
+
+    printf("%s\n    {\"corpus\": \"%s\", \"function\": \"%s\", "
+           "\"kernel\": \"%s\", \"accepted\": %zu, "
+           "\"ns_per_address\": %.3f, \"addresses_per_second\": %.0f",
+           first ? "" : ",", corpus->name, bc->name, kernel, accepted,
+           ns_per_address, 1e9 / ns_per_address);
+    for (int e = 0; opts->counters != NULL && e < BENCH_EVENTS; e++) {
+        if (have_counts && opts->counters->slot[e] >= 0)
+            printf(", \"%s_per_address\": %.3f", bench_events[e].name,
+                   best_counts[e] / addresses);
+        else
+            printf(", \"%s_per_address\": null", bench_events[e].name);
+    }
+    printf("}");
+}
+
+/*
+ * One HDR histogram of call latencies in timer ticks. Values below
+ * 2 * BENCH_HIST_HALF are counted exactly; larger ones keep their top
+ * log2(BENCH_HIST_HALF) + 1 bits, so every bucket is within 1.6% of the
+ * values it holds, from one tick to 2^64.
+ */
+struct bench_hist {
+    uint64_t counts[BENCH_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+};
+
+/**
+ * hist_index - Find the bucket of a value.
+ * @v: Value in ticks.
+ *
+ * Return: bucket index.
+ */
+static size_t hist_index(uint64_t v)
+{
+    if (v < 2 * BENCH_HIST_HALF)
+        return (size_t)v;
+
+    /* Shift @v down until it is in [BENCH_HIST_HALF, 2 * BENCH_HIST_HALF). */
+    unsigned int shift = 63 - (unsigned int)__builtin_clzll(v) -
+        BENCH_HIST_BITS;
+
+    return (size_t)shift * BENCH_HIST_HALF + (size_t)(v >> shift);
+}
+
+/**
+ * hist_value - Give the largest value a bucket holds.
+ * @index: Bucket index.
+ *
+ * Return: value in ticks.
+ */
+static uint64_t hist_value(size_t index)
+{
+    if (index < 2 * BENCH_HIST_HALF)
+        return index;
+
+    unsigned int shift = (unsigned int)(index / BENCH_HIST_HALF) - 1;
+    uint64_t top = index % BENCH_HIST_HALF + BENCH_HIST_HALF;
+
+    return ((top + 1) << shift) - 1;
+}
+
+/**
+ * hist_record - Add one value to a histogram.
+ * @h: Histogram.
+ * @v: Value in ticks.
+ */
+static void hist_record(struct bench_hist *h, uint64_t v)
+{
+    h->counts[hist_index(v)]++;
+    h->total++;
+    if (v > h->max)
+        h->max = v;
+}
+
+/**
+ * hist_percentile - Read a percentile from a histogram.
+ * @h: Histogram with at least one value.
+ * @q: Fraction of the values, such as 0.99.
+ *
+ * Return: value in ticks that at least @q of the recorded values do not
+ * exceed, rounded up to the end of its bucket.
+ */
+static uint64_t hist_percentile(const struct bench_hist *h, double q)
+{
+    uint64_t rank = (uint64_t)(q * (double)h->total + 0.999999);
+    uint64_t seen = 0;
+
+    if (rank == 0)
+        rank = 1;
+    for (size_t i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank)
+            return hist_value(i) < h->max ? hist_value(i) : h->max;
+    }
+    return h->max;
+}
+
+/*
+ * Per-call timestamps. On x86 the time-stamp counter is read between
+ * fences, so the timed call can neither start early nor finish late;
+ * elsewhere clock_gettime() is used, and its ticks are nanoseconds.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_TIMER "rdtsc"
+
+static inline uint64_t tick_start(void)
+{
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+
+    _mm_lfence();
+    return t;
+}
+
+static inline uint64_t tick_end(void)
+{
+    unsigned int aux;
+    uint64_t t = __rdtscp(&aux);
+
+    _mm_lfence();
+    return t;
+}
+#else
+#define BENCH_TIMER "clock_gettime"
+
+static inline uint64_t tick_start(void)
+{
+    return now_ns();
+}
+
+static inline uint64_t tick_end(void)
+{
+    return now_ns();
+}
+#endif
+
+/* Timer properties measured once before the latency classes run. */
+struct bench_timer {
+    double ticks_per_ns;
+    uint64_t overhead;          /* Ticks of an empty start/end pair */
+};
+
+/**
+ * timer_calibrate - Measure the tick rate and the cost of reading it.
+ * @timer: Output properties.
+ */
+static void timer_calibrate(struct bench_timer *timer)
+{
+    uint64_t ns0 = now_ns(), t0 = tick_start();
+
+    while (now_ns() - ns0 < BENCH_MIN_ROUND_NS)
+        ;
+
+    uint64_t t1 = tick_end(), ns1 = now_ns();
+
+    timer->ticks_per_ns = (double)(t1 - t0) / (double)(ns1 - ns0);
+    timer->overhead = UINT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t start = tick_start();
+        uint64_t d = tick_end() - start;
+
+        if (d < timer->overhead)
+            timer->overhead = d;
+    }
+}
+
+/* Input classes of -L mode, named after the groups in demo.c's suites. */
+static const struct {
+    const char *name;
+    int family;                 /* Parser the class is timed with */
+    size_t (*gen)(char *out);
+} bench_latency_classes[BENCH_LATENCY_CLASSES] = {
+    { "ipv4_valid", AF_INET, gen_ipv4 },
+    { "ipv4_invalid", AF_INET, gen_ipv4_invalid },
+    { "ipv4_adversarial", AF_INET, gen_ipv4_adversarial },
+    { "ipv6_valid", AF_INET6, gen_ipv6_valid },
+    { "ipv6_invalid", AF_INET6, gen_ipv6_invalid },
+    { "ipv6_adversarial", AF_INET6, gen_ipv6_adversarial },
+    { "long_garbage", AF_INET6, gen_long_garbage },
+    { "many_colons", AF_INET6, gen_many_colons },
+};
+
+/* Percentiles of one class, in nanoseconds, from one round. */
+struct bench_latency {
+    const char *corpus;
+    const char *function;
+    const char *kernel;
+    uint64_t samples;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+};
+
+/**
+ * time_calls - Time single parser calls into a histogram.
+ * @corpus: Inputs, used in turn.
+ * @family: AF_INET or AF_INET6, the parser to call.
+ * @timer: Calibrated timer; its overhead is taken off every sample.
+ * @samples: Number of calls to time.
+ * @h: Histogram to fill; cleared first.
+ */
+static void time_calls(const struct bench_corpus *corpus, int family,
+                       const struct bench_timer *timer, size_t samples,
+                       struct bench_hist *h)
+{
+    struct in_addr addr4;
+    struct in6_addr addr6;
+
+    memset(h, 0, sizeof(*h));
+    for (size_t s = 0; s < samples; s++) {
+        size_t i = s % corpus->count;
+        const char *buf = corpus->bufs[i];
+        size_t len = corpus->lens[i];
+        uint64_t start, end;
+        bool ok;
+
+        if (family == AF_INET) {
+            start = tick_start();
+            ok = parse_ipv4_address(buf, len, &addr4);
+            end = tick_end();
+        } else {
+            start = tick_start();
+            ok = parse_ipv6_address(buf, len, &addr6);
+            end = tick_end();
+        }
+        bench_sink += ok;
+        end -= start;
+        hist_record(h, end > timer->overhead ? end - timer->overhead : 0);
+    }
+}
+
+/* p99 of one record of a stored baseline. */
+struct bench_baseline {
+    char corpus[32];
+    char function[32];
+    char kernel[16];
+    double p99;
+};
+
+/* State of one -L run. */
+struct bench_latency_run {
+    const struct bench_options *opts;
+    struct bench_timer timer;
+    size_t samples;             /* Timed calls per round */
+    struct bench_hist *hist;    /* Scratch histogram */
+    struct bench_latency *rounds;       /* Scratch record per round */
+    struct bench_baseline baseline[BENCH_BASELINE_MAX];
+    size_t baseline_count;
+    bool check;                 /* -b given */
+    double threshold;           /* Allowed p99 growth, in percent */
+    size_t records;             /* Records printed so far */
+    bool regressed;
+};
+
+/**
+ * latency_compare - Order round records by p99, for qsort().
+ * @a: First record.
+ * @b: Second record.
+ *
+ * Return: negative, zero or positive as @a's p99 is below, equal to or
+ * above @b's.
+ */
+static int latency_compare(const void *a, const void *b)
+{
+    double pa = ((const struct bench_latency *)a)->p99;
+    double pb = ((const struct bench_latency *)b)->p99;
+
+    return (pa > pb) - (pa < pb);
+}
+
+/**
+ * latency_measure - Time one class over several rounds.
+ * @lr: Run state.
+ * @corpus: Inputs of the class.
+ * @family: AF_INET or AF_INET6.
+ * @kernel: Name of the kernel set in use, for the record.
+ * @res: Output percentiles of the round with the median p99.
+ *
+ * Unlike throughput, where the fastest round is closest to the true cost,
+ * the lowest p99 is a lucky one: a baseline recorded from it would fail
+ * most later checks. The median round is reported instead.
+ */
+static void latency_measure(struct bench_latency_run *lr,
+                            const struct bench_corpus *corpus, int family,
+                            const char *kernel, struct bench_latency *res)
+{
+    double scale = 1.0 / lr->timer.ticks_per_ns;
+    struct bench_hist *h = lr->hist;
+
+    /* Warm up caches and the branch predictor. */
+    time_calls(corpus, family, &lr->timer, lr->samples, h);
+    for (long r = 0; r < lr->opts->rounds; r++) {
+        struct bench_latency *round = &lr->rounds[r];
+
+        time_calls(corpus, family, &lr->timer, lr->samples, h);
+        round->corpus = corpus->name;
+        round->function = family == AF_INET ? "parse_ipv4_address" :
+            "parse_ipv6_address";
+        round->kernel = kernel;
+        round->samples = h->total;
+        round->p50 = (double)hist_percentile(h, 0.5) * scale;
+        round->p90 = (double)hist_percentile(h, 0.9) * scale;
+        round->p99 = (double)hist_percentile(h, 0.99) * scale;
+        round->p999 = (double)hist_percentile(h, 0.999) * scale;
+        round->max = (double)h->max * scale;
+    }
+    qsort(lr->rounds, (size_t)lr->opts->rounds, sizeof(*lr->rounds),
+          latency_compare);
+    *res = lr->rounds[lr->opts->rounds / 2];
+}
+
+/**
+ * latency_print - Print one latency record.
+ * @lr: Run state.
+ * @res: Record to print.
+ */
+static void latency_print(struct bench_latency_run *lr,
+                          const struct bench_latency *res)
+{
+    if (lr->opts->format == BENCH_CSV) {
+        printf("%s,%s,%s,%" PRIu64 ",%.1f,%.1f,%.1f,%.1f,%.1f\n",
+               res->corpus, res->function, res->kernel, res->samples,
+               res->p50, res->p90, res->p99, res->p999, res->max);
+    } else {
+        printf("%s\n    {\"corpus\": \"%s\", \"function\": \"%s\", "
+               "\"kernel\": \"%s\", \"samples\": %" PRIu64 ", "
+               "\"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, "
+               "\"p999_ns\": %.1f, \"max_ns\": %.1f}",
+               lr->records == 0 ? "" : ",", res->corpus, res->function,
+               res->kernel, res->samples, res->p50, res->p90, res->p99,
+               res->p999, res->max);
+    }
+    lr->records++;
+}
+
+/**
+ * baseline_load - Read the p99 column of a stored baseline.
+ * @lr: Run state; the baseline rows are filled in.
+ * @path: CSV file written by "ipbench -L -f csv".
+ *
+ * Return: true on success, false if @path cannot be read.
+ */
+static bool baseline_load(struct bench_latency_run *lr, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[256];
+
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    lr->baseline_count = 0;
+    while (fgets(line, sizeof(line), f) != NULL &&
+           lr->baseline_count < BENCH_BASELINE_MAX) {
+        struct bench_baseline *row = &lr->baseline[lr->baseline_count];
+        char *field[9], *save = NULL;
+        int n = 0;
+
+        for (char *tok = strtok_r(line, ",\n", &save); tok != NULL && n < 9;
+             tok = strtok_r(NULL, ",\n", &save))
+            field[n++] = tok;
+        /* corpus,function,kernel,samples,p50_ns,p90_ns,p99_ns,... */
+        if (n != 9 || strcmp(field[0], "corpus") == 0)
+            continue;
+        snprintf(row->corpus, sizeof(row->corpus), "%s", field[0]);
+        snprintf(row->function, sizeof(row->function), "%s", field[1]);
+        snprintf(row->kernel, sizeof(row->kernel), "%s", field[2]);
+        row->p99 = strtod(field[6], NULL);
+        lr->baseline_count++;
+    }
+    fclose(f);
+    return true;
+}
+
+/**
+ * baseline_limit - Find the largest p99 a record may have.
+ * @lr: Run state with a loaded baseline.
+ * @res: Record to look up by corpus, function and kernel.
+ *
+ * Return: the baseline p99 grown by the threshold, at least
+ * BENCH_LATENCY_FLOOR_NS, or a negative value if the baseline has no such
+ * record.
+ */
+static double baseline_limit(const struct bench_latency_run *lr,
+                             const struct bench_latency *res)
+{
+    for (size_t i = 0; i < lr->baseline_count; i++) {
+        const struct bench_baseline *row = &lr->baseline[i];
+
+        if (strcmp(row->corpus, res->corpus) == 0 &&
+            strcmp(row->function, res->function) == 0 &&
+            strcmp(row->kernel, res->kernel) == 0) {
+            double limit = row->p99 * (1.0 + lr->threshold / 100.0);
+
+            return limit > BENCH_LATENCY_FLOOR_NS ? limit :
+                BENCH_LATENCY_FLOOR_NS;
+        }
+    }
+    return -1.0;
+}
+
+/**
+ * latency_class - Measure, check and print one class with one kernel set.
+ * @lr: Run state.
+ * @corpus: Inputs of the class.
+ * @family: AF_INET or AF_INET6.
+ * @kernel: Name of the kernel set in use, for the record.
+ *
+ * When checking against a baseline, a p99 over its limit is measured again
+ * up to BENCH_LATENCY_RETRIES times, after a pause, and the lowest kept, so
+ * that a burst of noise from other tenants of the machine does not fail the
+ * check; a real regression shows up on every attempt.
+ */
+static void latency_class(struct bench_latency_run *lr,
+                          const struct bench_corpus *corpus, int family,
+                          const char *kernel)
+{
+    struct bench_latency res, retry;
+    double limit = -1.0;
+
+    latency_measure(lr, corpus, family, kernel, &res);
+    if (lr->check) {
+        limit = baseline_limit(lr, &res);
+        for (int t = 0; limit >= 0 && res.p99 > limit &&
+             t < BENCH_LATENCY_RETRIES; t++) {
+            struct timespec pause = { 0, BENCH_LATENCY_PAUSE_NS };
+
+            nanosleep(&pause, NULL);
+            latency_measure(lr, corpus, family, kernel, &retry);
+            if (retry.p99 < res.p99)
+                res = retry;
+        }
+    }
+    latency_print(lr, &res);
+
+    if (!lr->check)
+        return;
+    if (limit < 0) {
+        fprintf(stderr, "no baseline for %s %s %s\n", res.corpus,
+                res.function, res.kernel);
+        lr->regressed = true;
+    } else if (res.p99 > limit) {
+        fprintf(stderr, "p99 regression: %s %s %s %.1f ns, limit %.1f ns\n",
+                res.corpus, res.function, res.kernel, res.p99, limit);
+        lr->regressed = true;
+    }
+}
+
+/**
+ * latency_main - Run the latency mode.
+ * @opts: Run options.
+ * @samples: Timed calls per class and round.
+ * @baseline: CSV baseline to check against, or NULL.
+ * @threshold: Allowed p99 growth in percent.
+ *
+ * Return: process exit status; 1 on a p99 regression or an error.
+ */
+static int latency_main(const struct bench_options *opts, size_t samples,
+                        const char *baseline, double threshold)
+{
+    struct bench_latency_run *lr = calloc(1, sizeof(*lr));
+    const char *simd = ip_validator_simd_name();
+
+    if (lr == NULL || (lr->hist = malloc(sizeof(*lr->hist))) == NULL ||
+        (lr->rounds = malloc((size_t)opts->rounds *
+                             sizeof(*lr->rounds))) == NULL) {
+        perror("malloc");
+        return 1;
+    }
+    lr->opts = opts;
+    lr->samples = samples;
+    lr->check = baseline != NULL;
+    lr->threshold = threshold;
+    if (lr->check && !baseline_load(lr, baseline))
+        return 1;
+    timer_calibrate(&lr->timer);
+
+    if (opts->format == BENCH_CSV) {
+        printf("corpus,function,kernel,samples,p50_ns,p90_ns,p99_ns,"
+               "p999_ns,max_ns\n");
+    } else {
+        printf("{\n  \"benchmark\": \"latency\",\n  \"samples\": %zu,\n"
+               "  \"rounds\": %ld,\n  \"simd\": \"%s\",\n"
+               "  \"timer\": \"%s\",\n  \"timer_overhead_ns\": %.1f,\n"
+               "  \"results\": [", samples, opts->rounds, simd, BENCH_TIMER,
+               (double)lr->timer.overhead / lr->timer.ticks_per_ns);
+    }
+    for (size_t c = 0; c < BENCH_LATENCY_CLASSES; c++) {
+        struct bench_corpus corpus;
+        int family = bench_latency_classes[c].family;
+
+        memset(&corpus, 0, sizeof(corpus));
+        corpus.name = bench_latency_classes[c].name;
+        if (!corpus_build(&corpus, BENCH_LATENCY_ENTRIES,
+                          bench_latency_classes[c].gen)) {
+            perror("malloc");
+            return 1;
+        }
+        latency_class(lr, &corpus, family, ip_validator_use_simd(true));
+        if (strcmp(simd, "scalar") != 0)
+            latency_class(lr, &corpus, family, ip_validator_use_simd(false));
+        ip_validator_use_simd(true);
+        corpus_free(&corpus);
+    }
+    if (opts->format == BENCH_JSON)
+        printf("\n  ]\n}\n");
+    fflush(stdout);
+
+    int status = lr->regressed ? 1 : 0;
+
+    free(lr->rounds);
+    free(lr->hist);
+    free(lr);
+    return status;
+}
+
+/**
+ * Explains command-line options for the benchmark.
+ */
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [-n <addresses>] [-r <rounds>] [-p] [-f json|csv]\n",
+           prog);
+    printf("       %s -L [-n <calls>] [-r <rounds>] [-f json|csv]\n"
+           "          [-b <baseline.csv> [-t <percent>]]\n", prog);
+    printf("       Times the validators, the formatters and their libc\n");
+    printf("       counterparts over synthetic corpora and prints the\n");
+    printf("       results as JSON or CSV.\n");
+    printf("       -p     also report hardware counters per address\n");
+    printf("       -L     time single parser calls per input class and\n");
+    printf("              report p50/p90/p99/p99.9 latencies instead\n");
+    printf("       -b     exit 1 if a p99 exceeds the baseline's by more\n");
+    printf("              than -t percent (default: %.0f)\n",
+           BENCH_DEFAULT_THRESHOLD);
+}
+
+int main(int argc, char *argv[])
+{
+    long count = BENCH_DEFAULT_COUNT;
+    long rounds = BENCH_DEFAULT_ROUNDS;
+    struct bench_options opts;
+    struct bench_counters counters;
+    bool use_counters = false, latency = false;
+    const char *baseline = NULL;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    int opt;
+
+    memset(&opts, 0, sizeof(opts));
+    while ((opt = getopt(argc, argv, "n:r:pf:Lb:t:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            count = strtol(optarg, NULL, 10);
+            break;
+        case 'r':
+            rounds = strtol(optarg, NULL, 10);
+            break;
+        case 'p':
+            use_counters = true;
+            break;
+        case 'L':
+            latency = true;
+            break;
+        case 'b':
+            baseline = optarg;
+            break;
+        case 't':
+            threshold = strtod(optarg, NULL);
+            break;
+        case 'f':
+            if (strcmp(optarg, "csv") == 0) {
+                opts.format = BENCH_CSV;
+            } else if (strcmp(optarg, "json") != 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc || count < 1 || count > INT32_MAX / BENCH_MAX_ENTRY ||
+        rounds < 1 || threshold < 0 || (latency && use_counters) ||
+        (baseline != NULL && !latency)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char *simd = ip_validator_simd_name();
+    bool first = true;
+
+    opts.rounds = rounds;
+    if (latency)
+        return latency_main(&opts, (size_t)count, baseline, threshold);
+    if (use_counters) {
+        if (!counters_open(&counters)) {
+            fprintf(stderr, "no performance counters available\n");
+            return 1;
+        }
+        opts.counters = &counters;
+    }
+
+    if (!ip_cache_init(&bench_cache, BENCH_CACHE_BYTES, 0) ||
+        !bench_set_build()) {
+        perror("malloc");
+        return 1;
+    }
+
+    print_header(&opts, count);
+    for (size_t c = 0; c < sizeof(bench_corpora) / sizeof(bench_corpora[0]);
+         c++) {
+        struct bench_corpus corpus;
+
+        memset(&corpus, 0, sizeof(corpus));
+        corpus.name = bench_corpora[c].name;
+        if (!corpus_build(&corpus, (size_t)count, bench_corpora[c].gen)) {
+            perror("malloc");
+            return 1;
+        }
+        for (size_t b = 0; b < sizeof(bench_cases) / sizeof(bench_cases[0]);
+             b++) {
+            const struct bench_case *bc = &bench_cases[b];
+
+            if (bc->kernel != NULL) {
+                bench_run(bc, &corpus, &opts, bc->kernel, first);
+                first = false;
+                continue;
+            }
+            bench_run(bc, &corpus, &opts, ip_validator_use_simd(true),
+                      first);
+            first = false;
+            if (strcmp(simd, "scalar") != 0)
+                bench_run(bc, &corpus, &opts, ip_validator_use_simd(false),
+                          false);
+        }
+        ip_validator_use_simd(true);
+        corpus_free(&corpus);
+    }
+    if (opts.format == BENCH_JSON)
+        printf("\n  ]\n}\n");
+    if (opts.counters != NULL)
+        counters_close(opts.counters);
+    ip_cache_free(&bench_cache);
+    ip_set_free(&bench_set);
+    return 0;
+}
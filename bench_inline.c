@@ -0,0 +1,35 @@
+/*
+ * Benchmark loops compiled with IP_VALIDATOR_INLINE, so ipbench can time the
+ * inline definitions next to the same loops calling into the library.
+ */
+
+#define IP_VALIDATOR_INLINE
+#include "ip_validator.h"
+
+#include <stddef.h>
+
+size_t bench_inline_ipv4(const char *const *bufs, const size_t *lens,
+                         size_t count)
+{
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        struct in_addr addr;
+
+        accepted += parse_ipv4_address(bufs[i], lens[i], &addr);
+    }
+    return accepted;
+}
+
+size_t bench_inline_ipv6(const char *const *bufs, const size_t *lens,
+                         size_t count)
+{
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        struct in6_addr addr;
+
+        accepted += parse_ipv6_address(bufs[i], lens[i], &addr);
+    }
+    return accepted;
+}
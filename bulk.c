@@ -0,0 +1,1390 @@
+/*
+ * Bulk validator: checks every line of a newline-delimited file on a pool of
+ * worker threads and reports per-line verdicts or summary counts.
+ *
+ * The input is cut into chunks on line boundaries. Each worker owns a
+ * contiguous range of chunk indices and takes chunks from its front; a worker
+ * that runs dry steals single chunks from the back of another worker's range.
+ * Ranges are packed head/tail pairs updated with compare-and-swap, so the
+ * scheduler never takes a lock.
+ *
+ * Regular files are mapped read-only and every line is handed to the
+ * length-delimited validators as a slice of the mapping; lines are found
+ * with memchr, which libc implements with vector instructions.
+ *
+ * With -u a regular file is read through io_uring instead, for inputs on
+ * slow or remote storage where faulting a mapping in stalls the workers: a
+ * ring of registered buffers keeps reads in flight while the calling thread
+ * validates the buffer that arrived first, and per-line verdicts are
+ * written back through the same ring.
+ *
+ * gzip and zstd inputs are decompressed in-process, a window at a time.
+ * Lines inside a window are validated as slices of it; a line cut by the
+ * end of a window is fed to an ip_stream context, so no line is copied. A
+ * zstd file with several frames is cut into chunks on frame boundaries and
+ * the frames are decoded in parallel; the partial lines at the edges of
+ * each chunk are joined in input order once it is done.
+ */
+
+/* madvise(MADV_HUGEPAGE) is outside POSIX. */
+#define _DEFAULT_SOURCE
+
+#include "bulk_decode.h"
+#include "bulk_uring.h"
+#include "ip_validator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>             /* getopt */
+
+/* Default chunk size in KiB; a chunk always ends on a line boundary. */
+#define BULK_DEFAULT_CHUNK_KIB 1024
+
+/* Read buffers of the io_uring pipeline; all but one are in flight. */
+#define BULK_URING_DEPTH 8
+
+/* Completion tag of the pipeline's output write; reads use buffer indices. */
+#define BULK_URING_WRITE BULK_URING_DEPTH
+
+/*
+ * Longest line tail carried from one pipeline buffer to the next. Longer
+ * lines are never addresses, so only their length is tracked.
+ */
+#define BULK_CARRY_MAX 256
+
+/* Decompressed bytes validated at a time, per worker. */
+#define BULK_WINDOW_SIZE (256 * 1024)
+
+/* Per-line verdicts and summary counters. */
+enum bulk_verdict {
+    BULK_IPV4,
+    BULK_IPV6,
+    BULK_INVALID,
+    BULK_VERDICTS
+};
+
+/* Output byte for each verdict in per-line mode. */
+static const char bulk_verdict_text[BULK_VERDICTS] = { '4', '6', '-' };
+
+/* Chunk index range owned by one worker, kept on its own cache line. */
+struct bulk_worker {
+    _Alignas(64) _Atomic uint64_t range;    /* head << 32 | tail */
+    unsigned long long counts[BULK_VERDICTS];
+    struct bulk_job *job;
+    int id;
+    pthread_t thread;
+    char *window;               /* Compressed input: decoded text */
+    struct bulk_decoder dec;    /* Compressed input: kept across chunks */
+};
+
+/* A per-line output buffer and its capacity. */
+struct bulk_buf {
+    char *text;
+    size_t cap;
+};
+
+/* Output of one chunk in per-line mode, handed to the writer in order. */
+struct bulk_output {
+    struct bulk_buf buf;
+    size_t len;
+    bool done;
+};
+
+/* A line validated as its bytes arrive; see line_feed(). */
+struct bulk_line {
+    struct ip_stream ctx;
+    size_t len;                 /* Bytes seen, including a held '\r' */
+    bool cr;                    /* Last byte was '\r', held back from ctx */
+    bool lost;                  /* Bytes were dropped; the line is invalid */
+};
+
+/* Partial lines at the edges of a chunk of compressed input. */
+struct bulk_seam {
+    char head[BULK_CARRY_MAX];  /* Text before the chunk's first newline */
+    size_t head_len;
+    bool head_long;             /* The text was longer than head[] */
+    bool newline;               /* The chunk has a newline at all */
+    struct bulk_line tail;      /* Text after the last newline */
+};
+
+/* The input bytes, either a read-only file mapping or a heap buffer. */
+struct bulk_input {
+    const char *data;
+    size_t size;
+    void *base;
+    bool mapped;
+};
+
+/* Shared, read-only description of the run plus the ordered-output state. */
+struct bulk_job {
+    const char *data;
+    size_t size;
+    size_t *bounds;             /* nchunks + 1 chunk start offsets */
+    size_t nchunks;
+    int family;                 /* 0 for either, else 4 or 6 */
+    bool per_line;
+    bool mapped;                /* data is a file mapping */
+    long page_size;             /* Set before the workers start */
+    enum bulk_format format;    /* Compression of data */
+    struct bulk_seam *seams;    /* Per chunk, for compressed data only */
+    unsigned long long seam_counts[BULK_VERDICTS];  /* Lines across chunks */
+    struct bulk_worker *workers;
+    int nworkers;
+    struct bulk_output *outputs;
+    struct bulk_buf *spare;     /* Written buffers, for reuse by workers */
+    size_t nspare;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+/**
+ * classify_line - Validate one line according to the requested family.
+ * @line: Start of the line, without its newline.
+ * @len: Length of the line.
+ * @family: 0 to accept either family, 4 or 6 to accept only that one.
+ *
+ * Return: verdict for the line.
+ */
+static enum bulk_verdict classify_line(const char *line, size_t len,
+                                       int family)
+{
+    if (len > 0 && line[len - 1] == '\r')
+        len--;
+    if (family != 6 && is_valid_ipv4_address_len(line, len))
+        return BULK_IPV4;
+    if (family != 4 && is_valid_ipv6_address_len(line, len))
+        return BULK_IPV6;
+    return BULK_INVALID;
+}
+
+/**
+ * line_reset - Start a new line.
+ * @line: Line to reset.
+ * @family: 0 for either family, else 4 or 6.
+ */
+static void line_reset(struct bulk_line *line, int family)
+{
+    ip_stream_init(&line->ctx, family == 4 ? AF_INET :
+                   family == 6 ? AF_INET6 : AF_UNSPEC);
+    line->len = 0;
+    line->cr = false;
+    line->lost = false;
+}
+
+/**
+ * line_feed - Pass the next bytes of a line to its context.
+ * @line: Line in progress.
+ * @buf: Bytes of the line, without a newline.
+ * @len: Number of bytes.
+ *
+ * A trailing '\r' is held back until more of the line arrives, so a line
+ * ending in "\r\n" is judged without it, as classify_line() does.
+ */
+static void line_feed(struct bulk_line *line, const char *buf, size_t len)
+{
+    if (len == 0)
+        return;
+    if (line->cr)
+        ip_stream_feed(&line->ctx, "\r", 1);
+    line->cr = buf[len - 1] == '\r';
+    ip_stream_feed(&line->ctx, buf, len - line->cr);
+    line->len += len;
+}
+
+/**
+ * line_finish - Judge a line fed with line_feed().
+ * @line: Line whose newline or end of input was reached.
+ *
+ * Return: verdict for the line.
+ */
+static enum bulk_verdict line_finish(struct bulk_line *line)
+{
+    struct ip_address addr;
+
+    if (line->lost || !ip_stream_finish(&line->ctx, &addr))
+        return BULK_INVALID;
+    return addr.family == AF_INET ? BULK_IPV4 : BULK_IPV6;
+}
+
+/**
+ * read_stream - Load a non-mappable input (pipe, terminal) into the heap.
+ * @fd: Open descriptor positioned at the start of the data.
+ * @path: Name for error messages.
+ * @in: Input description to fill.
+ *
+ * Return: true on success, false on error (reported).
+ */
+static bool read_stream(int fd, const char *path, struct bulk_input *in)
+{
+    size_t cap = 1 << 20;
+    size_t got = 0;
+    char *data = malloc(cap);
+
+    if (data == NULL) {
+        perror("malloc");
+        return false;
+    }
+    for (;;) {
+        if (got == cap) {
+            char *grown = realloc(data, cap * 2);
+            if (grown == NULL) {
+                perror("realloc");
+                free(data);
+                return false;
+            }
+            data = grown;
+            cap *= 2;
+        }
+
+        ssize_t r = read(fd, data + got, cap - got);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0) {
+            perror(path);
+            free(data);
+            return false;
+        }
+        if (r == 0)
+            break;
+        got += (size_t)r;
+    }
+    in->base = data;
+    in->data = data;
+    in->size = got;
+    in->mapped = false;
+    return true;
+}
+
+/**
+ * open_input - Map the input file read-only, or read it if it cannot be.
+ * @path: File to open.
+ * @in: Input description to fill.
+ *
+ * Regular files are mapped and the workers validate lines as slices of the
+ * mapping, so no byte is copied. The kernel is told the access is
+ * sequential, and asked for transparent huge pages where it supports them
+ * for file mappings.
+ *
+ * Return: true on success, false on error (reported).
+ */
+static bool open_input(const char *path, struct bulk_input *in)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        bool ok = read_stream(fd, path, in);
+        close(fd);
+        return ok;
+    }
+
+    memset(in, 0, sizeof(*in));
+    in->size = (size_t)st.st_size;
+    if (in->size == 0) {
+        close(fd);
+        in->data = "";
+        return true;
+    }
+
+    in->base = mmap(NULL, in->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (in->base == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    in->data = in->base;
+    in->mapped = true;
+
+    posix_madvise(in->base, in->size, POSIX_MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(in->base, in->size, MADV_HUGEPAGE);
+#endif
+    return true;
+}
+
+/**
+ * close_input - Release the mapping or buffer behind the input.
+ * @in: Input description.
+ */
+static void close_input(struct bulk_input *in)
+{
+    if (in->mapped)
+        munmap(in->base, in->size);
+    else
+        free(in->base);
+}
+
+/**
+ * prefetch_chunk - Ask the kernel to start reading a chunk ahead of use.
+ * @job: Run description.
+ * @index: Chunk to prefetch; ignored when out of range.
+ */
+static void prefetch_chunk(struct bulk_job *job, size_t index)
+{
+    if (!job->mapped || index >= job->nchunks)
+        return;
+
+    uintptr_t start = (uintptr_t)(job->data + job->bounds[index]);
+    uintptr_t end = (uintptr_t)(job->data + job->bounds[index + 1]);
+    uintptr_t aligned = start & ~(uintptr_t)(job->page_size - 1);
+
+    posix_madvise((void *)aligned, end - aligned, POSIX_MADV_WILLNEED);
+}
+
+/**
+ * grow_buffer - Make an output buffer hold at least some number of bytes.
+ * @buf: Buffer; its text may move.
+ * @need: Bytes required.
+ */
+static void grow_buffer(struct bulk_buf *buf, size_t need)
+{
+    if (need <= buf->cap)
+        return;
+
+    size_t n = buf->cap ? buf->cap : 4096;
+
+    while (n < need)
+        n *= 2;
+
+    char *p = realloc(buf->text, n);
+
+    if (p == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    buf->text = p;
+    buf->cap = n;
+}
+
+/**
+ * take_buffer - Get an output buffer, reusing one already written out.
+ * @job: Run description.
+ * @need: Bytes required.
+ *
+ * Buffers go back to the job once write_outputs() has written them, so only
+ * as many exist as chunks are in flight, and the run stops allocating once
+ * they have grown to the chunk size.
+ *
+ * Return: buffer of at least @need bytes.
+ */
+static struct bulk_buf take_buffer(struct bulk_job *job, size_t need)
+{
+    struct bulk_buf buf = { NULL, 0 };
+
+    pthread_mutex_lock(&job->lock);
+    if (job->nspare > 0)
+        buf = job->spare[--job->nspare];
+    pthread_mutex_unlock(&job->lock);
+    grow_buffer(&buf, need);
+    return buf;
+}
+
+/**
+ * append_verdict - Add a per-line verdict to a growing output buffer.
+ * @out: Buffer; may be replaced.
+ * @len: Bytes used; advanced.
+ * @v: Verdict.
+ */
+static void append_verdict(struct bulk_buf *out, size_t *len,
+                           enum bulk_verdict v)
+{
+    if (*len + 2 > out->cap)
+        grow_buffer(out, *len + 2);
+    out->text[(*len)++] = bulk_verdict_text[v];
+    out->text[(*len)++] = '\n';
+}
+
+/**
+ * publish_output - Hand a chunk's per-line verdicts to the writer.
+ * @job: Run description.
+ * @index: Chunk index.
+ * @out: Verdict buffer, now owned by the writer.
+ * @len: Bytes of @out used.
+ */
+static void publish_output(struct bulk_job *job, size_t index,
+                           struct bulk_buf out, size_t len)
+{
+    pthread_mutex_lock(&job->lock);
+    job->outputs[index].buf = out;
+    job->outputs[index].len = len;
+    job->outputs[index].done = true;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/**
+ * process_compressed - Decompress one chunk and validate its lines.
+ * @job: Run description.
+ * @worker: Worker whose counters receive the results.
+ * @index: Chunk index; the chunk holds whole frames.
+ *
+ * Lines that start and end inside a window are validated in place. The
+ * text before the chunk's first newline and after its last one belongs to
+ * lines shared with the neighbouring chunks, so it is left in the chunk's
+ * seam for stitch_chunk(). The window and decoder belong to the worker and
+ * serve all of its chunks.
+ */
+static void process_compressed(struct bulk_job *job,
+                               struct bulk_worker *worker, size_t index)
+{
+    struct bulk_seam *seam = &job->seams[index];
+    struct bulk_line *line = &seam->tail;
+    struct bulk_decoder *dec = &worker->dec;
+    const char *data = job->data + job->bounds[index];
+    size_t size = job->bounds[index + 1] - job->bounds[index];
+    struct bulk_buf out = { NULL, 0 };
+    char *window = worker->window;
+    size_t out_len = 0, len;
+    bool in_head = true;
+
+    if (window == NULL) {
+        window = worker->window = malloc(BULK_WINDOW_SIZE);
+        if (window == NULL ||
+            !bulk_decoder_init(dec, job->format, data, size)) {
+            perror("malloc");
+            exit(1);
+        }
+    } else if (!bulk_decoder_restart(dec, data, size)) {
+        fprintf(stderr, "cannot reset the %s decoder\n",
+                bulk_format_name(job->format));
+        exit(1);
+    }
+    if (job->per_line)
+        out = take_buffer(job, 0);
+    line_reset(line, job->family);
+
+    for (;;) {
+        if (!bulk_decode(dec, window, BULK_WINDOW_SIZE, &len)) {
+            fprintf(stderr, "damaged %s data in chunk %zu\n",
+                    bulk_format_name(job->format), index);
+            exit(1);
+        }
+        if (len == 0)
+            break;
+
+        const char *p = window;
+        const char *end = window + len;
+
+        while (p < end) {
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            const char *stop = nl != NULL ? nl : end;
+            enum bulk_verdict v;
+
+            if (in_head) {
+                size_t n = (size_t)(stop - p);
+
+                if (n > BULK_CARRY_MAX - seam->head_len) {
+                    n = BULK_CARRY_MAX - seam->head_len;
+                    seam->head_long = true;
+                }
+                memcpy(seam->head + seam->head_len, p, n);
+                seam->head_len += n;
+                if (nl == NULL)
+                    break;
+                in_head = false;
+                seam->newline = true;
+                p = nl + 1;
+                continue;
+            }
+            if (nl == NULL) {
+                /* The line goes on in the next window. */
+                line_feed(line, p, (size_t)(end - p));
+                break;
+            }
+            if (line->len > 0) {
+                line_feed(line, p, (size_t)(nl - p));
+                v = line_finish(line);
+                line_reset(line, job->family);
+            } else {
+                v = classify_line(p, (size_t)(nl - p), job->family);
+            }
+            worker->counts[v]++;
+            if (job->per_line)
+                append_verdict(&out, &out_len, v);
+            p = nl + 1;
+        }
+    }
+    if (job->per_line)
+        publish_output(job, index, out, out_len);
+}
+
+/**
+ * process_chunk - Validate every line of one chunk.
+ * @job: Run description.
+ * @worker: Worker whose counters receive the results.
+ * @index: Chunk index.
+ */
+static void process_chunk(struct bulk_job *job, struct bulk_worker *worker,
+                          size_t index)
+{
+    const char *p = job->data + job->bounds[index];
+    const char *end = job->data + job->bounds[index + 1];
+    struct bulk_buf out = { NULL, 0 };
+    size_t out_len = 0;
+
+    if (job->format != BULK_FORMAT_PLAIN) {
+        process_compressed(job, worker, index);
+        return;
+    }
+    /* Every line costs at least one input byte and two output bytes. */
+    if (job->per_line)
+        out = take_buffer(job, 2 * (size_t)(end - p) + 2);
+
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = nl != NULL ? nl : end;
+        enum bulk_verdict v = classify_line(p, (size_t)(line_end - p),
+                                            job->family);
+
+        worker->counts[v]++;
+        if (out.text != NULL) {
+            out.text[out_len++] = bulk_verdict_text[v];
+            out.text[out_len++] = '\n';
+        }
+        p = line_end + 1;
+    }
+
+    if (out.text != NULL)
+        publish_output(job, index, out, out_len);
+}
+
+/**
+ * take_front - Pop the next chunk from the front of a worker's own range.
+ * @worker: Owning worker.
+ * @index: Output chunk index.
+ *
+ * Return: true if a chunk was taken.
+ */
+static bool take_front(struct bulk_worker *worker, size_t *index)
+{
+    uint64_t range = atomic_load_explicit(&worker->range,
+                                          memory_order_relaxed);
+
+    for (;;) {
+        uint32_t head = (uint32_t)(range >> 32);
+        uint32_t tail = (uint32_t)range;
+
+        if (head >= tail)
+            return false;
+        if (atomic_compare_exchange_weak_explicit
+            (&worker->range, &range, ((uint64_t)(head + 1) << 32) | tail,
+             memory_order_relaxed, memory_order_relaxed)) {
+            *index = head;
+            return true;
+        }
+    }
+}
+
+/**
+ * take_back - Steal one chunk from the back of another worker's range.
+ * @victim: Worker to steal from.
+ * @index: Output chunk index.
+ *
+ * Return: true if a chunk was stolen.
+ */
+static bool take_back(struct bulk_worker *victim, size_t *index)
+{
+    uint64_t range = atomic_load_explicit(&victim->range,
+                                          memory_order_relaxed);
+
+    for (;;) {
+        uint32_t head = (uint32_t)(range >> 32);
+        uint32_t tail = (uint32_t)range;
+
+        if (head >= tail)
+            return false;
+        if (atomic_compare_exchange_weak_explicit
+            (&victim->range, &range, ((uint64_t)head << 32) | (tail - 1),
+             memory_order_relaxed, memory_order_relaxed)) {
+            *index = tail - 1;
+            return true;
+        }
+    }
+}
+
+/**
+ * worker_main - Drain the worker's own range, then steal until none is left.
+ * @arg: The worker.
+ *
+ * Return: NULL.
+ */
+static void *worker_main(void *arg)
+{
+    struct bulk_worker *self = arg;
+    struct bulk_job *job = self->job;
+    size_t index;
+
+    for (;;) {
+        bool found = take_front(self, &index);
+
+        /* Ranges never grow, so one empty sweep means the run is over. */
+        for (int i = 1; !found && i < job->nworkers; i++)
+            found = take_back(&job->workers[(self->id + i) % job->nworkers],
+                              &index);
+        if (!found)
+            break;
+        /* The owner's next chunk is the one right after this one. */
+        prefetch_chunk(job, index + 1);
+        process_chunk(job, self, index);
+    }
+    return NULL;
+}
+
+/**
+ * split_chunks - Cut the input into chunks that end on line boundaries.
+ * @job: Run description; bounds and nchunks are filled in.
+ * @chunk_size: Target chunk size in bytes.
+ *
+ * Return: true on success, false if memory ran out.
+ */
+static bool split_chunks(struct bulk_job *job, size_t chunk_size)
+{
+    size_t max_chunks = job->size / chunk_size + 2;
+    size_t n = 0;
+    size_t pos = 0;
+
+    job->bounds = malloc((max_chunks + 1) * sizeof(*job->bounds));
+    if (job->bounds == NULL)
+        return false;
+
+    job->bounds[0] = 0;
+    while (pos < job->size) {
+        size_t next = pos + chunk_size;
+
+        if (next >= job->size) {
+            next = job->size;
+        } else {
+            const char *nl = memchr(job->data + next, '\n', job->size - next);
+            next = nl != NULL ? (size_t)(nl - job->data) + 1 : job->size;
+        }
+        job->bounds[++n] = next;
+        pos = next;
+    }
+    job->nchunks = n;
+    return true;
+}
+
+/**
+ * split_frames - Cut compressed input into chunks of whole frames.
+ * @job: Run description; bounds and nchunks are filled in.
+ * @chunk_size: Target compressed chunk size in bytes.
+ *
+ * Return: true on success; false with errno set to ENOMEM, or to EINVAL if
+ * a frame is damaged or cut short.
+ */
+static bool split_frames(struct bulk_job *job, size_t chunk_size)
+{
+    size_t max_chunks = job->size / chunk_size + 2;
+    size_t n = 0;
+    size_t pos = 0;
+
+    job->bounds = malloc((max_chunks + 1) * sizeof(*job->bounds));
+    if (job->bounds == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+
+    job->bounds[0] = 0;
+    while (pos < job->size) {
+        size_t next = pos;
+
+        /* Small frames are grouped; a big one is a chunk of its own. */
+        do {
+            size_t frame = bulk_frame_size(job->format, job->data + next,
+                                           job->size - next);
+
+            if (frame == 0) {
+                errno = EINVAL;
+                return false;
+            }
+            next += frame;
+        } while (next < job->size && next - pos < chunk_size);
+        job->bounds[++n] = next;
+        pos = next;
+    }
+    job->nchunks = n;
+    return true;
+}
+
+/**
+ * stitch_chunk - Judge the lines a chunk of compressed input shares with
+ * its predecessors.
+ * @job: Run description.
+ * @index: Chunk whose worker is done.
+ * @open: Line left open by the chunks before @index; updated.
+ * @out: Where per-line verdicts go, or NULL.
+ *
+ * The text before the chunk's first newline ends the open line, whose
+ * verdict comes before those of the chunk's own lines; the text after its
+ * last newline then becomes the open line. A chunk without a newline only
+ * extends it. Called in chunk order.
+ */
+static void stitch_chunk(struct bulk_job *job, size_t index,
+                         struct bulk_line *open, FILE *out)
+{
+    struct bulk_seam *seam = &job->seams[index];
+
+    line_feed(open, seam->head, seam->head_len);
+    if (seam->head_long)
+        open->lost = true;
+    if (!seam->newline)
+        return;
+
+    enum bulk_verdict v = line_finish(open);
+
+    job->seam_counts[v]++;
+    if (out != NULL)
+        fprintf(out, "%c\n", bulk_verdict_text[v]);
+    *open = seam->tail;
+}
+
+/**
+ * stitch_end - Judge the line left open at the end of compressed input.
+ * @job: Run description.
+ * @open: Line left open by the last chunk.
+ * @out: Where per-line verdicts go, or NULL.
+ */
+static void stitch_end(struct bulk_job *job, struct bulk_line *open,
+                       FILE *out)
+{
+    if (open->len == 0 && !open->lost)
+        return;
+
+    enum bulk_verdict v = line_finish(open);
+
+    job->seam_counts[v]++;
+    if (out != NULL)
+        fprintf(out, "%c\n", bulk_verdict_text[v]);
+}
+
+/**
+ * write_outputs - Emit per-line verdicts in input order as chunks finish.
+ * @job: Run description.
+ */
+static void write_outputs(struct bulk_job *job)
+{
+    struct bulk_line open;
+
+    line_reset(&open, job->family);
+    for (size_t i = 0; i < job->nchunks; i++) {
+        struct bulk_output *o = &job->outputs[i];
+
+        pthread_mutex_lock(&job->lock);
+        while (!o->done)
+            pthread_cond_wait(&job->cond, &job->lock);
+        pthread_mutex_unlock(&job->lock);
+
+        if (job->seams != NULL)
+            stitch_chunk(job, i, &open, stdout);
+        fwrite(o->buf.text, 1, o->len, stdout);
+
+        pthread_mutex_lock(&job->lock);
+        job->spare[job->nspare++] = o->buf;
+        pthread_mutex_unlock(&job->lock);
+        o->buf.text = NULL;
+    }
+    if (job->seams != NULL)
+        stitch_end(job, &open, stdout);
+}
+
+/* State of the io_uring pipeline; see uring_run(). */
+struct bulk_pipe {
+    struct bulk_ring ring;
+    int fd;
+    size_t buf_size;
+    char *bufs;                 /* Read buffers, then two output buffers */
+    size_t want[BULK_URING_DEPTH];      /* Bytes requested per buffer */
+    size_t filled[BULK_URING_DEPTH];
+    uint64_t offset[BULK_URING_DEPTH];  /* File offset of each buffer */
+    bool ready[BULK_URING_DEPTH];
+    bool fixed;                 /* Buffers are registered with the ring */
+    char *out[2];
+    size_t out_len;             /* Verdicts in out[out_cur] not yet sent */
+    int out_cur;
+    const char *write_buf;      /* Rest of the write in flight */
+    size_t write_left;
+    bool writing;
+    char carry[BULK_CARRY_MAX]; /* Start of a line split across buffers */
+    size_t carry_len;
+    bool carry_long;
+    int family;
+    bool per_line;
+    unsigned long long counts[BULK_VERDICTS];
+};
+
+/**
+ * pipe_read - Queue the rest of the read into one buffer.
+ * @pp: Pipeline.
+ * @b: Buffer index.
+ *
+ * Return: true if queued.
+ */
+static bool pipe_read(struct bulk_pipe *pp, int b)
+{
+    return bulk_ring_read(&pp->ring, pp->fd,
+                          pp->bufs + (size_t)b * pp->buf_size + pp->filled[b],
+                          pp->want[b] - pp->filled[b],
+                          pp->offset[b] + pp->filled[b], pp->fixed ? b : -1,
+                          (uint64_t)b);
+}
+
+/**
+ * pipe_write - Queue the rest of the output write.
+ * @pp: Pipeline with a write in progress.
+ *
+ * Return: true if queued.
+ */
+static bool pipe_write(struct bulk_pipe *pp)
+{
+    int index = BULK_URING_DEPTH + (pp->write_buf >= pp->out[1]);
+
+    return bulk_ring_write(&pp->ring, STDOUT_FILENO, pp->write_buf,
+                           pp->write_left, BULK_RING_CURRENT,
+                           pp->fixed ? index : -1, BULK_URING_WRITE);
+}
+
+/**
+ * pipe_reap - Wait for one completion and act on it.
+ * @pp: Pipeline.
+ *
+ * A short read or write is queued again for the remaining bytes; a read
+ * that hits the end of the file marks its buffer ready as it is.
+ *
+ * Return: true on success, false with errno set if a request failed.
+ */
+static bool pipe_reap(struct bulk_pipe *pp)
+{
+    uint64_t tag;
+    int32_t res;
+
+    if (!bulk_ring_wait(&pp->ring, &tag, &res))
+        return false;
+    if (res < 0) {
+        errno = -res;
+        return false;
+    }
+    if (tag == BULK_URING_WRITE) {
+        if (res == 0) {
+            errno = EIO;
+            return false;
+        }
+        pp->write_buf += res;
+        pp->write_left -= (size_t)res;
+        pp->writing = pp->write_left > 0;
+        return !pp->writing || pipe_write(pp);
+    }
+
+    int b = (int)tag;
+
+    pp->filled[b] += (size_t)res;
+    if (res == 0 || pp->filled[b] == pp->want[b]) {
+        pp->ready[b] = true;
+        return true;
+    }
+    return pipe_read(pp, b);
+}
+
+/**
+ * pipe_line - Validate one complete line.
+ * @pp: Pipeline.
+ * @line: Start of the line, without its newline.
+ * @len: Length of the line.
+ * @too_long: The line was longer than BULK_CARRY_MAX and is cut short.
+ */
+static void pipe_line(struct bulk_pipe *pp, const char *line, size_t len,
+                      bool too_long)
+{
+    enum bulk_verdict v = too_long ? BULK_INVALID :
+        classify_line(line, len, pp->family);
+
+    pp->counts[v]++;
+    if (pp->per_line) {
+        pp->out[pp->out_cur][pp->out_len++] = bulk_verdict_text[v];
+        pp->out[pp->out_cur][pp->out_len++] = '\n';
+    }
+}
+
+/**
+ * pipe_carry - Append bytes to the line carried over from earlier buffers.
+ * @pp: Pipeline.
+ * @data: Bytes to append.
+ * @len: Number of bytes.
+ */
+static void pipe_carry(struct bulk_pipe *pp, const char *data, size_t len)
+{
+    if (len > BULK_CARRY_MAX - pp->carry_len) {
+        pp->carry_long = true;
+        return;
+    }
+    memcpy(pp->carry + pp->carry_len, data, len);
+    pp->carry_len += len;
+}
+
+/**
+ * pipe_scan - Validate the lines of one buffer.
+ * @pp: Pipeline.
+ * @data: Buffer contents.
+ * @len: Number of bytes read into the buffer.
+ *
+ * A line split across buffers is assembled in the carry area; the bytes
+ * after the last newline are carried into the next buffer.
+ */
+static void pipe_scan(struct bulk_pipe *pp, const char *data, size_t len)
+{
+    const char *p = data;
+    const char *end = data + len;
+
+    if (pp->carry_len > 0 || pp->carry_long) {
+        const char *nl = memchr(p, '\n', len);
+
+        pipe_carry(pp, p, (size_t)((nl != NULL ? nl : end) - p));
+        if (nl == NULL)
+            return;
+        pipe_line(pp, pp->carry, pp->carry_len, pp->carry_long);
+        pp->carry_len = 0;
+        pp->carry_long = false;
+        p = nl + 1;
+    }
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+
+        if (nl == NULL) {
+            pipe_carry(pp, p, (size_t)(end - p));
+            return;
+        }
+        pipe_line(pp, p, (size_t)(nl - p), false);
+        p = nl + 1;
+    }
+}
+
+/**
+ * pipe_flush - Start writing the verdicts gathered so far.
+ * @pp: Pipeline in per-line mode.
+ *
+ * Waits for the previous write first, so writes reach the output in order
+ * while the pipeline fills the other output buffer.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+static bool pipe_flush(struct bulk_pipe *pp)
+{
+    if (pp->out_len == 0)
+        return true;
+    while (pp->writing)
+        if (!pipe_reap(pp))
+            return false;
+    pp->write_buf = pp->out[pp->out_cur];
+    pp->write_left = pp->out_len;
+    pp->writing = true;
+    pp->out_cur ^= 1;
+    pp->out_len = 0;
+    return pipe_write(pp) && bulk_ring_submit(&pp->ring);
+}
+
+/**
+ * pipe_teardown - Release what pipe_setup() acquired.
+ * @pp: Pipeline; parts that were never set up are skipped.
+ */
+static void pipe_teardown(struct bulk_pipe *pp)
+{
+    /*
+     * Closing the ring only starts cancelling the requests an error left in
+     * flight, so wait for them before freeing the buffers they read into or
+     * write from. If even that fails, the buffers are left allocated.
+     */
+    bool idle = pp->ring.fd < 0 || bulk_ring_drain(&pp->ring);
+
+    bulk_ring_destroy(&pp->ring);
+    if (pp->fd >= 0)
+        close(pp->fd);
+    pp->fd = -1;
+    if (idle)
+        free(pp->bufs);
+    pp->bufs = NULL;
+}
+
+/**
+ * pipe_setup - Open the input and allocate and register the buffers.
+ * @pp: Pipeline with family, per_line and buf_size set.
+ * @path: Input file.
+ * @size: Output size of the input file.
+ *
+ * Return: 1 on success, 0 to fall back to the other readers (input is not
+ * a plain regular file, or io_uring is unavailable), -1 on error
+ * (reported). Unless it returns 1, nothing is left to release.
+ */
+static int pipe_setup(struct bulk_pipe *pp, const char *path, uint64_t *size)
+{
+    struct stat st;
+
+    pp->ring.fd = -1;
+    pp->bufs = NULL;
+    pp->fd = open(path, O_RDONLY);
+    if (pp->fd < 0 || fstat(pp->fd, &st) < 0) {
+        perror(path);
+        pipe_teardown(pp);
+        return -1;
+    }
+
+    unsigned char magic[4];
+    ssize_t got = pread(pp->fd, magic, sizeof(magic), 0);
+
+    /* Compressed files go through the decoders instead. */
+    if (!S_ISREG(st.st_mode) ||
+        (got > 0 && bulk_format_detect(magic, (size_t)got) !=
+         BULK_FORMAT_PLAIN)) {
+        pipe_teardown(pp);
+        return 0;
+    }
+    if (!bulk_ring_init(&pp->ring, BULK_URING_DEPTH + 1)) {
+        fprintf(stderr, "io_uring unavailable (%s), mapping the file\n",
+                strerror(errno));
+        pipe_teardown(pp);
+        return 0;
+    }
+    *size = (uint64_t)st.st_size;
+
+    /* Every verdict needs a newline in the buffer, bar the final line. */
+    size_t out_cap = 2 * pp->buf_size + 2;
+    size_t total = BULK_URING_DEPTH * pp->buf_size + 2 * out_cap;
+
+    pp->bufs = aligned_alloc(4096, (total + 4095) & ~(size_t)4095);
+    if (pp->bufs == NULL) {
+        perror("malloc");
+        pipe_teardown(pp);
+        return -1;
+    }
+    pp->out[0] = pp->bufs + BULK_URING_DEPTH * pp->buf_size;
+    pp->out[1] = pp->out[0] + out_cap;
+
+    struct iovec iov[BULK_URING_DEPTH + 2];
+
+    for (int b = 0; b < BULK_URING_DEPTH; b++) {
+        iov[b].iov_base = pp->bufs + (size_t)b * pp->buf_size;
+        iov[b].iov_len = pp->buf_size;
+    }
+    for (int i = 0; i < 2; i++) {
+        iov[BULK_URING_DEPTH + i].iov_base = pp->out[i];
+        iov[BULK_URING_DEPTH + i].iov_len = out_cap;
+    }
+    /* Unregistered buffers still work, at the cost of a mapping per read. */
+    pp->fixed = bulk_ring_register(&pp->ring, iov,
+                                   pp->per_line ? BULK_URING_DEPTH + 2 :
+                                   BULK_URING_DEPTH);
+    return 1;
+}
+
+/**
+ * uring_run - Validate a regular file through the io_uring pipeline.
+ * @pp: Pipeline with family, per_line and buf_size set; counts are filled.
+ * @path: Input file.
+ * @nbufs: Output number of buffers read.
+ *
+ * Buffer k holds the file bytes from k * buf_size and is read into slot
+ * k % BULK_URING_DEPTH. Slot k is refilled with buffer k + depth as soon as
+ * buffer k is validated, so the reads of the buffers after k proceed while
+ * it is.
+ *
+ * Return: 1 on success, 0 to fall back to the other readers, -1 on error
+ * (reported).
+ */
+static int uring_run(struct bulk_pipe *pp, const char *path, size_t *nbufs)
+{
+    uint64_t size = 0;
+    int r = pipe_setup(pp, path, &size);
+
+    if (r <= 0)
+        return r;
+    r = -1;
+
+    size_t total = (size_t)((size + pp->buf_size - 1) / pp->buf_size);
+
+    for (size_t k = 0; k < total + BULK_URING_DEPTH; k++) {
+        int b = (int)(k % BULK_URING_DEPTH);
+
+        if (k >= BULK_URING_DEPTH) {
+            /* Buffer k - depth is due in slot b: wait, validate, reuse. */
+            while (!pp->ready[b])
+                if (!pipe_reap(pp))
+                    goto out;
+            pipe_scan(pp, pp->bufs + (size_t)b * pp->buf_size, pp->filled[b]);
+        }
+        if (k < total) {
+            uint64_t offset = (uint64_t)k * pp->buf_size;
+
+            pp->offset[b] = offset;
+            pp->want[b] = (size_t)(size - offset < pp->buf_size ?
+                                   size - offset : pp->buf_size);
+            pp->filled[b] = 0;
+            pp->ready[b] = false;
+            if (!pipe_read(pp, b) || !bulk_ring_submit(&pp->ring))
+                goto out;
+        }
+        if (k >= BULK_URING_DEPTH && pp->per_line && !pipe_flush(pp))
+            goto out;
+    }
+
+    /* A last line without a newline still counts. */
+    if (pp->carry_len > 0 || pp->carry_long)
+        pipe_line(pp, pp->carry, pp->carry_len, pp->carry_long);
+    if (pp->per_line && !pipe_flush(pp))
+        goto out;
+    while (pp->writing)
+        if (!pipe_reap(pp))
+            goto out;
+
+    *nbufs = total;
+    r = 1;
+
+out:
+    if (r < 0)
+        perror("io_uring");
+    pipe_teardown(pp);
+    return r;
+}
+
+/**
+ * elapsed_seconds - Seconds between two monotonic timestamps.
+ * @start: Earlier timestamp.
+ * @end: Later timestamp.
+ *
+ * Return: elapsed time in seconds.
+ */
+static double elapsed_seconds(const struct timespec *start,
+                              const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) +
+        (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * Explains command-line options for the bulk validator.
+ */
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [-4 | -6] [-l] [-u] [-t <threads>] [-c <chunk KiB>] "
+           "<file>\n", prog);
+    printf("       Validates every line of <file> as an IP address.\n");
+    printf("       -4/-6  accept only that family (default: either)\n");
+    printf("       -l     print one verdict per line: 4, 6 or -\n");
+    printf("       -u     read through io_uring, one thread, <chunk KiB> "
+           "buffers\n");
+}
+
+/**
+ * print_summary - Report the counts and the throughput of a run.
+ * @counts: Lines per verdict.
+ * @per_line: Verdicts went to standard output, so report on standard error.
+ * @threads: Number of validating threads.
+ * @chunks: Number of chunks or buffers validated.
+ * @seconds: Wall time of the run.
+ */
+static void print_summary(const unsigned long long counts[BULK_VERDICTS],
+                          bool per_line, int threads, size_t chunks,
+                          double seconds)
+{
+    unsigned long long lines = counts[BULK_IPV4] + counts[BULK_IPV6] +
+        counts[BULK_INVALID];
+    FILE *report = per_line ? stderr : stdout;
+
+    fprintf(report, "lines %llu ipv4 %llu ipv6 %llu invalid %llu\n", lines,
+            counts[BULK_IPV4], counts[BULK_IPV6], counts[BULK_INVALID]);
+    fprintf(report, "threads %d chunks %zu seconds %.3f lines/s %.0f\n",
+            threads, chunks, seconds,
+            seconds > 0 ? (double)lines / seconds : 0.0);
+}
+
+/**
+ * Entry point: parse options, split the input, run the workers and report.
+ */
+int main(int argc, char *argv[])
+{
+    struct bulk_job job;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long chunk_kib = BULK_DEFAULT_CHUNK_KIB;
+    bool uring = false;
+    int opt;
+
+    memset(&job, 0, sizeof(job));
+    while ((opt = getopt(argc, argv, "46lut:c:h")) != -1) {
+        switch (opt) {
+        case '4':
+            job.family = 4;
+            break;
+        case '6':
+            job.family = 6;
+            break;
+        case 'l':
+            job.per_line = true;
+            break;
+        case 'u':
+            uring = true;
+            break;
+        case 't':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 'c':
+            chunk_kib = strtol(optarg, NULL, 10);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1 || threads < 1 || chunk_kib < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (uring) {
+        static struct bulk_pipe pipe;
+        size_t nbufs = 0;
+
+        pipe.family = job.family;
+        pipe.per_line = job.per_line;
+        pipe.buf_size = (size_t)chunk_kib * 1024;
+
+        int r = uring_run(&pipe, argv[optind], &nbufs);
+
+        if (r < 0)
+            return 1;
+        if (r > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            print_summary(pipe.counts, job.per_line, 1, nbufs,
+                          elapsed_seconds(&start, &end));
+            return 0;
+        }
+    }
+
+    struct bulk_input input;
+    if (!open_input(argv[optind], &input))
+        return 1;
+    job.data = input.data;
+    job.size = input.size;
+    job.mapped = input.mapped;
+    job.page_size = sysconf(_SC_PAGESIZE);
+    job.format = bulk_format_detect(job.data, job.size);
+
+    if (!bulk_format_supported(job.format)) {
+        fprintf(stderr, "%s: %s input needs ipbulk built with %s=1\n",
+                argv[optind], bulk_format_name(job.format),
+                job.format == BULK_FORMAT_GZIP ? "GZIP" : "ZSTD");
+        return 1;
+    }
+    if (job.format == BULK_FORMAT_PLAIN) {
+        if (!split_chunks(&job, (size_t)chunk_kib * 1024)) {
+            perror("malloc");
+            return 1;
+        }
+    } else {
+        if (!split_frames(&job, (size_t)chunk_kib * 1024)) {
+            perror(argv[optind]);
+            return 1;
+        }
+        job.seams = calloc(job.nchunks + 1, sizeof(*job.seams));
+        if (job.seams == NULL) {
+            perror("calloc");
+            return 1;
+        }
+    }
+
+    if ((size_t)threads > job.nchunks)
+        threads = job.nchunks > 0 ? (long)job.nchunks : 1;
+    job.nworkers = (int)threads;
+    job.workers = aligned_alloc(_Alignof(struct bulk_worker),
+                                (size_t)threads * sizeof(*job.workers));
+    job.outputs = job.per_line ? calloc(job.nchunks + 1,
+                                        sizeof(*job.outputs)) : NULL;
+    /* Each chunk takes at most one buffer, so nchunks slots always do. */
+    job.spare = job.per_line ? calloc(job.nchunks + 1,
+                                      sizeof(*job.spare)) : NULL;
+    if (job.workers == NULL ||
+        (job.per_line && (job.outputs == NULL || job.spare == NULL))) {
+        perror("calloc");
+        return 1;
+    }
+    memset(job.workers, 0, (size_t)threads * sizeof(*job.workers));
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    /* Hand each worker an equal contiguous share of the chunks. */
+    for (int w = 0; w < job.nworkers; w++) {
+        uint64_t lo = job.nchunks * (size_t)w / (size_t)job.nworkers;
+        uint64_t hi = job.nchunks * (size_t)(w + 1) / (size_t)job.nworkers;
+
+        job.workers[w].job = &job;
+        job.workers[w].id = w;
+        atomic_init(&job.workers[w].range, (lo << 32) | hi);
+    }
+    for (int w = 0; w < job.nworkers; w++) {
+        if (pthread_create(&job.workers[w].thread, NULL, worker_main,
+                           &job.workers[w]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    if (job.per_line)
+        write_outputs(&job);
+
+    unsigned long long counts[BULK_VERDICTS] = { 0 };
+    for (int w = 0; w < job.nworkers; w++) {
+        pthread_join(job.workers[w].thread, NULL);
+        for (int v = 0; v < BULK_VERDICTS; v++)
+            counts[v] += job.workers[w].counts[v];
+        if (job.workers[w].window != NULL) {
+            bulk_decoder_free(&job.workers[w].dec);
+            free(job.workers[w].window);
+        }
+    }
+    if (job.seams != NULL && !job.per_line) {
+        struct bulk_line open;
+
+        line_reset(&open, job.family);
+        for (size_t i = 0; i < job.nchunks; i++)
+            stitch_chunk(&job, i, &open, NULL);
+        stitch_end(&job, &open, NULL);
+    }
+    for (int v = 0; v < BULK_VERDICTS; v++)
+        counts[v] += job.seam_counts[v];
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    print_summary(counts, job.per_line, job.nworkers, job.nchunks,
+                  elapsed_seconds(&start, &end));
+
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+    for (size_t i = 0; i < job.nspare; i++)
+        free(job.spare[i].text);
+    free(job.spare);
+    free(job.seams);
+    free(job.outputs);
+    free(job.workers);
+    free(job.bounds);
+    close_input(&input);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+ * gzip (zlib) and zstd streaming decoders for the bulk validator. Each
+ * library is optional: build with GZIP=1 or ZSTD=1 to link it. Without
+ * them, compressed inputs are recognised but refused.
+ */
+
+#include "bulk_decode.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef BULK_GZIP
+#include <zlib.h>
+#endif
+#ifdef BULK_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * bulk_format_detect - Recognise a compressed input.
+ * @data: Start of the input.
+ * @size: Number of bytes of @data.
+ *
+ * Return: the format whose magic number @data starts with.
+ */
+enum bulk_format bulk_format_detect(const void *data, size_t size)
+{
+    static const unsigned char gzip_magic[2] = { 0x1f, 0x8b };
+    static const unsigned char zstd_magic[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+    if (size >= sizeof(zstd_magic) &&
+        memcmp(data, zstd_magic, sizeof(zstd_magic)) == 0)
+        return BULK_FORMAT_ZSTD;
+    if (size >= sizeof(gzip_magic) &&
+        memcmp(data, gzip_magic, sizeof(gzip_magic)) == 0)
+        return BULK_FORMAT_GZIP;
+    return BULK_FORMAT_PLAIN;
+}
+
+/**
+ * bulk_format_name - Name a format for messages.
+ * @format: Format to name.
+ *
+ * Return: static name of @format.
+ */
+const char *bulk_format_name(enum bulk_format format)
+{
+    switch (format) {
+    case BULK_FORMAT_GZIP:
+        return "gzip";
+    case BULK_FORMAT_ZSTD:
+        return "zstd";
+    default:
+        return "plain";
+    }
+}
+
+/**
+ * bulk_format_supported - Tell whether this build can decode a format.
+ * @format: Format to check.
+ *
+ * Return: true if @format can be decoded.
+ */
+bool bulk_format_supported(enum bulk_format format)
+{
+    switch (format) {
+    case BULK_FORMAT_PLAIN:
+        return true;
+#ifdef BULK_GZIP
+    case BULK_FORMAT_GZIP:
+        return true;
+#endif
+#ifdef BULK_ZSTD
+    case BULK_FORMAT_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * bulk_frame_size - Measure the first independently decodable frame.
+ * @format: Format of @data.
+ * @data: Start of a frame.
+ * @size: Bytes from @data to the end of the input.
+ *
+ * Return: compressed size of the frame, or 0 if it is not complete.
+ */
+size_t bulk_frame_size(enum bulk_format format, const void *data, size_t size)
+{
+#ifdef BULK_ZSTD
+    if (format == BULK_FORMAT_ZSTD) {
+        size_t n = ZSTD_findFrameCompressedSize(data, size);
+
+        return ZSTD_isError(n) ? 0 : n;
+    }
+#else
+    (void)data;
+#endif
+    return format == BULK_FORMAT_PLAIN || format == BULK_FORMAT_GZIP ?
+        size : 0;
+}
+
+/**
+ * bulk_decoder_init - Start decoding a compressed input.
+ * @dec: Decoder to set up.
+ * @format: Format of @data.
+ * @data: Compressed bytes.
+ * @size: Number of bytes of @data.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+bool bulk_decoder_init(struct bulk_decoder *dec, enum bulk_format format,
+                       const void *data, size_t size)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->format = format;
+    dec->in = data;
+    dec->in_left = size;
+
+    switch (format) {
+#ifdef BULK_GZIP
+    case BULK_FORMAT_GZIP: {
+        z_stream *z = calloc(1, sizeof(*z));
+
+        /* 16 + MAX_WBITS: gzip framing only, with the largest window. */
+        if (z == NULL || inflateInit2(z, 16 + MAX_WBITS) != Z_OK) {
+            free(z);
+            return false;
+        }
+        dec->state = z;
+        return true;
+    }
+#endif
+#ifdef BULK_ZSTD
+    case BULK_FORMAT_ZSTD:
+        dec->state = ZSTD_createDStream();
+        return dec->state != NULL;
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * bulk_decoder_restart - Point a decoder at new input without reallocating.
+ * @dec: Decoder set up by bulk_decoder_init().
+ * @data: Compressed bytes in the same format.
+ * @size: Number of bytes of @data.
+ *
+ * Return: true on success, false if the library refused the reset.
+ */
+bool bulk_decoder_restart(struct bulk_decoder *dec, const void *data,
+                          size_t size)
+{
+    dec->in = data;
+    dec->in_left = size;
+    dec->in_pos = 0;
+    dec->done = false;
+
+    switch (dec->format) {
+#ifdef BULK_GZIP
+    case BULK_FORMAT_GZIP: {
+        z_stream *z = dec->state;
+
+        z->avail_in = 0;
+        return inflateReset(z) == Z_OK;
+    }
+#endif
+#ifdef BULK_ZSTD
+    case BULK_FORMAT_ZSTD:
+        return !ZSTD_isError(ZSTD_DCtx_reset(dec->state,
+                                             ZSTD_reset_session_only));
+#endif
+    default:
+        return false;
+    }
+}
+
+#ifdef BULK_GZIP
+/**
+ * decode_gzip - Fill a window from a gzip input.
+ * @dec: Decoder.
+ * @window: Output buffer.
+ * @window_size: Capacity of @window.
+ * @len: Output number of bytes produced.
+ *
+ * Concatenated members, as written by pigz or by appending to a .gz
+ * file, are decoded one after another.
+ *
+ * Return: true on success, false if the input is damaged or truncated.
+ */
+static bool decode_gzip(struct bulk_decoder *dec, char *window,
+                        size_t window_size, size_t *len)
+{
+    z_stream *z = dec->state;
+
+    z->next_out = (unsigned char *)window;
+    z->avail_out = window_size > UINT_MAX ? UINT_MAX : (uInt)window_size;
+
+    unsigned int cap = z->avail_out;
+    bool member_done = false;
+
+    while (z->avail_out > 0 && !dec->done) {
+        if (z->avail_in == 0 && dec->in_left > 0) {
+            size_t take = dec->in_left > UINT_MAX ? UINT_MAX : dec->in_left;
+
+            z->next_in = (unsigned char *)(uintptr_t)dec->in;
+            z->avail_in = (uInt)take;
+            dec->in += take;
+            dec->in_left -= take;
+        }
+        if (member_done) {
+            if (z->avail_in == 0) {
+                dec->done = true;
+                break;
+            }
+            if (inflateReset(z) != Z_OK)
+                return false;
+            member_done = false;
+        }
+
+        int r = inflate(z, Z_NO_FLUSH);
+
+        if (r == Z_STREAM_END)
+            member_done = true;
+        else if (r == Z_BUF_ERROR && z->avail_in == 0 && dec->in_left == 0)
+            return false;       /* Truncated member */
+        else if (r != Z_OK && r != Z_BUF_ERROR)
+            return false;
+    }
+    *len = cap - z->avail_out;
+    return true;
+}
+#endif
+
+#ifdef BULK_ZSTD
+/**
+ * decode_zstd - Fill a window from a zstd input.
+ * @dec: Decoder.
+ * @window: Output buffer.
+ * @window_size: Capacity of @window.
+ * @len: Output number of bytes produced.
+ *
+ * Return: true on success, false if the input is damaged or truncated.
+ */
+static bool decode_zstd(struct bulk_decoder *dec, char *window,
+                        size_t window_size, size_t *len)
+{
+    ZSTD_inBuffer in = { dec->in, dec->in_left, dec->in_pos };
+    ZSTD_outBuffer out = { window, window_size, 0 };
+
+    while (out.pos < out.size && !dec->done) {
+        size_t in_before = in.pos, out_before = out.pos;
+        size_t r = ZSTD_decompressStream(dec->state, &out, &in);
+
+        if (ZSTD_isError(r))
+            return false;
+        if (in.pos == in.size && r == 0) {
+            dec->done = true;
+        } else if (in.pos == in_before && out.pos == out_before) {
+            return false;       /* Truncated frame */
+        }
+    }
+    dec->in_pos = in.pos;
+    *len = out.pos;
+    return true;
+}
+#endif
+
+/**
+ * bulk_decode - Decompress the next window of text.
+ * @dec: Decoder.
+ * @window: Output buffer.
+ * @window_size: Capacity of @window.
+ * @len: Output number of bytes produced; 0 at the end.
+ *
+ * Return: true on success, false if the input is damaged or truncated.
+ */
+bool bulk_decode(struct bulk_decoder *dec, char *window, size_t window_size,
+                 size_t *len)
+{
+    *len = 0;
+    if (dec->done)
+        return true;
+    switch (dec->format) {
+#ifdef BULK_GZIP
+    case BULK_FORMAT_GZIP:
+        return decode_gzip(dec, window, window_size, len);
+#endif
+#ifdef BULK_ZSTD
+    case BULK_FORMAT_ZSTD:
+        return decode_zstd(dec, window, window_size, len);
+#endif
+    default:
+        (void)window;
+        (void)window_size;
+        return false;
+    }
+}
+
+/**
+ * bulk_decoder_free - Release a decoder.
+ * @dec: Decoder.
+ */
+void bulk_decoder_free(struct bulk_decoder *dec)
+{
+    if (dec->state == NULL)
+        return;
+    switch (dec->format) {
+#ifdef BULK_GZIP
+    case BULK_FORMAT_GZIP:
+        inflateEnd(dec->state);
+        free(dec->state);
+        break;
+#endif
+#ifdef BULK_ZSTD
+    case BULK_FORMAT_ZSTD:
+        ZSTD_freeDStream(dec->state);
+        break;
+#endif
+    default:
+        break;
+    }
+    dec->state = NULL;
+}
@@ -0,0 +1,113 @@
+#ifndef BULK_DECODE_H
+#define BULK_DECODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Encodings ipbulk recognises by their leading magic bytes. */
+enum bulk_format {
+    BULK_FORMAT_PLAIN,
+    BULK_FORMAT_GZIP,
+    BULK_FORMAT_ZSTD
+};
+
+/*
+ * Streaming decompressor over an input held in memory. Each bulk_decode()
+ * call fills the caller's window with the next decompressed bytes, so the
+ * decompressed text never exists in full.
+ */
+struct bulk_decoder {
+    enum bulk_format format;
+    void *state;                /* z_stream or ZSTD_DStream */
+    const unsigned char *in;    /* Input not yet handed to the library */
+    size_t in_left;
+    size_t in_pos;              /* zstd: bytes of the input consumed */
+    bool done;
+};
+
+/**
+ * bulk_format_detect - Recognise a compressed input.
+ * @data: Start of the input.
+ * @size: Number of bytes of @data.
+ *
+ * Return: BULK_FORMAT_GZIP or BULK_FORMAT_ZSTD when @data starts with that
+ * format's magic number, BULK_FORMAT_PLAIN otherwise.
+ */
+enum bulk_format bulk_format_detect(const void *data, size_t size);
+
+/**
+ * bulk_format_name - Name a format for messages.
+ * @format: Format to name.
+ *
+ * Return: "plain", "gzip" or "zstd".
+ */
+const char *bulk_format_name(enum bulk_format format);
+
+/**
+ * bulk_format_supported - Tell whether this build can decode a format.
+ * @format: Format to check.
+ *
+ * Return: true for plain text, and for gzip or zstd when ipbulk was built
+ * with GZIP=1 or ZSTD=1.
+ */
+bool bulk_format_supported(enum bulk_format format);
+
+/**
+ * bulk_frame_size - Measure the first independently decodable frame.
+ * @format: Format of @data.
+ * @data: Start of a frame.
+ * @size: Bytes from @data to the end of the input.
+ *
+ * zstd frames record their sizes, so a multi-frame file can be split
+ * without decoding it and the frames decoded in parallel. gzip members do
+ * not, so a gzip input is one frame.
+ *
+ * Return: compressed size of the frame, or 0 if @data is not a complete one.
+ */
+size_t bulk_frame_size(enum bulk_format format, const void *data, size_t size);
+
+/**
+ * bulk_decoder_init - Start decoding a compressed input.
+ * @dec: Decoder to set up; release it with bulk_decoder_free().
+ * @format: BULK_FORMAT_GZIP or BULK_FORMAT_ZSTD, supported by this build.
+ * @data: Compressed bytes: any number of whole gzip members or zstd frames.
+ * @size: Number of bytes of @data.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+bool bulk_decoder_init(struct bulk_decoder *dec, enum bulk_format format,
+                       const void *data, size_t size);
+
+/**
+ * bulk_decoder_restart - Point a decoder at new input without reallocating.
+ * @dec: Decoder set up by bulk_decoder_init().
+ * @data: Compressed bytes in the format @dec was set up for.
+ * @size: Number of bytes of @data.
+ *
+ * The library state is reset in place, so a worker that decodes chunk after
+ * chunk allocates it only once.
+ *
+ * Return: true on success, false if the library refused the reset.
+ */
+bool bulk_decoder_restart(struct bulk_decoder *dec, const void *data,
+                          size_t size);
+
+/**
+ * bulk_decode - Decompress the next window of text.
+ * @dec: Decoder set up by bulk_decoder_init().
+ * @window: Output buffer.
+ * @window_size: Capacity of @window; must not be zero.
+ * @len: Output number of bytes placed in @window; 0 at the end of input.
+ *
+ * Return: true on success, false if the input is damaged or truncated.
+ */
+bool bulk_decode(struct bulk_decoder *dec, char *window, size_t window_size,
+                 size_t *len);
+
+/**
+ * bulk_decoder_free - Release a decoder.
+ * @dec: Decoder set up by bulk_decoder_init().
+ */
+void bulk_decoder_free(struct bulk_decoder *dec);
+
+#endif                          /* BULK_DECODE_H */
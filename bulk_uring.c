@@ -0,0 +1,394 @@
+/*
+ * io_uring for the bulk validator without liburing.
+ *
+ * The kernel shares three mappings with the process: the submission ring
+ * (head, tail and an index array), the submission entries, and the
+ * completion ring. The process writes entries and publishes them by storing
+ * the submission tail with release ordering; it reads completions after an
+ * acquire load of the completion tail and returns them by storing the
+ * completion head. io_uring_enter() only has to be called to start work or
+ * to sleep until some completes.
+ */
+
+/* syscall() is outside POSIX. */
+#define _DEFAULT_SOURCE
+
+#include "bulk_uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/**
+ * ring_field - Locate a ring variable from its offset in a mapping.
+ * @map: Start of the mapping.
+ * @offset: Offset reported by io_uring_setup().
+ *
+ * Return: pointer to the variable.
+ */
+static void *ring_field(void *map, uint32_t offset)
+{
+    return (char *)map + offset;
+}
+
+/**
+ * bulk_ring_init - Create a ring.
+ * @ring: Ring to set up.
+ * @entries: Requests that may be in flight at once.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool bulk_ring_init(struct bulk_ring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+        return false;
+
+    ring->sq_map_size = params.sq_off.array +
+        params.sq_entries * sizeof(uint32_t);
+    ring->cq_map_size = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        /* Both rings live in one mapping. */
+        if (ring->cq_map_size > ring->sq_map_size)
+            ring->sq_map_size = ring->cq_map_size;
+        ring->cq_map_size = 0;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+        goto fail;
+    ring->cq_map = ring->sq_map;
+    if (ring->cq_map_size != 0) {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED)
+            goto fail;
+    }
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        goto fail;
+
+    ring->sq_entries = params.sq_entries;
+    ring->sq_khead = ring_field(ring->sq_map, params.sq_off.head);
+    ring->sq_ktail = ring_field(ring->sq_map, params.sq_off.tail);
+    ring->sq_mask = *(uint32_t *)ring_field(ring->sq_map,
+                                            params.sq_off.ring_mask);
+    ring->sq_array = ring_field(ring->sq_map, params.sq_off.array);
+    ring->cq_khead = ring_field(ring->cq_map, params.cq_off.head);
+    ring->cq_ktail = ring_field(ring->cq_map, params.cq_off.tail);
+    ring->cq_mask = *(uint32_t *)ring_field(ring->cq_map,
+                                            params.cq_off.ring_mask);
+    ring->cqes = ring_field(ring->cq_map, params.cq_off.cqes);
+    ring->sq_tail = atomic_load_explicit(ring->sq_ktail,
+                                         memory_order_relaxed);
+    ring->sq_flushed = ring->sq_tail;
+    return true;
+
+fail:;
+    int saved = errno;
+
+    if (ring->sq_map == MAP_FAILED)
+        ring->sq_map = NULL;
+    if (ring->cq_map == MAP_FAILED)
+        ring->cq_map = NULL;
+    if (ring->sqes == MAP_FAILED)
+        ring->sqes = NULL;
+    bulk_ring_destroy(ring);
+    errno = saved;
+    return false;
+}
+
+/**
+ * bulk_ring_destroy - Unmap and close a ring.
+ * @ring: Ring to release.
+ */
+void bulk_ring_destroy(struct bulk_ring *ring)
+{
+    if (ring->sqes != NULL)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map != NULL && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map != NULL)
+        munmap(ring->sq_map, ring->sq_map_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+/**
+ * bulk_ring_register - Pin buffers for fixed-buffer requests.
+ * @ring: Ring to register with.
+ * @iov: Buffers.
+ * @count: Number of buffers.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool bulk_ring_register(struct bulk_ring *ring, const struct iovec *iov,
+                        unsigned count)
+{
+    return syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS,
+                   iov, count) == 0;
+}
+
+/**
+ * ring_queue - Fill the next free submission entry.
+ * @ring: Ring to queue on.
+ * @opcode: Plain or fixed read or write.
+ * @fd: Descriptor.
+ * @buf: Buffer.
+ * @len: Length of @buf.
+ * @offset: File offset.
+ * @buf_index: Registered buffer index for fixed requests.
+ * @tag: User data of the completion.
+ *
+ * Return: true if queued, false if the submission queue is full.
+ */
+static bool ring_queue(struct bulk_ring *ring, uint8_t opcode, int fd,
+                       const void *buf, size_t len, uint64_t offset,
+                       int buf_index, uint64_t tag)
+{
+    uint32_t head = atomic_load_explicit(ring->sq_khead,
+                                         memory_order_acquire);
+
+    if (ring->sq_tail - head >= ring->sq_entries) {
+        errno = EBUSY;
+        return false;
+    }
+
+    uint32_t slot = ring->sq_tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *)ring->sqes + slot;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->buf_index = (uint16_t)(buf_index >= 0 ? buf_index : 0);
+    sqe->user_data = tag;
+    ring->sq_array[slot] = slot;
+    ring->sq_tail++;
+    return true;
+}
+
+/**
+ * bulk_ring_read - Queue a read.
+ * @ring: Ring to queue on.
+ * @fd: Descriptor to read from.
+ * @buf: Destination.
+ * @len: Number of bytes to read.
+ * @offset: File offset to read at.
+ * @buf_index: Registered buffer holding @buf, or -1.
+ * @tag: Value returned with the completion.
+ *
+ * Return: true if queued, false if the submission queue is full.
+ */
+bool bulk_ring_read(struct bulk_ring *ring, int fd, void *buf, size_t len,
+                    uint64_t offset, int buf_index, uint64_t tag)
+{
+    return ring_queue(ring, buf_index >= 0 ? IORING_OP_READ_FIXED :
+                      IORING_OP_READ, fd, buf, len, offset, buf_index, tag);
+}
+
+/**
+ * bulk_ring_write - Queue a write.
+ * @ring: Ring to queue on.
+ * @fd: Descriptor to write to.
+ * @buf: Source.
+ * @len: Number of bytes to write.
+ * @offset: File offset, or BULK_RING_CURRENT.
+ * @buf_index: Registered buffer holding @buf, or -1.
+ * @tag: Value returned with the completion.
+ *
+ * Return: true if queued, false if the submission queue is full.
+ */
+bool bulk_ring_write(struct bulk_ring *ring, int fd, const void *buf,
+                     size_t len, uint64_t offset, int buf_index, uint64_t tag)
+{
+    return ring_queue(ring, buf_index >= 0 ? IORING_OP_WRITE_FIXED :
+                      IORING_OP_WRITE, fd, buf, len, offset, buf_index, tag);
+}
+
+/**
+ * ring_enter - Submit queued requests and optionally wait for one.
+ * @ring: Ring to drive.
+ * @wait: true to sleep until at least one completion is available.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+static bool ring_enter(struct bulk_ring *ring, bool wait)
+{
+    if (ring->sq_flushed != ring->sq_tail) {
+        atomic_store_explicit(ring->sq_ktail, ring->sq_tail,
+                              memory_order_release);
+    }
+    for (;;) {
+        uint32_t pending = ring->sq_tail - ring->sq_flushed;
+
+        if (pending == 0 && !wait)
+            return true;
+
+        long r = syscall(__NR_io_uring_enter, ring->fd, pending,
+                         wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0,
+                         NULL, 0);
+
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return false;
+        ring->sq_flushed += (uint32_t)r;
+        ring->in_flight += (uint32_t)r;
+        if (wait || ring->sq_flushed == ring->sq_tail)
+            return true;
+    }
+}
+
+/**
+ * bulk_ring_submit - Hand every queued request to the kernel.
+ * @ring: Ring to submit.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool bulk_ring_submit(struct bulk_ring *ring)
+{
+    return ring_enter(ring, false);
+}
+
+/**
+ * bulk_ring_wait - Submit queued requests and take one completion.
+ * @ring: Ring to wait on.
+ * @tag: Output tag.
+ * @res: Output result.
+ *
+ * Return: true on success, false with errno set if waiting failed.
+ */
+bool bulk_ring_wait(struct bulk_ring *ring, uint64_t *tag, int32_t *res)
+{
+    if (!bulk_ring_submit(ring))
+        return false;
+    for (;;) {
+        uint32_t head = atomic_load_explicit(ring->cq_khead,
+                                             memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(ring->cq_ktail,
+                                             memory_order_acquire);
+
+        if (head != tail) {
+            const struct io_uring_cqe *cqe =
+                (const struct io_uring_cqe *)ring->cqes +
+                (head & ring->cq_mask);
+
+            *tag = cqe->user_data;
+            *res = cqe->res;
+            atomic_store_explicit(ring->cq_khead, head + 1,
+                                  memory_order_release);
+            ring->in_flight--;
+            return true;
+        }
+        if (!ring_enter(ring, true))
+            return false;
+    }
+}
+
+/**
+ * bulk_ring_drain - Wait until the kernel is done with every request.
+ * @ring: Ring to drain.
+ *
+ * Return: true once no request is left, false with errno set if waiting
+ * failed.
+ */
+bool bulk_ring_drain(struct bulk_ring *ring)
+{
+    uint64_t tag;
+    int32_t res;
+
+    while (ring->in_flight > 0 || ring->sq_flushed != ring->sq_tail)
+        if (!bulk_ring_wait(ring, &tag, &res))
+            return false;
+    return true;
+}
+
+#else                           /* !__linux__ */
+
+bool bulk_ring_init(struct bulk_ring *ring, unsigned entries)
+{
+    (void)entries;
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    errno = ENOSYS;
+    return false;
+}
+
+void bulk_ring_destroy(struct bulk_ring *ring)
+{
+    (void)ring;
+}
+
+bool bulk_ring_register(struct bulk_ring *ring, const struct iovec *iov,
+                        unsigned count)
+{
+    (void)ring;
+    (void)iov;
+    (void)count;
+    errno = ENOSYS;
+    return false;
+}
+
+bool bulk_ring_read(struct bulk_ring *ring, int fd, void *buf, size_t len,
+                    uint64_t offset, int buf_index, uint64_t tag)
+{
+    (void)ring;
+    (void)fd;
+    (void)buf;
+    (void)len;
+    (void)offset;
+    (void)buf_index;
+    (void)tag;
+    errno = ENOSYS;
+    return false;
+}
+
+bool bulk_ring_write(struct bulk_ring *ring, int fd, const void *buf,
+                     size_t len, uint64_t offset, int buf_index, uint64_t tag)
+{
+    return bulk_ring_read(ring, fd, (void *)(uintptr_t)buf, len, offset,
+                          buf_index, tag);
+}
+
+bool bulk_ring_submit(struct bulk_ring *ring)
+{
+    (void)ring;
+    errno = ENOSYS;
+    return false;
+}
+
+bool bulk_ring_wait(struct bulk_ring *ring, uint64_t *tag, int32_t *res)
+{
+    (void)ring;
+    (void)tag;
+    (void)res;
+    errno = ENOSYS;
+    return false;
+}
+
+bool bulk_ring_drain(struct bulk_ring *ring)
+{
+    (void)ring;
+    return true;
+}
+
+#endif                          /* __linux__ */
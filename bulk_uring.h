@@ -0,0 +1,131 @@
+#ifndef BULK_URING_H
+#define BULK_URING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/* Offset for bulk_ring_write() meaning the file's current position. */
+#define BULK_RING_CURRENT UINT64_MAX
+
+/*
+ * Minimal io_uring, driven through the raw system calls: one submission
+ * queue, one completion queue, plain and fixed-buffer reads and writes.
+ * Requests are queued with bulk_ring_read() and bulk_ring_write(), reach the
+ * kernel on bulk_ring_submit() or bulk_ring_wait(), and complete in any
+ * order, identified by the tag given when queueing.
+ */
+struct bulk_ring {
+    int fd;
+    uint32_t sq_entries;
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+    uint32_t sq_tail;           /* Queued up to here, not yet visible */
+    uint32_t sq_flushed;        /* Made visible to the kernel up to here */
+    uint32_t in_flight;         /* Submitted, completion not yet taken */
+    _Atomic uint32_t *sq_khead;
+    _Atomic uint32_t *sq_ktail;
+    _Atomic uint32_t *cq_khead;
+    _Atomic uint32_t *cq_ktail;
+    uint32_t *sq_array;
+    void *sqes;
+    void *cqes;
+    void *sq_map;
+    void *cq_map;
+    size_t sq_map_size;
+    size_t cq_map_size;
+    size_t sqes_size;
+};
+
+/**
+ * bulk_ring_init - Create a ring.
+ * @ring: Ring to set up; release it with bulk_ring_destroy().
+ * @entries: Requests that may be in flight at once.
+ *
+ * Return: true on success; false with errno set, ENOSYS or EPERM where the
+ * kernel has no io_uring or it is disabled.
+ */
+bool bulk_ring_init(struct bulk_ring *ring, unsigned entries);
+
+/**
+ * bulk_ring_destroy - Unmap and close a ring.
+ * @ring: Ring with no requests in flight.
+ */
+void bulk_ring_destroy(struct bulk_ring *ring);
+
+/**
+ * bulk_ring_register - Pin buffers for fixed-buffer requests.
+ * @ring: Ring to register with.
+ * @iov: Buffers; the index into @iov is the buf_index of later requests.
+ * @count: Number of buffers.
+ *
+ * Return: true on success; false with errno set, typically ENOMEM when the
+ * buffers exceed the locked-memory limit.
+ */
+bool bulk_ring_register(struct bulk_ring *ring, const struct iovec *iov,
+                        unsigned count);
+
+/**
+ * bulk_ring_read - Queue a read.
+ * @ring: Ring to queue on.
+ * @fd: Descriptor to read from.
+ * @buf: Destination.
+ * @len: Number of bytes to read.
+ * @offset: File offset to read at.
+ * @buf_index: Registered buffer holding @buf, or -1 for an unregistered one.
+ * @tag: Value returned with the completion.
+ *
+ * Return: true if queued, false if the submission queue is full.
+ */
+bool bulk_ring_read(struct bulk_ring *ring, int fd, void *buf, size_t len,
+                    uint64_t offset, int buf_index, uint64_t tag);
+
+/**
+ * bulk_ring_write - Queue a write.
+ * @ring: Ring to queue on.
+ * @fd: Descriptor to write to.
+ * @buf: Source.
+ * @len: Number of bytes to write.
+ * @offset: File offset, or BULK_RING_CURRENT for the current position.
+ * @buf_index: Registered buffer holding @buf, or -1 for an unregistered one.
+ * @tag: Value returned with the completion.
+ *
+ * Return: true if queued, false if the submission queue is full.
+ */
+bool bulk_ring_write(struct bulk_ring *ring, int fd, const void *buf,
+                     size_t len, uint64_t offset, int buf_index, uint64_t tag);
+
+/**
+ * bulk_ring_submit - Hand every queued request to the kernel.
+ * @ring: Ring to submit.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool bulk_ring_submit(struct bulk_ring *ring);
+
+/**
+ * bulk_ring_wait - Submit queued requests and take one completion.
+ * @ring: Ring to wait on.
+ * @tag: Output tag of the completed request.
+ * @res: Output result: bytes transferred, or a negated errno value.
+ *
+ * Return: true on success, false with errno set if waiting failed.
+ */
+bool bulk_ring_wait(struct bulk_ring *ring, uint64_t *tag, int32_t *res);
+
+/**
+ * bulk_ring_drain - Wait until the kernel is done with every request.
+ * @ring: Ring to drain.
+ *
+ * Queued requests are submitted and every completion is taken and dropped.
+ * Closing a ring only starts cancelling its requests, so the buffers of a
+ * ring that may have requests in flight are freed only after this succeeds.
+ *
+ * Return: true once no request is left, false with errno set if waiting
+ * failed.
+ */
+bool bulk_ring_drain(struct bulk_ring *ring);
+
+#endif                          /* BULK_URING_H */
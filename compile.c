@@ -0,0 +1,304 @@
+/*
+ * Ruleset compiler: turns text lists of prefixes and addresses into a file
+ * that services map with ip_ruleset_open() instead of parsing and building
+ * the tables at every start.
+ *
+ * Prefix lists hold one CIDR block per line, optionally followed by the
+ * value lookups return for it; without one, a prefix gets its position among
+ * all prefix lines, counting from 0. Address lists hold one address per
+ * line. Blank lines and everything after '#' are ignored.
+ */
+
+#include "ip_validator.h"
+#include "ip_prefix.h"
+#include "ip_ruleset.h"
+#include "ip_set.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>             /* getopt */
+
+/* Everything read from the input lists. */
+struct compile_input {
+    struct ip_prefix *prefixes;
+    uint32_t *values;
+    size_t prefix_count;
+    size_t prefix_cap;
+    size_t value_cap;
+    struct in_addr *v4;
+    size_t v4_count;
+    size_t v4_cap;
+    struct in6_addr *v6;
+    size_t v6_count;
+    size_t v6_cap;
+};
+
+/**
+ * grow - Make room for one more element in a growing array.
+ * @array: Array to extend; may be replaced.
+ * @cap: Capacity of *@array in elements; updated.
+ * @count: Number of elements in use.
+ * @size: Size of one element.
+ *
+ * Return: false if memory could not be allocated.
+ */
+static bool grow(void **array, size_t *cap, size_t count, size_t size)
+{
+    if (count < *cap)
+        return true;
+
+    size_t n = *cap ? *cap * 2 : 1024;
+    void *p = realloc(*array, n * size);
+
+    if (p == NULL)
+        return false;
+    *array = p;
+    *cap = n;
+    return true;
+}
+
+/**
+ * next_token - Find the next blank-separated word of a line.
+ * @p: Position in the line; advanced past the word.
+ * @len: Output word length.
+ *
+ * Return: start of the word, or NULL at the end of the line.
+ */
+static const char *next_token(const char **p, size_t *len)
+{
+    const char *s = *p;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+    if (*s == '\0')
+        return NULL;
+    *len = strcspn(s, " \t");
+    *p = s + *len;
+    return s;
+}
+
+/**
+ * parse_value - Parse the value column of a prefix line.
+ * @buf: Start of the word.
+ * @len: Word length.
+ * @value: Output value.
+ *
+ * Return: true if the word is a decimal number below IP_LPM_NONE.
+ */
+static bool parse_value(const char *buf, size_t len, uint32_t *value)
+{
+    uint64_t v = 0;
+
+    if (len == 0 || len > 10)
+        return false;
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] < '0' || buf[i] > '9')
+            return false;
+        v = v * 10 + (uint64_t)(buf[i] - '0');
+    }
+    if (v >= IP_LPM_NONE)
+        return false;
+    *value = (uint32_t)v;
+    return true;
+}
+
+/**
+ * add_line - Add one line of a list to the input.
+ * @in: Input so far.
+ * @line: Line without its newline or comment.
+ * @prefixes: true for a prefix list, false for an address list.
+ *
+ * Return: 1 if an entry was added, 0 for a blank line, -1 if the line is
+ * malformed and -2 if memory ran out.
+ */
+static int add_line(struct compile_input *in, const char *line, bool prefixes)
+{
+    const char *p = line;
+    size_t len = 0, value_len = 0;
+    const char *word = next_token(&p, &len);
+
+    if (word == NULL)
+        return 0;
+
+    const char *value = next_token(&p, &value_len);
+    size_t extra_len = 0;
+
+    if (next_token(&p, &extra_len) != NULL || (!prefixes && value != NULL))
+        return -1;
+
+    if (prefixes) {
+        uint32_t v = (uint32_t)in->prefix_count;
+
+        if (!grow((void **)&in->prefixes, &in->prefix_cap, in->prefix_count,
+                  sizeof(*in->prefixes)) ||
+            !grow((void **)&in->values, &in->value_cap, in->prefix_count,
+                  sizeof(*in->values)))
+            return -2;
+        if (!parse_ip_prefix(word, len, &in->prefixes[in->prefix_count]) ||
+            (value != NULL && !parse_value(value, value_len, &v)) ||
+            v == IP_LPM_NONE)
+            return -1;
+        in->values[in->prefix_count++] = v;
+        return 1;
+    }
+
+    if (!grow((void **)&in->v4, &in->v4_cap, in->v4_count, sizeof(*in->v4)) ||
+        !grow((void **)&in->v6, &in->v6_cap, in->v6_count, sizeof(*in->v6)))
+        return -2;
+    if (parse_ipv4_address(word, len, &in->v4[in->v4_count]))
+        in->v4_count++;
+    else if (parse_ipv6_address(word, len, &in->v6[in->v6_count]))
+        in->v6_count++;
+    else
+        return -1;
+    return 1;
+}
+
+/**
+ * read_list - Add every line of a list file to the input.
+ * @in: Input so far.
+ * @path: File to read, or "-" for standard input.
+ * @prefixes: true for a prefix list, false for an address list.
+ *
+ * Return: true on success; false after printing the offending line.
+ */
+static bool read_list(struct compile_input *in, const char *path,
+                      bool prefixes)
+{
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    char *line = NULL;
+    size_t cap = 0;
+    unsigned long lineno = 0;
+    bool ok = true;
+
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    while (ok && getline(&line, &cap, f) != -1) {
+        lineno++;
+        line[strcspn(line, "#\r\n")] = '\0';
+
+        int r = add_line(in, line, prefixes);
+
+        if (r == -2) {
+            perror("malloc");
+            ok = false;
+        } else if (r < 0) {
+            fprintf(stderr, "%s:%lu: invalid %s: %s\n", path, lineno,
+                    prefixes ? "prefix" : "address", line);
+            ok = false;
+        }
+    }
+    if (ok && ferror(f)) {
+        perror(path);
+        ok = false;
+    }
+    free(line);
+    if (f != stdin)
+        fclose(f);
+    return ok;
+}
+
+/**
+ * print_info - Describe a compiled ruleset.
+ * @path: Ruleset file.
+ *
+ * Return: true if the file could be opened as a ruleset.
+ */
+static bool print_info(const char *path)
+{
+    struct ip_ruleset rules;
+
+    if (!ip_ruleset_open(&rules, path)) {
+        perror(path);
+        return false;
+    }
+    printf("version %d bytes %zu nodes %zu leaves %zu ipv4 %zu ipv6 %zu\n",
+           IP_RULESET_VERSION, rules.image_size, rules.lpm.node_count,
+           rules.lpm.leaf_count, rules.set.v4_count, rules.set.v6_count);
+    ip_ruleset_close(&rules);
+    return true;
+}
+
+/**
+ * Explains command-line options for the ruleset compiler.
+ */
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s -o <ruleset> [-p <prefix list>]... "
+           "[-a <address list>]...\n", prog);
+    printf("       %s -i <ruleset>\n", prog);
+    printf("       Compiles CIDR lines (\"10.0.0.0/8 [value]\") and address\n");
+    printf("       lines into a file for ip_ruleset_open().\n");
+    printf("       -i     describe an existing ruleset\n");
+}
+
+/**
+ * Entry point: read the lists, build the tables and write the ruleset.
+ */
+int main(int argc, char *argv[])
+{
+    struct compile_input in;
+    struct ip_lpm lpm;
+    struct ip_set set;
+    const char *out = NULL;
+    int opt;
+
+    memset(&in, 0, sizeof(in));
+    while ((opt = getopt(argc, argv, "o:p:a:i:h")) != -1) {
+        switch (opt) {
+        case 'o':
+            out = optarg;
+            break;
+        case 'p':
+        case 'a':
+            if (!read_list(&in, optarg, opt == 'p'))
+                return 1;
+            break;
+        case 'i':
+            return print_info(optarg) ? 0 : 1;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc || out == NULL) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!ip_lpm_build(&lpm, in.prefixes, in.values, in.prefix_count) ||
+        !ip_set_build(&set, in.v4, in.v4_count, in.v6, in.v6_count)) {
+        perror("malloc");
+        return 1;
+    }
+    if (!ip_ruleset_save(&lpm, &set, out)) {
+        perror(out);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    fprintf(stderr, "prefixes %zu ipv4 %zu ipv6 %zu nodes %zu leaves %zu "
+            "seconds %.3f\n", in.prefix_count, set.v4_count, set.v6_count,
+            lpm.node_count, lpm.leaf_count,
+            (double)(end.tv_sec - start.tv_sec) +
+            (double)(end.tv_nsec - start.tv_nsec) / 1e9);
+    ip_lpm_free(&lpm);
+    ip_set_free(&set);
+    free(in.prefixes);
+    free(in.values);
+    free(in.v4);
+    free(in.v6);
+    return 0;
+}
@@ -5,11 +5,24 @@
  */
 
 #include "ip_validator.h"
+#include "ip_arena.h"
+#include "ip_cache.h"
+#include "ip_classify.h"
+#include "ip_prefix.h"
+#include "ip_reload.h"
+#include "ip_ruleset.h"
+#include "ip_scan.h"
+#include "ip_set.h"
 
+#include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h> /* getopt */
 
 #include <arpa/inet.h>
+#include <net/if.h>
 
 /**
  * is_valid_ipv4_inet - Validate IPv4 text using inet_pton for parity testing.
@@ -100,6 +113,80 @@ void test_case_ipv6(test_stats * stats, const char *name,
                        result_custom);
 }
 
+/**
+ * Runs a length-delimited IPv4 test case over the first @len bytes of @buf,
+ * comparing against inet_pton on a NUL-terminated copy of the slice.
+ */
+void test_case_ipv4_slice(test_stats * stats, const char *name,
+                          const char *buf, size_t len, bool expected)
+{
+    char copy[64];
+
+    if (len >= sizeof(copy))
+        len = sizeof(copy) - 1;
+    memcpy(copy, buf, len);
+    copy[len] = '\0';
+
+    bool result_inet = is_valid_ipv4_inet(copy);
+    bool result_custom = is_valid_ipv4_address_len(buf, len);
+    report_test_result(stats, name, copy, expected, result_inet,
+                       result_custom);
+}
+
+/**
+ * Runs a length-delimited IPv6 test case over the first @len bytes of @buf,
+ * comparing against inet_pton on a NUL-terminated copy of the slice.
+ */
+void test_case_ipv6_slice(test_stats * stats, const char *name,
+                          const char *buf, size_t len, bool expected)
+{
+    char copy[64];
+
+    if (len >= sizeof(copy))
+        len = sizeof(copy) - 1;
+    memcpy(copy, buf, len);
+    copy[len] = '\0';
+
+    bool result_inet = is_valid_ipv6_inet(copy);
+    bool result_custom = is_valid_ipv6_address_len(buf, len);
+    report_test_result(stats, name, copy, expected, result_inet,
+                       result_custom);
+}
+
+/**
+ * Runs an IPv4 parse test: the custom parser must accept @input exactly when
+ * inet_pton does and produce the same network-order bytes.
+ */
+void test_case_parse_ipv4(test_stats * stats, const char *name,
+                          const char *input, bool expected)
+{
+    struct in_addr ref, got;
+
+    bool result_inet = inet_pton(AF_INET, input, &ref) == 1;
+    bool result_custom = parse_ipv4_address(input, strlen(input), &got);
+    if (result_custom && result_inet)
+        result_custom = memcmp(&ref, &got, sizeof(ref)) == 0;
+    report_test_result(stats, name, input, expected, result_inet,
+                       result_custom);
+}
+
+/**
+ * Runs an IPv6 parse test: the custom parser must accept @input exactly when
+ * inet_pton does and produce the same network-order bytes.
+ */
+void test_case_parse_ipv6(test_stats * stats, const char *name,
+                          const char *input, bool expected)
+{
+    struct in6_addr ref, got;
+
+    bool result_inet = inet_pton(AF_INET6, input, &ref) == 1;
+    bool result_custom = parse_ipv6_address(input, strlen(input), &got);
+    if (result_custom && result_inet)
+        result_custom = memcmp(&ref, &got, sizeof(ref)) == 0;
+    report_test_result(stats, name, input, expected, result_inet,
+                       result_custom);
+}
+
 /**
  * Executes the IPv4 regression suite covering valid cases, edge cases, and
  * adversarial input.
@@ -113,10 +200,10 @@ void run_ipv4_tests(test_stats * stats)
     test_case_ipv4(stats, "IPv4: Private network", "192.168.1.1", true);
     test_case_ipv4(stats, "IPv4: Public IP", "8.8.8.8", true);
 
-    /* Leading zeros - allowed in our implementation */
-    // test_case_ipv4(stats, "IPv4: Leading zeros 1", "192.001.002.003", true);
-    // test_case_ipv4(stats, "IPv4: Leading zeros 2", "010.020.030.040", true);
-    // test_case_ipv4(stats, "IPv4: All zeros", "000.000.000.000", true);
+    /*
+     * Leading zeros are allowed in our implementation but rejected by
+     * inet_pton, so they are covered per policy in run_policy_tests().
+     */
 
     /* Edge cases */
     test_case_ipv4(stats, "IPv4: Max octets", "255.255.255.254", true);
@@ -324,6 +411,1814 @@ void run_ipv6_tests(test_stats * stats)
                    "１９２.１６８.１.１", false);
 }
 
+/**
+ * Executes the length-delimited regression suite: slices taken out of larger
+ * buffers must be judged on their own bytes only.
+ */
+void run_slice_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    static const char line[] = "192.168.1.1 2001:db8::1 10.0.0.256";
+
+    test_case_ipv4_slice(ipv4_stats, "IPv4 Slice: Leading token", line, 11,
+                         true);
+    test_case_ipv4_slice(ipv4_stats, "IPv4 Slice: Token with separator", line,
+                         12, false);
+    test_case_ipv4_slice(ipv4_stats, "IPv4 Slice: Truncated token", line, 9,
+                         false);
+    test_case_ipv4_slice(ipv4_stats, "IPv4 Slice: Trailing dot", line, 10,
+                         false);
+    test_case_ipv4_slice(ipv4_stats, "IPv4 Slice: Out of range tail",
+                         line + 24, 10, false);
+    test_case_ipv4_slice(ipv4_stats, "IPv4 Slice: In range prefix", line + 24,
+                         9, true);
+    test_case_ipv4_slice(ipv4_stats, "IPv4 Slice: Empty", line, 0, false);
+
+    test_case_ipv6_slice(ipv6_stats, "IPv6 Slice: Middle token", line + 12, 11,
+                         true);
+    test_case_ipv6_slice(ipv6_stats, "IPv6 Slice: Compressed prefix",
+                         line + 12, 10, true);
+    test_case_ipv6_slice(ipv6_stats, "IPv6 Slice: Token with separator",
+                         line + 12, 12, false);
+    test_case_ipv6_slice(ipv6_stats, "IPv6 Slice: Single colon tail",
+                         line + 12, 9, false);
+    test_case_ipv6_slice(ipv6_stats, "IPv6 Slice: Empty", line + 12, 0, false);
+}
+
+/**
+ * Executes the parse regression suite: accepted text must convert to the
+ * same binary address inet_pton produces.
+ */
+void run_parse_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    test_case_parse_ipv4(ipv4_stats, "IPv4 Parse: Minimum", "0.0.0.0", true);
+    test_case_parse_ipv4(ipv4_stats, "IPv4 Parse: Maximum", "255.255.255.255",
+                         true);
+    test_case_parse_ipv4(ipv4_stats, "IPv4 Parse: Mixed", "192.0.2.33", true);
+    test_case_parse_ipv4(ipv4_stats, "IPv4 Parse: Out of range", "1.2.3.256",
+                         false);
+
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: All zeros", "::", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Loopback", "::1", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Compression at end",
+                         "2001:db8::", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Compression in middle",
+                         "2001:db8::8a2e:370:7334", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Single group compressed",
+                         "1:2:3::5:6:7:8", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Full format",
+                         "2001:0DB8:85a3:0000:0000:8a2e:0370:7334", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: IPv4-mapped",
+                         "::ffff:192.0.2.128", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: IPv4 suffix full",
+                         "1:2:3:4:5:6:10.20.30.40", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: IPv4 suffix too late",
+                         "1:2:3:4:5:6:7:10.20.30.40", false);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Too many groups",
+                         "1:2:3:4:5:6:7:8:9", false);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Suffix after compression",
+                         "64:ff9b::198.51.100.7", true);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Suffix three octets",
+                         "::ffff:1.2.3", false);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Suffix five octets",
+                         "::ffff:1.2.3.4.5", false);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Suffix trailing dot",
+                         "::ffff:1.2.3.", false);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Suffix hex first octet",
+                         "::ffff:a1.2.3.4", false);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Suffix then colon",
+                         "::1.2.3.4:5", false);
+    test_case_parse_ipv6(ipv6_stats, "IPv6 Parse: Suffix octet overflow",
+                         "::ffff:1.2.3.256", false);
+}
+
+/**
+ * Executes the batch regression suite: every bit of the validity bitmap and
+ * every parsed address must match the scalar entry points.
+ */
+void run_batch_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    static const char *const inputs[] = {
+        "192.168.1.1", "2001:db8::1", "256.1.1.1", "::ffff:192.0.2.128",
+        "10.0.0.1", "", "fe80::1", "1.2.3", "::", "8.8.8.8",
+    };
+    enum { N = sizeof(inputs) / sizeof(inputs[0]) };
+    size_t lens[N];
+    int32_t offsets[N + 1];
+    char data[256];
+    uint8_t bits[(N + 7) / 8], arrow_bits[(N + 7) / 8];
+    struct in_addr addrs4[N], arrow4[N];
+    struct in6_addr addrs6[N], arrow6[N];
+
+    offsets[0] = 0;
+    for (size_t i = 0; i < N; i++) {
+        lens[i] = strlen(inputs[i]);
+        memcpy(data + offsets[i], inputs[i], lens[i]);
+        offsets[i + 1] = offsets[i] + (int32_t)lens[i];
+    }
+
+    size_t valid = is_valid_ipv4_batch(inputs, lens, N, bits, addrs4);
+    size_t arrow_valid = is_valid_ipv4_batch_arrow(offsets, data, N,
+                                                   arrow_bits, arrow4);
+    for (size_t i = 0; i < N; i++) {
+        struct in_addr ref = { 0 };
+        bool expected = parse_ipv4_address(inputs[i], lens[i], &ref);
+        bool bit = (bits[i / 8] >> (i % 8)) & 1;
+        bool arrow_bit = (arrow_bits[i / 8] >> (i % 8)) & 1;
+        bool same = memcmp(&ref, &addrs4[i], sizeof(ref)) == 0 &&
+            memcmp(&ref, &arrow4[i], sizeof(ref)) == 0;
+        report_test_result(ipv4_stats, "IPv4 Batch: Bitmap entry", inputs[i],
+                           expected, bit == arrow_bit ? bit : !expected,
+                           same ? arrow_bit : !expected);
+    }
+    report_test_result(ipv4_stats, "IPv4 Batch: Valid count", "3 of 10", true,
+                       valid == 3, arrow_valid == 3);
+
+    valid = is_valid_ipv6_batch(inputs, lens, N, bits, addrs6);
+    arrow_valid = is_valid_ipv6_batch_arrow(offsets, data, N, arrow_bits,
+                                            arrow6);
+    for (size_t i = 0; i < N; i++) {
+        struct in6_addr ref = IN6ADDR_ANY_INIT;
+        bool expected = parse_ipv6_address(inputs[i], lens[i], &ref);
+        bool bit = (bits[i / 8] >> (i % 8)) & 1;
+        bool arrow_bit = (arrow_bits[i / 8] >> (i % 8)) & 1;
+        bool same = memcmp(&ref, &addrs6[i], sizeof(ref)) == 0 &&
+            memcmp(&ref, &arrow6[i], sizeof(ref)) == 0;
+        report_test_result(ipv6_stats, "IPv6 Batch: Bitmap entry", inputs[i],
+                           expected, bit == arrow_bit ? bit : !expected,
+                           same ? arrow_bit : !expected);
+    }
+    report_test_result(ipv6_stats, "IPv6 Batch: Valid count", "4 of 10", true,
+                       valid == 4, arrow_valid == 4);
+}
+
+/**
+ * Feeds @input to a stream context of @family split at every offset, and
+ * once a byte at a time, and reports whether every run agreed with inet_pton
+ * on both the verdict and the address.
+ */
+void test_case_stream(test_stats * stats, const char *name,
+                      const char *input, int family, bool expected)
+{
+    size_t len = strlen(input);
+    struct ip_address ref;
+    bool result_inet = false;
+    bool result_custom = expected;
+
+    memset(&ref, 0, sizeof(ref));
+    if (family != AF_INET6 && inet_pton(AF_INET, input, &ref.v4) == 1) {
+        ref.family = AF_INET;
+        result_inet = true;
+    } else if (family != AF_INET && inet_pton(AF_INET6, input, &ref.v6) == 1) {
+        ref.family = AF_INET6;
+        result_inet = true;
+    }
+
+    for (size_t split = 0; split <= len + 1; split++) {
+        struct ip_stream ctx;
+        struct ip_address got;
+
+        memset(&got, 0, sizeof(got));
+        ip_stream_init(&ctx, family);
+        if (split > len) {
+            for (size_t i = 0; i < len; i++)
+                ip_stream_feed(&ctx, input + i, 1);
+        } else {
+            ip_stream_feed(&ctx, input, split);
+            ip_stream_feed(&ctx, input + split, len - split);
+        }
+        bool ok = ip_stream_finish(&ctx, &got);
+
+        if (ok != expected || (ok && memcmp(&got, &ref, sizeof(got)) != 0))
+            result_custom = !expected;
+    }
+    report_test_result(stats, name, input, expected, result_inet,
+                       result_custom);
+}
+
+/**
+ * Executes the streaming suite: addresses cut across feed() calls must be
+ * judged exactly as if they had arrived in one piece.
+ */
+void run_stream_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    test_case_stream(ipv4_stats, "IPv4 Stream: Valid", "192.168.1.1", AF_INET,
+                     true);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Broadcast", "255.255.255.255",
+                     AF_INET, true);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Out of range", "256.1.1.1",
+                     AF_INET, false);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Trailing dot", "1.2.3.4.",
+                     AF_INET, false);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Three octets", "1.2.3",
+                     AF_INET, false);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Wrong family", "2001:db8::1",
+                     AF_INET, false);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Either family", "10.0.0.1",
+                     AF_UNSPEC, true);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Port suffix", "10.0.0.1:80",
+                     AF_UNSPEC, false);
+    test_case_stream(ipv4_stats, "IPv4 Stream: Empty", "", AF_UNSPEC, false);
+
+    test_case_stream(ipv6_stats, "IPv6 Stream: Compressed", "2001:db8::1",
+                     AF_INET6, true);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Full form", "1:2:3:4:5:6:7:8",
+                     AF_INET6, true);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Unspecified", "::", AF_INET6,
+                     true);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Mapped IPv4",
+                     "::ffff:192.0.2.128", AF_INET6, true);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Double compression", "1::2::3",
+                     AF_INET6, false);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Zone index", "fe80::1%eth0",
+                     AF_INET6, false);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Too long",
+                     "0000:0000:0000:0000:0000:0000:0000:0000:0", AF_INET6,
+                     false);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Wrong family", "192.168.1.1",
+                     AF_INET6, false);
+    test_case_stream(ipv6_stats, "IPv6 Stream: Either family", "fe80::1",
+                     AF_UNSPEC, true);
+}
+
+/**
+ * Scans @text and reports whether the spans found, joined by spaces, equal
+ * @expected. The scan is repeated one match per call to exercise resuming,
+ * and every span must parse on its own to the address reported for it.
+ */
+void test_case_scan(test_stats * stats, const char *name, const char *text,
+                    int family, const char *expected)
+{
+    struct ip_match matches[8], one;
+    size_t len = strlen(text), pos = 0, resumed = 0;
+    size_t n = ip_scan(text, len, &pos, family, matches, 8);
+    char found[256] = "";
+    size_t used = 0;
+    bool consistent = pos == len;
+
+    for (size_t i = 0; i < n; i++) {
+        const struct ip_match *m = &matches[i];
+        struct in_addr ref4;
+        struct in6_addr ref6;
+        bool same;
+
+        if (m->addr.family == AF_INET)
+            same = parse_ipv4_address(text + m->offset, m->len, &ref4) &&
+                memcmp(&ref4, &m->addr.v4, sizeof(ref4)) == 0;
+        else
+            same = parse_ipv6_address(text + m->offset, m->len, &ref6) &&
+                memcmp(&ref6, &m->addr.v6, sizeof(ref6)) == 0;
+        if (!same)
+            consistent = false;
+        used += (size_t)snprintf(found + used, sizeof(found) - used,
+                                 "%s%.*s", i ? " " : "", (int)m->len,
+                                 text + m->offset);
+    }
+
+    pos = 0;
+    while (ip_scan(text, len, &pos, family, &one, 1) == 1) {
+        if (resumed >= n || one.offset != matches[resumed].offset ||
+            one.len != matches[resumed].len)
+            consistent = false;
+        resumed++;
+    }
+    consistent = consistent && resumed == n;
+
+    report_test_result(stats, name, text, true, consistent,
+                       strcmp(found, expected) == 0);
+}
+
+/**
+ * Executes the scanner suite over log-style text, covering separators,
+ * ports, brackets, zones and text glued to address-like tokens.
+ */
+void run_scan_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    test_case_scan(ipv4_stats, "IPv4 Scan: Apache access log",
+                   "127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] "
+                   "\"GET / HTTP/1.0\" 200 2326", AF_UNSPEC, "127.0.0.1");
+    test_case_scan(ipv4_stats, "IPv4 Scan: Ports and forwarded list",
+                   "10.1.2.3:51234 \"203.0.113.9, 198.51.100.7\"", AF_UNSPEC,
+                   "10.1.2.3 203.0.113.9 198.51.100.7");
+    test_case_scan(ipv4_stats, "IPv4 Scan: Sentence end",
+                   "Blocked 198.51.100.23.", AF_UNSPEC, "198.51.100.23");
+    test_case_scan(ipv4_stats, "IPv4 Scan: Version strings",
+                   "version 1.2.3.4.5 build 10.0.0.256", AF_UNSPEC, "");
+    test_case_scan(ipv4_stats, "IPv4 Scan: Glued to words",
+                   "host10.0.0.1 x1.2.3.4 1.2.3.4x", AF_UNSPEC, "");
+    test_case_scan(ipv4_stats, "IPv4 Scan: Family filter",
+                   "{\"src\":\"192.0.2.1\",\"dst\":\"2001:db8::2\"}", AF_INET,
+                   "192.0.2.1");
+
+    test_case_scan(ipv6_stats, "IPv6 Scan: Zone suffix",
+                   "sshd[123]: Accepted from fe80::1%eth0 port 22", AF_UNSPEC,
+                   "fe80::1");
+    test_case_scan(ipv6_stats, "IPv6 Scan: Brackets and port",
+                   "GET http://[2001:db8::1]:8080/ and [::1]", AF_UNSPEC,
+                   "2001:db8::1 ::1");
+    test_case_scan(ipv6_stats, "IPv6 Scan: Mapped IPv4",
+                   "client ::ffff:192.0.2.128 connected", AF_UNSPEC,
+                   "::ffff:192.0.2.128");
+    test_case_scan(ipv6_stats, "IPv6 Scan: Too many groups",
+                   "1:2:3:4:5:6:7:8:9 at 12:34:56", AF_UNSPEC, "");
+    test_case_scan(ipv6_stats, "IPv6 Scan: MAC then address",
+                   "mac 00:1a:2b:3c:4d:5e ip 2001:DB8:0:0:8:800:200C:417A",
+                   AF_UNSPEC, "2001:DB8:0:0:8:800:200C:417A");
+    test_case_scan(ipv6_stats, "IPv6 Scan: Long hex word",
+                   "deadbeef::1 cafe::1", AF_UNSPEC, "cafe::1");
+    test_case_scan(ipv6_stats, "IPv6 Scan: Mixed separators",
+                   "10.0.0.1,2001:db8::1;fe80::", AF_UNSPEC,
+                   "10.0.0.1 2001:db8::1 fe80::");
+    test_case_scan(ipv6_stats, "IPv6 Scan: Family filter",
+                   "{\"src\":\"192.0.2.1\",\"dst\":\"2001:db8::2\"}", AF_INET6,
+                   "2001:db8::2");
+}
+
+/**
+ * Runs a CIDR parse test. The reference splits @input at '/', converts the
+ * address with inet_pton and the length with strtol, then clears the host
+ * bits; parse_ip_prefix() must agree on validity, address and length.
+ */
+void test_case_prefix(test_stats * stats, const char *name,
+                      const char *input, bool expected)
+{
+    const char *slash = strchr(input, '/');
+    size_t addr_len = slash ? (size_t)(slash - input) : strlen(input);
+    char text[64];
+    unsigned char ref[16] = { 0 };
+    struct ip_prefix got;
+
+    snprintf(text, sizeof(text), "%.*s", (int)addr_len, input);
+    int family = strchr(text, ':') ? AF_INET6 : AF_INET;
+    unsigned int max = family == AF_INET ? 32 : 128, plen = max;
+    bool result_inet = inet_pton(family, text, ref) == 1;
+
+    if (slash != NULL) {
+        char *end;
+        long v = strtol(slash + 1, &end, 10);
+
+        result_inet = result_inet && slash[1] >= '0' && slash[1] <= '9' &&
+            *end == '\0' && v <= (long)max &&
+            !(slash[1] == '0' && slash[2] != '\0');
+        plen = (unsigned int)v;
+    }
+    for (unsigned int bit = plen; result_inet && bit < max; bit++)
+        ref[bit / 8] &= (unsigned char)~(0x80 >> (bit % 8));
+
+    bool result_custom = parse_ip_prefix(input, strlen(input), &got);
+    if (result_custom && result_inet) {
+        const void *bytes = family == AF_INET ? (const void *)&got.addr.v4 :
+            (const void *)&got.addr.v6;
+
+        result_custom = got.addr.family == family && got.len == plen &&
+            memcmp(bytes, ref, max / 8) == 0;
+    }
+    report_test_result(stats, name, input, expected, result_inet,
+                       result_custom);
+}
+
+/**
+ * Looks @input up in @lpm through the fused text path and through the
+ * single and batch binary lookups, and reports whether all of them return
+ * @value.
+ */
+void test_case_lpm(test_stats * stats, const struct ip_lpm *lpm,
+                   const char *name, const char *input, uint32_t value)
+{
+    struct in_addr addr4;
+    struct in6_addr addr6;
+    uint32_t fused = 0, single, batch;
+
+    bool parsed = ip_lpm_match(lpm, input, strlen(input), &fused);
+    if (inet_pton(AF_INET, input, &addr4) == 1) {
+        single = ip_lpm_lookup_ipv4(lpm, &addr4);
+        ip_lpm_lookup_ipv4_batch(lpm, &addr4, 1, &batch);
+    } else if (inet_pton(AF_INET6, input, &addr6) == 1) {
+        single = ip_lpm_lookup_ipv6(lpm, &addr6);
+        ip_lpm_lookup_ipv6_batch(lpm, &addr6, 1, &batch);
+    } else {
+        single = batch = IP_LPM_NONE - 1;
+    }
+    report_test_result(stats, name, input, true,
+                       single == value && batch == value,
+                       parsed && fused == value);
+}
+
+/**
+ * Executes the CIDR suite: prefix parsing against an inet_pton reference,
+ * then longest-prefix matching over nested, overlapping, duplicate and
+ * default routes of both families.
+ */
+void run_prefix_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    static const char *const rules[] = {
+        "0.0.0.0/0", "10.0.0.0/8", "10.1.0.0/16", "10.1.2.0/24",
+        "10.1.2.3/32", "192.168.0.0/23", "192.168.1.128/25", "172.16.0.0/12",
+        "10.1.2.0/24", "2001:db8::/32", "2001:db8:1::/48",
+        "2001:db8:1:2::/64", "::1/128", "fe80::/10",
+    };
+    enum { N = sizeof(rules) / sizeof(rules[0]) };
+    struct ip_prefix prefixes[N];
+    uint32_t values[N];
+    struct ip_lpm lpm;
+
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Network", "10.0.0.0/8", true);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Host bits cleared",
+                     "10.1.2.3/8", true);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Bare address", "192.168.1.1",
+                     true);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Default route", "0.0.0.0/0",
+                     true);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Odd length",
+                     "192.168.1.255/25", true);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Too long", "10.0.0.0/33",
+                     false);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Empty length", "10.0.0.0/",
+                     false);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Leading zero length",
+                     "10.0.0.0/08", false);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Second slash", "10.0.0.0/8/8",
+                     false);
+    test_case_prefix(ipv4_stats, "IPv4 Prefix: Bad address", "10.0.0/8",
+                     false);
+    test_case_prefix(ipv6_stats, "IPv6 Prefix: Network", "2001:db8::/32",
+                     true);
+    test_case_prefix(ipv6_stats, "IPv6 Prefix: Host bits cleared",
+                     "fe80::1/10", true);
+    test_case_prefix(ipv6_stats, "IPv6 Prefix: Default route", "::/0", true);
+    test_case_prefix(ipv6_stats, "IPv6 Prefix: Host route", "::1/128", true);
+    test_case_prefix(ipv6_stats, "IPv6 Prefix: Too long", "2001:db8::/129",
+                     false);
+    test_case_prefix(ipv6_stats, "IPv6 Prefix: Signed length",
+                     "2001:db8::/+32", false);
+
+    for (size_t i = 0; i < N; i++) {
+        parse_ip_prefix(rules[i], strlen(rules[i]), &prefixes[i]);
+        values[i] = (uint32_t)i + 1;
+    }
+    if (!ip_lpm_build(&lpm, prefixes, values, N)) {
+        report_test_result(ipv4_stats, "LPM: Build", "rules", true, true,
+                           false);
+        return;
+    }
+
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: Host route", "10.1.2.3", 5);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: Later duplicate wins",
+                  "10.1.2.4", 9);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: /16", "10.1.3.1", 3);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: /8", "10.2.0.0", 2);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: Default route", "8.8.8.8", 1);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: /25 inside /23",
+                  "192.168.1.129", 7);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: /23 below /25", "192.168.1.1",
+                  6);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: Past /23", "192.168.2.1", 1);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: /12 top", "172.31.255.255", 8);
+    test_case_lpm(ipv4_stats, &lpm, "IPv4 LPM: Past /12", "172.32.0.0", 1);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: /64", "2001:db8:1:2::5", 12);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: /48", "2001:db8:1:3::", 11);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: /32", "2001:db8:ffff::1", 10);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: No match", "2001:db9::",
+                  IP_LPM_NONE);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: Host route", "::1", 13);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: Next to host route", "::2",
+                  IP_LPM_NONE);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: /10 top", "febf::1", 14);
+    test_case_lpm(ipv6_stats, &lpm, "IPv6 LPM: Past /10", "fec0::1",
+                  IP_LPM_NONE);
+    ip_lpm_free(&lpm);
+}
+
+/**
+ * Classifies @input once from its inet_pton conversion and once through the
+ * parse_*() conversion with the single, generic and batch entry points, and
+ * reports whether each agrees with @classes.
+ */
+void test_case_classify(test_stats * stats, const char *name,
+                        const char *input, unsigned int classes)
+{
+    struct ip_address addr;
+    struct ip_address ref;
+    uint16_t batch = 0;
+    bool result_inet, result_custom;
+
+    if (inet_pton(AF_INET, input, &ref.v4) == 1) {
+        result_inet = ip_classify_ipv4(&ref.v4) == classes;
+        addr.family = AF_INET;
+        result_custom = parse_ipv4_address(input, strlen(input), &addr.v4);
+        ip_classify_ipv4_batch(&addr.v4, 1, &batch);
+    } else {
+        result_inet = inet_pton(AF_INET6, input, &ref.v6) == 1 &&
+            ip_classify_ipv6(&ref.v6) == classes;
+        addr.family = AF_INET6;
+        result_custom = parse_ipv6_address(input, strlen(input), &addr.v6);
+        ip_classify_ipv6_batch(&addr.v6, 1, &batch);
+    }
+    result_custom = result_custom && ip_classify(&addr) == classes &&
+        batch == classes;
+    report_test_result(stats, name, input, true, result_inet, result_custom);
+}
+
+/**
+ * Executes the classification suite: one address from each special-purpose
+ * block of both registries, the edges of the blocks that do not end on a
+ * byte boundary, and IPv4-mapped addresses that inherit their IPv4 class.
+ */
+void run_classify_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    test_case_classify(ipv4_stats, "IPv4 Class: Global", "8.8.8.8", 0);
+    test_case_classify(ipv4_stats, "IPv4 Class: Unspecified", "0.0.0.0",
+                       IP_CLASS_UNSPECIFIED | IP_CLASS_RESERVED);
+    test_case_classify(ipv4_stats, "IPv4 Class: This network", "0.1.2.3",
+                       IP_CLASS_RESERVED);
+    test_case_classify(ipv4_stats, "IPv4 Class: Private /8", "10.20.30.40",
+                       IP_CLASS_PRIVATE);
+    test_case_classify(ipv4_stats, "IPv4 Class: Private /12 top",
+                       "172.31.255.255", IP_CLASS_PRIVATE);
+    test_case_classify(ipv4_stats, "IPv4 Class: Past private /12",
+                       "172.32.0.0", 0);
+    test_case_classify(ipv4_stats, "IPv4 Class: Private /16",
+                       "192.168.1.1", IP_CLASS_PRIVATE);
+    test_case_classify(ipv4_stats, "IPv4 Class: Shared /10 bottom",
+                       "100.64.0.0", IP_CLASS_SHARED);
+    test_case_classify(ipv4_stats, "IPv4 Class: Past shared /10",
+                       "100.128.0.0", 0);
+    test_case_classify(ipv4_stats, "IPv4 Class: Loopback", "127.0.0.1",
+                       IP_CLASS_LOOPBACK);
+    test_case_classify(ipv4_stats, "IPv4 Class: Link-local", "169.254.1.1",
+                       IP_CLASS_LINK_LOCAL);
+    test_case_classify(ipv4_stats, "IPv4 Class: Protocol assignments",
+                       "192.0.0.8", IP_CLASS_RESERVED);
+    test_case_classify(ipv4_stats, "IPv4 Class: TEST-NET-1", "192.0.2.1",
+                       IP_CLASS_DOCUMENTATION);
+    test_case_classify(ipv4_stats, "IPv4 Class: TEST-NET-2", "198.51.100.7",
+                       IP_CLASS_DOCUMENTATION);
+    test_case_classify(ipv4_stats, "IPv4 Class: TEST-NET-3", "203.0.113.255",
+                       IP_CLASS_DOCUMENTATION);
+    test_case_classify(ipv4_stats, "IPv4 Class: Benchmarking /15 top",
+                       "198.19.255.255", IP_CLASS_BENCHMARKING);
+    test_case_classify(ipv4_stats, "IPv4 Class: Multicast", "239.1.2.3",
+                       IP_CLASS_MULTICAST);
+    test_case_classify(ipv4_stats, "IPv4 Class: Reserved", "240.0.0.1",
+                       IP_CLASS_RESERVED);
+    test_case_classify(ipv4_stats, "IPv4 Class: Broadcast",
+                       "255.255.255.255", IP_CLASS_RESERVED);
+    test_case_classify(ipv6_stats, "IPv6 Class: Global", "2606:4700::1111",
+                       0);
+    test_case_classify(ipv6_stats, "IPv6 Class: Unspecified", "::",
+                       IP_CLASS_UNSPECIFIED);
+    test_case_classify(ipv6_stats, "IPv6 Class: Loopback", "::1",
+                       IP_CLASS_LOOPBACK);
+    test_case_classify(ipv6_stats, "IPv6 Class: IPv4-compatible", "::1.2.3.4",
+                       IP_CLASS_RESERVED);
+    test_case_classify(ipv6_stats, "IPv6 Class: Mapped global",
+                       "::ffff:8.8.8.8", IP_CLASS_MAPPED);
+    test_case_classify(ipv6_stats, "IPv6 Class: Mapped documentation",
+                       "::ffff:192.0.2.128",
+                       IP_CLASS_MAPPED | IP_CLASS_DOCUMENTATION);
+    test_case_classify(ipv6_stats, "IPv6 Class: NAT64", "64:ff9b::192.0.2.1",
+                       IP_CLASS_TRANSLATION);
+    test_case_classify(ipv6_stats, "IPv6 Class: Local NAT64",
+                       "64:ff9b:1:2::1", IP_CLASS_TRANSLATION);
+    test_case_classify(ipv6_stats, "IPv6 Class: Discard-only", "100::1",
+                       IP_CLASS_RESERVED);
+    test_case_classify(ipv6_stats, "IPv6 Class: Protocol assignments",
+                       "2001:1ff::1", IP_CLASS_RESERVED);
+    test_case_classify(ipv6_stats, "IPv6 Class: Past /23", "2001:200::1", 0);
+    test_case_classify(ipv6_stats, "IPv6 Class: Benchmarking", "2001:2::1",
+                       IP_CLASS_BENCHMARKING);
+    test_case_classify(ipv6_stats, "IPv6 Class: Documentation",
+                       "2001:db8::1", IP_CLASS_DOCUMENTATION);
+    test_case_classify(ipv6_stats, "IPv6 Class: Documentation /20",
+                       "3fff:fff::1", IP_CLASS_DOCUMENTATION);
+    test_case_classify(ipv6_stats, "IPv6 Class: Unique local", "fd12:3456::1",
+                       IP_CLASS_PRIVATE);
+    test_case_classify(ipv6_stats, "IPv6 Class: Link-local", "fe80::1",
+                       IP_CLASS_LINK_LOCAL);
+    test_case_classify(ipv6_stats, "IPv6 Class: Link-local /10 top",
+                       "febf::1", IP_CLASS_LINK_LOCAL);
+    test_case_classify(ipv6_stats, "IPv6 Class: Site-local", "fec0::1",
+                       IP_CLASS_RESERVED);
+    test_case_classify(ipv6_stats, "IPv6 Class: Multicast", "ff02::1",
+                       IP_CLASS_MULTICAST);
+}
+
+/**
+ * Formats @input through inet_pton/inet_ntop and through parse_ipv4_address()
+ * with format_ipv4_address() and the Arrow batch formatter, and reports
+ * whether each produces @canonical. The single formatter must also refuse a
+ * buffer one byte too small.
+ */
+void test_case_format4(test_stats * stats, const char *name,
+                       const char *input, const char *canonical)
+{
+    struct in_addr ref, addr;
+    char text[INET_ADDRSTRLEN], data[INET_ADDRSTRLEN];
+    int32_t offsets[2];
+    size_t len = strlen(canonical);
+
+    bool result_inet = inet_pton(AF_INET, canonical, &ref) == 1 &&
+        inet_ntop(AF_INET, &ref, text, sizeof(text)) != NULL &&
+        strcmp(text, canonical) == 0;
+    bool result_custom = parse_ipv4_address(input, strlen(input), &addr) &&
+        format_ipv4_address(&addr, text, len) == 0 &&
+        format_ipv4_address(&addr, text, sizeof(text)) == len &&
+        strcmp(text, canonical) == 0 &&
+        format_ipv4_batch_arrow(&addr, 1, offsets, data) == len &&
+        offsets[0] == 0 && offsets[1] == (int32_t)len &&
+        memcmp(data, canonical, len) == 0;
+    report_test_result(stats, name, input, true, result_inet, result_custom);
+}
+
+/**
+ * Formats @input through inet_pton/inet_ntop and through parse_ipv6_address()
+ * with format_ipv6_address() and the Arrow batch formatter, and reports
+ * whether each produces @canonical. The single formatter must also refuse a
+ * buffer one byte too small.
+ */
+void test_case_format6(test_stats * stats, const char *name,
+                       const char *input, const char *canonical)
+{
+    struct in6_addr ref, addr;
+    char text[INET6_ADDRSTRLEN], data[INET6_ADDRSTRLEN];
+    int32_t offsets[2];
+    size_t len = strlen(canonical);
+
+    bool result_inet = inet_pton(AF_INET6, input, &ref) == 1 &&
+        inet_ntop(AF_INET6, &ref, text, sizeof(text)) != NULL &&
+        strcmp(text, canonical) == 0;
+    bool result_custom = parse_ipv6_address(input, strlen(input), &addr) &&
+        format_ipv6_address(&addr, text, len) == 0 &&
+        format_ipv6_address(&addr, text, sizeof(text)) == len &&
+        strcmp(text, canonical) == 0 &&
+        format_ipv6_batch_arrow(&addr, 1, offsets, data) == len &&
+        offsets[0] == 0 && offsets[1] == (int32_t)len &&
+        memcmp(data, canonical, len) == 0;
+    report_test_result(stats, name, input, true, result_inet, result_custom);
+}
+
+/**
+ * Executes the formatting suite: octets of every width, then each RFC 5952
+ * rule on its own and the cases where the rules interact, such as ties
+ * between zero runs.
+ */
+void run_format_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    test_case_format4(ipv4_stats, "IPv4 Format: Shortest", "0.0.0.0",
+                      "0.0.0.0");
+    test_case_format4(ipv4_stats, "IPv4 Format: Longest", "255.255.255.255",
+                      "255.255.255.255");
+    test_case_format4(ipv4_stats, "IPv4 Format: Mixed widths", "1.22.133.4",
+                      "1.22.133.4");
+    test_case_format4(ipv4_stats, "IPv4 Format: Leading zeros dropped",
+                      "010.001.000.099", "10.1.0.99");
+    test_case_format4(ipv4_stats, "IPv4 Format: Width boundaries",
+                      "9.10.99.100", "9.10.99.100");
+    test_case_format6(ipv6_stats, "IPv6 Format: Lower case",
+                      "2001:DB8:ABCD:EF01:2345:6789:ABCD:EF01",
+                      "2001:db8:abcd:ef01:2345:6789:abcd:ef01");
+    test_case_format6(ipv6_stats, "IPv6 Format: Leading zeros",
+                      "2001:0db8:0001:0000:0000:0ab9:00c0:000a",
+                      "2001:db8:1::ab9:c0:a");
+    test_case_format6(ipv6_stats, "IPv6 Format: Unspecified",
+                      "0:0:0:0:0:0:0:0", "::");
+    test_case_format6(ipv6_stats, "IPv6 Format: Loopback", "0:0:0:0:0:0:0:1",
+                      "::1");
+    test_case_format6(ipv6_stats, "IPv6 Format: Trailing run",
+                      "fe80:0:0:0:0:0:0:0", "fe80::");
+    test_case_format6(ipv6_stats, "IPv6 Format: Single zero group kept",
+                      "2001:db8:0:1:1:1:1:1", "2001:db8:0:1:1:1:1:1");
+    test_case_format6(ipv6_stats, "IPv6 Format: Longest run wins",
+                      "2001:0:0:1:0:0:0:1", "2001:0:0:1::1");
+    test_case_format6(ipv6_stats, "IPv6 Format: First of equal runs",
+                      "2001:db8:0:0:1:0:0:1", "2001:db8::1:0:0:1");
+    test_case_format6(ipv6_stats, "IPv6 Format: Shorter run expanded",
+                      "1:0:2:3:4:5:0:0", "1:0:2:3:4:5::");
+    test_case_format6(ipv6_stats, "IPv6 Format: Mapped",
+                      "::FFFF:c000:0280", "::ffff:192.0.2.128");
+    test_case_format6(ipv6_stats, "IPv6 Format: Mapped zero",
+                      "0:0:0:0:0:ffff:0:0", "::ffff:0.0.0.0");
+    test_case_format6(ipv6_stats, "IPv6 Format: Not mapped",
+                      "::fffe:c000:280", "::fffe:c000:280");
+    test_case_format6(ipv6_stats, "IPv6 Format: NAT64 in hex",
+                      "64:ff9b::192.0.2.33", "64:ff9b::c000:221");
+    test_case_format6(ipv6_stats, "IPv6 Format: Longest text",
+                      "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255",
+                      "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
+}
+
+/**
+ * Builds the inet_pton/inet_addr view of @input under @flags: zeros that
+ * lead a number are dropped unless the policy forbids them, an accepted zone
+ * is cut off, and forbidden dotted-quad suffixes are refused.
+ */
+bool policy_reference(int family, unsigned int flags, const char *input)
+{
+    unsigned char addr[16];
+    char text[128];
+    size_t n = 0;
+
+    /* POSIX inet_addr() reads the inet_aton() forms; no test uses all ones. */
+    if (family == AF_INET && (flags & IP_PARSE_INET_ATON))
+        return inet_addr(input) != (in_addr_t)-1;
+    for (size_t i = 0; input[i] != '\0' && n < sizeof(text) - 1; i++) {
+        bool starts = i == 0 || input[i - 1] == '.' || input[i - 1] == ':';
+
+        if (family == AF_INET6 && input[i] == '%' &&
+            (flags & IP_PARSE_ALLOW_ZONE)) {
+            if (input[i + 1] == '\0' || strchr(input + i + 1, '/') != NULL)
+                return false;
+            break;
+        }
+        if (input[i] == '.' && (flags & IP_PARSE_NO_EMBEDDED_IPV4) &&
+            family == AF_INET6)
+            return false;
+        while (starts && !(flags & IP_PARSE_NO_LEADING_ZEROS) &&
+               input[i] == '0' && input[i + 1] >= '0' && input[i + 1] <= '9')
+            i++;
+        text[n++] = input[i];
+    }
+    text[n] = '\0';
+    return inet_pton(family, text, addr) == 1;
+}
+
+/**
+ * Runs @input through the parser ip_ipv4_parser() or ip_ipv6_parser() picks
+ * for @flags and compares it with policy_reference().
+ */
+void test_case_policy(test_stats * stats, const char *name, int family,
+                      unsigned int flags, const char *input, bool expected)
+{
+    bool result_inet = policy_reference(family, flags, input);
+    bool result_custom;
+
+    if (family == AF_INET) {
+        struct in_addr addr;
+
+        result_custom = ip_ipv4_parser(flags)(input, strlen(input), &addr);
+    } else {
+        struct in6_addr addr;
+
+        result_custom = ip_ipv6_parser(flags)(input, strlen(input), &addr);
+    }
+    report_test_result(stats, name, input, expected, result_inet,
+                       result_custom);
+}
+
+/**
+ * Executes the policy suite: each IP_PARSE_* flag against the default
+ * policy, the inet_aton() shorthand forms, and rejection of unknown flags.
+ */
+void run_policy_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    const unsigned int nlz = IP_PARSE_NO_LEADING_ZEROS;
+    const unsigned int aton = IP_PARSE_INET_ATON;
+    const unsigned int zone = IP_PARSE_ALLOW_ZONE;
+    const unsigned int no_v4 = IP_PARSE_NO_EMBEDDED_IPV4;
+
+    test_case_policy(ipv4_stats, "IPv4 Policy: Leading zeros 1", AF_INET, 0,
+                     "192.001.002.003", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: Leading zeros 2", AF_INET, 0,
+                     "010.020.030.040", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: All zeros", AF_INET, 0,
+                     "000.000.000.000", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: Strict leading zeros",
+                     AF_INET, nlz, "192.001.002.003", false);
+    test_case_policy(ipv4_stats, "IPv4 Policy: Strict single zero", AF_INET,
+                     nlz, "0.0.0.0", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: Strict plain", AF_INET, nlz,
+                     "10.20.30.40", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: Shorthand by default",
+                     AF_INET, 0, "127.1", false);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton two parts", AF_INET,
+                     aton, "127.1", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton 16-bit tail",
+                     AF_INET, aton, "10.1.65535", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton one part", AF_INET,
+                     aton, "2130706433", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton hex", AF_INET, aton,
+                     "0x7f.0.0.0X1", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton octal", AF_INET,
+                     aton, "0177.0.0.01", true);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton bad octal", AF_INET,
+                     aton, "08.1.1.1", false);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton octal overflow",
+                     AF_INET, aton, "0777.0777.0777.0777", false);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton bare 0x", AF_INET,
+                     aton, "0x.1", false);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton tail overflow",
+                     AF_INET, aton, "1.2.65536", false);
+    test_case_policy(ipv4_stats, "IPv4 Policy: inet_aton trailing dot",
+                     AF_INET, aton, "1.2.3.4.", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Zone by default", AF_INET6, 0,
+                     "fe80::1%eth0", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Zone name", AF_INET6, zone,
+                     "fe80::1%eth0", true);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Zone index", AF_INET6, zone,
+                     "fe80::1%2", true);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Empty zone", AF_INET6, zone,
+                     "fe80::1%", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Zone with slash", AF_INET6,
+                     zone, "fe80::1%eth/0", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Zone without address",
+                     AF_INET6, zone, "%eth0", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Zone after quad", AF_INET6,
+                     zone | nlz, "::ffff:192.0.2.1%lo", true);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Embedded quad", AF_INET6, 0,
+                     "::ffff:192.0.2.1", true);
+    test_case_policy(ipv6_stats, "IPv6 Policy: No embedded quad", AF_INET6,
+                     no_v4, "::ffff:192.0.2.1", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: No embedded quad, hex",
+                     AF_INET6, no_v4, "::ffff:c000:201", true);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Quad leading zeros",
+                     AF_INET6, 0, "::ffff:192.000.002.001", true);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Strict quad leading zeros",
+                     AF_INET6, nlz, "::ffff:192.000.002.001", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Strict keeps hex zeros",
+                     AF_INET6, nlz, "2001:0db8::0001", true);
+    test_case_policy(ipv6_stats, "IPv6 Policy: Strict long last octet",
+                     AF_INET6, nlz, "::1.2.3.0077", false);
+    test_case_policy(ipv6_stats, "IPv6 Policy: No quad, long last octet",
+                     AF_INET6, no_v4, "::1.2.3.0077", false);
+    report_test_result(ipv4_stats, "Policy: Unknown flags", "0x100", true,
+                       ip_ipv4_parser(0x100) == NULL,
+                       ip_ipv6_parser(0x100) == NULL);
+    report_test_result(ipv4_stats, "Policy: Default is plain parser", "0",
+                       true, ip_ipv4_parser(0) == parse_ipv4_address,
+                       ip_ipv6_parser(0) == parse_ipv6_address);
+}
+
+/**
+ * Parses @input with parse_ipv6_address_zone() and reports whether it agrees
+ * with inet_pton on the text before the '%', under the embedded-quad rule
+ * of @flags, and whether the zone span
+ * selects @zone_text (NULL for no zone) inside @input.
+ */
+void test_case_zone(test_stats * stats, const char *name, const char *input,
+                    unsigned int flags, const char *zone_text, bool expected)
+{
+    const char *pct = strchr(input, '%');
+    size_t addr_len = pct ? (size_t)(pct - input) : strlen(input);
+    struct in6_addr ref, addr;
+    struct ip_zone zone;
+    char text[INET6_ADDRSTRLEN];
+
+    snprintf(text, sizeof(text), "%.*s", (int)addr_len, input);
+    bool result_inet = inet_pton(AF_INET6, text, &ref) == 1 &&
+        (pct == NULL || zone_text != NULL) &&
+        !((flags & IP_PARSE_NO_EMBEDDED_IPV4) && strchr(text, '.'));
+    bool result_custom = parse_ipv6_address_zone(input, strlen(input), flags,
+                                                 &addr, &zone);
+    if (result_custom) {
+        size_t want = zone_text ? strlen(zone_text) : 0;
+
+        result_custom = memcmp(&addr, &ref, sizeof(addr)) == 0 &&
+            zone.len == want && zone.offset + zone.len == strlen(input) &&
+            (want == 0 || memcmp(input + zone.offset, zone_text, want) == 0);
+    }
+    report_test_result(stats, name, input, expected, result_inet,
+                       result_custom);
+}
+
+/**
+ * Resolves the zone of @input with ip_zone_index(), twice so the second
+ * lookup comes from the cache, and once more after a flush, and compares
+ * each with @want.
+ */
+void test_case_zone_index(test_stats * stats, const char *name,
+                          const char *input, unsigned int want)
+{
+    struct in6_addr addr;
+    struct ip_zone zone;
+    bool parsed = parse_ipv6_address_zone(input, strlen(input), 0, &addr,
+                                          &zone);
+    unsigned int first = parsed ? ip_zone_index(input, &zone) : 0;
+    unsigned int cached = parsed ? ip_zone_index(input, &zone) : 0;
+
+    ip_zone_cache_flush();
+    unsigned int flushed = parsed ? ip_zone_index(input, &zone) : 0;
+
+    report_test_result(stats, name, input, true, parsed && first == want,
+                       cached == want && flushed == want);
+}
+
+/**
+ * Executes the zone suite: span output for named, numeric and missing zones
+ * under the default and strict policies, then index resolution checked
+ * against if_nametoindex().
+ */
+void run_zone_tests(test_stats * ipv6_stats)
+{
+    test_case_zone(ipv6_stats, "IPv6 Zone: Name", "fe80::1%eth0", 0, "eth0",
+                   true);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Index", "fe80::abcd%3", 0, "3",
+                   true);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Multicast", "ff02::1%wlan0", 0,
+                   "wlan0", true);
+    test_case_zone(ipv6_stats, "IPv6 Zone: VLAN name", "fe80::1%eth0.100", 0,
+                   "eth0.100", true);
+    test_case_zone(ipv6_stats, "IPv6 Zone: None", "2001:db8::1", 0, NULL,
+                   true);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Empty", "fe80::1%", 0, NULL,
+                   false);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Too long",
+                   "fe80::1%abcdefghijklmnop", 0, NULL, false);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Space", "fe80::1%eth 0", 0, NULL,
+                   false);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Bad address", "fe80:::1%eth0", 0,
+                   "eth0", false);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Strict quad",
+                   "::ffff:10.0.0.1%eth0", IP_PARSE_NO_LEADING_ZEROS, "eth0",
+                   true);
+    test_case_zone(ipv6_stats, "IPv6 Zone: Forbidden quad",
+                   "::ffff:10.0.0.1%eth0", IP_PARSE_NO_EMBEDDED_IPV4, "eth0",
+                   false);
+    test_case_zone_index(ipv6_stats, "IPv6 Zone Index: Numeric", "fe80::1%7",
+                         7);
+    test_case_zone_index(ipv6_stats, "IPv6 Zone Index: Loopback", "fe80::1%lo",
+                         if_nametoindex("lo"));
+    test_case_zone_index(ipv6_stats, "IPv6 Zone Index: Unknown name",
+                         "fe80::1%nosuchif0", 0);
+    test_case_zone_index(ipv6_stats, "IPv6 Zone Index: No zone", "fe80::1",
+                         0);
+}
+
+/**
+ * Parses @input through @cache twice and reports whether the first lookup
+ * missed, the second hit, and both returned the inet_pton address with its
+ * ip_classify() flags.
+ */
+void test_case_cache(test_stats * stats, struct ip_cache *cache,
+                     const char *name, const char *input, bool expected)
+{
+    struct ip_address ref;
+    struct ip_cache_result first, second;
+    uint64_t hits = cache->hits;
+    uint64_t misses = cache->misses;
+    size_t len = strlen(input);
+
+    memset(&ref, 0, sizeof(ref));
+    if (inet_pton(AF_INET, input, &ref.v4) == 1)
+        ref.family = AF_INET;
+    else if (inet_pton(AF_INET6, input, &ref.v6) == 1)
+        ref.family = AF_INET6;
+
+    bool r1 = ip_cache_parse(cache, input, len, &first);
+    bool r2 = ip_cache_parse(cache, input, len, &second);
+    bool same = r1 == r2 && first.classes == ip_classify(&ref) &&
+        second.classes == first.classes &&
+        first.addr.family == ref.family && second.addr.family == ref.family &&
+        memcmp(&first.addr, &ref, sizeof(ref)) == 0 &&
+        memcmp(&second.addr, &ref, sizeof(ref)) == 0 &&
+        cache->misses == misses + 1 && cache->hits == hits + 1;
+
+    report_test_result(stats, name, input, expected, ref.family != AF_UNSPEC,
+                       same ? r1 : !expected);
+}
+
+/**
+ * Executes the cache suite: hits for valid and rejected text of both
+ * families, least-recently-used replacement in a single set, the bypass for
+ * over-long text, a strict policy, and the init-time limits.
+ */
+void run_cache_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    static const char *const order[] = {
+        "10.0.0.1", "10.0.0.2", "10.0.0.1", "10.0.0.3", "10.0.0.1",
+        "10.0.0.2",
+    };
+    static const char long_text[] =
+        "0000:0000:0000:0000:0000:ffff:192.168.100.200";
+    struct ip_cache cache, strict, tiny;
+    struct ip_cache_result res;
+    bool ok;
+
+    ok = ip_cache_init(&cache, 4096, 0);
+    report_test_result(ipv4_stats, "IPv4 Cache: Init", "4096 bytes", true,
+                       true, ok && cache.set_count == 32);
+    if (!ok)
+        return;
+    test_case_cache(ipv4_stats, &cache, "IPv4 Cache: Private", "192.168.1.1",
+                    true);
+    test_case_cache(ipv4_stats, &cache, "IPv4 Cache: Global", "8.8.8.8",
+                    true);
+    test_case_cache(ipv4_stats, &cache, "IPv4 Cache: Rejected", "256.1.1.1",
+                    false);
+    test_case_cache(ipv6_stats, &cache, "IPv6 Cache: Link-local", "fe80::1",
+                    true);
+    test_case_cache(ipv6_stats, &cache, "IPv6 Cache: Mapped",
+                    "::ffff:10.1.2.3", true);
+    test_case_cache(ipv6_stats, &cache, "IPv6 Cache: Rejected", "1:::2",
+                    false);
+    test_case_cache(ipv6_stats, &cache, "IPv6 Cache: Empty", "", false);
+
+    uint64_t misses = cache.misses;
+
+    ok = ip_cache_parse(&cache, long_text, strlen(long_text), &res) &&
+        ip_cache_parse(&cache, long_text, strlen(long_text), &res) &&
+        cache.misses == misses + 2 && (res.classes & IP_CLASS_MAPPED);
+    report_test_result(ipv6_stats, "IPv6 Cache: Too long to cache", long_text,
+                       true, true, ok);
+    ip_cache_free(&cache);
+
+    /* One set of two ways: 10.0.0.3 must evict 10.0.0.2, not 10.0.0.1. */
+    ok = ip_cache_init(&tiny, 128, 0);
+    for (size_t i = 0; ok && i < sizeof(order) / sizeof(order[0]); i++)
+        ok = ip_cache_parse(&tiny, order[i], strlen(order[i]), &res);
+    report_test_result(ipv4_stats, "IPv4 Cache: LRU replacement",
+                       "A B A C A B", true, true,
+                       ok && tiny.hits == 2 && tiny.misses == 4);
+    ip_cache_free(&tiny);
+
+    ok = ip_cache_init(&strict, 1024, IP_PARSE_NO_LEADING_ZEROS);
+    if (ok) {
+        ok = !ip_cache_parse(&strict, "010.0.0.1", 9, &res) &&
+            !ip_cache_parse(&strict, "010.0.0.1", 9, &res) &&
+            strict.hits == 1 && res.addr.family == AF_UNSPEC;
+        ip_cache_free(&strict);
+    }
+    report_test_result(ipv4_stats, "IPv4 Cache: Strict policy", "010.0.0.1",
+                       false, false, !ok);
+
+    report_test_result(ipv4_stats, "IPv4 Cache: Budget below one set",
+                       "64 bytes", false, false, ip_cache_init(&tiny, 64, 0));
+    report_test_result(ipv4_stats, "IPv4 Cache: Unknown flags", "0x100",
+                       false, false, ip_cache_init(&tiny, 4096, 0x100));
+}
+
+/* Even host numbers of 172.16.0.0/21 join the set suite's IPv4 addresses. */
+#define SET_RANGE_SIZE 2048
+
+/* Addresses the set suite builds from, and the set built from them. */
+struct set_fixture {
+    struct in_addr v4[16 + SET_RANGE_SIZE / 2];
+    struct in6_addr v6[16];
+    size_t v4_count;
+    size_t v6_count;
+    struct ip_set set;
+};
+
+/**
+ * Reports whether ip_set_contains() finds @input exactly when a linear search
+ * of the addresses @fx was built from does.
+ */
+void test_case_set(test_stats * stats, const struct set_fixture *fx,
+                   const char *name, const char *input, bool expected)
+{
+    struct ip_address addr;
+    bool found = false;
+
+    memset(&addr, 0, sizeof(addr));
+    if (inet_pton(AF_INET, input, &addr.v4) == 1)
+        addr.family = AF_INET;
+    else if (inet_pton(AF_INET6, input, &addr.v6) == 1)
+        addr.family = AF_INET6;
+    for (size_t i = 0; addr.family == AF_INET && i < fx->v4_count; i++)
+        found = found || fx->v4[i].s_addr == addr.v4.s_addr;
+    for (size_t i = 0; addr.family == AF_INET6 && i < fx->v6_count; i++)
+        found = found || memcmp(&fx->v6[i], &addr.v6, sizeof(addr.v6)) == 0;
+
+    report_test_result(stats, name, input, expected, found,
+                       ip_set_contains(&fx->set, &addr));
+}
+
+/**
+ * Reports whether ip_set_contains_ipv4_batch() agrees with single lookups on
+ * @count addresses of 172.16.0.0/21, with the vector kernels on and off.
+ */
+void test_case_set_batch(test_stats * stats, const struct ip_set *set,
+                         const char *name, size_t count)
+{
+    struct in_addr addrs[SET_RANGE_SIZE];
+    uint8_t bitmap[SET_RANGE_SIZE / 8];
+    char input[32];
+    size_t members = 0;
+    bool same = true;
+
+    for (size_t i = 0; i < count; i++) {
+        addrs[i].s_addr = htonl(0xac100000u | (uint32_t)(i * 7 % 4096));
+        members += ip_set_contains_ipv4(set, &addrs[i]);
+    }
+    for (int simd = 0; simd < 2; simd++) {
+        ip_validator_use_simd(simd);
+        memset(bitmap, 0xff, sizeof(bitmap));
+        same = same &&
+            ip_set_contains_ipv4_batch(set, addrs, count, bitmap) == members;
+        for (size_t i = 0; i < count; i++)
+            same = same && ((bitmap[i / 8] >> (i % 8)) & 1) ==
+                ip_set_contains_ipv4(set, &addrs[i]);
+    }
+    snprintf(input, sizeof(input), "%zu addresses", count);
+    report_test_result(stats, name, input, true, true, same);
+}
+
+/**
+ * Executes the set suite: membership at the ends of both address spaces,
+ * duplicates, batch lookups of several lengths, a save and reopen, and the
+ * rejection of a damaged file.
+ */
+void run_set_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    static const char *const v4_text[] = {
+        "0.0.0.0", "10.0.0.1", "10.0.0.1", "192.168.1.1", "8.8.8.8",
+        "255.255.255.255",
+    };
+    static const char *const v6_text[] = {
+        "::", "::1", "fe80::1", "2001:db8::1", "2001:db8::1",
+        "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff",
+    };
+    static const char path[] = "/tmp/ip_validator_demo.set";
+    static struct set_fixture fx, mapped;
+    struct ip_set empty;
+    bool ok;
+
+    for (size_t i = 0; i < sizeof(v4_text) / sizeof(v4_text[0]); i++)
+        inet_pton(AF_INET, v4_text[i], &fx.v4[fx.v4_count++]);
+    for (uint32_t i = 0; i < SET_RANGE_SIZE; i += 2)
+        fx.v4[fx.v4_count++].s_addr = htonl(0xac100000u | i);
+    for (size_t i = 0; i < sizeof(v6_text) / sizeof(v6_text[0]); i++)
+        inet_pton(AF_INET6, v6_text[i], &fx.v6[fx.v6_count++]);
+
+    ok = ip_set_build(&fx.set, fx.v4, fx.v4_count, fx.v6, fx.v6_count);
+    report_test_result(ipv4_stats, "IPv4 Set: Duplicates stored once",
+                       "10.0.0.1 twice", true, true,
+                       ok && fx.set.v4_count == fx.v4_count - 1 &&
+                       fx.set.v6_count == fx.v6_count - 1);
+    if (!ok)
+        return;
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Lowest", "0.0.0.0", true);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Highest", "255.255.255.255",
+                  true);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Duplicate", "10.0.0.1", true);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Neighbour", "10.0.0.2", false);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Below highest",
+                  "255.255.255.254", false);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Range start", "172.16.0.0",
+                  true);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Range odd", "172.16.3.17",
+                  false);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Range end", "172.16.7.254",
+                  true);
+    test_case_set(ipv4_stats, &fx, "IPv4 Set: Past range", "172.16.8.0",
+                  false);
+    test_case_set(ipv6_stats, &fx, "IPv6 Set: Unspecified", "::", true);
+    test_case_set(ipv6_stats, &fx, "IPv6 Set: Highest",
+                  "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", true);
+    test_case_set(ipv6_stats, &fx, "IPv6 Set: Duplicate", "2001:db8::1",
+                  true);
+    test_case_set(ipv6_stats, &fx, "IPv6 Set: Low half differs",
+                  "2001:db8::2", false);
+    test_case_set(ipv6_stats, &fx, "IPv6 Set: High half differs",
+                  "2001:db9::1", false);
+    test_case_set(ipv6_stats, &fx, "IPv6 Set: Mapped is not IPv4",
+                  "::ffff:10.0.0.1", false);
+
+    test_case_set_batch(ipv4_stats, &fx.set, "IPv4 Set: Batch partial byte",
+                        5);
+    test_case_set_batch(ipv4_stats, &fx.set, "IPv4 Set: Batch one block", 8);
+    test_case_set_batch(ipv4_stats, &fx.set, "IPv4 Set: Batch with tail",
+                        1029);
+
+    ok = ip_set_save(&fx.set, path) && ip_set_open(&mapped.set, path);
+    if (ok) {
+        memcpy(mapped.v4, fx.v4, sizeof(fx.v4));
+        memcpy(mapped.v6, fx.v6, sizeof(fx.v6));
+        mapped.v4_count = fx.v4_count;
+        mapped.v6_count = fx.v6_count;
+        test_case_set(ipv4_stats, &mapped, "IPv4 Set: Mapped member",
+                      "172.16.4.2", true);
+        test_case_set(ipv6_stats, &mapped, "IPv6 Set: Mapped member",
+                      "fe80::1", true);
+        test_case_set(ipv6_stats, &mapped, "IPv6 Set: Mapped non-member",
+                      "fe80::2", false);
+        ok = mapped.set.mapped && mapped.set.v4_count == fx.set.v4_count;
+        ip_set_free(&mapped.set);
+    }
+    report_test_result(ipv4_stats, "IPv4 Set: Save and open", path, true,
+                       true, ok);
+    ip_set_free(&fx.set);
+
+    FILE *f = fopen(path, "r+b");
+
+    ok = f != NULL && fputc('X', f) != EOF;
+    if (f != NULL)
+        fclose(f);
+    ok = ok && !ip_set_open(&empty, path) && errno == EINVAL;
+    unlink(path);
+    report_test_result(ipv4_stats, "IPv4 Set: Damaged file", path, false,
+                       false, !ok);
+
+    ok = ip_set_build(&empty, NULL, 0, NULL, 0);
+    if (ok) {
+        struct in_addr zero = { 0 };
+        uint8_t bitmap = 0xff;
+
+        ok = !ip_set_contains_ipv4(&empty, &zero) &&
+            ip_set_contains_ipv4_batch(&empty, &zero, 1, &bitmap) == 0 &&
+            (bitmap & 1) == 0;
+        ip_set_free(&empty);
+    }
+    report_test_result(ipv4_stats, "IPv4 Set: Empty", "0.0.0.0", false, false,
+                       !ok);
+}
+
+/**
+ * Writes @len bytes of @bytes at @offset of the file at @path and reports
+ * whether ip_ruleset_open() then refuses it with EINVAL.
+ */
+void test_case_ruleset_damage(test_stats * stats, const char *name,
+                              const char *path, long offset,
+                              const void *bytes, size_t len)
+{
+    struct ip_ruleset rules;
+    FILE *f = fopen(path, "r+b");
+    bool written = f != NULL && fseek(f, offset, SEEK_SET) == 0 &&
+        fwrite(bytes, 1, len, f) == len;
+
+    if (f != NULL)
+        fclose(f);
+
+    bool opened = ip_ruleset_open(&rules, path);
+
+    if (opened)
+        ip_ruleset_close(&rules);
+    report_test_result(stats, name, path, false, false,
+                       !written || opened || errno != EINVAL);
+}
+
+/**
+ * Executes the ruleset suite: a prefix table and an address set saved to one
+ * file and mapped back, an empty ruleset, and the refusal of a wrong
+ * version, a truncated file and trie nodes that would send lookups out of
+ * bounds.
+ */
+void run_ruleset_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    static const char *const rules_text[] = {
+        "0.0.0.0/0", "10.0.0.0/8", "10.1.2.0/24", "2001:db8::/32",
+    };
+    static const char path[] = "/tmp/ip_validator_demo.rules";
+    enum { N = sizeof(rules_text) / sizeof(rules_text[0]) };
+    struct ip_prefix prefixes[N];
+    uint32_t values[N];
+    struct ip_lpm lpm, view;
+    struct ip_ruleset rules;
+    struct ip_set set;
+    struct in_addr v4[2];
+    struct in6_addr v6[1];
+    bool ok;
+
+    for (size_t i = 0; i < N; i++) {
+        parse_ip_prefix(rules_text[i], strlen(rules_text[i]), &prefixes[i]);
+        values[i] = (uint32_t)i + 1;
+    }
+    inet_pton(AF_INET, "192.0.2.1", &v4[0]);
+    inet_pton(AF_INET, "198.51.100.7", &v4[1]);
+    inet_pton(AF_INET6, "2001:db8::dead", &v6[0]);
+    if (!ip_lpm_build(&lpm, prefixes, values, N)) {
+        report_test_result(ipv4_stats, "Ruleset: Build", "rules", true, true,
+                           false);
+        return;
+    }
+    if (!ip_set_build(&set, v4, 2, v6, 1)) {
+        ip_lpm_free(&lpm);
+        report_test_result(ipv4_stats, "Ruleset: Build", "rules", true, true,
+                           false);
+        return;
+    }
+
+    ok = ip_ruleset_save(&lpm, &set, path) && ip_ruleset_open(&rules, path);
+    report_test_result(ipv4_stats, "IPv4 Ruleset: Save and open", path, true,
+                       true, ok && rules.lpm.node_count == lpm.node_count &&
+                       rules.set.v4_count == 2);
+    if (ok) {
+        struct in_addr listed = v4[1];
+
+        test_case_lpm(ipv4_stats, &rules.lpm, "IPv4 Ruleset: /24",
+                      "10.1.2.200", 3);
+        test_case_lpm(ipv4_stats, &rules.lpm, "IPv4 Ruleset: Default route",
+                      "11.0.0.1", 1);
+        test_case_lpm(ipv6_stats, &rules.lpm, "IPv6 Ruleset: /32",
+                      "2001:db8:5::1", 4);
+        test_case_lpm(ipv6_stats, &rules.lpm, "IPv6 Ruleset: No match",
+                      "2001:db9::1", IP_LPM_NONE);
+        report_test_result(ipv4_stats, "IPv4 Ruleset: Set member",
+                           "198.51.100.7", true, true,
+                           ip_set_contains_ipv4(&rules.set, &listed));
+        report_test_result(ipv6_stats, "IPv6 Ruleset: Set member",
+                           "2001:db8::dead", true, true,
+                           ip_set_contains_ipv6(&rules.set, &v6[0]));
+        ip_ruleset_close(&rules);
+    }
+
+    /* Node 0 claiming node 1, the IPv6 root, as its child. */
+    struct ip_lpm_node bad[2];
+
+    memcpy(bad, lpm.nodes, sizeof(bad));
+    bad[0].child_bits[0] |= 1;
+    bad[0].child_base = 1;
+    for (int w = 1; w < 4; w++)
+        bad[0].child_rank[w] = (uint8_t)(bad[0].child_rank[w] + 1);
+    report_test_result(ipv4_stats, "IPv4 Ruleset: Shared node refused",
+                       "node 0 -> node 1", false, false,
+                       ip_lpm_attach(&view, bad, 2, lpm.leaves,
+                                     lpm.leaf_count));
+    ip_lpm_free(&lpm);
+    ip_set_free(&set);
+
+    static const uint32_t version = IP_RULESET_VERSION + 1;
+    static const uint8_t rank = 0xff;
+
+    if (ip_ruleset_save(NULL, NULL, path) && ip_ruleset_open(&rules, path)) {
+        struct in_addr any = { 0 };
+
+        report_test_result(ipv4_stats, "IPv4 Ruleset: Empty", "0.0.0.0",
+                           false, false,
+                           ip_lpm_lookup_ipv4(&rules.lpm, &any) !=
+                           IP_LPM_NONE ||
+                           ip_set_contains_ipv4(&rules.set, &any));
+        ip_ruleset_close(&rules);
+    }
+    test_case_ruleset_damage(ipv4_stats, "IPv4 Ruleset: Newer version", path,
+                             8, &version, sizeof(version));
+
+    ok = ip_lpm_build(&lpm, prefixes, values, N);
+    if (ok) {
+        ok = ip_ruleset_save(&lpm, NULL, path);
+        ip_lpm_free(&lpm);
+    }
+    /* The first rank byte of the IPv4 root, which must be 0. */
+    if (ok)
+        test_case_ruleset_damage(ipv4_stats, "IPv4 Ruleset: Bad node rank",
+                                 path, 64 + offsetof(struct ip_lpm_node,
+                                                     child_rank), &rank, 1);
+    ok = ok && truncate(path, 100) == 0;
+    if (ok)
+        test_case_ruleset_damage(ipv4_stats, "IPv4 Ruleset: Truncated", path,
+                                 0, "I", 1);
+    unlink(path);
+}
+
+/**
+ * Writes a ruleset mapping 10.0.0.0/8 to @value to @path.
+ * Return: true on success.
+ */
+bool write_reload_ruleset(const char *path, uint32_t value)
+{
+    struct ip_prefix prefix;
+    struct ip_lpm lpm;
+
+    parse_ip_prefix("10.0.0.0/8", 10, &prefix);
+    if (!ip_lpm_build(&lpm, &prefix, &value, 1))
+        return false;
+
+    bool ok = ip_ruleset_save(&lpm, NULL, path);
+
+    ip_lpm_free(&lpm);
+    return ok;
+}
+
+/**
+ * Enters @reload through @slot and reports whether 10.1.2.3 maps to @value
+ * in the ruleset it hands out.
+ */
+void test_case_reload(test_stats * stats, struct ip_reload *reload, int slot,
+                      const char *name, uint32_t value)
+{
+    struct in_addr addr;
+    char input[32];
+
+    inet_pton(AF_INET, "10.1.2.3", &addr);
+    if (value == IP_LPM_NONE)
+        snprintf(input, sizeof(input), "10.1.2.3 -> none");
+    else
+        snprintf(input, sizeof(input), "10.1.2.3 -> %u", (unsigned)value);
+
+    const struct ip_ruleset *rules = ip_reload_enter(reload, slot);
+    uint32_t got = ip_lpm_lookup_ipv4(&rules->lpm, &addr);
+
+    ip_reload_exit(reload, slot);
+    report_test_result(stats, name, input, true, true, got == value);
+}
+
+/**
+ * Executes the hot reload suite: an empty start, two reloads, a failed
+ * reload that keeps the current ruleset, and reader slot exhaustion.
+ */
+void run_reload_tests(test_stats * ipv4_stats)
+{
+    static const char first[] = "/tmp/ip_validator_demo.rules.1";
+    static const char second[] = "/tmp/ip_validator_demo.rules.2";
+    static struct ip_reload reload;
+    int slots[IP_RELOAD_MAX_READERS];
+    int slot, extra;
+
+    if (!ip_reload_init(&reload, NULL)) {
+        report_test_result(ipv4_stats, "Reload: Init", "empty", true, true,
+                           false);
+        return;
+    }
+    slot = ip_reload_register(&reload);
+    test_case_reload(ipv4_stats, &reload, slot, "IPv4 Reload: Empty start",
+                     IP_LPM_NONE);
+    report_test_result(ipv4_stats, "IPv4 Reload: First file", first, true,
+                       true, write_reload_ruleset(first, 1) &&
+                       ip_reload_open(&reload, first));
+    test_case_reload(ipv4_stats, &reload, slot, "IPv4 Reload: First lookup",
+                     1);
+    report_test_result(ipv4_stats, "IPv4 Reload: Second file", second, true,
+                       true, write_reload_ruleset(second, 2) &&
+                       ip_reload_open(&reload, second));
+    test_case_reload(ipv4_stats, &reload, slot, "IPv4 Reload: Second lookup",
+                     2);
+    unlink(first);
+    report_test_result(ipv4_stats, "IPv4 Reload: Missing file", first, false,
+                       false, ip_reload_open(&reload, first));
+    test_case_reload(ipv4_stats, &reload, slot,
+                     "IPv4 Reload: Kept after failure", 2);
+    unlink(second);
+
+    /* One slot is taken above, so the last request must fail. */
+    for (int i = 1; i < IP_RELOAD_MAX_READERS; i++)
+        slots[i] = ip_reload_register(&reload);
+    extra = ip_reload_register(&reload);
+    ip_reload_unregister(&reload, slots[IP_RELOAD_MAX_READERS - 1]);
+    report_test_result(ipv4_stats, "IPv4 Reload: Slots exhausted",
+                       "64 readers", true, true, extra == -1 &&
+                       ip_reload_register(&reload) ==
+                       slots[IP_RELOAD_MAX_READERS - 1]);
+    ip_reload_destroy(&reload);
+}
+
+/**
+ * Reports whether ip_ipv4_error() or ip_ipv6_error() gives @want for @input
+ * and agrees with inet_pton on whether the text is valid at all.
+ */
+void test_case_error(test_stats * stats, const char *name, int family,
+                     const char *input, enum ip_error want)
+{
+    unsigned char ref[sizeof(struct in6_addr)];
+    size_t len = strlen(input);
+    enum ip_error err = family == AF_INET ? ip_ipv4_error(input, len) :
+        ip_ipv6_error(input, len);
+    bool expected = want == IP_OK;
+
+    if (err != want)
+        printf("  %s: got %s, want %s\n", input, ip_error_name(err),
+               ip_error_name(want));
+    report_test_result(stats, name, input, expected,
+                       inet_pton(family, input, ref) == 1,
+                       err == want ? err == IP_OK : !expected);
+}
+
+/**
+ * Executes the rejection-reason suite: one input per reason and family,
+ * then the outcome counters, which must either move by exactly the calls
+ * made here or, when not compiled in, stay zero.
+ */
+void run_error_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    test_case_error(ipv4_stats, "IPv4 Error: Valid", AF_INET, "10.0.0.1",
+                    IP_OK);
+    test_case_error(ipv4_stats, "IPv4 Error: Empty", AF_INET, "",
+                    IP_ERR_EMPTY);
+    test_case_error(ipv4_stats, "IPv4 Error: Too long", AF_INET,
+                    "192.168.100.2000", IP_ERR_TOO_LONG);
+    test_case_error(ipv4_stats, "IPv4 Error: Letter", AF_INET, "1.2.3.a",
+                    IP_ERR_BAD_CHAR);
+    test_case_error(ipv4_stats, "IPv4 Error: Empty octet", AF_INET,
+                    "1..2.3", IP_ERR_EMPTY_OCTET);
+    test_case_error(ipv4_stats, "IPv4 Error: Trailing dot", AF_INET,
+                    "1.2.3.", IP_ERR_EMPTY_OCTET);
+    test_case_error(ipv4_stats, "IPv4 Error: Range", AF_INET, "1.2.3.256",
+                    IP_ERR_OCTET_RANGE);
+    test_case_error(ipv4_stats, "IPv4 Error: Three octets", AF_INET,
+                    "1.2.3", IP_ERR_OCTET_COUNT);
+    test_case_error(ipv4_stats, "IPv4 Error: Five octets", AF_INET,
+                    "1.2.3.4.5", IP_ERR_OCTET_COUNT);
+    test_case_error(ipv6_stats, "IPv6 Error: Valid", AF_INET6,
+                    "2001:db8::1", IP_OK);
+    test_case_error(ipv6_stats, "IPv6 Error: Too long", AF_INET6,
+                    "0000:0000:0000:0000:0000:0000:0000:0000:0000:0000",
+                    IP_ERR_TOO_LONG);
+    test_case_error(ipv6_stats, "IPv6 Error: Letter", AF_INET6, "fe80::g",
+                    IP_ERR_BAD_CHAR);
+    test_case_error(ipv6_stats, "IPv6 Error: Leading colon", AF_INET6,
+                    ":1::2", IP_ERR_EMPTY_GROUP);
+    test_case_error(ipv6_stats, "IPv6 Error: Trailing colon", AF_INET6,
+                    "1::2:", IP_ERR_EMPTY_GROUP);
+    test_case_error(ipv6_stats, "IPv6 Error: Triple colon", AF_INET6,
+                    "1:::2", IP_ERR_EMPTY_GROUP);
+    test_case_error(ipv6_stats, "IPv6 Error: Long group", AF_INET6,
+                    "1:23456::", IP_ERR_GROUP_TOO_LONG);
+    test_case_error(ipv6_stats, "IPv6 Error: Two compressions", AF_INET6,
+                    "1::2::3", IP_ERR_MULTIPLE_COMPRESSION);
+    test_case_error(ipv6_stats, "IPv6 Error: Seven groups", AF_INET6,
+                    "1:2:3:4:5:6:7", IP_ERR_GROUP_COUNT);
+    test_case_error(ipv6_stats, "IPv6 Error: Nine groups", AF_INET6,
+                    "1:2:3:4:5:6:7:8:9", IP_ERR_GROUP_COUNT);
+    test_case_error(ipv6_stats, "IPv6 Error: Full with ::", AF_INET6,
+                    "1:2:3:4::5:6:7:8", IP_ERR_GROUP_COUNT);
+    test_case_error(ipv6_stats, "IPv6 Error: Quad range", AF_INET6,
+                    "::ffff:1.2.3.256", IP_ERR_BAD_IPV4_SUFFIX);
+    test_case_error(ipv6_stats, "IPv6 Error: Short quad", AF_INET6,
+                    "::ffff:1.2.3", IP_ERR_BAD_IPV4_SUFFIX);
+    test_case_error(ipv6_stats, "IPv6 Error: Quad not last", AF_INET6,
+                    "::1.2.3.4:5", IP_ERR_BAD_IPV4_SUFFIX);
+    test_case_error(ipv6_stats, "IPv6 Error: Hex quad", AF_INET6,
+                    "::ffff:a.2.3.4", IP_ERR_BAD_IPV4_SUFFIX);
+
+    struct ip_validator_stats before, after;
+    struct in6_addr addr;
+
+    ip_validator_stats_flush();
+    bool counting = ip_validator_stats_snapshot(&before);
+
+    is_valid_ipv4_address("10.0.0.1");
+    is_valid_ipv4_address("10.0.0.300");
+    is_valid_ipv6_address("1::2::3");
+    parse_ipv6_address("::1", 3, &addr);
+    parse_ipv4_address("10.0.0.2", 8, NULL);    /* Rejected, not counted */
+    ip_validator_stats_flush();
+    ip_validator_stats_snapshot(&after);
+
+    bool moved = after.ipv4[IP_OK] - before.ipv4[IP_OK] == 1 &&
+        after.ipv4[IP_ERR_OCTET_RANGE] - before.ipv4[IP_ERR_OCTET_RANGE] ==
+        1 && after.ipv6[IP_OK] - before.ipv6[IP_OK] == 1 &&
+        after.ipv6[IP_ERR_MULTIPLE_COMPRESSION] -
+        before.ipv6[IP_ERR_MULTIPLE_COMPRESSION] == 1;
+    bool zero = after.ipv4[IP_OK] == 0 && after.ipv6[IP_OK] == 0;
+
+    report_test_result(ipv4_stats, "Validator Stats: Counters",
+                       counting ? "compiled in" : "compiled out", true, true,
+                       counting ? moved : zero);
+}
+
+/**
+ * Runs one IPv4 input through the vector and scalar paths and reports whether
+ * both agree with @expected and produce the same bytes.
+ */
+void test_case_ipv4_simd(test_stats * stats, const char *name,
+                         const char *input, bool expected)
+{
+    struct in_addr vec = { 0 }, scalar = { 0 };
+
+    ip_validator_use_simd(true);
+    bool result_vec = parse_ipv4_address(input, strlen(input), &vec);
+    ip_validator_use_simd(false);
+    bool result_scalar = parse_ipv4_address(input, strlen(input), &scalar);
+    ip_validator_use_simd(true);
+
+    if (result_vec && result_scalar)
+        result_vec = memcmp(&vec, &scalar, sizeof(vec)) == 0;
+    report_test_result(stats, name, input, expected, result_scalar,
+                       result_vec);
+}
+
+/**
+ * Runs one IPv6 input through the vector and scalar paths and reports whether
+ * both agree with @expected and produce the same bytes.
+ */
+void test_case_ipv6_simd(test_stats * stats, const char *name,
+                         const char *input, bool expected)
+{
+    struct in6_addr vec = IN6ADDR_ANY_INIT, scalar = IN6ADDR_ANY_INIT;
+
+    ip_validator_use_simd(true);
+    bool result_vec = parse_ipv6_address(input, strlen(input), &vec);
+    ip_validator_use_simd(false);
+    bool result_scalar = parse_ipv6_address(input, strlen(input), &scalar);
+    ip_validator_use_simd(true);
+
+    if (result_vec && result_scalar)
+        result_vec = memcmp(&vec, &scalar, sizeof(vec)) == 0;
+    report_test_result(stats, name, input, expected, result_scalar,
+                       result_vec);
+}
+
+/**
+ * Executes the vector-kernel parity suite. Inputs mirror the octet layouts the
+ * kernel derives from its dot bitmask, plus the leading-zero forms it hands
+ * back to the scalar parser.
+ */
+void run_simd_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    printf("Vector kernel: %s\n", ip_validator_simd_name());
+
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Shortest", "1.2.3.4", true);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Longest", "255.255.255.255",
+                        true);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Mixed widths", "9.87.654.32",
+                        false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Mixed widths valid",
+                        "9.87.254.32", true);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Hundreds boundary",
+                        "199.200.249.250", true);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Last octet 256", "1.1.1.256",
+                        false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: First octet 300", "300.1.1.1",
+                        false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Two-digit leading zero",
+                        "01.2.3.4", true);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Four-digit leading zeros",
+                        "0001.2.3.4", true);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Four-digit overflow",
+                        "1000.2.3.4", false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Empty middle octet", "1..3.4",
+                        false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Trailing dot", "1.2.3.", false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Letter", "1.2.3.a", false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Embedded space", "1.2.3 .4",
+                        false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: Five octets", "1.2.3.4.5",
+                        false);
+    test_case_ipv4_simd(ipv4_stats, "IPv4 SIMD: High byte", "1.2.3.\xb9",
+                        false);
+
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Full width",
+                        "2001:0db8:85a3:0000:0000:8a2e:0370:7334", true);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Group in second block",
+                        "0:0:0:0:0:0:0:0000000000000000000000000001", false);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Compression position",
+                        "a:b::c:d", true);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Leading compression",
+                        "::2:3:4:5:6:7:8", true);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Trailing compression",
+                        "1:2:3:4:5:6:7::", true);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Compression with 8 groups",
+                        "1:2:3:4::5:6:7:8", false);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Five digit group",
+                        "1:2:3:4:5:6:7:12345", false);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Triple colon", "1:::2", false);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Two compressions", "1::2::3",
+                        false);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Lone leading colon", ":1::2",
+                        false);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Lone trailing colon", "1::2:",
+                        false);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Uppercase hex", "FE80::ABCD",
+                        true);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Dotted tail to scalar",
+                        "::ffff:10.1.2.3", true);
+    test_case_ipv6_simd(ipv6_stats, "IPv6 SIMD: Non-hex letter", "fe80::g",
+                        false);
+}
+
+/**
+ * Reports whether ip_batch_validate() with every part agrees with
+ * parse_ipv4_address() or parse_ipv6_address(), the ip_*_error() reasons and
+ * format_*_address() on each of @count inputs.
+ */
+void test_case_arena_batch(test_stats * stats, struct ip_arena *arena,
+                           const char *name, int family,
+                           const char *const *inputs, size_t count)
+{
+    size_t lens[16];
+    struct ip_batch batch;
+    char input[32];
+    bool same;
+
+    for (size_t i = 0; i < count; i++)
+        lens[i] = strlen(inputs[i]);
+    same = ip_batch_validate(inputs, lens, count, family,
+                             IP_BATCH_ERRORS | IP_BATCH_TEXT, arena, &batch) &&
+        batch.count == count && batch.addrs != NULL;
+
+    size_t valid = 0;
+
+    for (size_t i = 0; same && i < count; i++) {
+        struct ip_address addr;
+        char text[INET6_ADDRSTRLEN];
+        size_t text_len = 0;
+        enum ip_error err;
+        bool ok;
+
+        addr.family = family;
+        if (family == AF_INET) {
+            ok = parse_ipv4_address(inputs[i], lens[i], &addr.v4);
+            err = ip_ipv4_error(inputs[i], lens[i]);
+            if (ok)
+                text_len = format_ipv4_address(&addr.v4, text, sizeof(text));
+        } else {
+            ok = parse_ipv6_address(inputs[i], lens[i], &addr.v6);
+            err = ip_ipv6_error(inputs[i], lens[i]);
+            if (ok)
+                text_len = format_ipv6_address(&addr.v6, text, sizeof(text));
+        }
+        valid += ok;
+
+        size_t start = (size_t)batch.text_offsets[i];
+
+        same = ((batch.validity[i / 8] >> (i % 8)) & 1) == ok &&
+            batch.errors[i] == err &&
+            (size_t)batch.text_offsets[i + 1] - start == text_len &&
+            memcmp(batch.text + start, text, text_len) == 0;
+    }
+    same = same && batch.valid == valid &&
+        batch.text_len == (size_t)batch.text_offsets[count];
+    snprintf(input, sizeof(input), "%zu entries", count);
+    report_test_result(stats, name, input, true, true, same);
+}
+
+/**
+ * Executes the arena suite: batches of both families checked entry by entry,
+ * exact size queries, reuse after a reset, and scans that finish in one call
+ * or resume when the arena fills.
+ */
+void run_arena_tests(test_stats * ipv4_stats, test_stats * ipv6_stats)
+{
+    static const char *const v4_inputs[] = {
+        "192.168.1.1", "256.1.1.1", "1.2.3", "0.0.0.0", "01.2.3.4",
+        "255.255.255.255", "", "10.0.0.1 ", "8.8.8.8",
+    };
+    static const char *const v6_inputs[] = {
+        "::1", "1:::2", "2001:DB8:0:0:0:0:0:1", "::ffff:10.1.2.3",
+        "1::2::3", "fe80::a:b:c:d", "12345::",
+    };
+    static const char scan_text[] = "from 10.0.0.1, to [::1]:443 via 1.2.3.4.5";
+    static const char dense_text[] = "::,::,::,::";
+    static _Alignas(IP_ARENA_ALIGN) unsigned char mem[8192];
+    struct ip_arena arena;
+    struct ip_batch batch;
+    struct ip_match *matches;
+    size_t v4_count = sizeof(v4_inputs) / sizeof(v4_inputs[0]);
+    size_t v4_lens[sizeof(v4_inputs) / sizeof(v4_inputs[0])];
+    size_t need, pos, n;
+    bool ok;
+
+    for (size_t i = 0; i < v4_count; i++)
+        v4_lens[i] = strlen(v4_inputs[i]);
+
+    ip_arena_init(&arena, mem, sizeof(mem));
+    test_case_arena_batch(ipv4_stats, &arena, "IPv4 Arena: Batch", AF_INET,
+                          v4_inputs, v4_count);
+    test_case_arena_batch(ipv6_stats, &arena, "IPv6 Arena: Batch", AF_INET6,
+                          v6_inputs, sizeof(v6_inputs) / sizeof(v6_inputs[0]));
+
+    /* An arena of exactly the reported size holds the batch, one less not. */
+    need = ip_batch_arena_size(v4_count, AF_INET, IP_BATCH_ERRORS);
+    ip_arena_init(&arena, mem, need);
+    ok = ip_batch_validate(v4_inputs, v4_lens, v4_count, AF_INET,
+                           IP_BATCH_ERRORS, &arena, &batch) &&
+        arena.used == need && batch.addrs == NULL && batch.text == NULL;
+    report_test_result(ipv4_stats, "IPv4 Arena: Exact size", "errors only",
+                       true, true, ok);
+    ip_arena_init(&arena, mem, need - 1);
+    ok = ip_batch_validate(v4_inputs, v4_lens, v4_count, AF_INET,
+                           IP_BATCH_ERRORS, &arena, &batch);
+    report_test_result(ipv4_stats, "IPv4 Arena: Too small", "errors only",
+                       false, false, ok || arena.used != 0);
+
+    /* Batches after a reset reuse the same memory. */
+    need = ip_batch_arena_size(v4_count, AF_INET, IP_BATCH_TEXT);
+    ip_arena_init(&arena, mem, sizeof(mem));
+    ok = true;
+    for (int round = 0; ok && round < 4; round++) {
+        ip_arena_reset(&arena);
+        ok = ip_batch_validate(v4_inputs, v4_lens, v4_count, AF_INET,
+                               IP_BATCH_TEXT, &arena, &batch) &&
+            (unsigned char *)batch.validity == mem && batch.valid == 5;
+    }
+    report_test_result(ipv4_stats, "IPv4 Arena: Reset per batch", "4 rounds",
+                       true, true, ok && arena.peak == need);
+
+    report_test_result(ipv4_stats, "IPv4 Arena: Unknown family", "AF_UNIX",
+                       false, false,
+                       ip_batch_arena_size(1, AF_UNIX, 0) != 0 ||
+                       ip_batch_validate(v4_inputs, v4_lens, 1, AF_UNIX, 0,
+                                         &arena, &batch));
+
+    ip_arena_init(&arena, mem, ip_scan_arena_size(strlen(scan_text)));
+    pos = 0;
+    n = ip_scan_arena(scan_text, strlen(scan_text), &pos, AF_UNSPEC, &arena,
+                      &matches);
+    ok = n == 2 && pos == strlen(scan_text) &&
+        matches[0].addr.family == AF_INET && matches[0].offset == 5 &&
+        matches[1].addr.family == AF_INET6 && matches[1].len == 3;
+    report_test_result(ipv6_stats, "IPv6 Arena: Scan in one call", scan_text,
+                       true, true, ok);
+
+    ip_arena_init(&arena, mem, ip_scan_arena_size(strlen(dense_text)));
+    pos = 0;
+    n = ip_scan_arena(dense_text, strlen(dense_text), &pos, AF_INET6, &arena,
+                      &matches);
+    report_test_result(ipv6_stats, "IPv6 Arena: Densest text", dense_text,
+                       true, true, n == 4 && pos == strlen(dense_text));
+
+    /* Room for one match: each call finds the next, resuming from *pos. */
+    ip_arena_init(&arena, mem, sizeof(struct ip_match) + IP_ARENA_ALIGN - 1);
+    pos = 0;
+    ok = arena.size / sizeof(struct ip_match) == 1;
+    for (size_t found = 0; ok && found < 2; found++) {
+        ip_arena_reset(&arena);
+        n = ip_scan_arena(scan_text, strlen(scan_text), &pos, AF_UNSPEC,
+                          &arena, &matches);
+        ok = n == 1 && (unsigned char *)matches == mem &&
+            matches[0].addr.family == (found == 0 ? AF_INET : AF_INET6);
+    }
+    report_test_result(ipv6_stats, "IPv6 Arena: Scan resumes when full",
+                       scan_text, true, true, ok);
+}
+
 /**
  * Prints per-family pass/fail counts and aggregated totals after suite
  * execution.
@@ -387,6 +2282,23 @@ int main(int argc, char *argv[])
         test_stats ipv6_stats = { 0, 0 };
         run_ipv4_tests(&ipv4_stats);
         run_ipv6_tests(&ipv6_stats);
+        run_slice_tests(&ipv4_stats, &ipv6_stats);
+        run_parse_tests(&ipv4_stats, &ipv6_stats);
+        run_batch_tests(&ipv4_stats, &ipv6_stats);
+        run_stream_tests(&ipv4_stats, &ipv6_stats);
+        run_scan_tests(&ipv4_stats, &ipv6_stats);
+        run_prefix_tests(&ipv4_stats, &ipv6_stats);
+        run_classify_tests(&ipv4_stats, &ipv6_stats);
+        run_format_tests(&ipv4_stats, &ipv6_stats);
+        run_policy_tests(&ipv4_stats, &ipv6_stats);
+        run_zone_tests(&ipv6_stats);
+        run_cache_tests(&ipv4_stats, &ipv6_stats);
+        run_error_tests(&ipv4_stats, &ipv6_stats);
+        run_set_tests(&ipv4_stats, &ipv6_stats);
+        run_ruleset_tests(&ipv4_stats, &ipv6_stats);
+        run_reload_tests(&ipv4_stats);
+        run_simd_tests(&ipv4_stats, &ipv6_stats);
+        run_arena_tests(&ipv4_stats, &ipv6_stats);
         print_summary(&ipv4_stats, &ipv6_stats);
         return 0;
     }
@@ -0,0 +1,651 @@
+/*
+ * Differential fuzzer: runs every candidate through the validators, the
+ * parsing policies, the stream context, the rejection diagnostics and the
+ * formatters, and checks each verdict and address against inet_pton() and
+ * inet_ntop().
+ *
+ * Three ways to drive it:
+ *
+ *   ipfuzz [-n count] [-t threads] [-s seed]   generate candidates
+ *   ipfuzz -S ...                              same, on the scalar path
+ *   ipfuzz file...                             replay inputs, e.g. for AFL
+ *   ipfuzz-libfuzzer corpus/                   libFuzzer (make fuzz-libfuzzer)
+ *
+ * Generated candidates come from a small grammar of near-addresses: dotted
+ * quads and colon groups with random widths, leading zeros, extra or missing
+ * separators, "::" in random places and embedded quads, followed by a few
+ * random byte edits. Only mismatches are printed, then a summary with the
+ * throughput.
+ *
+ * glibc's inet_pton() rejects leading zeros in dotted quads, so it is the
+ * exact reference for the IP_PARSE_NO_LEADING_ZEROS parsers. The default
+ * parsers are checked against inet_pton() of the text with those zeros
+ * removed.
+ */
+
+#include "ip_validator.h"
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>             /* getopt */
+
+/* Longest input compared byte for byte; longer ones must be rejected. */
+#define FUZZ_MAX_TEXT 256
+
+/* Longest generated candidate. */
+#define FUZZ_MAX_CANDIDATE 96
+
+/* Bytes gen_octet() may touch, counting the NUL snprintf() writes. */
+#define FUZZ_MAX_OCTET 8
+
+/* gen_ipv6() stops adding groups at this length; a group adds at most 7. */
+#define FUZZ_MAX_GROUPS_LEN 48
+_Static_assert(FUZZ_MAX_GROUPS_LEN + 7 < FUZZ_MAX_CANDIDATE,
+               "colon groups must leave room in the candidate buffer");
+
+/* Default number of generated candidates. */
+#define FUZZ_DEFAULT_COUNT 10000000ULL
+
+/* Mismatches printed before the rest are only counted. */
+#define FUZZ_DEFAULT_REPORTS 20
+
+/* Candidates a worker checks between progress updates. */
+#define FUZZ_BLOCK 4096
+
+/* Shared state of a run; workers only touch it between blocks. */
+struct fuzz_run {
+    unsigned long long count;
+    uint64_t seed;
+    unsigned long max_reports;
+    _Atomic unsigned long long next;    /* First candidate not yet claimed */
+    _Atomic unsigned long long mismatches;
+    _Atomic unsigned long long valid4;
+    _Atomic unsigned long long valid6;
+    pthread_mutex_t report_lock;
+};
+
+static ip_parse_ipv4_fn strict_ipv4;
+static ip_parse_ipv6_fn strict_ipv6;
+
+/**
+ * fuzz_report - Print one mismatch.
+ * @run: Run whose report budget to use, or NULL to always print.
+ * @what: Name of the failed check.
+ * @buf: Candidate bytes.
+ * @len: Number of bytes of @buf.
+ */
+static void fuzz_report(struct fuzz_run *run, const char *what,
+                        const char *buf, size_t len)
+{
+    unsigned long long n = 0;
+
+    if (run != NULL) {
+        n = atomic_fetch_add_explicit(&run->mismatches, 1,
+                                      memory_order_relaxed);
+        if (n >= run->max_reports)
+            return;
+        pthread_mutex_lock(&run->report_lock);
+    }
+    printf("MISMATCH %s: \"", what);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)buf[i];
+
+        if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\')
+            putchar(c);
+        else
+            printf("\\x%02x", c);
+    }
+    printf("\"\n");
+    if (run != NULL)
+        pthread_mutex_unlock(&run->report_lock);
+}
+
+/**
+ * strip_quad_zeros - Remove leading zeros from the octets of a dotted quad.
+ * @family: AF_INET, or AF_INET6 to strip only after the last ':'.
+ * @text: NUL-terminated candidate of fewer than FUZZ_MAX_TEXT bytes.
+ * @out: Output buffer of FUZZ_MAX_TEXT bytes.
+ *
+ * Also applies the length limits the default parsers put on a quad, which
+ * inet_pton() does not have once the zeros are gone.
+ *
+ * Return: false if the default parsers must reject @text for its length.
+ */
+static bool strip_quad_zeros(int family, const char *text, char *out)
+{
+    size_t len = strlen(text);
+    size_t quad = 0;
+    size_t n = 0;
+
+    if (family == AF_INET) {
+        if (len >= INET_ADDRSTRLEN)
+            return false;
+    } else {
+        if (len >= INET6_ADDRSTRLEN)
+            return false;
+        const char *colon = strrchr(text, ':');
+
+        if (colon != NULL)
+            quad = (size_t)(colon - text) + 1;
+        if (strchr(text + quad, '.') != NULL) {
+            /* The quad shares its budget with a 4-digit group. */
+            if (len - quad >= INET_ADDRSTRLEN ||
+                strcspn(text + quad, ".") > 4)
+                return false;
+        } else {
+            quad = len;
+        }
+    }
+    memcpy(out, text, quad);
+    n = quad;
+    for (size_t i = quad; i < len; i++) {
+        if (i == quad || text[i - 1] == '.') {
+            while (text[i] == '0' && text[i + 1] >= '0' && text[i + 1] <= '9')
+                i++;
+        }
+        out[n++] = text[i];
+    }
+    out[n] = '\0';
+    return true;
+}
+
+/**
+ * fuzz_check - Run one candidate through every check.
+ * @run: Run to count and report into, or NULL to report everything.
+ * @buf: Candidate bytes; need not be NUL-terminated.
+ * @len: Number of bytes of @buf.
+ * @cut: Where to split the text between two ip_stream_feed() calls.
+ * @valid: Optional counts of valid IPv4 and IPv6 candidates to update.
+ *
+ * Return: number of failed checks.
+ */
+static int fuzz_check(struct fuzz_run *run, const char *buf, size_t len,
+                      size_t cut, unsigned long long valid[2])
+{
+    char text[FUZZ_MAX_TEXT];
+    char stripped[FUZZ_MAX_TEXT];
+    char out[INET6_ADDRSTRLEN];
+    char ref_out[INET6_ADDRSTRLEN];
+    struct in_addr a4, r4;
+    struct in6_addr a6, r6;
+    struct ip_stream stream;
+    struct ip_address sa;
+    int failed = 0;
+
+    /* inet_pton() sees a C string; embedded NULs and long text never pass. */
+    bool comparable = len < sizeof(text) && memchr(buf, '\0', len) == NULL;
+
+    if (comparable) {
+        memcpy(text, buf, len);
+        text[len] = '\0';
+    }
+
+#define FUZZ_EXPECT(cond, what)                                 \
+    do {                                                        \
+        if (!(cond)) {                                          \
+            fuzz_report(run, what, buf, len);                   \
+            failed++;                                           \
+        }                                                       \
+    } while (0)
+
+    /* Strict policy: exactly inet_pton(). */
+    bool ref = comparable && inet_pton(AF_INET, text, &r4) == 1;
+    bool ok = strict_ipv4(buf, len, &a4);
+
+    FUZZ_EXPECT(ok == ref && (!ok || a4.s_addr == r4.s_addr),
+                "ipv4 strict vs inet_pton");
+
+    ref = comparable && inet_pton(AF_INET6, text, &r6) == 1;
+    ok = strict_ipv6(buf, len, &a6);
+    FUZZ_EXPECT(ok == ref && (!ok || memcmp(&a6, &r6, sizeof(a6)) == 0),
+                "ipv6 strict vs inet_pton");
+
+    /* Default policy: inet_pton() once leading zeros are stripped. */
+    ref = comparable && strip_quad_zeros(AF_INET, text, stripped) &&
+        inet_pton(AF_INET, stripped, &r4) == 1;
+    bool v4 = parse_ipv4_address(buf, len, &a4);
+
+    FUZZ_EXPECT(v4 == ref && (!v4 || a4.s_addr == r4.s_addr),
+                "ipv4 default vs inet_pton");
+    FUZZ_EXPECT(is_valid_ipv4_address_len(buf, len) == v4,
+                "ipv4 is_valid vs parse");
+    FUZZ_EXPECT((ip_ipv4_error(buf, len) == IP_OK) == v4,
+                "ipv4 error vs parse");
+
+    ref = comparable && strip_quad_zeros(AF_INET6, text, stripped) &&
+        inet_pton(AF_INET6, stripped, &r6) == 1;
+    bool v6 = parse_ipv6_address(buf, len, &a6);
+
+    FUZZ_EXPECT(v6 == ref && (!v6 || memcmp(&a6, &r6, sizeof(a6)) == 0),
+                "ipv6 default vs inet_pton");
+    FUZZ_EXPECT(is_valid_ipv6_address_len(buf, len) == v6,
+                "ipv6 is_valid vs parse");
+    FUZZ_EXPECT((ip_ipv6_error(buf, len) == IP_OK) == v6,
+                "ipv6 error vs parse");
+
+    /* Stream context: the scalar DFA, fed in two pieces. */
+    if (cut > len)
+        cut = len;
+    ip_stream_init(&stream, AF_UNSPEC);
+    ip_stream_feed(&stream, buf, cut);
+    ip_stream_feed(&stream, buf + cut, len - cut);
+    ok = ip_stream_finish(&stream, &sa);
+    FUZZ_EXPECT(ok == (v4 || v6) &&
+                (!ok || (sa.family == AF_INET ? v4 &&
+                         sa.v4.s_addr == a4.s_addr : v6 &&
+                         memcmp(&sa.v6, &a6, sizeof(a6)) == 0)),
+                "stream vs parse");
+
+    /* Formatters: inet_ntop() text for IPv4, a lossless round trip for v6. */
+    if (v4) {
+        size_t n = format_ipv4_address(&a4, out, sizeof(out));
+
+        inet_ntop(AF_INET, &a4, ref_out, sizeof(ref_out));
+        FUZZ_EXPECT(n == strlen(ref_out) && strcmp(out, ref_out) == 0,
+                    "format_ipv4_address vs inet_ntop");
+    }
+    if (v6) {
+        size_t n = format_ipv6_address(&a6, out, sizeof(out));
+
+        FUZZ_EXPECT(n == strlen(out) && inet_pton(AF_INET6, out, &r6) == 1 &&
+                    memcmp(&a6, &r6, sizeof(a6)) == 0,
+                    "format_ipv6_address round trip");
+    }
+#undef FUZZ_EXPECT
+
+    if (valid != NULL) {
+        valid[0] += v4;
+        valid[1] += v6;
+    }
+    return failed;
+}
+
+/**
+ * fuzz_setup - Pick the strict parsers once, before any check runs.
+ */
+static void fuzz_setup(void)
+{
+    strict_ipv4 = ip_ipv4_parser(IP_PARSE_NO_LEADING_ZEROS);
+    strict_ipv6 = ip_ipv6_parser(IP_PARSE_NO_LEADING_ZEROS);
+}
+
+#ifdef IP_FUZZ_LIBFUZZER
+
+/**
+ * LLVMFuzzerTestOneInput - libFuzzer entry point.
+ * @data: Candidate bytes.
+ * @size: Number of bytes of @data.
+ *
+ * A mismatch aborts, so libFuzzer saves the input that caused it.
+ *
+ * Return: 0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (strict_ipv4 == NULL)
+        fuzz_setup();
+    if (fuzz_check(NULL, (const char *)data, size, size / 2, NULL) != 0)
+        abort();
+    return 0;
+}
+
+#else
+
+/* xorshift64* generator; each worker block has its own stream. */
+struct fuzz_rng {
+    uint64_t state;
+};
+
+/**
+ * Returns the next pseudo-random 32-bit value.
+ */
+static uint32_t rng_next(struct fuzz_rng *r)
+{
+    r->state ^= r->state >> 12;
+    r->state ^= r->state << 25;
+    r->state ^= r->state >> 27;
+    return (uint32_t)((r->state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+/**
+ * Returns a pseudo-random value in [0, n).
+ */
+static uint32_t rng_below(struct fuzz_rng *r, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)rng_next(r) * n) >> 32);
+}
+
+/* Bytes the mutator inserts: address syntax, near misses and junk. */
+static const char fuzz_alphabet[] =
+    "0123456789abcdefABCDEF..::%xXgG/ \t-+\xff";
+
+/**
+ * gen_octet - Append one dotted-quad octet, often not a valid one.
+ * @r: Generator.
+ * @out: Output position.
+ *
+ * Return: number of bytes written, at most FUZZ_MAX_OCTET - 1.
+ */
+static size_t gen_octet(struct fuzz_rng *r, char *out)
+{
+    unsigned int zeros = rng_below(r, 8) == 0 ? rng_below(r, 4) : 0;
+    unsigned int value;
+    size_t n = 0;
+
+    switch (rng_below(r, 16)) {
+    case 0:
+        return 0;               /* Empty octet */
+    case 1:
+        value = 256 + rng_below(r, 800);
+        break;
+    case 2:
+        value = rng_below(r, 10);
+        break;
+    default:
+        value = rng_below(r, 256);
+        break;
+    }
+    while (zeros-- > 0)
+        out[n++] = '0';
+    return n + (size_t)snprintf(out + n, 5, "%u", value);
+}
+
+/**
+ * gen_quad - Append a dotted quad, usually of four octets.
+ * @r: Generator.
+ * @out: Output position.
+ * @room: Bytes available at @out; octets that would not fit are dropped.
+ *
+ * Return: number of bytes written, less than @room.
+ */
+static size_t gen_quad(struct fuzz_rng *r, char *out, size_t room)
+{
+    unsigned int octets = rng_below(r, 8) == 0 ? 1 + rng_below(r, 6) : 4;
+    size_t n = 0;
+
+    for (unsigned int i = 0; i < octets && n + 1 + FUZZ_MAX_OCTET <= room;
+         i++) {
+        if (i > 0)
+            out[n++] = '.';
+        n += gen_octet(r, out + n);
+    }
+    return n;
+}
+
+/**
+ * gen_ipv6 - Append colon groups with any number of "::" and an optional
+ *            quad.
+ * @r: Generator.
+ * @out: Output buffer of FUZZ_MAX_CANDIDATE bytes.
+ *
+ * Return: number of bytes written.
+ */
+static size_t gen_ipv6(struct fuzz_rng *r, char *out)
+{
+    static const char hex[] = "0123456789abcdef0123456789ABCDEF";
+    unsigned int groups = rng_below(r, 10);
+    bool quad = rng_below(r, 4) == 0;
+    int compress_at = rng_below(r, 3) == 0 ? -1 :
+        (int)rng_below(r, groups + 1);
+    size_t n = 0;
+
+    for (unsigned int g = 0; g <= groups && n < FUZZ_MAX_GROUPS_LEN; g++) {
+        if ((int)g == compress_at || (g > 0 && rng_below(r, 64) == 0)) {
+            out[n++] = ':';
+            out[n++] = ':';
+        } else if (g > 0) {
+            out[n++] = ':';
+        }
+        if (g == groups)
+            break;
+        unsigned int digits = rng_below(r, 16) == 0 ? rng_below(r, 6) :
+            1 + rng_below(r, 4);
+        unsigned int upper = rng_below(r, 4) == 0 ? 16 : 0;
+
+        for (unsigned int d = 0; d < digits; d++)
+            out[n++] = hex[upper + rng_below(r, 16)];
+    }
+    /* Drop the separator left after the last group unless it is "::". */
+    if (n > 0 && out[n - 1] == ':' && (n < 2 || out[n - 2] != ':') &&
+        rng_below(r, 8) != 0)
+        n--;
+    if (quad) {
+        if (n > 0 && out[n - 1] != ':')
+            out[n++] = ':';
+        n += gen_quad(r, out + n, FUZZ_MAX_CANDIDATE - n);
+    }
+    return n;
+}
+
+/**
+ * gen_candidate - Write one grammar-guided candidate.
+ * @r: Generator.
+ * @out: Output buffer of FUZZ_MAX_CANDIDATE bytes.
+ *
+ * Return: length of the candidate.
+ */
+static size_t gen_candidate(struct fuzz_rng *r, char *out)
+{
+    size_t n;
+
+    switch (rng_below(r, 8)) {
+    case 0:
+    case 1:
+    case 2:
+        n = gen_quad(r, out, FUZZ_MAX_CANDIDATE);
+        break;
+    case 7:
+        n = rng_below(r, 48);
+        for (size_t i = 0; i < n; i++)
+            out[i] = fuzz_alphabet[rng_below(r, sizeof(fuzz_alphabet) - 1)];
+        break;
+    default:
+        n = gen_ipv6(r, out);
+        break;
+    }
+
+    /* A few random edits turn valid text into near misses and back. */
+    for (unsigned int e = rng_below(r, 4); e > 0; e--) {
+        size_t at = rng_below(r, (uint32_t)n + 1);
+        char c = fuzz_alphabet[rng_below(r, sizeof(fuzz_alphabet) - 1)];
+
+        switch (rng_below(r, 3)) {
+        case 0:
+            if (n < FUZZ_MAX_CANDIDATE - 1) {
+                memmove(out + at + 1, out + at, n - at);
+                out[at] = c;
+                n++;
+            }
+            break;
+        case 1:
+            if (at < n) {
+                memmove(out + at, out + at + 1, n - at - 1);
+                n--;
+            }
+            break;
+        default:
+            if (at < n)
+                out[at] = c;
+            break;
+        }
+    }
+    return n;
+}
+
+/**
+ * fuzz_worker - Claim blocks of candidates and check them.
+ * @arg: Shared struct fuzz_run.
+ *
+ * Candidate i of a run depends only on the seed and i / FUZZ_BLOCK, so a
+ * report can be reproduced whatever the thread count.
+ *
+ * Return: NULL.
+ */
+static void *fuzz_worker(void *arg)
+{
+    struct fuzz_run *run = arg;
+    char buf[FUZZ_MAX_CANDIDATE + 1];
+
+    for (;;) {
+        unsigned long long first =
+            atomic_fetch_add_explicit(&run->next, FUZZ_BLOCK,
+                                      memory_order_relaxed);
+
+        if (first >= run->count)
+            return NULL;
+
+        unsigned long long last = first + FUZZ_BLOCK < run->count ?
+            first + FUZZ_BLOCK : run->count;
+        struct fuzz_rng rng = {
+            (run->seed ^ (first / FUZZ_BLOCK) * 0x9e3779b97f4a7c15ULL) | 1
+        };
+
+        unsigned long long valid[2] = { 0, 0 };
+
+        for (unsigned long long i = first; i < last; i++) {
+            size_t len = gen_candidate(&rng, buf);
+
+            fuzz_check(run, buf, len, rng_below(&rng, (uint32_t)len + 1),
+                       valid);
+        }
+        atomic_fetch_add_explicit(&run->valid4, valid[0],
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&run->valid6, valid[1],
+                                  memory_order_relaxed);
+    }
+}
+
+/**
+ * fuzz_replay - Check the contents of one file as a single candidate.
+ * @path: File to read; "-" for standard input.
+ *
+ * Return: number of failed checks, or -1 if the file could not be read.
+ */
+static int fuzz_replay(const char *path)
+{
+    static char buf[1 << 16];
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    size_t len = fread(buf, 1, sizeof(buf), f);
+
+    if (f != stdin)
+        fclose(f);
+    return fuzz_check(NULL, buf, len, len / 2, NULL);
+}
+
+/**
+ * Explains command-line options for the fuzzer.
+ */
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [-S] [-n <count>] [-t <threads>] [-s <seed>] "
+           "[-m <reports>]\n", prog);
+    printf("       %s <file>...\n", prog);
+    printf("       Checks generated candidates, or the contents of each\n");
+    printf("       <file> (\"-\" for standard input), against inet_pton()\n");
+    printf("       and prints only mismatches and a summary. -S forces\n");
+    printf("       the scalar parsers.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long count = FUZZ_DEFAULT_COUNT;
+    unsigned long long seed = 1;
+    unsigned long max_reports = FUZZ_DEFAULT_REPORTS;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:s:m:Sh")) != -1) {
+        switch (opt) {
+        case 'S':
+            ip_validator_use_simd(false);
+            break;
+        case 'n':
+            count = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'm':
+            max_reports = strtoul(optarg, NULL, 10);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1 || threads > 1024) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    fuzz_setup();
+
+    if (optind < argc) {
+        int failed = 0;
+
+        for (int i = optind; i < argc; i++) {
+            int n = fuzz_replay(argv[i]);
+
+            if (n < 0)
+                return 2;
+            failed += n;
+        }
+        return failed != 0;
+    }
+
+    struct fuzz_run run = {
+        .count = count,
+        .seed = seed,
+        .max_reports = max_reports,
+    };
+    pthread_t *workers = malloc((size_t)threads * sizeof(*workers));
+    struct timespec start, end;
+
+    if (workers == NULL) {
+        perror("malloc");
+        return 2;
+    }
+    pthread_mutex_init(&run.report_lock, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long w = 0; w < threads; w++) {
+        if (pthread_create(&workers[w], NULL, fuzz_worker, &run) != 0) {
+            perror("pthread_create");
+            return 2;
+        }
+    }
+    for (long w = 0; w < threads; w++)
+        pthread_join(workers[w], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(workers);
+    pthread_mutex_destroy(&run.report_lock);
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) +
+        (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    unsigned long long mismatches = atomic_load(&run.mismatches);
+
+    printf("candidates %llu ipv4 %llu ipv6 %llu mismatches %llu\n", count,
+           atomic_load(&run.valid4), atomic_load(&run.valid6), mismatches);
+    printf("threads %ld seed %llu simd %s seconds %.3f candidates/s %.0f\n",
+           threads, seed, ip_validator_simd_name(), seconds,
+           seconds > 0 ? (double)count / seconds : 0.0);
+    return mismatches != 0;
+}
+
+#endif                          /* IP_FUZZ_LIBFUZZER */
@@ -0,0 +1,279 @@
+/*
+ * Caller-owned result memory for the batch and scan entry points.
+ *
+ * Every block is rounded to IP_ARENA_ALIGN, so the space a batch takes is a
+ * sum of rounded part sizes and the _size() queries can report it exactly.
+ * Nothing here calls malloc(): worker threads that each own an arena and
+ * reset it per batch never meet in the allocator.
+ */
+
+#include "ip_arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Parts of a batch result, in the order they are carved from the arena. */
+struct batch_layout {
+    size_t validity;
+    size_t addrs;
+    size_t errors;
+    size_t offsets;
+    size_t text;
+};
+
+/**
+ * arena_round - Round a block size up to the arena alignment.
+ * @size: Requested bytes.
+ *
+ * Return: @size rounded up to a multiple of IP_ARENA_ALIGN.
+ */
+static inline size_t arena_round(size_t size)
+{
+    return (size + IP_ARENA_ALIGN - 1) & ~(size_t)(IP_ARENA_ALIGN - 1);
+}
+
+/**
+ * ip_arena_init - Set up an arena over caller memory.
+ * @arena: Arena to initialise.
+ * @mem: Memory to hand out.
+ * @size: Number of bytes of @mem.
+ */
+void ip_arena_init(struct ip_arena *arena, void *mem, size_t size)
+{
+    uintptr_t start = (uintptr_t)mem;
+    size_t skip = (size_t)(-start & (IP_ARENA_ALIGN - 1));
+
+    if (mem == NULL || skip > size)
+        skip = size;
+    arena->base = (unsigned char *)mem + skip;
+    /* Whole blocks only, so a request that fits stays fitting when rounded. */
+    arena->size = (size - skip) & ~(size_t)(IP_ARENA_ALIGN - 1);
+    arena->used = 0;
+    arena->peak = 0;
+}
+
+/**
+ * ip_arena_alloc - Take a block from an arena.
+ * @arena: Arena to take from.
+ * @size: Number of bytes.
+ *
+ * Return: aligned block, or NULL if the arena is too full.
+ */
+void *ip_arena_alloc(struct ip_arena *arena, size_t size)
+{
+    size_t left = arena->size - arena->used;
+
+    /* Compare before rounding so that a huge @size cannot wrap. */
+    if (size > left || arena_round(size) > left)
+        return NULL;
+
+    void *block = arena->base + arena->used;
+
+    arena->used += arena_round(size);
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    return block;
+}
+
+/**
+ * ip_arena_reset - Give every block back at once.
+ * @arena: Arena to empty.
+ */
+void ip_arena_reset(struct ip_arena *arena)
+{
+    arena->used = 0;
+}
+
+/**
+ * batch_layout_of - Size the parts of a batch result.
+ * @count: Number of entries.
+ * @family: AF_INET or AF_INET6.
+ * @parts: IP_BATCH_* parts requested.
+ * @layout: Output part sizes, each already rounded.
+ * @total: Output sum of the part sizes.
+ *
+ * Return: false if @family is unknown or the text of @count entries would
+ * not fit 32-bit Arrow offsets.
+ */
+static bool batch_layout_of(size_t count, int family, unsigned int parts,
+                            struct batch_layout *layout, size_t *total)
+{
+    size_t addr_size, text_max;
+
+    if (family == AF_INET) {
+        addr_size = sizeof(struct in_addr);
+        text_max = INET_ADDRSTRLEN;
+    } else if (family == AF_INET6) {
+        addr_size = sizeof(struct in6_addr);
+        text_max = INET6_ADDRSTRLEN;
+    } else {
+        return false;
+    }
+    if (parts & IP_BATCH_TEXT) {
+        parts |= IP_BATCH_ADDRS;
+        if (count > INT32_MAX / text_max)
+            return false;
+    }
+
+    memset(layout, 0, sizeof(*layout));
+    layout->validity = arena_round((count + 7) / 8);
+    if (parts & IP_BATCH_ADDRS)
+        layout->addrs = arena_round(count * addr_size);
+    if (parts & IP_BATCH_ERRORS)
+        layout->errors = arena_round(count);
+    if (parts & IP_BATCH_TEXT) {
+        layout->offsets = arena_round((count + 1) * sizeof(int32_t));
+        /* format_*_address() writes a NUL, which the next entry overwrites. */
+        layout->text = arena_round(count * text_max);
+    }
+    *total = layout->validity + layout->addrs + layout->errors +
+        layout->offsets + layout->text;
+    return true;
+}
+
+/**
+ * ip_batch_arena_size - Arena bytes ip_batch_validate() takes.
+ * @count: Number of entries.
+ * @family: AF_INET or AF_INET6.
+ * @parts: IP_BATCH_* parts requested.
+ *
+ * Return: exact number of bytes, or 0 if @family is neither family.
+ */
+size_t ip_batch_arena_size(size_t count, int family, unsigned int parts)
+{
+    struct batch_layout layout;
+    size_t total;
+
+    return batch_layout_of(count, family, parts, &layout, &total) ? total : 0;
+}
+
+/**
+ * batch_text - Format the valid entries of a batch as an Arrow column.
+ * @batch: Batch with validity and addresses filled in.
+ * @family: AF_INET or AF_INET6.
+ */
+static void batch_text(struct ip_batch *batch, int family)
+{
+    size_t len = 0;
+
+    batch->text_offsets[0] = 0;
+    for (size_t i = 0; i < batch->count; i++) {
+        if (batch->validity[i / 8] & (1u << (i % 8))) {
+            if (family == AF_INET) {
+                const struct in_addr *addrs = batch->addrs;
+
+                len += format_ipv4_address(&addrs[i], batch->text + len,
+                                           INET_ADDRSTRLEN);
+            } else {
+                const struct in6_addr *addrs = batch->addrs;
+
+                len += format_ipv6_address(&addrs[i], batch->text + len,
+                                           INET6_ADDRSTRLEN);
+            }
+        }
+        batch->text_offsets[i + 1] = (int32_t)len;
+    }
+    batch->text_len = len;
+}
+
+/**
+ * ip_batch_validate - Validate a batch of slices into arena memory.
+ * @bufs: Array of @count pointers to candidate text.
+ * @lens: Array of @count slice lengths matching @bufs.
+ * @count: Number of candidates.
+ * @family: AF_INET or AF_INET6.
+ * @parts: IP_BATCH_* parts to produce besides the validity bitmap.
+ * @arena: Arena the result arrays are taken from.
+ * @batch: Output result.
+ *
+ * Return: true on success, false if @family is unknown or the arena is too
+ * full.
+ */
+bool ip_batch_validate(const char *const *bufs, const size_t *lens,
+                       size_t count, int family, unsigned int parts,
+                       struct ip_arena *arena, struct ip_batch *batch)
+{
+    struct batch_layout layout;
+    size_t total;
+
+    if (!batch_layout_of(count, family, parts, &layout, &total) ||
+        total > arena->size - arena->used)
+        return false;
+
+    memset(batch, 0, sizeof(*batch));
+    batch->count = count;
+    batch->validity = ip_arena_alloc(arena, layout.validity);
+    if (layout.addrs)
+        batch->addrs = ip_arena_alloc(arena, layout.addrs);
+    if (layout.errors)
+        batch->errors = ip_arena_alloc(arena, layout.errors);
+    if (layout.text) {
+        batch->text_offsets = ip_arena_alloc(arena, layout.offsets);
+        batch->text = ip_arena_alloc(arena, layout.text);
+    }
+
+    if (family == AF_INET)
+        batch->valid = is_valid_ipv4_batch(bufs, lens, count, batch->validity,
+                                           batch->addrs);
+    else
+        batch->valid = is_valid_ipv6_batch(bufs, lens, count, batch->validity,
+                                           batch->addrs);
+
+    if (batch->errors != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            enum ip_error err = IP_OK;
+
+            if (!(batch->validity[i / 8] & (1u << (i % 8))))
+                err = family == AF_INET ? ip_ipv4_error(bufs[i], lens[i]) :
+                    ip_ipv6_error(bufs[i], lens[i]);
+            batch->errors[i] = (uint8_t)err;
+        }
+    }
+    if (batch->text != NULL)
+        batch_text(batch, family);
+    return true;
+}
+
+/**
+ * ip_scan_arena_size - Arena bytes that let ip_scan_arena() finish in one
+ * call.
+ * @len: Length of the text to scan.
+ *
+ * The shortest address, "::", needs a separator before the next one can
+ * start, so @len bytes hold at most (@len + 1) / 3 addresses. One spare
+ * entry lets ip_scan() see the end of the text rather than a full array.
+ *
+ * Return: bytes for the most matches @len bytes of text can hold.
+ */
+size_t ip_scan_arena_size(size_t len)
+{
+    return arena_round(((len + 1) / 3 + 1) * sizeof(struct ip_match));
+}
+
+/**
+ * ip_scan_arena - Find the IP addresses in text, into arena memory.
+ * @buf: Text to search.
+ * @len: Number of bytes of @buf.
+ * @pos: In/out scan position.
+ * @family: AF_INET, AF_INET6 or AF_UNSPEC.
+ * @arena: Arena the match array is taken from.
+ * @matches: Output array of the matches found.
+ *
+ * Return: number of entries in *@matches.
+ */
+size_t ip_scan_arena(const char *buf, size_t len, size_t *pos, int family,
+                     struct ip_arena *arena, struct ip_match **matches)
+{
+    size_t room = (arena->size - arena->used) / sizeof(struct ip_match);
+
+    *matches = (struct ip_match *)(void *)(arena->base + arena->used);
+    if (room == 0)
+        return 0;
+
+    size_t n = ip_scan(buf, len, pos, family, *matches, room);
+
+    /* Keep only the entries filled; the rest of the space goes back. */
+    if (n > 0)
+        ip_arena_alloc(arena, n * sizeof(struct ip_match));
+    return n;
+}
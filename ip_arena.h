@@ -0,0 +1,135 @@
+#ifndef IP_ARENA_H
+#define IP_ARENA_H
+
+#include "ip_validator.h"
+#include "ip_scan.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Alignment of every block an arena hands out. */
+#define IP_ARENA_ALIGN 16
+
+/*
+ * Bump allocator over memory the caller owns, for the results of one batch.
+ * Blocks are carved off the front and all given back at once by
+ * ip_arena_reset(), so a loop that sizes its arena once with the _size()
+ * queries below and resets it per batch never allocates. The arena never
+ * calls malloc() itself. Like a parse cache, it belongs to one thread.
+ */
+struct ip_arena {
+    unsigned char *base;        /* IP_ARENA_ALIGN aligned */
+    size_t size;
+    size_t used;
+    size_t peak;                /* Highest @used since ip_arena_init() */
+};
+
+/* Optional parts of an ip_batch_validate() result. */
+enum ip_batch_part {
+    IP_BATCH_ADDRS = 1 << 0,    /* Parsed address of every entry */
+    IP_BATCH_ERRORS = 1 << 1,   /* Rejection reason of every entry */
+    IP_BATCH_TEXT = 1 << 2,     /* Canonical text; implies IP_BATCH_ADDRS */
+};
+
+/* Result of ip_batch_validate(); every array lives in the arena. */
+struct ip_batch {
+    size_t count;
+    size_t valid;               /* Number of valid entries */
+    uint8_t *validity;          /* (@count + 7) / 8 bytes, LSB first */
+    void *addrs;                /* struct in_addr or in6_addr, or NULL */
+    uint8_t *errors;            /* enum ip_error per entry, or NULL */
+    int32_t *text_offsets;      /* Arrow offsets, @count + 1, or NULL */
+    char *text;                 /* Arrow data; rejected entries are empty */
+    size_t text_len;
+};
+
+/**
+ * ip_arena_init - Set up an arena over caller memory.
+ * @arena: Arena to initialise.
+ * @mem: Memory to hand out; it must outlive every block taken from it.
+ * @size: Number of bytes of @mem.
+ *
+ * The arena uses whole IP_ARENA_ALIGN blocks; memory from malloc() is aligned,
+ * otherwise up to IP_ARENA_ALIGN - 1 bytes at the front of @mem are skipped.
+ */
+void ip_arena_init(struct ip_arena *arena, void *mem, size_t size);
+
+/**
+ * ip_arena_alloc - Take a block from an arena.
+ * @arena: Arena to take from.
+ * @size: Number of bytes; rounded up to a multiple of IP_ARENA_ALIGN.
+ *
+ * Return: IP_ARENA_ALIGN aligned block, or NULL if the arena has less than
+ * @size bytes left; the arena is then unchanged.
+ */
+void *ip_arena_alloc(struct ip_arena *arena, size_t size);
+
+/**
+ * ip_arena_reset - Give every block back at once.
+ * @arena: Arena to empty; blocks taken from it must no longer be used.
+ */
+void ip_arena_reset(struct ip_arena *arena);
+
+/**
+ * ip_batch_arena_size - Arena bytes ip_batch_validate() takes.
+ * @count: Number of entries.
+ * @family: AF_INET or AF_INET6.
+ * @parts: IP_BATCH_* parts requested.
+ *
+ * Return: exact number of bytes, or 0 if @family is neither family or the
+ * text of @count entries would overflow 32-bit Arrow offsets.
+ */
+size_t ip_batch_arena_size(size_t count, int family, unsigned int parts);
+
+/**
+ * ip_batch_validate - Validate a batch of slices into arena memory.
+ * @bufs: Array of @count pointers to candidate text.
+ * @lens: Array of @count slice lengths matching @bufs.
+ * @count: Number of candidates.
+ * @family: AF_INET or AF_INET6.
+ * @parts: IP_BATCH_* parts to produce besides the validity bitmap.
+ * @arena: Arena the result arrays are taken from.
+ * @batch: Output result.
+ *
+ * The validity bitmap and addresses come from is_valid_ipv4_batch() or
+ * is_valid_ipv6_batch(). Reasons are IP_OK for valid entries and
+ * ip_ipv4_error() or ip_ipv6_error() otherwise. The text of valid entries is
+ * what format_ipv4_address() or format_ipv6_address() writes.
+ *
+ * Return: true on success; false if @family is unknown, the text would
+ * overflow 32-bit offsets, or the arena has fewer than ip_batch_arena_size()
+ * bytes left. The arena is then unchanged.
+ */
+bool ip_batch_validate(const char *const *bufs, const size_t *lens,
+                       size_t count, int family, unsigned int parts,
+                       struct ip_arena *arena, struct ip_batch *batch);
+
+/**
+ * ip_scan_arena_size - Arena bytes that let ip_scan_arena() finish in one
+ * call.
+ * @len: Length of the text to scan.
+ *
+ * Return: bytes for the most matches @len bytes of text can hold.
+ */
+size_t ip_scan_arena_size(size_t len);
+
+/**
+ * ip_scan_arena - Find the IP addresses in text, into arena memory.
+ * @buf: Text to search; need not be NUL-terminated.
+ * @len: Number of bytes of @buf.
+ * @pos: In/out scan position, as for ip_scan().
+ * @family: AF_INET, AF_INET6 or AF_UNSPEC, as for ip_scan().
+ * @arena: Arena the match array is taken from.
+ * @matches: Output array of the matches found, in the arena.
+ *
+ * Works as ip_scan() with all of the arena's free space as the match array;
+ * the part not filled is given back. If the arena runs out first, *@pos
+ * stops short of @len and the scan resumes from there after a reset.
+ *
+ * Return: number of entries in *@matches.
+ */
+size_t ip_scan_arena(const char *buf, size_t len, size_t *pos, int family,
+                     struct ip_arena *arena, struct ip_match **matches);
+
+#endif                          /* IP_ARENA_H */
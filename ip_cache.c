@@ -0,0 +1,189 @@
+/*
+ * Parse-result cache for skewed traffic.
+ *
+ * Each set holds two entries of one cache line each; way 0 is the most
+ * recently used. An input is hashed a word at a time, its set probed
+ * with two tag compares, and the key bytes compared only on a tag match, so
+ * a hit costs about as much as reading the input once.
+ */
+
+#include "ip_cache.h"
+#include "ip_classify.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(struct ip_cache_entry) == 64,
+               "cache entries must fill exactly one cache line");
+
+#define CACHE_SET_BYTES (2 * sizeof(struct ip_cache_entry))
+
+/**
+ * cache_mix - Fold one word into a running hash.
+ * @h: Hash so far.
+ * @w: Next input word.
+ *
+ * Return: updated hash.
+ */
+static inline uint64_t cache_mix(uint64_t h, uint64_t w)
+{
+    h = (h ^ w) * 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 32);
+}
+
+/**
+ * cache_hash - Hash the bytes of an input.
+ * @buf: Input bytes.
+ * @len: Number of bytes, at most IP_CACHE_MAX_KEY.
+ *
+ * Return: 64-bit hash; the low bits pick the set, the high bits make the tag.
+ */
+static uint64_t cache_hash(const char *buf, size_t len)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+    uint64_t w;
+    size_t i = 0;
+
+    for (; i + sizeof(w) <= len; i += sizeof(w)) {
+        memcpy(&w, buf + i, sizeof(w));
+        h = cache_mix(h, w);
+    }
+    if (i < len) {
+        w = 0;
+        memcpy(&w, buf + i, len - i);
+        h = cache_mix(h, w);
+    }
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 29);
+}
+
+/**
+ * cache_fill - Parse and classify an input into an entry.
+ * @cache: Cache whose parsers to use.
+ * @buf: Input bytes.
+ * @len: Number of bytes of @buf.
+ * @e: Entry to fill; the caller sets the tag and key.
+ */
+static void cache_fill(const struct ip_cache *cache, const char *buf,
+                       size_t len, struct ip_cache_entry *e)
+{
+    struct ip_address addr;
+
+    memset(&addr, 0, sizeof(addr));
+    if (cache->parse_ipv4(buf, len, &addr.v4))
+        addr.family = AF_INET;
+    else if (cache->parse_ipv6(buf, len, &addr.v6))
+        addr.family = AF_INET6;
+
+    e->family = (uint8_t)addr.family;
+    e->classes = (uint16_t)ip_classify(&addr);
+    /* The union was zeroed, so this also covers IPv4 and rejected text. */
+    memcpy(e->addr, &addr.v6, sizeof(e->addr));
+}
+
+/**
+ * cache_result - Copy an entry's outcome to the caller.
+ * @e: Filled entry.
+ * @result: Output.
+ *
+ * Return: true if the entry holds a valid address.
+ */
+static inline bool cache_result(const struct ip_cache_entry *e,
+                                struct ip_cache_result *result)
+{
+    result->addr.family = e->family ? e->family : AF_UNSPEC;
+    memcpy(&result->addr.v6, e->addr, sizeof(result->addr.v6));
+    result->classes = e->classes;
+    return e->family != 0;
+}
+
+/**
+ * ip_cache_init - Set up a parse cache.
+ * @cache: Cache to initialise.
+ * @max_bytes: Memory budget.
+ * @flags: IP_PARSE_* policy applied to every input.
+ *
+ * Return: true on success, false otherwise.
+ */
+bool ip_cache_init(struct ip_cache *cache, size_t max_bytes,
+                   unsigned int flags)
+{
+    size_t sets = 1;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->parse_ipv4 = ip_ipv4_parser(flags);
+    cache->parse_ipv6 = ip_ipv6_parser(flags);
+    if (cache->parse_ipv4 == NULL || cache->parse_ipv6 == NULL ||
+        max_bytes < CACHE_SET_BYTES)
+        return false;
+    while (sets <= max_bytes / CACHE_SET_BYTES / 2)
+        sets *= 2;
+
+    cache->sets = aligned_alloc(sizeof(struct ip_cache_entry),
+                                sets * CACHE_SET_BYTES);
+    if (cache->sets == NULL)
+        return false;
+    memset(cache->sets, 0, sets * CACHE_SET_BYTES);
+    cache->set_count = sets;
+    return true;
+}
+
+/**
+ * ip_cache_free - Release a cache set up by ip_cache_init().
+ * @cache: Cache to release.
+ */
+void ip_cache_free(struct ip_cache *cache)
+{
+    free(cache->sets);
+    cache->sets = NULL;
+    cache->set_count = 0;
+}
+
+/**
+ * ip_cache_parse - Validate, convert and classify text, reusing past results.
+ * @cache: Cache of the calling thread.
+ * @buf: Start of the candidate text.
+ * @len: Number of bytes of @buf to examine.
+ * @result: Output family, address and classification.
+ *
+ * Return: true if the text is a valid address.
+ */
+bool ip_cache_parse(struct ip_cache *cache, const char *buf, size_t len,
+                    struct ip_cache_result *result)
+{
+    struct ip_cache_entry fresh;
+
+    if (buf == NULL || len > IP_CACHE_MAX_KEY || cache->sets == NULL) {
+        cache->misses++;
+        cache_fill(cache, buf, len, &fresh);
+        return cache_result(&fresh, result);
+    }
+
+    uint64_t h = cache_hash(buf, len);
+    uint32_t tag = (uint32_t)(h >> 32) | 1;
+    struct ip_cache_entry *set =
+        &cache->sets[2 * (h & (cache->set_count - 1))];
+
+    for (int way = 0; way < 2; way++) {
+        struct ip_cache_entry *e = &set[way];
+
+        if (e->tag != tag || e->len != len || memcmp(e->key, buf, len) != 0)
+            continue;
+        cache->hits++;
+        if (way == 1) {
+            fresh = set[1];
+            set[1] = set[0];
+            set[0] = fresh;
+        }
+        return cache_result(&set[0], result);
+    }
+
+    cache->misses++;
+    fresh.tag = tag;
+    fresh.len = (uint8_t)len;
+    memcpy(fresh.key, buf, len);
+    cache_fill(cache, buf, len, &fresh);
+    set[1] = set[0];
+    set[0] = fresh;
+    return cache_result(&fresh, result);
+}
@@ -0,0 +1,79 @@
+#ifndef IP_CACHE_H
+#define IP_CACHE_H
+
+#include "ip_validator.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Longest text the cache stores; longer inputs are parsed every time. */
+#define IP_CACHE_MAX_KEY 40
+
+/* One cached input and its outcome; exactly one cache line. */
+struct ip_cache_entry {
+    uint32_t tag;               /* Hash of the key; 0 marks an empty slot */
+    uint8_t len;                /* Key length */
+    uint8_t family;             /* AF_INET, AF_INET6, or 0 when invalid */
+    uint16_t classes;           /* ip_classify() of the address */
+    unsigned char addr[16];
+    char key[IP_CACHE_MAX_KEY];
+};
+
+/*
+ * Two-way set-associative cache of parse results. A cache is not shared:
+ * give each thread its own, so lookups take no locks and touch no shared
+ * cache lines. @hits and @misses may be read at any time by the owner.
+ */
+struct ip_cache {
+    struct ip_cache_entry *sets;        /* 2 * @set_count entries */
+    size_t set_count;                   /* A power of two */
+    ip_parse_ipv4_fn parse_ipv4;
+    ip_parse_ipv6_fn parse_ipv6;
+    uint64_t hits;
+    uint64_t misses;                    /* Including inputs too long to cache */
+};
+
+/* Outcome of ip_cache_parse(). */
+struct ip_cache_result {
+    struct ip_address addr;     /* family is AF_UNSPEC when invalid */
+    unsigned int classes;       /* ip_classify() flags of @addr */
+};
+
+/**
+ * ip_cache_init - Set up a parse cache.
+ * @cache: Cache to initialise; release it with ip_cache_free().
+ * @max_bytes: Memory budget. The cache uses the largest power-of-two number
+ *             of 128-byte sets that fits, and never grows later.
+ * @flags: IP_PARSE_* policy applied to every input, chosen here once.
+ *
+ * Return: true on success, false if @max_bytes is below one set, @flags has
+ * unknown bits, or memory could not be allocated.
+ */
+bool ip_cache_init(struct ip_cache *cache, size_t max_bytes,
+                   unsigned int flags);
+
+/**
+ * ip_cache_free - Release a cache set up by ip_cache_init().
+ * @cache: Cache to release; its counters are kept.
+ */
+void ip_cache_free(struct ip_cache *cache);
+
+/**
+ * ip_cache_parse - Validate, convert and classify text, reusing past results.
+ * @cache: Cache of the calling thread.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @result: Output family, address and classification.
+ *
+ * The text is looked up by a hash of its bytes. On a hit the stored outcome
+ * is returned without parsing; on a miss the text is parsed as IPv4, then as
+ * IPv6, under the cache's policy and the outcome replaces the least recently
+ * used entry of its set. Rejected text is cached as well.
+ *
+ * Return: true if the text is a valid address.
+ */
+bool ip_cache_parse(struct ip_cache *cache, const char *buf, size_t len,
+                    struct ip_cache_result *result);
+
+#endif                          /* IP_CACHE_H */
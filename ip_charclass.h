@@ -0,0 +1,34 @@
+#ifndef IP_CHARCLASS_H
+#define IP_CHARCLASS_H
+
+/*
+ * Locale-independent character classes shared by the validators. Each entry
+ * of ip_char_class[] holds the hexadecimal value of the byte in its low four
+ * bits (zero for non-hex bytes) and the class flags above them, so one load
+ * answers both "what kind of byte is this" and "what is its digit value".
+ */
+
+#include <stdint.h>
+
+#define IP_CC_VALUE_MASK 0x000f /* Hex value of the byte */
+#define IP_CC_DIGIT      0x0010 /* '0'-'9' */
+#define IP_CC_HEX        0x0020 /* '0'-'9', 'a'-'f', 'A'-'F' */
+#define IP_CC_DOT        0x0040 /* '.' */
+#define IP_CC_COLON      0x0080 /* ':' */
+#define IP_CC_PERCENT    0x0100 /* '%' */
+#define IP_CC_WORD       0x0200 /* '0'-'9', 'a'-'z', 'A'-'Z', '_' */
+
+extern const uint16_t ip_char_class[256];
+
+/**
+ * ip_cc - Look up the class entry for a byte.
+ * @ch: Byte to classify; any char value, including high bytes.
+ *
+ * Return: class flags and hex value of @ch.
+ */
+static inline unsigned int ip_cc(char ch)
+{
+    return ip_char_class[(unsigned char)ch];
+}
+
+#endif                          /* IP_CHARCLASS_H */
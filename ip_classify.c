@@ -0,0 +1,301 @@
+/*
+ * Special-purpose address classification.
+ *
+ * Both families are classified by a table indexed by the first byte of the
+ * address. Most bytes settle the answer on their own; the few that the IANA
+ * special-purpose registries subdivide name a short run of prefix rules,
+ * checked most specific first, that replace the table answer on a match. A
+ * lookup is therefore one load for common traffic and a handful of masked
+ * compares otherwise.
+ */
+
+#include "ip_classify.h"
+
+#include <string.h>
+
+/* Marks the first bytes whose class depends on the bytes that follow. */
+struct class_entry {
+    uint16_t cls;               /* Class when no rule matches */
+    uint8_t rule;               /* First rule to check */
+    uint8_t nrules;             /* Number of rules to check */
+};
+
+/* An IPv4 prefix, in host byte order. */
+struct ipv4_rule {
+    uint32_t net;
+    uint32_t mask;
+    uint16_t cls;
+};
+
+/* An IPv6 prefix, as two big-endian halves converted to host order. */
+struct ipv6_rule {
+    uint64_t hi, hi_mask;
+    uint64_t lo, lo_mask;
+    uint16_t cls;
+};
+
+#define V4(a, b, c, d) \
+    (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | \
+     (uint32_t)(d))
+#define V4_MASK(len) ((uint32_t)(0xffffffffull << (32 - (len))))
+
+/* Masks for an IPv6 prefix of @len bits, split over the two halves. */
+#define V6_HI_MASK(len) \
+    ((len) >= 64 ? UINT64_MAX : (len) == 0 ? 0 : UINT64_MAX << (64 - (len)))
+#define V6_LO_MASK(len) \
+    ((len) <= 64 ? 0 : (len) == 128 ? UINT64_MAX : UINT64_MAX << (128 - (len)))
+
+#define V4_RULE(a, b, c, d, len, c_) \
+    { V4(a, b, c, d), V4_MASK(len), (c_) }
+#define V6_RULE(hi, lo, len, c_) \
+    { (hi), V6_HI_MASK(len), (lo), V6_LO_MASK(len), (c_) }
+
+/* Rule runs, grouped by first byte and ordered most specific first. */
+enum {
+    R4_0 = 0,                   /* 0.0.0.0/8 */
+    R4_100 = R4_0 + 1,          /* 100.0.0.0/8 */
+    R4_169 = R4_100 + 1,        /* 169.0.0.0/8 */
+    R4_172 = R4_169 + 1,        /* 172.0.0.0/8 */
+    R4_192 = R4_172 + 1,        /* 192.0.0.0/8 */
+    R4_198 = R4_192 + 4,        /* 198.0.0.0/8 */
+    R4_203 = R4_198 + 2,        /* 203.0.0.0/8 */
+    R4_255 = R4_203 + 1,        /* 255.0.0.0/8 */
+    R4_COUNT = R4_255 + 1
+};
+
+static const struct ipv4_rule ipv4_rules[R4_COUNT] = {
+    [R4_0] = V4_RULE(0, 0, 0, 0, 32,
+                     IP_CLASS_UNSPECIFIED | IP_CLASS_RESERVED),
+    [R4_100] = V4_RULE(100, 64, 0, 0, 10, IP_CLASS_SHARED),
+    [R4_169] = V4_RULE(169, 254, 0, 0, 16, IP_CLASS_LINK_LOCAL),
+    [R4_172] = V4_RULE(172, 16, 0, 0, 12, IP_CLASS_PRIVATE),
+    [R4_192] = V4_RULE(192, 0, 0, 0, 24, IP_CLASS_RESERVED),
+    [R4_192 + 1] = V4_RULE(192, 0, 2, 0, 24, IP_CLASS_DOCUMENTATION),
+    [R4_192 + 2] = V4_RULE(192, 88, 99, 0, 24, IP_CLASS_RESERVED),
+    [R4_192 + 3] = V4_RULE(192, 168, 0, 0, 16, IP_CLASS_PRIVATE),
+    [R4_198] = V4_RULE(198, 18, 0, 0, 15, IP_CLASS_BENCHMARKING),
+    [R4_198 + 1] = V4_RULE(198, 51, 100, 0, 24, IP_CLASS_DOCUMENTATION),
+    [R4_203] = V4_RULE(203, 0, 113, 0, 24, IP_CLASS_DOCUMENTATION),
+    /* Limited broadcast, inside the reserved 240.0.0.0/4. */
+    [R4_255] = V4_RULE(255, 255, 255, 255, 32, IP_CLASS_RESERVED),
+};
+
+/* Runs of consecutive first octets with the same class. */
+#define CLASS4(base, c_) \
+    [(base) + 0] = {(c_), 0, 0}, [(base) + 1] = {(c_), 0, 0}, \
+    [(base) + 2] = {(c_), 0, 0}, [(base) + 3] = {(c_), 0, 0}
+#define CLASS16(base, c_) \
+    CLASS4((base) + 0, c_), CLASS4((base) + 4, c_), \
+    CLASS4((base) + 8, c_), CLASS4((base) + 12, c_)
+
+static const struct class_entry ipv4_first_octet[256] = {
+    [0] = {IP_CLASS_RESERVED, R4_0, 1},
+    [10] = {IP_CLASS_PRIVATE, 0, 0},
+    [100] = {0, R4_100, 1},
+    [127] = {IP_CLASS_LOOPBACK, 0, 0},
+    [169] = {0, R4_169, 1},
+    [172] = {0, R4_172, 1},
+    [192] = {0, R4_192, 4},
+    [198] = {0, R4_198, 2},
+    [203] = {0, R4_203, 1},
+    CLASS16(224, IP_CLASS_MULTICAST),
+    CLASS4(240, IP_CLASS_RESERVED),
+    CLASS4(244, IP_CLASS_RESERVED),
+    CLASS4(248, IP_CLASS_RESERVED),
+    [252] = {IP_CLASS_RESERVED, 0, 0},
+    [253] = {IP_CLASS_RESERVED, 0, 0},
+    [254] = {IP_CLASS_RESERVED, 0, 0},
+    [255] = {IP_CLASS_RESERVED, R4_255, 1},
+};
+
+enum {
+    R6_00 = 0,                  /* ::/8, which also holds 64:ff9b::/96 */
+    R6_01 = R6_00 + 5,          /* 100::/8 */
+    R6_20 = R6_01 + 1,          /* 2000::/8 */
+    R6_3F = R6_20 + 3,          /* 3f00::/8 */
+    R6_FE = R6_3F + 1,          /* fe00::/8 */
+    R6_COUNT = R6_FE + 1
+};
+
+static const struct ipv6_rule ipv6_rules[R6_COUNT] = {
+    [R6_00] = V6_RULE(0, 0, 128, IP_CLASS_UNSPECIFIED),
+    [R6_00 + 1] = V6_RULE(0, 1, 128, IP_CLASS_LOOPBACK),
+    [R6_00 + 2] = V6_RULE(0, 0x0000ffff00000000ull, 96, IP_CLASS_MAPPED),
+    [R6_00 + 3] = V6_RULE(0x0064ff9b00000000ull, 0, 96,
+                          IP_CLASS_TRANSLATION),
+    [R6_00 + 4] = V6_RULE(0x0064ff9b00010000ull, 0, 48,
+                          IP_CLASS_TRANSLATION),
+    [R6_01] = V6_RULE(0x0100000000000000ull, 0, 64, IP_CLASS_RESERVED),
+    [R6_20] = V6_RULE(0x2001000200000000ull, 0, 48, IP_CLASS_BENCHMARKING),
+    [R6_20 + 1] = V6_RULE(0x2001000000000000ull, 0, 23, IP_CLASS_RESERVED),
+    [R6_20 + 2] = V6_RULE(0x20010db800000000ull, 0, 32,
+                          IP_CLASS_DOCUMENTATION),
+    [R6_3F] = V6_RULE(0x3fff000000000000ull, 0, 20, IP_CLASS_DOCUMENTATION),
+    [R6_FE] = V6_RULE(0xfe80000000000000ull, 0, 10, IP_CLASS_LINK_LOCAL),
+};
+
+static const struct class_entry ipv6_first_byte[256] = {
+    /* The rest of ::/8 is reserved, IPv4-compatible addresses included. */
+    [0x00] = {IP_CLASS_RESERVED, R6_00, 5},
+    [0x01] = {0, R6_01, 1},
+    [0x20] = {0, R6_20, 3},
+    [0x3f] = {0, R6_3F, 1},
+    [0xfc] = {IP_CLASS_PRIVATE, 0, 0},
+    [0xfd] = {IP_CLASS_PRIVATE, 0, 0},
+    /* fe00::/9 and the deprecated site-local fec0::/10. */
+    [0xfe] = {IP_CLASS_RESERVED, R6_FE, 1},
+    [0xff] = {IP_CLASS_MULTICAST, 0, 0},
+};
+
+/**
+ * load_be64 - Read eight bytes as a big-endian integer.
+ * @p: Bytes to read.
+ *
+ * Return: value of the bytes in host order.
+ */
+static inline uint64_t load_be64(const uint8_t *p)
+{
+    uint64_t v = 0;
+
+    for (int i = 0; i < 8; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+/**
+ * ip_classify_ipv4 - Classify an IPv4 address.
+ * @addr: Address in network byte order.
+ *
+ * Return: bitwise OR of enum ip_class flags; 0 for global unicast.
+ */
+unsigned int ip_classify_ipv4(const struct in_addr *addr)
+{
+    const uint8_t *b = (const uint8_t *) &addr->s_addr;
+    const struct class_entry *e = &ipv4_first_octet[b[0]];
+
+    if (e->nrules == 0)
+        return e->cls;
+
+    uint32_t a = V4(b[0], b[1], b[2], b[3]);
+
+    for (unsigned int i = e->rule; i < (unsigned int) e->rule + e->nrules;
+         i++) {
+        if ((a & ipv4_rules[i].mask) == ipv4_rules[i].net)
+            return ipv4_rules[i].cls;
+    }
+    return e->cls;
+}
+
+/**
+ * ip_classify_ipv6 - Classify an IPv6 address.
+ * @addr: Address in network byte order.
+ *
+ * Return: bitwise OR of enum ip_class flags; 0 for global unicast.
+ */
+unsigned int ip_classify_ipv6(const struct in6_addr *addr)
+{
+    const uint8_t *b = addr->s6_addr;
+    const struct class_entry *e = &ipv6_first_byte[b[0]];
+
+    if (e->nrules == 0)
+        return e->cls;
+
+    uint64_t hi = load_be64(b);
+    uint64_t lo = load_be64(b + 8);
+
+    for (unsigned int i = e->rule; i < (unsigned int) e->rule + e->nrules;
+         i++) {
+        const struct ipv6_rule *r = &ipv6_rules[i];
+
+        if ((hi & r->hi_mask) != r->hi || (lo & r->lo_mask) != r->lo)
+            continue;
+        if (r->cls == IP_CLASS_MAPPED) {
+            struct in_addr v4;
+
+            memcpy(&v4, b + 12, sizeof(v4));
+            return IP_CLASS_MAPPED | ip_classify_ipv4(&v4);
+        }
+        return r->cls;
+    }
+    return e->cls;
+}
+
+/**
+ * ip_classify - Classify an address of either family.
+ * @addr: Parsed address.
+ *
+ * Return: bitwise OR of enum ip_class flags; 0 for global unicast or an
+ * unknown family.
+ */
+unsigned int ip_classify(const struct ip_address *addr)
+{
+    if (addr->family == AF_INET)
+        return ip_classify_ipv4(&addr->v4);
+    if (addr->family == AF_INET6)
+        return ip_classify_ipv6(&addr->v6);
+    return 0;
+}
+
+/**
+ * ip_classify_ipv4_batch - Classify an array of IPv4 addresses.
+ * @addrs: Array of @count addresses.
+ * @count: Number of addresses.
+ * @classes: Output array of @count flag sets.
+ */
+void ip_classify_ipv4_batch(const struct in_addr *addrs, size_t count,
+                            uint16_t *classes)
+{
+    for (size_t i = 0; i < count; i++)
+        classes[i] = (uint16_t) ip_classify_ipv4(&addrs[i]);
+}
+
+/**
+ * ip_classify_ipv6_batch - Classify an array of IPv6 addresses.
+ * @addrs: Array of @count addresses.
+ * @count: Number of addresses.
+ * @classes: Output array of @count flag sets.
+ */
+void ip_classify_ipv6_batch(const struct in6_addr *addrs, size_t count,
+                            uint16_t *classes)
+{
+    for (size_t i = 0; i < count; i++)
+        classes[i] = (uint16_t) ip_classify_ipv6(&addrs[i]);
+}
+
+/**
+ * ip_class_name - Name one classification flag.
+ * @flag: A single enum ip_class value.
+ *
+ * Return: lower-case name, "global" for 0 and "unknown" otherwise.
+ */
+const char *ip_class_name(unsigned int flag)
+{
+    switch (flag) {
+    case 0:
+        return "global";
+    case IP_CLASS_PRIVATE:
+        return "private";
+    case IP_CLASS_LOOPBACK:
+        return "loopback";
+    case IP_CLASS_LINK_LOCAL:
+        return "link-local";
+    case IP_CLASS_MULTICAST:
+        return "multicast";
+    case IP_CLASS_RESERVED:
+        return "reserved";
+    case IP_CLASS_DOCUMENTATION:
+        return "documentation";
+    case IP_CLASS_MAPPED:
+        return "ipv4-mapped";
+    case IP_CLASS_UNSPECIFIED:
+        return "unspecified";
+    case IP_CLASS_SHARED:
+        return "shared";
+    case IP_CLASS_BENCHMARKING:
+        return "benchmarking";
+    case IP_CLASS_TRANSLATION:
+        return "translation";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef IP_CLASSIFY_H
+#define IP_CLASSIFY_H
+
+#include "ip_validator.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Special-purpose ranges from the IANA IPv4 and IPv6 special-purpose address
+ * registries. An address may carry more than one flag; global unicast
+ * addresses carry none.
+ */
+enum ip_class {
+    IP_CLASS_PRIVATE = 1 << 0,          /* RFC 1918, fc00::/7 */
+    IP_CLASS_LOOPBACK = 1 << 1,         /* 127.0.0.0/8, ::1 */
+    IP_CLASS_LINK_LOCAL = 1 << 2,       /* 169.254.0.0/16, fe80::/10 */
+    IP_CLASS_MULTICAST = 1 << 3,        /* 224.0.0.0/4, ff00::/8 */
+    IP_CLASS_RESERVED = 1 << 4,         /* 240.0.0.0/4, 2001::/23, ... */
+    IP_CLASS_DOCUMENTATION = 1 << 5,    /* 192.0.2.0/24, 2001:db8::/32, ... */
+    IP_CLASS_MAPPED = 1 << 6,           /* ::ffff:0:0/96 */
+    IP_CLASS_UNSPECIFIED = 1 << 7,      /* 0.0.0.0, :: */
+    IP_CLASS_SHARED = 1 << 8,           /* 100.64.0.0/10 carrier-grade NAT */
+    IP_CLASS_BENCHMARKING = 1 << 9,     /* 198.18.0.0/15, 2001:2::/48 */
+    IP_CLASS_TRANSLATION = 1 << 10,     /* 64:ff9b::/96, 64:ff9b:1::/48 */
+};
+
+/**
+ * ip_classify_ipv4 - Classify an IPv4 address.
+ * @addr: Address in network byte order.
+ *
+ * Return: bitwise OR of enum ip_class flags; 0 for global unicast.
+ */
+unsigned int ip_classify_ipv4(const struct in_addr *addr);
+
+/**
+ * ip_classify_ipv6 - Classify an IPv6 address.
+ * @addr: Address in network byte order.
+ *
+ * An IPv4-mapped address also carries the flags of the IPv4 address it
+ * embeds, so ::ffff:192.168.0.1 is IP_CLASS_MAPPED | IP_CLASS_PRIVATE.
+ *
+ * Return: bitwise OR of enum ip_class flags; 0 for global unicast.
+ */
+unsigned int ip_classify_ipv6(const struct in6_addr *addr);
+
+/**
+ * ip_classify - Classify an address of either family.
+ * @addr: Parsed address, for example from ip_stream_finish() or ip_scan().
+ *
+ * Return: bitwise OR of enum ip_class flags; 0 for global unicast or an
+ * unknown family.
+ */
+unsigned int ip_classify(const struct ip_address *addr);
+
+/**
+ * ip_classify_ipv4_batch - Classify an array of IPv4 addresses.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv4_batch().
+ * @count: Number of addresses.
+ * @classes: Output array of @count flag sets.
+ */
+void ip_classify_ipv4_batch(const struct in_addr *addrs, size_t count,
+                            uint16_t *classes);
+
+/**
+ * ip_classify_ipv6_batch - Classify an array of IPv6 addresses.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv6_batch().
+ * @count: Number of addresses.
+ * @classes: Output array of @count flag sets.
+ */
+void ip_classify_ipv6_batch(const struct in6_addr *addrs, size_t count,
+                            uint16_t *classes);
+
+/**
+ * ip_class_name - Name one classification flag.
+ * @flag: A single enum ip_class value.
+ *
+ * Return: lower-case name such as "private", or "global" for 0 and
+ * "unknown" for anything else.
+ */
+const char *ip_class_name(unsigned int flag);
+
+#endif                          /* IP_CLASSIFY_H */
@@ -0,0 +1,326 @@
+#ifndef IP_DFA_H
+#define IP_DFA_H
+
+/*
+ * Byte-at-a-time recognisers shared by the one-shot parsers, the stream
+ * context and the scanner. Every function is static inline so each caller
+ * gets a copy specialised for its own loop. A recogniser is driven by
+ * ip_char_class[] entries and never sees the bytes themselves; the callers
+ * enforce the overall length limits.
+ */
+
+#include "ip_validator.h"
+#include "ip_charclass.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/* Maximum dotted-quad length including NUL */
+#define MAX_SIZE_IPV4 16
+
+/**
+ * ipv4_dfa_init - Reset the dotted-quad recogniser.
+ * @m: Recogniser state.
+ */
+static inline void ipv4_dfa_init(struct ipv4_dfa *m)
+{
+    m->value = 0;
+    m->octet_count = 0;
+    m->digits = false;
+}
+
+/**
+ * ipv4_dfa_step - Feed one byte to the dotted-quad recogniser.
+ * @m: Recogniser state.
+ * @cls: ip_char_class[] entry of the byte.
+ *
+ * Octets may have leading zeros but must not exceed 255; the caller enforces
+ * the overall length limit.
+ *
+ * Return: false if no continuation can be valid any more.
+ */
+static inline bool ipv4_dfa_step(struct ipv4_dfa *m, unsigned int cls)
+{
+    if (cls & IP_CC_DIGIT) {
+        m->value = m->value * 10 + (cls & IP_CC_VALUE_MASK);
+        m->digits = true;
+        return m->value <= 255;
+    }
+    if ((cls & IP_CC_DOT) && m->digits && m->octet_count < 3) {
+        m->octets[m->octet_count++] = (unsigned char)m->value;
+        m->value = 0;
+        m->digits = false;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * ipv4_dfa_finish - Accept or reject the text fed to the recogniser.
+ * @m: Recogniser state; on success @m->octets holds the address.
+ *
+ * Return: true if exactly four non-empty octets were read.
+ */
+static inline bool ipv4_dfa_finish(struct ipv4_dfa *m)
+{
+    if (!m->digits || m->octet_count != 3)
+        return false;
+    m->octets[3] = (unsigned char)m->value;
+    return true;
+}
+
+/**
+ * ipv4_dfa_accepting - Test whether the text fed so far is a dotted quad.
+ * @m: Recogniser state.
+ *
+ * Unlike ipv4_dfa_finish() this leaves @m untouched, so the caller may keep
+ * feeding bytes to look for a longer match.
+ *
+ * Return: true if finishing now would succeed.
+ */
+static inline bool ipv4_dfa_accepting(const struct ipv4_dfa *m)
+{
+    return m->digits && m->octet_count == 3;
+}
+
+/* States of the scalar IPv6 recogniser; see ipv6_dfa_step(). */
+enum ipv6_state {
+    IPV6_START,                 /* Nothing consumed yet */
+    IPV6_LEAD_COLON,            /* Leading ':' that must start a "::" */
+    IPV6_GROUP,                 /* Inside a group of 1-4 hex digits */
+    IPV6_COLON,                 /* Single ':' after a group */
+    IPV6_DOUBLE_COLON,          /* Just consumed "::" */
+    IPV6_V4_DOT,                /* '.' inside the dotted-quad suffix */
+    IPV6_V4_OCTET,              /* Decimal octet of the dotted-quad suffix */
+};
+
+/**
+ * ipv6_store_group - Append one 16-bit group to the address being built.
+ * @bytes: Address under construction.
+ * @group_count: In/out number of groups stored so far.
+ * @val: Group value.
+ *
+ * Return: false if all eight groups are already taken.
+ */
+static inline bool ipv6_store_group(unsigned char bytes[16],
+                                    int *group_count, unsigned int val)
+{
+    if (*group_count == 8)
+        return false;
+    bytes[*group_count * 2] = (unsigned char)(val >> 8);
+    bytes[*group_count * 2 + 1] = (unsigned char)val;
+    (*group_count)++;
+    return true;
+}
+
+/**
+ * ipv6_dfa_init - Reset the IPv6 recogniser.
+ * @m: Recogniser state.
+ */
+static inline void ipv6_dfa_init(struct ipv6_dfa *m)
+{
+    m->state = IPV6_START;
+    m->group_count = 0;
+    m->has_compression = false;
+    m->compression_at = 0;
+    m->xdigits_seen = 0;
+    m->val = 0;
+    m->dval = 0;
+    m->decimal = true;
+    m->octet_count = 0;
+    m->suffix_len = 0;
+}
+
+/**
+ * ipv6_dfa_step - Feed one byte to the IPv6 recogniser.
+ * @m: Recogniser state.
+ * @cls: ip_char_class[] entry of the byte.
+ *
+ * A hand-built DFA over the byte classes in ip_char_class[]. Each byte is
+ * consumed exactly once; an embedded dotted-quad suffix is recognised inline
+ * by reinterpreting the digits of the group in progress as its first decimal
+ * octet, so the tail is never rescanned. The caller enforces the overall
+ * length limit.
+ *
+ * Return: false if no continuation can be valid any more.
+ */
+static inline bool ipv6_dfa_step(struct ipv6_dfa *m, unsigned int cls)
+{
+    unsigned int digit = cls & IP_CC_VALUE_MASK;
+
+    switch (m->state) {
+    case IPV6_START:
+        if (cls & IP_CC_COLON) {
+            m->state = IPV6_LEAD_COLON;
+            return true;
+        }
+        if (!(cls & IP_CC_HEX))
+            return false;
+        break;                  /* First digit of the first group */
+
+    case IPV6_COLON:
+        if (cls & IP_CC_COLON) {
+            if (m->has_compression)
+                return false;   /* Multiple :: not allowed */
+            m->has_compression = true;
+            m->compression_at = m->group_count;
+            m->state = IPV6_DOUBLE_COLON;
+            return true;
+        }
+        if (!(cls & IP_CC_HEX))
+            return false;
+        break;                  /* First digit of the next group */
+
+    case IPV6_DOUBLE_COLON:
+        if (!(cls & IP_CC_HEX))
+            return false;       /* ":::" or junk after "::" */
+        break;                  /* First digit of the next group */
+
+    case IPV6_LEAD_COLON:
+        if (!(cls & IP_CC_COLON))
+            return false;
+        m->has_compression = true;
+        m->compression_at = 0;
+        m->state = IPV6_DOUBLE_COLON;
+        return true;
+
+    case IPV6_GROUP:
+        if (cls & IP_CC_HEX) {
+            if (m->xdigits_seen == 4)
+                return false;
+            m->val = (m->val << 4) | digit;
+            m->dval = m->dval * 10 + digit;
+            m->decimal = m->decimal && (cls & IP_CC_DIGIT);
+            ++m->xdigits_seen;
+            return true;
+        }
+        if (cls & IP_CC_COLON) {
+            if (!ipv6_store_group(m->bytes, &m->group_count, m->val))
+                return false;
+            m->state = IPV6_COLON;
+            return true;
+        }
+        if (cls & IP_CC_DOT) {
+            /*
+             * Dotted-quad suffix: the group digits were really its first
+             * octet. It needs two groups of room.
+             */
+            if (!m->decimal || m->dval > 255 || m->group_count > 6)
+                return false;
+            m->bytes[m->group_count * 2] = (unsigned char)m->dval;
+            m->octet_count = 1;
+            m->suffix_len = m->xdigits_seen + 1;
+            m->state = IPV6_V4_DOT;
+            return true;
+        }
+        return false;
+
+    case IPV6_V4_DOT:
+    case IPV6_V4_OCTET:
+        if (++m->suffix_len >= MAX_SIZE_IPV4)
+            return false;
+        if (cls & IP_CC_DIGIT) {
+            if (m->state == IPV6_V4_DOT) {
+                m->dval = 0;
+                m->state = IPV6_V4_OCTET;
+            }
+            m->dval = m->dval * 10 + digit;
+            return m->dval <= 255;
+        }
+        if ((cls & IP_CC_DOT) && m->state == IPV6_V4_OCTET &&
+            m->octet_count < 3) {
+            m->bytes[m->group_count * 2 + m->octet_count++] =
+                (unsigned char)m->dval;
+            m->state = IPV6_V4_DOT;
+            return true;
+        }
+        return false;
+    }
+
+    /* Only group-opening transitions get here. */
+    m->val = digit;
+    m->dval = digit;
+    m->decimal = (cls & IP_CC_DIGIT) != 0;
+    m->xdigits_seen = 1;
+    m->state = IPV6_GROUP;
+    return true;
+}
+
+/**
+ * ipv6_dfa_finish - Accept or reject the text fed to the IPv6 recogniser.
+ * @m: Recogniser state; on success @m->bytes holds the address with any "::"
+ *     gap expanded.
+ *
+ * Return: true if the text read is a complete IPv6 address.
+ */
+static inline bool ipv6_dfa_finish(struct ipv6_dfa *m)
+{
+    switch (m->state) {
+    case IPV6_GROUP:
+        if (!ipv6_store_group(m->bytes, &m->group_count, m->val))
+            return false;
+        break;
+    case IPV6_DOUBLE_COLON:
+        break;
+    case IPV6_V4_OCTET:
+        if (m->octet_count != 3)
+            return false;
+        m->bytes[m->group_count * 2 + 3] = (unsigned char)m->dval;
+        m->group_count += 2;    /* IPv4 takes 2 groups worth */
+        break;
+    default:
+        /* Empty input, lone ':', trailing single ':' or trailing '.' */
+        return false;
+    }
+
+    /* Check if we have the right number of groups */
+    if (m->has_compression) {
+        if (m->group_count >= 8)
+            return false;
+
+        /* Slide the groups after :: to the end and zero the gap. */
+        int tail = (m->group_count - m->compression_at) * 2;
+        memmove(&m->bytes[16 - tail], &m->bytes[m->compression_at * 2],
+                (size_t)tail);
+        memset(&m->bytes[m->compression_at * 2], 0,
+               (size_t)(16 - m->group_count * 2));
+    } else {
+        if (m->group_count != 8)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * ipv6_dfa_accepting - Test whether the text fed so far is an IPv6 address.
+ * @m: Recogniser state.
+ *
+ * Mirrors the checks of ipv6_dfa_finish() without storing the final group or
+ * expanding the "::" gap, so @m can keep consuming bytes.
+ *
+ * Return: true if finishing now would succeed.
+ */
+static inline bool ipv6_dfa_accepting(const struct ipv6_dfa *m)
+{
+    int groups;
+
+    switch (m->state) {
+    case IPV6_GROUP:
+        groups = m->group_count + 1;
+        break;
+    case IPV6_DOUBLE_COLON:
+        groups = m->group_count;
+        break;
+    case IPV6_V4_OCTET:
+        if (m->octet_count != 3)
+            return false;
+        groups = m->group_count + 2;
+        break;
+    default:
+        return false;
+    }
+    return m->has_compression ? groups < 8 : groups == 8;
+}
+
+#endif                          /* IP_DFA_H */
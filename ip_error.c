@@ -0,0 +1,178 @@
+/*
+ * Rejection diagnostics.
+ *
+ * The parsers only answer yes or no, so that their byte loops stay small.
+ * When the reason matters, the text is fed once more to the same scalar
+ * recognisers from ip_dfa.h, and the state they were in when they gave up
+ * names the reason. Because the recognisers are shared, the verdict always
+ * agrees with the parsers, and with the vector kernels that mirror them.
+ */
+
+#include "ip_validator.h"
+#include "ip_charclass.h"
+#include "ip_dfa.h"
+
+/**
+ * ipv4_step_error - Name the reason ipv4_dfa_step() refused a byte.
+ * @m: Recogniser state before the byte.
+ * @cls: ip_char_class[] entry of the byte.
+ *
+ * Return: rejection reason.
+ */
+static enum ip_error ipv4_step_error(const struct ipv4_dfa *m,
+                                     unsigned int cls)
+{
+    if (cls & IP_CC_DIGIT)
+        return IP_ERR_OCTET_RANGE;
+    if (cls & IP_CC_DOT)
+        return m->digits ? IP_ERR_OCTET_COUNT : IP_ERR_EMPTY_OCTET;
+    return IP_ERR_BAD_CHAR;
+}
+
+/**
+ * ip_ipv4_error - Explain why dotted-quad text is rejected.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * Return: IP_OK if the text is valid, otherwise the reason.
+ */
+enum ip_error ip_ipv4_error(const char *buf, size_t len)
+{
+    struct ipv4_dfa m;
+
+    if (buf == NULL || len == 0)
+        return IP_ERR_EMPTY;
+    if (len >= MAX_SIZE_IPV4)
+        return IP_ERR_TOO_LONG;
+
+    ipv4_dfa_init(&m);
+    for (size_t i = 0; i < len; i++) {
+        struct ipv4_dfa before = m;
+        unsigned int cls = ip_cc(buf[i]);
+
+        if (!ipv4_dfa_step(&m, cls))
+            return ipv4_step_error(&before, cls);
+    }
+    if (!m.digits)
+        return IP_ERR_EMPTY_OCTET;
+    if (m.octet_count != 3)
+        return IP_ERR_OCTET_COUNT;
+    return IP_OK;
+}
+
+/**
+ * ipv6_step_error - Name the reason ipv6_dfa_step() refused a byte.
+ * @m: Recogniser state before the byte.
+ * @cls: ip_char_class[] entry of the byte.
+ *
+ * Return: rejection reason.
+ */
+static enum ip_error ipv6_step_error(const struct ipv6_dfa *m,
+                                     unsigned int cls)
+{
+    switch (m->state) {
+    case IPV6_START:
+        break;
+    case IPV6_LEAD_COLON:
+        return IP_ERR_EMPTY_GROUP;
+    case IPV6_COLON:
+        if (cls & IP_CC_COLON)
+            return IP_ERR_MULTIPLE_COMPRESSION;
+        break;
+    case IPV6_DOUBLE_COLON:
+        if (cls & IP_CC_COLON)
+            return IP_ERR_EMPTY_GROUP;
+        break;
+    case IPV6_GROUP:
+        if (cls & IP_CC_HEX)
+            return IP_ERR_GROUP_TOO_LONG;
+        if (cls & IP_CC_COLON)
+            return IP_ERR_GROUP_COUNT;
+        break;
+    default:
+        /* Anything an address can contain is misplaced inside the quad. */
+        if (cls & (IP_CC_HEX | IP_CC_DOT | IP_CC_COLON))
+            return IP_ERR_BAD_IPV4_SUFFIX;
+        return IP_ERR_BAD_CHAR;
+    }
+    return (cls & IP_CC_DOT) ? IP_ERR_BAD_IPV4_SUFFIX : IP_ERR_BAD_CHAR;
+}
+
+/**
+ * ip_ipv6_error - Explain why IPv6 text is rejected.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * Return: IP_OK if the text is valid, otherwise the reason.
+ */
+enum ip_error ip_ipv6_error(const char *buf, size_t len)
+{
+    struct ipv6_dfa m;
+    int groups;
+
+    if (buf == NULL || len == 0)
+        return IP_ERR_EMPTY;
+    if (len >= INET6_ADDRSTRLEN)
+        return IP_ERR_TOO_LONG;
+
+    ipv6_dfa_init(&m);
+    for (size_t i = 0; i < len; i++) {
+        struct ipv6_dfa before = m;
+        unsigned int cls = ip_cc(buf[i]);
+
+        if (!ipv6_dfa_step(&m, cls))
+            return ipv6_step_error(&before, cls);
+    }
+
+    /* Same checks as ipv6_dfa_finish(), in the same order. */
+    switch (m.state) {
+    case IPV6_GROUP:
+        if (m.group_count == 8)
+            return IP_ERR_GROUP_COUNT;
+        groups = m.group_count + 1;
+        break;
+    case IPV6_DOUBLE_COLON:
+        groups = m.group_count;
+        break;
+    case IPV6_V4_OCTET:
+        if (m.octet_count != 3)
+            return IP_ERR_BAD_IPV4_SUFFIX;
+        groups = m.group_count + 2;
+        break;
+    case IPV6_V4_DOT:
+        return IP_ERR_BAD_IPV4_SUFFIX;
+    default:
+        return IP_ERR_EMPTY_GROUP;      /* Lone or trailing single ':' */
+    }
+    if (m.has_compression ? groups >= 8 : groups != 8)
+        return IP_ERR_GROUP_COUNT;
+    return IP_OK;
+}
+
+/**
+ * ip_error_name - Name a rejection reason.
+ * @err: Code from ip_ipv4_error() or ip_ipv6_error().
+ *
+ * Return: short lower-case name, or "unknown".
+ */
+const char *ip_error_name(enum ip_error err)
+{
+    static const char *const names[IP_ERR_COUNT] = {
+        [IP_OK] = "ok",
+        [IP_ERR_EMPTY] = "empty",
+        [IP_ERR_TOO_LONG] = "too-long",
+        [IP_ERR_BAD_CHAR] = "bad-char",
+        [IP_ERR_EMPTY_OCTET] = "empty-octet",
+        [IP_ERR_OCTET_RANGE] = "octet-range",
+        [IP_ERR_OCTET_COUNT] = "octet-count",
+        [IP_ERR_EMPTY_GROUP] = "empty-group",
+        [IP_ERR_GROUP_TOO_LONG] = "group-too-long",
+        [IP_ERR_MULTIPLE_COMPRESSION] = "multiple-compression",
+        [IP_ERR_GROUP_COUNT] = "group-count",
+        [IP_ERR_BAD_IPV4_SUFFIX] = "bad-ipv4-suffix",
+    };
+
+    if ((unsigned int)err >= IP_ERR_COUNT)
+        return "unknown";
+    return names[err];
+}
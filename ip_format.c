@@ -0,0 +1,329 @@
+/*
+ * Address formatting: the inverse of the parse_*() conversions.
+ *
+ * IPv6 text follows the canonical form of RFC 5952: lower-case hex without
+ * leading zeros, the longest run of two or more zero groups (the first one
+ * on a tie) shortened to "::", and dotted-quad notation for IPv4-mapped
+ * addresses. Every group is printed with the same instruction sequence: its
+ * digits come from a pair table, and the leading zeros are dropped by where
+ * the fixed-size copy starts rather than by a branch. The zero run is found
+ * with one lookup on the bitmap of zero groups.
+ *
+ * IPv4 text is assembled from a table holding the decimal text of every
+ * octet value: four fixed-size copies and no division.
+ */
+
+#include "ip_validator.h"
+
+#include <string.h>
+
+#define HEX_ROW(h) \
+    h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" \
+    h "8" h "9" h "a" h "b" h "c" h "d" h "e" h "f"
+
+/* Two lower-case hex digits for every byte value, at offset 2 * byte. */
+static const char hex_pairs[] =
+    HEX_ROW("0") HEX_ROW("1") HEX_ROW("2") HEX_ROW("3")
+    HEX_ROW("4") HEX_ROW("5") HEX_ROW("6") HEX_ROW("7")
+    HEX_ROW("8") HEX_ROW("9") HEX_ROW("a") HEX_ROW("b")
+    HEX_ROW("c") HEX_ROW("d") HEX_ROW("e") HEX_ROW("f");
+
+/*
+ * Longest run of zero groups for every bitmap in which bit i marks group i
+ * as zero: start in the high nibble, length in the low nibble. Runs shorter
+ * than two groups are not shortened (RFC 5952 section 4.2.2) and read as 0;
+ * of two equal runs the first wins (section 4.2.3).
+ */
+static const uint8_t zero_run[256] = {
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x00, 0x00, 0x00, 0x02, 0x22, 0x22, 0x13, 0x04,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x32, 0x32, 0x32, 0x02, 0x23, 0x23, 0x14, 0x05,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x00, 0x00, 0x00, 0x02, 0x22, 0x22, 0x13, 0x04,
+    0x42, 0x42, 0x42, 0x02, 0x42, 0x42, 0x12, 0x03,
+    0x33, 0x33, 0x33, 0x33, 0x24, 0x24, 0x15, 0x06,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x00, 0x00, 0x00, 0x02, 0x22, 0x22, 0x13, 0x04,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x32, 0x32, 0x32, 0x02, 0x23, 0x23, 0x14, 0x05,
+    0x52, 0x52, 0x52, 0x02, 0x52, 0x52, 0x12, 0x03,
+    0x52, 0x52, 0x52, 0x02, 0x22, 0x22, 0x13, 0x04,
+    0x43, 0x43, 0x43, 0x43, 0x43, 0x43, 0x43, 0x03,
+    0x34, 0x34, 0x34, 0x34, 0x25, 0x25, 0x16, 0x07,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x00, 0x00, 0x00, 0x02, 0x22, 0x22, 0x13, 0x04,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x32, 0x32, 0x32, 0x02, 0x23, 0x23, 0x14, 0x05,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x03,
+    0x00, 0x00, 0x00, 0x02, 0x22, 0x22, 0x13, 0x04,
+    0x42, 0x42, 0x42, 0x02, 0x42, 0x42, 0x12, 0x03,
+    0x33, 0x33, 0x33, 0x33, 0x24, 0x24, 0x15, 0x06,
+    0x62, 0x62, 0x62, 0x02, 0x62, 0x62, 0x12, 0x03,
+    0x62, 0x62, 0x62, 0x02, 0x22, 0x22, 0x13, 0x04,
+    0x62, 0x62, 0x62, 0x02, 0x62, 0x62, 0x12, 0x03,
+    0x32, 0x32, 0x32, 0x02, 0x23, 0x23, 0x14, 0x05,
+    0x53, 0x53, 0x53, 0x53, 0x53, 0x53, 0x53, 0x03,
+    0x53, 0x53, 0x53, 0x53, 0x53, 0x53, 0x13, 0x04,
+    0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44,
+    0x35, 0x35, 0x35, 0x35, 0x26, 0x26, 0x17, 0x08,
+};
+
+/*
+ * Decimal text of every octet value, padded with dots to four bytes so that
+ * one fixed-size copy writes the digits and the dot that follows them.
+ */
+static const struct {
+    char text[5];
+    uint8_t len;
+} octet_text[256] = {
+    {"0...", 1}, {"1...", 1}, {"2...", 1}, {"3...", 1}, {"4...", 1},
+    {"5...", 1}, {"6...", 1}, {"7...", 1}, {"8...", 1}, {"9...", 1},
+    {"10..", 2}, {"11..", 2}, {"12..", 2}, {"13..", 2}, {"14..", 2},
+    {"15..", 2}, {"16..", 2}, {"17..", 2}, {"18..", 2}, {"19..", 2},
+    {"20..", 2}, {"21..", 2}, {"22..", 2}, {"23..", 2}, {"24..", 2},
+    {"25..", 2}, {"26..", 2}, {"27..", 2}, {"28..", 2}, {"29..", 2},
+    {"30..", 2}, {"31..", 2}, {"32..", 2}, {"33..", 2}, {"34..", 2},
+    {"35..", 2}, {"36..", 2}, {"37..", 2}, {"38..", 2}, {"39..", 2},
+    {"40..", 2}, {"41..", 2}, {"42..", 2}, {"43..", 2}, {"44..", 2},
+    {"45..", 2}, {"46..", 2}, {"47..", 2}, {"48..", 2}, {"49..", 2},
+    {"50..", 2}, {"51..", 2}, {"52..", 2}, {"53..", 2}, {"54..", 2},
+    {"55..", 2}, {"56..", 2}, {"57..", 2}, {"58..", 2}, {"59..", 2},
+    {"60..", 2}, {"61..", 2}, {"62..", 2}, {"63..", 2}, {"64..", 2},
+    {"65..", 2}, {"66..", 2}, {"67..", 2}, {"68..", 2}, {"69..", 2},
+    {"70..", 2}, {"71..", 2}, {"72..", 2}, {"73..", 2}, {"74..", 2},
+    {"75..", 2}, {"76..", 2}, {"77..", 2}, {"78..", 2}, {"79..", 2},
+    {"80..", 2}, {"81..", 2}, {"82..", 2}, {"83..", 2}, {"84..", 2},
+    {"85..", 2}, {"86..", 2}, {"87..", 2}, {"88..", 2}, {"89..", 2},
+    {"90..", 2}, {"91..", 2}, {"92..", 2}, {"93..", 2}, {"94..", 2},
+    {"95..", 2}, {"96..", 2}, {"97..", 2}, {"98..", 2}, {"99..", 2},
+    {"100.", 3}, {"101.", 3}, {"102.", 3}, {"103.", 3}, {"104.", 3},
+    {"105.", 3}, {"106.", 3}, {"107.", 3}, {"108.", 3}, {"109.", 3},
+    {"110.", 3}, {"111.", 3}, {"112.", 3}, {"113.", 3}, {"114.", 3},
+    {"115.", 3}, {"116.", 3}, {"117.", 3}, {"118.", 3}, {"119.", 3},
+    {"120.", 3}, {"121.", 3}, {"122.", 3}, {"123.", 3}, {"124.", 3},
+    {"125.", 3}, {"126.", 3}, {"127.", 3}, {"128.", 3}, {"129.", 3},
+    {"130.", 3}, {"131.", 3}, {"132.", 3}, {"133.", 3}, {"134.", 3},
+    {"135.", 3}, {"136.", 3}, {"137.", 3}, {"138.", 3}, {"139.", 3},
+    {"140.", 3}, {"141.", 3}, {"142.", 3}, {"143.", 3}, {"144.", 3},
+    {"145.", 3}, {"146.", 3}, {"147.", 3}, {"148.", 3}, {"149.", 3},
+    {"150.", 3}, {"151.", 3}, {"152.", 3}, {"153.", 3}, {"154.", 3},
+    {"155.", 3}, {"156.", 3}, {"157.", 3}, {"158.", 3}, {"159.", 3},
+    {"160.", 3}, {"161.", 3}, {"162.", 3}, {"163.", 3}, {"164.", 3},
+    {"165.", 3}, {"166.", 3}, {"167.", 3}, {"168.", 3}, {"169.", 3},
+    {"170.", 3}, {"171.", 3}, {"172.", 3}, {"173.", 3}, {"174.", 3},
+    {"175.", 3}, {"176.", 3}, {"177.", 3}, {"178.", 3}, {"179.", 3},
+    {"180.", 3}, {"181.", 3}, {"182.", 3}, {"183.", 3}, {"184.", 3},
+    {"185.", 3}, {"186.", 3}, {"187.", 3}, {"188.", 3}, {"189.", 3},
+    {"190.", 3}, {"191.", 3}, {"192.", 3}, {"193.", 3}, {"194.", 3},
+    {"195.", 3}, {"196.", 3}, {"197.", 3}, {"198.", 3}, {"199.", 3},
+    {"200.", 3}, {"201.", 3}, {"202.", 3}, {"203.", 3}, {"204.", 3},
+    {"205.", 3}, {"206.", 3}, {"207.", 3}, {"208.", 3}, {"209.", 3},
+    {"210.", 3}, {"211.", 3}, {"212.", 3}, {"213.", 3}, {"214.", 3},
+    {"215.", 3}, {"216.", 3}, {"217.", 3}, {"218.", 3}, {"219.", 3},
+    {"220.", 3}, {"221.", 3}, {"222.", 3}, {"223.", 3}, {"224.", 3},
+    {"225.", 3}, {"226.", 3}, {"227.", 3}, {"228.", 3}, {"229.", 3},
+    {"230.", 3}, {"231.", 3}, {"232.", 3}, {"233.", 3}, {"234.", 3},
+    {"235.", 3}, {"236.", 3}, {"237.", 3}, {"238.", 3}, {"239.", 3},
+    {"240.", 3}, {"241.", 3}, {"242.", 3}, {"243.", 3}, {"244.", 3},
+    {"245.", 3}, {"246.", 3}, {"247.", 3}, {"248.", 3}, {"249.", 3},
+    {"250.", 3}, {"251.", 3}, {"252.", 3}, {"253.", 3}, {"254.", 3},
+    {"255.", 3},
+};
+
+/**
+ * put_group - Write one IPv6 group and the colon after it.
+ * @p: Output position; up to three bytes past the colon are clobbered.
+ * @hi: High byte of the group.
+ * @lo: Low byte of the group.
+ *
+ * Return: position just past the colon.
+ */
+static inline char *put_group(char *p, unsigned int hi, unsigned int lo)
+{
+    unsigned int v = hi << 8 | lo;
+    unsigned int n = 1 + (v > 0xf) + (v > 0xff) + (v > 0xfff);
+    char digits[8];
+
+    memcpy(digits, &hex_pairs[2 * hi], 2);
+    memcpy(digits + 2, &hex_pairs[2 * lo], 2);
+    memset(digits + 4, ':', 4);
+    memcpy(p, digits + 4 - n, 4);
+    p[4] = ':';
+    return p + n + 1;
+}
+
+/**
+ * put_octet - Write one decimal octet and the dot after it.
+ * @p: Output position; up to two bytes past the dot are clobbered.
+ * @v: Octet value.
+ *
+ * Return: position just past the dot.
+ */
+static inline char *put_octet(char *p, unsigned int v)
+{
+    memcpy(p, octet_text[v].text, 4);
+    return p + octet_text[v].len + 1;
+}
+
+/**
+ * format_ipv4_raw - Write the dotted-quad text of an IPv4 address.
+ * @b: The four address bytes in network order.
+ * @p: Output with room for INET_ADDRSTRLEN bytes; not NUL-terminated.
+ *
+ * Return: length of the text.
+ */
+static size_t format_ipv4_raw(const uint8_t *b, char *p)
+{
+    char *start = p;
+
+    p = put_octet(p, b[0]);
+    p = put_octet(p, b[1]);
+    p = put_octet(p, b[2]);
+    p = put_octet(p, b[3]);
+    return (size_t)(p - start) - 1;
+}
+
+/**
+ * format_ipv4_address - Write the dotted-quad text of an address.
+ * @addr: Address in network byte order.
+ * @buf: Output buffer.
+ * @size: Size of @buf; INET_ADDRSTRLEN always suffices.
+ *
+ * Return: length of the text, not counting the terminating NUL, or 0 if
+ * @size is too small; @buf is then left untouched.
+ */
+size_t format_ipv4_address(const struct in_addr *addr, char *buf,
+                           size_t size)
+{
+    char tmp[INET_ADDRSTRLEN];
+    size_t len;
+
+    if (size >= INET_ADDRSTRLEN) {
+        len = format_ipv4_raw((const uint8_t *)&addr->s_addr, buf);
+        buf[len] = '\0';
+        return len;
+    }
+    len = format_ipv4_raw((const uint8_t *)&addr->s_addr, tmp);
+    if (len >= size)
+        return 0;
+    memcpy(buf, tmp, len);
+    buf[len] = '\0';
+    return len;
+}
+
+/**
+ * format_ipv4_batch_arrow - Format addresses into an Arrow string column.
+ * @addrs: Array of @count addresses in network byte order.
+ * @count: Number of addresses.
+ * @offsets: Output Arrow offsets buffer of @count + 1 entries.
+ * @data: Output Arrow value data buffer.
+ *
+ * Return: number of bytes written to @data.
+ */
+size_t format_ipv4_batch_arrow(const struct in_addr *addrs, size_t count,
+                               int32_t *offsets, char *data)
+{
+    size_t pos = 0;
+
+    offsets[0] = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *b = (const uint8_t *)&addrs[i].s_addr;
+
+        pos += format_ipv4_raw(b, data + pos);
+        offsets[i + 1] = (int32_t)pos;
+    }
+    return pos;
+}
+
+/**
+ * format_ipv6_raw - Write the canonical text of an IPv6 address.
+ * @addr: Address in network byte order.
+ * @p: Output with room for INET6_ADDRSTRLEN bytes; not NUL-terminated.
+ *
+ * Stores at most 40 bytes, the longest text plus a colon, slack included.
+ *
+ * Return: length of the text.
+ */
+static size_t format_ipv6_raw(const struct in6_addr *addr, char *p)
+{
+    const uint8_t *b = addr->s6_addr;
+    char *start = p;
+    unsigned int zero = 0;
+
+    for (int i = 0; i < 8; i++)
+        zero |= (unsigned int)((b[2 * i] | b[2 * i + 1]) == 0) << i;
+
+    /* ::ffff:a.b.c.d, RFC 5952 section 5. */
+    if ((zero & 0x1f) == 0x1f && b[10] == 0xff && b[11] == 0xff) {
+        memcpy(p, "::ffff:", 7);
+        return 7 + format_ipv4_raw(b + 12, p + 7);
+    }
+
+    unsigned int run = zero_run[zero];
+    unsigned int skip = run >> 4, end = skip + (run & 0xf);
+
+    if (run == 0) {
+        for (int i = 0; i < 8; i++)
+            p = put_group(p, b[2 * i], b[2 * i + 1]);
+        return (size_t)(p - start) - 1;
+    }
+    for (unsigned int i = 0; i < skip; i++)
+        p = put_group(p, b[2 * i], b[2 * i + 1]);
+    if (skip == 0)
+        *p++ = ':';
+    *p++ = ':';
+    for (unsigned int i = end; i < 8; i++)
+        p = put_group(p, b[2 * i], b[2 * i + 1]);
+    return (size_t)(p - start) - (end < 8);
+}
+
+/**
+ * format_ipv6_address - Write the canonical RFC 5952 text of an address.
+ * @addr: Address in network byte order.
+ * @buf: Output buffer.
+ * @size: Size of @buf; INET6_ADDRSTRLEN always suffices.
+ *
+ * Return: length of the text, not counting the terminating NUL, or 0 if
+ * @size is too small; @buf is then left untouched.
+ */
+size_t format_ipv6_address(const struct in6_addr *addr, char *buf,
+                           size_t size)
+{
+    char tmp[INET6_ADDRSTRLEN];
+    size_t len;
+
+    if (size >= INET6_ADDRSTRLEN) {
+        len = format_ipv6_raw(addr, buf);
+        buf[len] = '\0';
+        return len;
+    }
+    len = format_ipv6_raw(addr, tmp);
+    if (len >= size)
+        return 0;
+    memcpy(buf, tmp, len);
+    buf[len] = '\0';
+    return len;
+}
+
+/**
+ * format_ipv6_batch_arrow - Format addresses into an Arrow string column.
+ * @addrs: Array of @count addresses in network byte order.
+ * @count: Number of addresses.
+ * @offsets: Output Arrow offsets buffer of @count + 1 entries.
+ * @data: Output Arrow value data buffer.
+ *
+ * Return: number of bytes written to @data.
+ */
+size_t format_ipv6_batch_arrow(const struct in6_addr *addrs, size_t count,
+                               int32_t *offsets, char *data)
+{
+    size_t pos = 0;
+
+    offsets[0] = 0;
+    for (size_t i = 0; i < count; i++) {
+        pos += format_ipv6_raw(&addrs[i], data + pos);
+        offsets[i + 1] = (int32_t)pos;
+    }
+    return pos;
+}
@@ -0,0 +1,623 @@
+/*
+ * CIDR parsing and a compiled longest-prefix-match table.
+ *
+ * The table is a multibit trie with an 8-bit stride compressed the way
+ * Poptrie compresses its nodes: every node covers one address byte, a
+ * 256-bit map marks the slots that continue in a child, and the remaining
+ * leaf slots are stored as runs of equal values marked in a second map.
+ * Children of a node are contiguous, so a lookup step is a bit test, one
+ * popcount and an index add; an IPv4 lookup touches at most four nodes.
+ * Prefixes are leaf-pushed at build time, so the first leaf reached holds
+ * the answer and no backtracking is needed.
+ *
+ * Building never materialises uncompressed 256-slot nodes for more than one
+ * root-to-leaf path: the prefixes are sorted by address, and each node is
+ * computed from the contiguous run of prefixes under its path, emitted
+ * compressed and then recursed into.
+ */
+
+#include "ip_prefix.h"
+#include "ip_charclass.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Addresses walked in lockstep by the batch lookups. */
+#define LPM_BATCH 8
+
+/* One prefix being compiled, with its key widened to 16 bytes. */
+struct lpm_entry {
+    unsigned char key[16];
+    unsigned int len;
+    uint32_t value;
+    size_t order;               /* Input position; later duplicates win */
+};
+
+/* Output arrays of a build in progress. */
+struct lpm_image {
+    struct ip_lpm_node *nodes;
+    size_t node_count;
+    size_t node_cap;
+    uint32_t *leaves;
+    size_t leaf_count;
+    size_t leaf_cap;
+};
+
+/**
+ * prefix_mask - Clear the host bits of an address.
+ * @bytes: Address in network byte order.
+ * @size: Address size in bytes, 4 or 16.
+ * @len: Prefix length; bits from @len on are cleared.
+ */
+static void prefix_mask(unsigned char *bytes, size_t size, unsigned int len)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (len >= 8 * (i + 1))
+            continue;
+        if (len <= 8 * i)
+            bytes[i] = 0;
+        else
+            bytes[i] &= (unsigned char)(0xff << (8 * (i + 1) - len));
+    }
+}
+
+/**
+ * parse_ip_prefix - Parse CIDR text such as "10.0.0.0/8" or "2001:db8::/32".
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @prefix: Output network address and prefix length.
+ *
+ * Return: true if the text was a valid prefix and @prefix was written.
+ */
+bool parse_ip_prefix(const char *buf, size_t len, struct ip_prefix *prefix)
+{
+    if (buf == NULL || len == 0 || prefix == NULL)
+        return false;
+
+    const char *slash = memchr(buf, '/', len);
+    size_t addr_len = slash != NULL ? (size_t)(slash - buf) : len;
+    struct ip_address addr;
+    unsigned char *bytes;
+    unsigned int max;
+
+    memset(&addr, 0, sizeof(addr));
+    if (memchr(buf, ':', addr_len) != NULL) {
+        if (!parse_ipv6_address(buf, addr_len, &addr.v6))
+            return false;
+        addr.family = AF_INET6;
+        bytes = addr.v6.s6_addr;
+        max = 128;
+    } else {
+        if (!parse_ipv4_address(buf, addr_len, &addr.v4))
+            return false;
+        addr.family = AF_INET;
+        bytes = (unsigned char *)&addr.v4;
+        max = 32;
+    }
+
+    unsigned int plen = max;
+
+    if (slash != NULL) {
+        const char *digits = slash + 1;
+        size_t ndigits = len - addr_len - 1;
+
+        if (ndigits == 0 || ndigits > 3 || (ndigits > 1 && digits[0] == '0'))
+            return false;
+        plen = 0;
+        for (size_t i = 0; i < ndigits; i++) {
+            unsigned int cls = ip_cc(digits[i]);
+
+            if (!(cls & IP_CC_DIGIT))
+                return false;
+            plen = plen * 10 + (cls & IP_CC_VALUE_MASK);
+        }
+        if (plen > max)
+            return false;
+    }
+
+    prefix_mask(bytes, max / 8, plen);
+    prefix->addr = addr;
+    prefix->len = plen;
+    return true;
+}
+
+/**
+ * lpm_entry_cmp - qsort() order for prefixes: by address, then length, then
+ * input position.
+ */
+static int lpm_entry_cmp(const void *a, const void *b)
+{
+    const struct lpm_entry *x = a, *y = b;
+    int c = memcmp(x->key, y->key, sizeof(x->key));
+
+    if (c != 0)
+        return c;
+    if (x->len != y->len)
+        return x->len < y->len ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/**
+ * lpm_reserve_nodes - Append zeroed nodes to a build.
+ * @img: Build in progress.
+ * @n: Number of nodes to append.
+ * @first: Output index of the first new node.
+ *
+ * Return: false if memory could not be allocated.
+ */
+static bool lpm_reserve_nodes(struct lpm_image *img, size_t n,
+                              uint32_t *first)
+{
+    if (img->node_count + n > img->node_cap) {
+        size_t cap = img->node_cap ? img->node_cap : 64;
+        struct ip_lpm_node *nodes;
+
+        while (cap < img->node_count + n)
+            cap *= 2;
+        nodes = realloc(img->nodes, cap * sizeof(*nodes));
+        if (nodes == NULL)
+            return false;
+        img->nodes = nodes;
+        img->node_cap = cap;
+    }
+    memset(&img->nodes[img->node_count], 0, n * sizeof(*img->nodes));
+    *first = (uint32_t)img->node_count;
+    img->node_count += n;
+    return true;
+}
+
+/**
+ * lpm_push_leaf - Append one leaf value to a build.
+ * @img: Build in progress.
+ * @value: Leaf value.
+ *
+ * Return: false if memory could not be allocated.
+ */
+static bool lpm_push_leaf(struct lpm_image *img, uint32_t value)
+{
+    if (img->leaf_count == img->leaf_cap) {
+        size_t cap = img->leaf_cap ? img->leaf_cap * 2 : 256;
+        uint32_t *leaves = realloc(img->leaves, cap * sizeof(*leaves));
+
+        if (leaves == NULL)
+            return false;
+        img->leaves = leaves;
+        img->leaf_cap = cap;
+    }
+    img->leaves[img->leaf_count++] = value;
+    return true;
+}
+
+/**
+ * lpm_build_node - Compile one trie node and, recursively, its children.
+ * @img: Build in progress.
+ * @e: Sorted prefixes.
+ * @lo: First prefix under this node's path.
+ * @hi: One past the last prefix under this node's path.
+ * @depth: Address byte this node consumes.
+ * @def: Value inherited from the ancestors for slots no prefix here covers.
+ * @index: Node slot reserved for this node.
+ *
+ * Return: false if memory could not be allocated.
+ */
+static bool lpm_build_node(struct lpm_image *img, const struct lpm_entry *e,
+                           size_t lo, size_t hi, unsigned int depth,
+                           uint32_t def, uint32_t index)
+{
+    unsigned int base = depth * 8;
+    uint32_t slots[256];
+    struct ip_lpm_node node;
+    size_t children = 0;
+
+    for (int s = 0; s < 256; s++)
+        slots[s] = def;
+
+    /* Expand the prefixes ending here, shortest first so longer ones win. */
+    for (unsigned int l = base + 1; l <= base + 8; l++) {
+        unsigned int span = 1u << (base + 8 - l);
+
+        for (size_t i = lo; i < hi; i++) {
+            if (e[i].len != l)
+                continue;
+            for (unsigned int s = 0; s < span; s++)
+                slots[e[i].key[depth] + s] = e[i].value;
+        }
+    }
+
+    memset(&node, 0, sizeof(node));
+    for (size_t i = lo; i < hi; i++) {
+        unsigned int s = e[i].key[depth];
+
+        if (e[i].len > base + 8 &&
+            !((node.child_bits[s >> 6] >> (s & 63)) & 1)) {
+            node.child_bits[s >> 6] |= 1ULL << (s & 63);
+            children++;
+        }
+    }
+    if (children > 0 && !lpm_reserve_nodes(img, children, &node.child_base))
+        return false;
+
+    /* Leaf slots, run-length compressed across intervening children. */
+    bool have_prev = false;
+    uint32_t prev = 0;
+
+    node.leaf_base = (uint32_t)img->leaf_count;
+    for (unsigned int s = 0; s < 256; s++) {
+        if ((node.child_bits[s >> 6] >> (s & 63)) & 1)
+            continue;
+        if (have_prev && slots[s] == prev)
+            continue;
+        if (!lpm_push_leaf(img, slots[s]))
+            return false;
+        node.leaf_bits[s >> 6] |= 1ULL << (s & 63);
+        prev = slots[s];
+        have_prev = true;
+    }
+    for (int w = 1; w < 4; w++) {
+        node.child_rank[w] = (uint8_t)(node.child_rank[w - 1] +
+                                       __builtin_popcountll(node.child_bits
+                                                            [w - 1]));
+        node.leaf_rank[w] = (uint8_t)(node.leaf_rank[w - 1] +
+                                      __builtin_popcountll(node.leaf_bits
+                                                           [w - 1]));
+    }
+    img->nodes[index] = node;
+
+    /* Children, in slot order, each over the run sharing its byte. */
+    uint32_t child = node.child_base;
+
+    for (size_t i = lo; i < hi;) {
+        size_t j = i;
+        unsigned int s = e[i].key[depth];
+
+        while (j < hi && e[j].key[depth] == s)
+            j++;
+        if ((node.child_bits[s >> 6] >> (s & 63)) & 1) {
+            if (!lpm_build_node(img, e, i, j, depth + 1, slots[s], child++))
+                return false;
+        }
+        i = j;
+    }
+    return true;
+}
+
+/**
+ * lpm_build_family - Compile the prefixes of one family under its root.
+ * @img: Build in progress.
+ * @e: Prefixes of one family; sorted in place.
+ * @n: Number of prefixes.
+ * @root: Reserved root node.
+ *
+ * Return: false if memory could not be allocated.
+ */
+static bool lpm_build_family(struct lpm_image *img, struct lpm_entry *e,
+                             size_t n, uint32_t root)
+{
+    uint32_t def = IP_LPM_NONE;
+
+    qsort(e, n, sizeof(*e), lpm_entry_cmp);
+    /* Zero-length prefixes sort by position; the last one wins. */
+    for (size_t i = 0; i < n; i++) {
+        if (e[i].len == 0)
+            def = e[i].value;
+    }
+    return lpm_build_node(img, e, 0, n, 0, def, root);
+}
+
+/**
+ * ip_lpm_build - Compile a set of prefixes into a lookup table.
+ * @lpm: Table to fill.
+ * @prefixes: Array of @count prefixes of either family.
+ * @values: Array of @count values.
+ * @count: Number of prefixes.
+ *
+ * Return: true on success, false on allocation failure or invalid input.
+ */
+bool ip_lpm_build(struct ip_lpm *lpm, const struct ip_prefix *prefixes,
+                  const uint32_t *values, size_t count)
+{
+    struct lpm_image img;
+    struct lpm_entry *entries;
+    size_t n4 = 0, n6 = 0;
+    uint32_t root;
+
+    memset(lpm, 0, sizeof(*lpm));
+    memset(&img, 0, sizeof(img));
+    if (count > 0 && (prefixes == NULL || values == NULL))
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        if (prefixes[i].addr.family == AF_INET && prefixes[i].len <= 32)
+            n4++;
+        else if (prefixes[i].addr.family != AF_INET6 ||
+                 prefixes[i].len > 128)
+            return false;
+        if (values[i] == IP_LPM_NONE)
+            return false;
+    }
+
+    entries = malloc((count > 0 ? count : 1) * sizeof(*entries));
+    if (entries == NULL)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        const struct ip_prefix *p = &prefixes[i];
+        bool v4 = p->addr.family == AF_INET;
+        struct lpm_entry *out = v4 ? &entries[i - n6] :
+            &entries[n4 + n6];
+
+        memset(out->key, 0, sizeof(out->key));
+        if (v4)
+            memcpy(out->key, &p->addr.v4, 4);
+        else
+            memcpy(out->key, &p->addr.v6, 16);
+        prefix_mask(out->key, v4 ? 4 : 16, p->len);
+        out->len = p->len;
+        out->value = values[i];
+        out->order = i;
+        if (!v4)
+            n6++;
+    }
+
+    bool ok = lpm_reserve_nodes(&img, 2, &root) &&
+        lpm_build_family(&img, entries, n4, 0) &&
+        lpm_build_family(&img, entries + n4, n6, 1);
+
+    free(entries);
+    if (!ok) {
+        free(img.nodes);
+        free(img.leaves);
+        return false;
+    }
+    lpm->nodes = img.nodes;
+    lpm->node_count = img.node_count;
+    lpm->leaves = img.leaves;
+    lpm->leaf_count = img.leaf_count;
+    return true;
+}
+
+/**
+ * ip_lpm_free - Release a table filled by ip_lpm_build().
+ * @lpm: Table to release.
+ */
+void ip_lpm_free(struct ip_lpm *lpm)
+{
+    free(lpm->nodes);
+    free(lpm->leaves);
+    memset(lpm, 0, sizeof(*lpm));
+}
+
+/**
+ * lpm_check_node - Check that lookups at one node stay inside the arrays.
+ * @node: Node to check.
+ * @index: Index of @node.
+ * @node_count: Number of nodes.
+ * @leaf_count: Number of leaves.
+ *
+ * Return: true if the rank bytes match the maps, the lowest leaf slot starts
+ * a run, and the children and leaves lie in bounds after @index.
+ */
+static bool lpm_check_node(const struct ip_lpm_node *node, size_t index,
+                           size_t node_count, size_t leaf_count)
+{
+    uint64_t children = 0, leaves = 0;
+    int first_leaf_slot = -1, first_run = -1;
+
+    for (int w = 0; w < 4; w++) {
+        if (node->child_rank[w] != children || node->leaf_rank[w] != leaves)
+            return false;
+        if (first_leaf_slot < 0 && ~node->child_bits[w] != 0)
+            first_leaf_slot = w * 64 + __builtin_ctzll(~node->child_bits[w]);
+        if (first_run < 0 && node->leaf_bits[w] != 0)
+            first_run = w * 64 + __builtin_ctzll(node->leaf_bits[w]);
+        children += (uint64_t)__builtin_popcountll(node->child_bits[w]);
+        leaves += (uint64_t)__builtin_popcountll(node->leaf_bits[w]);
+    }
+    /* Every leaf slot must have a run starting at or before it. */
+    if (first_leaf_slot >= 0 &&
+        (first_run < 0 || first_run > first_leaf_slot ||
+         node->leaf_base + leaves > leaf_count))
+        return false;
+    return children == 0 || (node->child_base > index &&
+                             node->child_base + children <= node_count);
+}
+
+/**
+ * ip_lpm_attach - Use compiled trie arrays that are already in memory.
+ * @lpm: Table to fill; it only refers to the arrays.
+ * @nodes: Array of @node_count nodes, as in a table from ip_lpm_build().
+ * @node_count: Number of nodes.
+ * @leaves: Array of @leaf_count leaf values.
+ * @leaf_count: Number of leaves.
+ *
+ * Return: true if every lookup stays inside the arrays, otherwise false.
+ */
+bool ip_lpm_attach(struct ip_lpm *lpm, const struct ip_lpm_node *nodes,
+                   size_t node_count, const uint32_t *leaves,
+                   size_t leaf_count)
+{
+    unsigned char *levels;
+    bool ok = true;
+
+    memset(lpm, 0, sizeof(*lpm));
+    if (node_count == 0)
+        return true;
+    if (node_count < 2 || node_count > UINT32_MAX || leaf_count > UINT32_MAX)
+        return false;
+
+    /* Address bytes left below each node; 0 marks a node not yet reached. */
+    levels = calloc(node_count, 1);
+    if (levels == NULL)
+        return false;
+    levels[0] = 4;
+    levels[1] = 16;
+    for (size_t i = 0; ok && i < node_count; i++) {
+        const struct ip_lpm_node *node = &nodes[i];
+        uint32_t children = 0;
+
+        ok = levels[i] != 0 &&
+            lpm_check_node(node, i, node_count, leaf_count);
+        for (int w = 0; ok && w < 4; w++)
+            children += (uint32_t)__builtin_popcountll(node->child_bits[w]);
+        ok = ok && (children == 0 || levels[i] > 1);
+        for (uint32_t c = 0; ok && c < children; c++) {
+            ok = levels[node->child_base + c] == 0;
+            levels[node->child_base + c] = (unsigned char)(levels[i] - 1);
+        }
+    }
+    free(levels);
+    if (ok) {
+        lpm->nodes = (struct ip_lpm_node *)nodes;
+        lpm->node_count = node_count;
+        lpm->leaves = (uint32_t *)leaves;
+        lpm->leaf_count = leaf_count;
+    }
+    return ok;
+}
+
+/**
+ * lpm_step - Consume one address byte at a node.
+ * @lpm: Compiled table.
+ * @node: Current node.
+ * @byte: Address byte this node consumes.
+ * @next: Output child index when the slot continues.
+ *
+ * Return: true if the walk continues at *@next; false if the slot is a leaf,
+ * whose value is then stored in *@next.
+ */
+static inline bool lpm_step(const struct ip_lpm *lpm,
+                            const struct ip_lpm_node *node,
+                            unsigned int byte, uint32_t *next)
+{
+    unsigned int w = byte >> 6;
+    uint64_t bit = 1ULL << (byte & 63);
+
+    if (node->child_bits[w] & bit) {
+        *next = node->child_base + node->child_rank[w] +
+            (uint32_t)__builtin_popcountll(node->child_bits[w] & (bit - 1));
+        return true;
+    }
+    *next = lpm->leaves[node->leaf_base + node->leaf_rank[w] +
+                        (uint32_t)__builtin_popcountll(node->leaf_bits[w] &
+                                                       (bit | (bit - 1))) -
+                        1];
+    return false;
+}
+
+/**
+ * lpm_walk - Look up one address below a root.
+ * @lpm: Compiled table.
+ * @root: 0 for IPv4, 1 for IPv6.
+ * @key: Address bytes in network order.
+ *
+ * Return: value of the longest matching prefix, or IP_LPM_NONE.
+ */
+static uint32_t lpm_walk(const struct ip_lpm *lpm, uint32_t root,
+                         const unsigned char *key)
+{
+    uint32_t next = root;
+
+    if (lpm->node_count == 0)
+        return IP_LPM_NONE;
+    for (unsigned int d = 0; lpm_step(lpm, &lpm->nodes[next], key[d], &next);
+         d++)
+        continue;
+    return next;
+}
+
+/**
+ * lpm_walk_batch - Look up an array of addresses below a root in lockstep.
+ * @lpm: Compiled table.
+ * @root: 0 for IPv4, 1 for IPv6.
+ * @keys: Address bytes, @stride bytes per address.
+ * @stride: Size of one address.
+ * @count: Number of addresses.
+ * @values: Output values.
+ */
+static void lpm_walk_batch(const struct ip_lpm *lpm, uint32_t root,
+                           const unsigned char *keys, size_t stride,
+                           size_t count, uint32_t *values)
+{
+    if (lpm->node_count == 0) {
+        for (size_t i = 0; i < count; i++)
+            values[i] = IP_LPM_NONE;
+        return;
+    }
+
+    for (size_t i = 0; i < count; i += LPM_BATCH) {
+        size_t n = count - i < LPM_BATCH ? count - i : LPM_BATCH;
+        uint32_t node[LPM_BATCH];
+        unsigned int live = (1u << n) - 1;
+
+        for (size_t k = 0; k < n; k++)
+            node[k] = root;
+        for (unsigned int d = 0; live != 0; d++) {
+            for (size_t k = 0; k < n; k++) {
+                if (!(live & (1u << k)))
+                    continue;
+                if (lpm_step(lpm, &lpm->nodes[node[k]],
+                             keys[(i + k) * stride + d], &node[k])) {
+                    __builtin_prefetch(&lpm->nodes[node[k]]);
+                } else {
+                    values[i + k] = node[k];
+                    live &= ~(1u << k);
+                }
+            }
+        }
+    }
+}
+
+uint32_t ip_lpm_lookup_ipv4(const struct ip_lpm *lpm,
+                            const struct in_addr *addr)
+{
+    return lpm_walk(lpm, 0, (const unsigned char *)addr);
+}
+
+uint32_t ip_lpm_lookup_ipv6(const struct ip_lpm *lpm,
+                            const struct in6_addr *addr)
+{
+    return lpm_walk(lpm, 1, addr->s6_addr);
+}
+
+void ip_lpm_lookup_ipv4_batch(const struct ip_lpm *lpm,
+                              const struct in_addr *addrs, size_t count,
+                              uint32_t *values)
+{
+    lpm_walk_batch(lpm, 0, (const unsigned char *)addrs, sizeof(*addrs),
+                   count, values);
+}
+
+void ip_lpm_lookup_ipv6_batch(const struct ip_lpm *lpm,
+                              const struct in6_addr *addrs, size_t count,
+                              uint32_t *values)
+{
+    lpm_walk_batch(lpm, 1, (const unsigned char *)addrs, sizeof(*addrs),
+                   count, values);
+}
+
+/**
+ * ip_lpm_match - Validate address text and look it up in one pass.
+ * @lpm: Compiled table.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @value: Output value of the longest matching prefix, or IP_LPM_NONE.
+ *
+ * Return: true if the text is a valid address and @value was written.
+ */
+bool ip_lpm_match(const struct ip_lpm *lpm, const char *buf, size_t len,
+                  uint32_t *value)
+{
+    struct in_addr addr4;
+    struct in6_addr addr6;
+
+    if (buf == NULL || len == 0)
+        return false;
+    if (memchr(buf, ':', len) != NULL) {
+        if (!parse_ipv6_address(buf, len, &addr6))
+            return false;
+        *value = ip_lpm_lookup_ipv6(lpm, &addr6);
+        return true;
+    }
+    if (!parse_ipv4_address(buf, len, &addr4))
+        return false;
+    *value = ip_lpm_lookup_ipv4(lpm, &addr4);
+    return true;
+}
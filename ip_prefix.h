@@ -0,0 +1,168 @@
+#ifndef IP_PREFIX_H
+#define IP_PREFIX_H
+
+#include "ip_validator.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Value ip_lpm lookups return when no prefix covers the address. */
+#define IP_LPM_NONE UINT32_MAX
+
+/* A CIDR block: network address and prefix length. */
+struct ip_prefix {
+    struct ip_address addr;     /* Family and network address */
+    unsigned int len;           /* Prefix length, 0-32 or 0-128 */
+};
+
+/*
+ * One node of the compiled trie. Each node consumes one byte of the address.
+ * Bit i of @child_bits is set when slot i continues in a child node; the
+ * children of a node are stored contiguously from @child_base in slot order.
+ * The other slots are leaves, stored run-length compressed from @leaf_base:
+ * bit i of @leaf_bits is set where a leaf slot starts a new value. The rank
+ * bytes count the set bits in the lower words, so locating any slot costs
+ * one popcount.
+ */
+struct ip_lpm_node {
+    uint64_t child_bits[4];
+    uint64_t leaf_bits[4];
+    uint32_t child_base;
+    uint32_t leaf_base;
+    uint8_t child_rank[4];
+    uint8_t leaf_rank[4];
+};
+
+/*
+ * Compiled longest-prefix-match table for both families. The arrays hold
+ * indices only, never pointers, so a compiled table can be copied or mapped
+ * as is. Node 0 is the IPv4 root and node 1 the IPv6 root.
+ */
+struct ip_lpm {
+    struct ip_lpm_node *nodes;
+    uint32_t *leaves;
+    size_t node_count;
+    size_t leaf_count;
+};
+
+/**
+ * parse_ip_prefix - Parse CIDR text such as "10.0.0.0/8" or "2001:db8::/32".
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @prefix: Output network address and prefix length.
+ *
+ * The address part is validated exactly as by parse_ipv4_address() or
+ * parse_ipv6_address(). The length is 0-32 or 0-128 in decimal without
+ * leading zeros. A bare address is taken as a host prefix (/32 or /128).
+ * Host bits set below the prefix length are cleared, so "10.1.2.3/8" yields
+ * 10.0.0.0/8. @prefix is left untouched when the text is rejected.
+ *
+ * Return: true if the text was a valid prefix and @prefix was written.
+ */
+bool parse_ip_prefix(const char *buf, size_t len, struct ip_prefix *prefix);
+
+/**
+ * ip_lpm_build - Compile a set of prefixes into a lookup table.
+ * @lpm: Table to fill; release it with ip_lpm_free().
+ * @prefixes: Array of @count prefixes of either family.
+ * @values: Array of @count values returned for addresses whose longest
+ *          matching prefix is the corresponding entry of @prefixes, for
+ *          example a rule number. IP_LPM_NONE is reserved.
+ * @count: Number of prefixes.
+ *
+ * When the same prefix appears more than once the later entry wins.
+ *
+ * Return: true on success, false if memory could not be allocated or a value
+ * is IP_LPM_NONE; @lpm is then empty.
+ */
+bool ip_lpm_build(struct ip_lpm *lpm, const struct ip_prefix *prefixes,
+                  const uint32_t *values, size_t count);
+
+/**
+ * ip_lpm_free - Release a table filled by ip_lpm_build().
+ * @lpm: Table to release; it is left empty.
+ */
+void ip_lpm_free(struct ip_lpm *lpm);
+
+/**
+ * ip_lpm_attach - Use compiled trie arrays that are already in memory.
+ * @lpm: Table to fill. It only refers to the arrays, which must outlive it;
+ *       do not pass it to ip_lpm_free().
+ * @nodes: Array of @node_count nodes, as in a table from ip_lpm_build(), for
+ *         example part of a mapped file.
+ * @node_count: Number of nodes.
+ * @leaves: Array of @leaf_count leaf values.
+ * @leaf_count: Number of leaves.
+ *
+ * Every node is checked once, so a damaged table is refused instead of
+ * sending a later lookup outside the arrays: the rank bytes must match the
+ * maps, children must follow their parent in bounds and be reached once, and
+ * no path may be deeper than the address. The arrays are never written.
+ *
+ * Return: true if the arrays form a valid table, otherwise false; @lpm is
+ * then empty.
+ */
+bool ip_lpm_attach(struct ip_lpm *lpm, const struct ip_lpm_node *nodes,
+                   size_t node_count, const uint32_t *leaves,
+                   size_t leaf_count);
+
+/**
+ * ip_lpm_lookup_ipv4 - Find the longest prefix covering an IPv4 address.
+ * @lpm: Compiled table.
+ * @addr: Address in network byte order.
+ *
+ * Return: value of the longest matching prefix, or IP_LPM_NONE.
+ */
+uint32_t ip_lpm_lookup_ipv4(const struct ip_lpm *lpm,
+                            const struct in_addr *addr);
+
+/**
+ * ip_lpm_lookup_ipv6 - Find the longest prefix covering an IPv6 address.
+ * @lpm: Compiled table.
+ * @addr: Address in network byte order.
+ *
+ * Return: value of the longest matching prefix, or IP_LPM_NONE.
+ */
+uint32_t ip_lpm_lookup_ipv6(const struct ip_lpm *lpm,
+                            const struct in6_addr *addr);
+
+/**
+ * ip_lpm_lookup_ipv4_batch - Look up an array of IPv4 addresses.
+ * @lpm: Compiled table.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv4_batch().
+ * @count: Number of addresses.
+ * @values: Output array of @count values, IP_LPM_NONE where nothing matches.
+ *
+ * Walks several addresses down the trie in lockstep and prefetches each
+ * next level, so the cache misses of independent lookups overlap.
+ */
+void ip_lpm_lookup_ipv4_batch(const struct ip_lpm *lpm,
+                              const struct in_addr *addrs, size_t count,
+                              uint32_t *values);
+
+/**
+ * ip_lpm_lookup_ipv6_batch - Look up an array of IPv6 addresses.
+ * @lpm: Compiled table.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv6_batch().
+ * @count: Number of addresses.
+ * @values: Output array of @count values, IP_LPM_NONE where nothing matches.
+ */
+void ip_lpm_lookup_ipv6_batch(const struct ip_lpm *lpm,
+                              const struct in6_addr *addrs, size_t count,
+                              uint32_t *values);
+
+/**
+ * ip_lpm_match - Validate address text and look it up in one pass.
+ * @lpm: Compiled table.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @value: Output value of the longest matching prefix, or IP_LPM_NONE.
+ *
+ * Return: true if the text is a valid IPv4 or IPv6 address and @value was
+ * written, false if the text was rejected.
+ */
+bool ip_lpm_match(const struct ip_lpm *lpm, const char *buf, size_t len,
+                  uint32_t *value);
+
+#endif                          /* IP_PREFIX_H */
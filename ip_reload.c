@@ -0,0 +1,170 @@
+/*
+ * Hot reload of rulesets with epoch-based reclamation.
+ *
+ * The global epoch only grows. A reader copies it into its slot before it
+ * loads the ruleset pointer and clears the slot when done. After swapping
+ * the pointer a writer advances the epoch to E; a slot that is clear, or
+ * holds E or later, belongs to a reader that cannot have the previous
+ * pointer, so the writer waits until every slot is one of these and then
+ * closes the previous ruleset. Readers never wait for anything.
+ */
+
+#include "ip_reload.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * ruleset_take - Move a ruleset into heap memory the handle owns.
+ * @rules: Ruleset to move, or NULL for an empty one; left empty.
+ *
+ * Return: the moved ruleset, or NULL if memory could not be allocated.
+ */
+static struct ip_ruleset *ruleset_take(struct ip_ruleset *rules)
+{
+    struct ip_ruleset *owned = calloc(1, sizeof(*owned));
+
+    if (owned != NULL && rules != NULL) {
+        *owned = *rules;
+        memset(rules, 0, sizeof(*rules));
+    }
+    return owned;
+}
+
+/**
+ * ruleset_drop - Close and free a ruleset from ruleset_take().
+ * @rules: Ruleset no reader can reach.
+ */
+static void ruleset_drop(struct ip_ruleset *rules)
+{
+    ip_ruleset_close(rules);
+    free(rules);
+}
+
+/**
+ * ip_reload_init - Set up a handle serving a ruleset.
+ * @reload: Handle to initialise.
+ * @rules: Initial ruleset, or NULL.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+bool ip_reload_init(struct ip_reload *reload, struct ip_ruleset *rules)
+{
+    struct ip_ruleset *owned = ruleset_take(rules);
+
+    if (owned == NULL)
+        return false;
+    atomic_init(&reload->current, owned);
+    atomic_init(&reload->epoch, 1);
+    atomic_flag_clear(&reload->writer);
+    for (int i = 0; i < IP_RELOAD_MAX_READERS; i++) {
+        atomic_init(&reload->slots[i].epoch, 0);
+        atomic_init(&reload->slots[i].used, false);
+    }
+    return true;
+}
+
+/**
+ * ip_reload_destroy - Release a handle and its current ruleset.
+ * @reload: Handle to release.
+ */
+void ip_reload_destroy(struct ip_reload *reload)
+{
+    ruleset_drop(atomic_load(&reload->current));
+    atomic_store(&reload->current, NULL);
+}
+
+/**
+ * ip_reload_register - Claim a reader slot for the calling thread.
+ * @reload: Handle to read from.
+ *
+ * Return: slot number, or -1 if all slots are taken.
+ */
+int ip_reload_register(struct ip_reload *reload)
+{
+    for (int i = 0; i < IP_RELOAD_MAX_READERS; i++) {
+        bool expected = false;
+
+        if (atomic_compare_exchange_strong(&reload->slots[i].used, &expected,
+                                           true))
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * ip_reload_unregister - Give a reader slot back.
+ * @reload: Handle the slot belongs to.
+ * @slot: Slot to release.
+ */
+void ip_reload_unregister(struct ip_reload *reload, int slot)
+{
+    atomic_store(&reload->slots[slot].epoch, 0);
+    atomic_store(&reload->slots[slot].used, false);
+}
+
+/**
+ * wait_for_readers - Wait until no reader can hold a pointer from before
+ * @epoch.
+ * @reload: Handle being updated.
+ * @epoch: Epoch set after the pointer swap.
+ */
+static void wait_for_readers(struct ip_reload *reload, uint64_t epoch)
+{
+    for (int i = 0; i < IP_RELOAD_MAX_READERS; i++) {
+        for (;;) {
+            uint64_t seen = atomic_load(&reload->slots[i].epoch);
+
+            if (seen == 0 || seen >= epoch)
+                break;
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * ip_reload_publish - Replace the current ruleset.
+ * @reload: Handle to update.
+ * @rules: New ruleset; left empty on success.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+bool ip_reload_publish(struct ip_reload *reload, struct ip_ruleset *rules)
+{
+    struct ip_ruleset *owned = ruleset_take(rules);
+
+    if (owned == NULL)
+        return false;
+    while (atomic_flag_test_and_set_explicit(&reload->writer,
+                                             memory_order_acquire))
+        sched_yield();
+
+    struct ip_ruleset *old = atomic_exchange(&reload->current, owned);
+    uint64_t epoch = atomic_fetch_add(&reload->epoch, 1) + 1;
+
+    wait_for_readers(reload, epoch);
+    atomic_flag_clear_explicit(&reload->writer, memory_order_release);
+    ruleset_drop(old);
+    return true;
+}
+
+/**
+ * ip_reload_open - Map a ruleset file and publish it.
+ * @reload: Handle to update.
+ * @path: Ruleset file.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool ip_reload_open(struct ip_reload *reload, const char *path)
+{
+    struct ip_ruleset rules;
+
+    if (!ip_ruleset_open(&rules, path))
+        return false;
+    if (!ip_reload_publish(reload, &rules)) {
+        ip_ruleset_close(&rules);
+        return false;
+    }
+    return true;
+}
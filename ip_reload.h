@@ -0,0 +1,126 @@
+#ifndef IP_RELOAD_H
+#define IP_RELOAD_H
+
+#include "ip_ruleset.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Reader slots of a reload handle; one per thread doing lookups. */
+#define IP_RELOAD_MAX_READERS 64
+
+/* Epoch one reader entered at, 0 while it holds no ruleset. */
+struct ip_reload_slot {
+    _Alignas(64) _Atomic uint64_t epoch;
+    _Atomic bool used;
+};
+
+/*
+ * Current ruleset shared between lookup threads and a reloading thread,
+ * with epoch-based reclamation. A reader brackets its lookups with
+ * ip_reload_enter() and ip_reload_exit(), which store the global epoch in
+ * the reader's own slot and clear it again: no lock, no shared write. A
+ * writer swaps the pointer, advances the epoch and unmaps the previous
+ * ruleset once every slot is clear or newer, so readers never see it go.
+ */
+struct ip_reload {
+    _Atomic(struct ip_ruleset *) current;
+    _Atomic uint64_t epoch;
+    atomic_flag writer;         /* Held by ip_reload_publish() */
+    struct ip_reload_slot slots[IP_RELOAD_MAX_READERS];
+};
+
+/**
+ * ip_reload_init - Set up a handle serving a ruleset.
+ * @reload: Handle to initialise; release it with ip_reload_destroy().
+ * @rules: Ruleset from ip_ruleset_open(), now owned by @reload and left
+ *         empty, or NULL to start with an empty ruleset.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+bool ip_reload_init(struct ip_reload *reload, struct ip_ruleset *rules);
+
+/**
+ * ip_reload_destroy - Release a handle and its current ruleset.
+ * @reload: Handle no thread is using any more.
+ */
+void ip_reload_destroy(struct ip_reload *reload);
+
+/**
+ * ip_reload_register - Claim a reader slot for the calling thread.
+ * @reload: Handle to read from.
+ *
+ * Return: slot number to pass to ip_reload_enter(), or -1 if all
+ * IP_RELOAD_MAX_READERS slots are taken.
+ */
+int ip_reload_register(struct ip_reload *reload);
+
+/**
+ * ip_reload_unregister - Give a reader slot back.
+ * @reload: Handle the slot belongs to.
+ * @slot: Slot from ip_reload_register(), outside ip_reload_enter().
+ */
+void ip_reload_unregister(struct ip_reload *reload, int slot);
+
+/**
+ * ip_reload_enter - Start using the current ruleset.
+ * @reload: Handle to read from.
+ * @slot: Caller's slot from ip_reload_register().
+ *
+ * The ruleset stays mapped until the matching ip_reload_exit(), however
+ * many reloads happen meanwhile. Sections do not nest, and a long one
+ * delays the writer, not other readers; bracket a batch of lookups rather
+ * than a whole thread lifetime.
+ *
+ * Return: the ruleset to look up in.
+ */
+static inline const struct ip_ruleset *ip_reload_enter(struct ip_reload
+                                                       *reload, int slot)
+{
+    /*
+     * Sequentially consistent on both sides: a writer that swapped the
+     * pointer before this load also sees this slot before freeing.
+     */
+    atomic_store(&reload->slots[slot].epoch, atomic_load(&reload->epoch));
+    return atomic_load(&reload->current);
+}
+
+/**
+ * ip_reload_exit - Stop using the ruleset from ip_reload_enter().
+ * @reload: Handle read from.
+ * @slot: Caller's slot.
+ */
+static inline void ip_reload_exit(struct ip_reload *reload, int slot)
+{
+    atomic_store_explicit(&reload->slots[slot].epoch, 0,
+                          memory_order_release);
+}
+
+/**
+ * ip_reload_publish - Replace the current ruleset.
+ * @reload: Handle to update.
+ * @rules: New ruleset from ip_ruleset_open(), now owned by @reload and left
+ *         empty.
+ *
+ * Readers entering after the swap get @rules at once. The call returns
+ * after every reader that may still hold the previous ruleset has left its
+ * section, and the previous ruleset has been closed, so it must not be made
+ * from inside a section. Concurrent publishers take turns.
+ *
+ * Return: true on success, false if memory could not be allocated; @rules
+ * is then untouched.
+ */
+bool ip_reload_publish(struct ip_reload *reload, struct ip_ruleset *rules);
+
+/**
+ * ip_reload_open - Map a ruleset file and publish it.
+ * @reload: Handle to update.
+ * @path: File written by ip_ruleset_save() or ipcompile.
+ *
+ * Return: true on success; false with errno set if the file could not be
+ * opened, in which case the current ruleset stays in place.
+ */
+bool ip_reload_open(struct ip_reload *reload, const char *path);
+
+#endif                          /* IP_RELOAD_H */
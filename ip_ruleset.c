@@ -0,0 +1,246 @@
+/*
+ * Precompiled ruleset files.
+ *
+ * A ruleset file is a 64-byte header followed by the trie nodes, the trie
+ * leaves and an embedded ip_set image, each at a 64-byte aligned offset
+ * recorded in the header. Opening maps the file and points the tables at
+ * their arrays; the only work proportional to the size is one pass over the
+ * trie nodes, which keeps a damaged file from sending lookups out of bounds.
+ */
+
+#include "ip_ruleset.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Identifies a ruleset image; the version is kept separately. */
+static const char ip_ruleset_magic[8] = { 'I', 'P', 'R', 'U', 'L', 'E', 'S',
+    0
+};
+
+/* Written in native order, so a foreign-endian image reads differently. */
+#define IP_RULESET_BYTE_ORDER 0x01020304u
+
+/* Alignment of the header and of each section. */
+#define IP_RULESET_ALIGN 64
+
+/* First bytes of a ruleset image. */
+struct ip_ruleset_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t node_count;
+    uint64_t node_offset;
+    uint64_t leaf_count;
+    uint64_t leaf_offset;
+    uint64_t set_offset;
+    uint64_t set_size;
+};
+
+_Static_assert(sizeof(struct ip_ruleset_header) == IP_RULESET_ALIGN,
+               "the header fills exactly one alignment unit");
+
+/**
+ * ruleset_layout - Compute the section offsets of an image.
+ * @header: In: node and leaf counts and the set size. Out: offsets.
+ *
+ * Return: total image size, or 0 if the image would not fit in memory.
+ */
+static uint64_t ruleset_layout(struct ip_ruleset_header *header)
+{
+    const uint64_t max = SIZE_MAX / 4;
+    const uint64_t mask = IP_RULESET_ALIGN - 1;
+
+    if (header->node_count > max / sizeof(struct ip_lpm_node) ||
+        header->leaf_count > max / sizeof(uint32_t) || header->set_size > max)
+        return 0;
+    header->node_offset = IP_RULESET_ALIGN;
+    header->leaf_offset = (header->node_offset + header->node_count *
+                           sizeof(struct ip_lpm_node) + mask) & ~mask;
+    header->set_offset = (header->leaf_offset + header->leaf_count *
+                          sizeof(uint32_t) + mask) & ~mask;
+    return header->set_offset + header->set_size;
+}
+
+/**
+ * write_section - Write one section and pad it to its offset.
+ * @f: Output file, positioned at @pos.
+ * @pos: Current offset in the image; advanced.
+ * @offset: Offset the section starts at.
+ * @data: Section bytes.
+ * @size: Number of bytes of @data.
+ *
+ * Return: true if everything was written.
+ */
+static bool write_section(FILE *f, uint64_t *pos, uint64_t offset,
+                          const void *data, size_t size)
+{
+    static const unsigned char zeros[IP_RULESET_ALIGN];
+
+    if (offset - *pos > sizeof(zeros) ||
+        fwrite(zeros, 1, (size_t)(offset - *pos), f) != offset - *pos ||
+        (size > 0 && fwrite(data, 1, size, f) != size))
+        return false;
+    *pos = offset + size;
+    return true;
+}
+
+/**
+ * ip_ruleset_save - Write a prefix table and an address set to one file.
+ * @lpm: Table to write, or NULL.
+ * @set: Set to write, or NULL.
+ * @path: File to create or replace.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool ip_ruleset_save(const struct ip_lpm *lpm, const struct ip_set *set,
+                     const char *path)
+{
+    struct ip_ruleset_header header;
+    size_t tmp_len = strlen(path) + sizeof(".tmp");
+    char *tmp = malloc(tmp_len);
+    uint64_t pos = 0;
+
+    if (tmp == NULL)
+        return false;
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ip_ruleset_magic, sizeof(header.magic));
+    header.version = IP_RULESET_VERSION;
+    header.byte_order = IP_RULESET_BYTE_ORDER;
+    if (lpm != NULL) {
+        header.node_count = lpm->node_count;
+        header.leaf_count = lpm->leaf_count;
+    }
+    if (set != NULL)
+        header.set_size = set->image_size;
+    ruleset_layout(&header);
+
+    size_t node_bytes = (size_t)header.node_count * sizeof(*lpm->nodes);
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f != NULL &&
+        write_section(f, &pos, 0, &header, sizeof(header)) &&
+        write_section(f, &pos, header.node_offset,
+                      lpm != NULL ? lpm->nodes : NULL, node_bytes) &&
+        write_section(f, &pos, header.leaf_offset,
+                      lpm != NULL ? lpm->leaves : NULL,
+                      (size_t)header.leaf_count * sizeof(uint32_t)) &&
+        write_section(f, &pos, header.set_offset,
+                      set != NULL ? set->image : NULL,
+                      (size_t)header.set_size) &&
+        fflush(f) == 0 && fsync(fileno(f)) == 0;
+
+    /*
+     * Synced before the rename, so after a crash the name never points at a
+     * file whose data did not reach the disk.
+     */
+    if (f != NULL && fclose(f) != 0)
+        ok = false;
+    if (ok && rename(tmp, path) != 0)
+        ok = false;
+    if (!ok && f != NULL) {
+        int saved = errno;
+
+        unlink(tmp);
+        errno = saved;
+    }
+    free(tmp);
+    return ok;
+}
+
+/**
+ * ruleset_attach - Point the tables of a ruleset at a mapped image.
+ * @rules: Ruleset whose @image and @image_size are set.
+ *
+ * Return: true if the image is a valid ruleset.
+ */
+static bool ruleset_attach(struct ip_ruleset *rules)
+{
+    struct ip_ruleset_header header, expect;
+    const unsigned char *base = rules->image;
+
+    if (rules->image_size < sizeof(header))
+        return false;
+    memcpy(&header, base, sizeof(header));
+    expect = header;
+    if (memcmp(header.magic, ip_ruleset_magic, sizeof(header.magic)) != 0 ||
+        header.version != IP_RULESET_VERSION ||
+        header.byte_order != IP_RULESET_BYTE_ORDER ||
+        ruleset_layout(&expect) != rules->image_size ||
+        header.node_offset != expect.node_offset ||
+        header.leaf_offset != expect.leaf_offset ||
+        header.set_offset != expect.set_offset)
+        return false;
+    if (!ip_lpm_attach(&rules->lpm, (const struct ip_lpm_node *)(const void *)
+                       (base + header.node_offset),
+                       (size_t)header.node_count,
+                       (const uint32_t *)(const void *)
+                       (base + header.leaf_offset),
+                       (size_t)header.leaf_count))
+        return false;
+    return header.set_size == 0 ||
+        ip_set_attach(&rules->set, base + header.set_offset,
+                      (size_t)header.set_size);
+}
+
+/**
+ * ip_ruleset_open - Map a file written by ip_ruleset_save().
+ * @rules: Ruleset to fill; release it with ip_ruleset_close().
+ * @path: File to map read-only.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool ip_ruleset_open(struct ip_ruleset *rules, const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    memset(rules, 0, sizeof(*rules));
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size < (off_t)sizeof(struct ip_ruleset_header)) {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    void *image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd,
+                       0);
+
+    close(fd);
+    if (image == MAP_FAILED)
+        return false;
+    rules->image = image;
+    rules->image_size = (size_t)st.st_size;
+    errno = 0;
+    if (!ruleset_attach(rules)) {
+        bool nomem = errno == ENOMEM;
+
+        ip_ruleset_close(rules);
+        errno = nomem ? ENOMEM : EINVAL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * ip_ruleset_close - Unmap a ruleset from ip_ruleset_open().
+ * @rules: Ruleset to release.
+ */
+void ip_ruleset_close(struct ip_ruleset *rules)
+{
+    if (rules->image != NULL)
+        munmap(rules->image, rules->image_size);
+    memset(rules, 0, sizeof(*rules));
+}
@@ -0,0 +1,64 @@
+#ifndef IP_RULESET_H
+#define IP_RULESET_H
+
+#include "ip_prefix.h"
+#include "ip_set.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Format version written by ip_ruleset_save(); others are refused. */
+#define IP_RULESET_VERSION 1
+
+/*
+ * Precompiled rules mapped from a file: a prefix table whose values are rule
+ * numbers or class labels, and a set of single addresses. The file holds the
+ * compiled arrays at 64-byte aligned offsets with no pointers, so it needs
+ * no fix-ups and processes mapping the same file share its pages.
+ *
+ * @lpm and @set work with every lookup in ip_prefix.h and ip_set.h but refer
+ * into the mapping; release them only through ip_ruleset_close().
+ */
+struct ip_ruleset {
+    struct ip_lpm lpm;
+    struct ip_set set;
+    void *image;                /* Read-only mapping of the whole file */
+    size_t image_size;
+};
+
+/**
+ * ip_ruleset_save - Write a prefix table and an address set to one file.
+ * @lpm: Table from ip_lpm_build(), or NULL for none.
+ * @set: Set from ip_set_build(), or NULL for none.
+ * @path: File to create or replace.
+ *
+ * The image is written to "@path.tmp", synced and renamed over @path, so a
+ * service opening @path sees either the old file or the complete new one,
+ * even after a crash.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool ip_ruleset_save(const struct ip_lpm *lpm, const struct ip_set *set,
+                     const char *path);
+
+/**
+ * ip_ruleset_open - Map a file written by ip_ruleset_save().
+ * @rules: Ruleset to fill; release it with ip_ruleset_close().
+ * @path: File to map read-only.
+ *
+ * Nothing is rebuilt: the header and the trie nodes are checked, as by
+ * ip_lpm_attach(), and the arrays are used in place.
+ *
+ * Return: true on success; false with errno set if the file cannot be
+ * mapped, or EINVAL if it is not a valid ruleset of this version and byte
+ * order.
+ */
+bool ip_ruleset_open(struct ip_ruleset *rules, const char *path);
+
+/**
+ * ip_ruleset_close - Unmap a ruleset from ip_ruleset_open().
+ * @rules: Ruleset to release; it is left empty.
+ */
+void ip_ruleset_close(struct ip_ruleset *rules);
+
+#endif                          /* IP_RULESET_H */
@@ -0,0 +1,182 @@
+/*
+ * Address scanner: finds every IPv4 and IPv6 address in a text buffer.
+ *
+ * A vector kernel skips to the next decimal digit or colon; every address
+ * has one within its first five bytes, so the scanner steps back over at most
+ * four hex letters to the real start. From there both recognisers of
+ * ip_dfa.h run side by side over the same byte-class lookups, remembering
+ * the last length at which each one accepted, until both have rejected. The
+ * longest accepted span wins. Text that fails is skipped up to the end of
+ * its token, so every byte is classified a bounded number of times.
+ */
+
+#include "ip_scan.h"
+#include "ip_charclass.h"
+#include "ip_dfa.h"
+#include "ip_simd.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/* Bytes that glue neighbouring text into one token. */
+#define SCAN_TOKEN (IP_CC_WORD | IP_CC_DOT | IP_CC_COLON)
+
+/* Furthest an address can start before its first digit or colon. */
+#define SCAN_MAX_LEAD 4
+
+/**
+ * scan_token_end - Skip to the end of the token containing @pos.
+ * @buf: Text being scanned.
+ * @len: Number of bytes of @buf.
+ * @pos: Offset inside the token.
+ *
+ * Return: offset of the first byte after the token.
+ */
+static size_t scan_token_end(const char *buf, size_t len, size_t pos)
+{
+    while (pos < len && (ip_cc(buf[pos]) & SCAN_TOKEN))
+        pos++;
+    return pos;
+}
+
+/**
+ * scan_boundary_after - Check that a match is not glued to what follows.
+ * @buf: Text being scanned.
+ * @len: Number of bytes of @buf.
+ * @end: Offset just past the match.
+ * @family: AF_INET or AF_INET6, the family of the match.
+ *
+ * Return: true if the match ends on a token boundary.
+ */
+static bool scan_boundary_after(const char *buf, size_t len, size_t end,
+                                int family)
+{
+    if (end == len)
+        return true;
+
+    unsigned int cls = ip_cc(buf[end]);
+
+    if (cls & IP_CC_WORD)
+        return false;
+    if (end + 1 < len && (ip_cc(buf[end + 1]) & IP_CC_WORD)) {
+        /* "1.2.3.4.5" or "1:2:3:4:5:6:7:8:9" continue the token. */
+        if (cls & IP_CC_DOT)
+            return false;
+        if ((cls & IP_CC_COLON) && family == AF_INET6)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * scan_munch - Find the longest valid address starting at @buf.
+ * @buf: Candidate start.
+ * @len: Bytes available from @buf.
+ * @family: AF_INET, AF_INET6 or AF_UNSPEC.
+ * @addr: Output family and address of the match.
+ *
+ * Return: length of the longest valid prefix of @buf, or 0 if there is none.
+ */
+static size_t scan_munch(const char *buf, size_t len, int family,
+                         struct ip_address *addr)
+{
+    struct ipv4_dfa v4;
+    struct ipv6_dfa v6;
+    bool v4_live = family != AF_INET6;
+    bool v6_live = family != AF_INET;
+    size_t v4_best = 0, v6_best = 0;
+
+    if (len > INET6_ADDRSTRLEN - 1)
+        len = INET6_ADDRSTRLEN - 1;
+    ipv4_dfa_init(&v4);
+    ipv6_dfa_init(&v6);
+    for (size_t i = 0; i < len && (v4_live || v6_live); i++) {
+        unsigned int cls = ip_cc(buf[i]);
+
+        if (v4_live) {
+            v4_live = i < MAX_SIZE_IPV4 - 1 && ipv4_dfa_step(&v4, cls);
+            if (v4_live && ipv4_dfa_accepting(&v4))
+                v4_best = i + 1;
+        }
+        if (v6_live) {
+            v6_live = ipv6_dfa_step(&v6, cls);
+            if (v6_live && ipv6_dfa_accepting(&v6))
+                v6_best = i + 1;
+        }
+    }
+
+    /*
+     * The recognisers have run past the best span, so convert it with the
+     * one-shot parsers, which take the vector path; this happens once per
+     * match and accepts exactly what the recognisers accepted.
+     */
+    if (v4_best > v6_best) {
+        addr->family = AF_INET;
+        parse_ipv4_address(buf, v4_best, &addr->v4);
+        return v4_best;
+    }
+    if (v6_best > 0) {
+        addr->family = AF_INET6;
+        parse_ipv6_address(buf, v6_best, &addr->v6);
+        return v6_best;
+    }
+    return 0;
+}
+
+/**
+ * ip_scan - Find the IP addresses embedded in free-form text.
+ * @buf: Text to search; need not be NUL-terminated.
+ * @len: Number of bytes of @buf.
+ * @pos: In/out scan position.
+ * @family: AF_INET, AF_INET6 or AF_UNSPEC.
+ * @matches: Output array of @max_matches entries.
+ * @max_matches: Capacity of @matches.
+ *
+ * Return: number of entries written to @matches.
+ */
+size_t ip_scan(const char *buf, size_t len, size_t *pos, int family,
+               struct ip_match *matches, size_t max_matches)
+{
+    size_t n = 0;
+    size_t p = *pos;
+
+    if (buf == NULL) {
+        *pos = len;
+        return 0;
+    }
+    while (n < max_matches && p < len) {
+        size_t anchor = p + ip_simd_find_anchor(buf + p, len - p);
+        size_t start = anchor;
+
+        if (anchor == len) {
+            p = len;
+            break;
+        }
+
+        /* Step back over the hex letters of a leading IPv6 group. */
+        while (start > p && anchor - start < SCAN_MAX_LEAD &&
+               (ip_cc(buf[start - 1]) & IP_CC_HEX))
+            start--;
+        if (start > 0 && (ip_cc(buf[start - 1]) & SCAN_TOKEN)) {
+            p = scan_token_end(buf, len, anchor);
+            continue;
+        }
+
+        struct ip_match *m = &matches[n];
+        size_t match_len = scan_munch(buf + start, len - start, family,
+                                      &m->addr);
+
+        if (match_len == 0 ||
+            !scan_boundary_after(buf, len, start + match_len,
+                                 m->addr.family)) {
+            p = scan_token_end(buf, len, anchor);
+            continue;
+        }
+        m->offset = start;
+        m->len = match_len;
+        n++;
+        p = start + match_len;
+    }
+    *pos = p;
+    return n;
+}
@@ -0,0 +1,43 @@
+#ifndef IP_SCAN_H
+#define IP_SCAN_H
+
+#include "ip_validator.h"
+
+#include <stddef.h>
+
+/* One address found in free-form text. */
+struct ip_match {
+    size_t offset;              /* Start of the address text in the buffer */
+    size_t len;                 /* Length of the address text */
+    struct ip_address addr;     /* Family and binary value */
+};
+
+/**
+ * ip_scan - Find the IP addresses embedded in free-form text.
+ * @buf: Text to search, such as log lines or JSON; need not be
+ *       NUL-terminated.
+ * @len: Number of bytes of @buf.
+ * @pos: In/out scan position. Set it to 0 before the first call; on return
+ *       it is where the next call resumes.
+ * @family: AF_INET or AF_INET6 to report only that family, or AF_UNSPEC for
+ *          both.
+ * @matches: Output array of @max_matches entries.
+ * @max_matches: Capacity of @matches.
+ *
+ * An address is reported when it is not glued to surrounding text: the byte
+ * before it must not be a letter, digit, '_', '.' or ':', and the byte after
+ * it must not be a letter, digit or '_', nor a '.' (or, after IPv6, a ':')
+ * followed by one. Ports ("10.0.0.1:80"), brackets ("[::1]:443") and zone
+ * suffixes ("fe80::1%eth0") therefore leave the address itself intact,
+ * while version strings like "1.2.3.4.5" report nothing. At each start the
+ * longest valid text wins, so "::ffff:192.0.2.1" is one IPv6 address.
+ * Every address accepted is exactly what parse_ipv4_address() or
+ * parse_ipv6_address() accepts for the reported span.
+ *
+ * Return: number of entries written to @matches. Fewer than @max_matches
+ * means the end of @buf was reached and *@pos == @len.
+ */
+size_t ip_scan(const char *buf, size_t len, size_t *pos, int family,
+               struct ip_match *matches, size_t max_matches);
+
+#endif                          /* IP_SCAN_H */
@@ -0,0 +1,598 @@
+/*
+ * Immutable address sets in Eytzinger order.
+ *
+ * A sorted array is rearranged so that node k has its children at 2k and
+ * 2k + 1. A search then walks a fixed access pattern from the root, with no
+ * data-dependent branches: it goes left or right by adding a comparison
+ * result to the index, and the first level of a subtree shares a cache line
+ * with its parent's grandparent. The last step, k >> ffs(~k), climbs back
+ * to the deepest node where the search went left, which is the first key not
+ * below the one searched for.
+ *
+ * Both key arrays live in one block preceded by a header, and that block is
+ * also the file format, so saving is one write and opening is one mmap.
+ */
+
+#include "ip_set.h"
+#include "ip_simd.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+
+/* Identifies a set image; the last byte is the format version. */
+static const char ip_set_magic[8] = { 'I', 'P', 'S', 'E', 'T', 0, 0, 1 };
+
+/* Written in native order, so a foreign-endian image reads differently. */
+#define IP_SET_BYTE_ORDER 0x01020304u
+
+/* Alignment of the header and of each key array inside an image. */
+#define IP_SET_ALIGN 64
+
+/* First bytes of an image; the key arrays follow at the given offsets. */
+struct ip_set_header {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t reserved;
+    uint64_t image_size;
+    uint64_t v4_count;
+    uint64_t v4_offset;
+    uint64_t v6_count;
+    uint64_t v6_offset;
+    uint64_t reserved2;
+};
+
+_Static_assert(sizeof(struct ip_set_header) == IP_SET_ALIGN,
+               "the header fills exactly one alignment unit");
+
+/**
+ * align_up - Round a size up to the image alignment.
+ * @n: Size in bytes.
+ *
+ * Return: @n rounded up to a multiple of IP_SET_ALIGN.
+ */
+static inline size_t align_up(size_t n)
+{
+    return (n + IP_SET_ALIGN - 1) & ~(size_t)(IP_SET_ALIGN - 1);
+}
+
+/**
+ * set_layout - Compute where the arrays of an image go.
+ * @header: In: key counts. Out: offsets and total size.
+ *
+ * Each array has one unused slot at index 0.
+ *
+ * Return: false if the image would not fit in memory.
+ */
+static bool set_layout(struct ip_set_header *header)
+{
+    const size_t max = SIZE_MAX / 2;
+
+    if (header->v4_count >= max / sizeof(uint32_t) ||
+        header->v6_count >= max / sizeof(struct ip_set_key6))
+        return false;
+
+    size_t v4_bytes = align_up(((size_t)header->v4_count + 1) *
+                               sizeof(uint32_t));
+    size_t v6_bytes = align_up(((size_t)header->v6_count + 1) *
+                               sizeof(struct ip_set_key6));
+
+    if (v4_bytes > max - v6_bytes - IP_SET_ALIGN)
+        return false;
+    header->v4_offset = IP_SET_ALIGN;
+    header->v6_offset = IP_SET_ALIGN + v4_bytes;
+    header->image_size = IP_SET_ALIGN + v4_bytes + v6_bytes;
+    return true;
+}
+
+/**
+ * set_attach - Point a set at the arrays of an image.
+ * @set: Set to fill.
+ * @image: Image with a valid header.
+ * @mapped: true if @image is a file mapping.
+ */
+static void set_attach(struct ip_set *set, void *image, bool mapped)
+{
+    const struct ip_set_header *header = image;
+    const unsigned char *base = image;
+
+    set->v4 = (const uint32_t *)(const void *)(base + header->v4_offset);
+    set->v6 = (const struct ip_set_key6 *)(const void *)
+        (base + header->v6_offset);
+    set->v4_count = (size_t)header->v4_count;
+    set->v6_count = (size_t)header->v6_count;
+    set->image = image;
+    set->image_size = (size_t)header->image_size;
+    set->mapped = mapped;
+}
+
+/**
+ * load_be64 - Read a big-endian 64-bit value.
+ * @p: First of eight bytes.
+ *
+ * Return: value in host order.
+ */
+static inline uint64_t load_be64(const unsigned char *p)
+{
+    uint64_t v = 0;
+
+    for (int i = 0; i < 8; i++)
+        v = v << 8 | p[i];
+    return v;
+}
+
+/**
+ * key6_of - Turn an IPv6 address into a search key.
+ * @addr: Address in network byte order.
+ *
+ * Return: key comparing like the address bytes.
+ */
+static inline struct ip_set_key6 key6_of(const struct in6_addr *addr)
+{
+    struct ip_set_key6 key = {
+        load_be64(addr->s6_addr),
+        load_be64(addr->s6_addr + 8),
+    };
+
+    return key;
+}
+
+static inline bool key6_less(struct ip_set_key6 a, struct ip_set_key6 b)
+{
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+static int key6_cmp(const void *pa, const void *pb)
+{
+    const struct ip_set_key6 *a = pa;
+    const struct ip_set_key6 *b = pb;
+
+    return key6_less(*b, *a) - key6_less(*a, *b);
+}
+
+/**
+ * radix_sort32 - Sort 32-bit keys with four byte-wide counting passes.
+ * @keys: Keys to sort.
+ * @tmp: Scratch array of the same length.
+ * @n: Number of keys.
+ */
+static void radix_sort32(uint32_t *keys, uint32_t *tmp, size_t n)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t count[257] = { 0 };
+
+        for (size_t i = 0; i < n; i++)
+            count[((keys[i] >> shift) & 0xff) + 1]++;
+        for (int b = 0; b < 256; b++)
+            count[b + 1] += count[b];
+        for (size_t i = 0; i < n; i++)
+            tmp[count[(keys[i] >> shift) & 0xff]++] = keys[i];
+        memcpy(keys, tmp, n * sizeof(*keys));
+    }
+}
+
+/**
+ * eytzinger_fill4 - Lay out the subtree at @k from sorted keys.
+ * @tree: Output tree.
+ * @sorted: Sorted unique keys.
+ * @i: Next unused index into @sorted.
+ * @k: Subtree root.
+ * @n: Number of keys.
+ *
+ * Return: index into @sorted after the subtree.
+ */
+static size_t eytzinger_fill4(uint32_t *tree, const uint32_t *sorted,
+                              size_t i, size_t k, size_t n)
+{
+    if (k <= n) {
+        i = eytzinger_fill4(tree, sorted, i, 2 * k, n);
+        tree[k] = sorted[i++];
+        i = eytzinger_fill4(tree, sorted, i, 2 * k + 1, n);
+    }
+    return i;
+}
+
+/* IPv6 counterpart of eytzinger_fill4(). */
+static size_t eytzinger_fill6(struct ip_set_key6 *tree,
+                              const struct ip_set_key6 *sorted, size_t i,
+                              size_t k, size_t n)
+{
+    if (k <= n) {
+        i = eytzinger_fill6(tree, sorted, i, 2 * k, n);
+        tree[k] = sorted[i++];
+        i = eytzinger_fill6(tree, sorted, i, 2 * k + 1, n);
+    }
+    return i;
+}
+
+/**
+ * sorted_keys4 - Convert, sort and deduplicate IPv4 addresses.
+ * @addrs: Addresses in network byte order.
+ * @count: Number of addresses.
+ * @unique: Output number of distinct keys.
+ *
+ * Return: malloc()ed array of sorted host-order keys, or NULL if memory ran
+ * out. An empty input yields a non-NULL array.
+ */
+static uint32_t *sorted_keys4(const struct in_addr *addrs, size_t count,
+                              size_t *unique)
+{
+    uint32_t *keys = malloc((count + 1) * sizeof(*keys));
+    uint32_t *tmp = malloc((count + 1) * sizeof(*tmp));
+    size_t n = 0;
+
+    if (keys == NULL || tmp == NULL) {
+        free(keys);
+        free(tmp);
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++)
+        keys[i] = ntohl(addrs[i].s_addr);
+    radix_sort32(keys, tmp, count);
+    free(tmp);
+    for (size_t i = 0; i < count; i++) {
+        if (n == 0 || keys[n - 1] != keys[i])
+            keys[n++] = keys[i];
+    }
+    *unique = n;
+    return keys;
+}
+
+/* IPv6 counterpart of sorted_keys4(). */
+static struct ip_set_key6 *sorted_keys6(const struct in6_addr *addrs,
+                                        size_t count, size_t *unique)
+{
+    struct ip_set_key6 *keys = malloc((count + 1) * sizeof(*keys));
+    size_t n = 0;
+
+    if (keys == NULL)
+        return NULL;
+    for (size_t i = 0; i < count; i++)
+        keys[i] = key6_of(&addrs[i]);
+    qsort(keys, count, sizeof(*keys), key6_cmp);
+    for (size_t i = 0; i < count; i++) {
+        if (n == 0 || key6_less(keys[n - 1], keys[i]))
+            keys[n++] = keys[i];
+    }
+    *unique = n;
+    return keys;
+}
+
+/**
+ * ip_set_build - Build a set from parsed addresses.
+ * @set: Set to fill; release it with ip_set_free().
+ * @v4: Array of @v4_count IPv4 addresses, or NULL.
+ * @v4_count: Number of IPv4 addresses.
+ * @v6: Array of @v6_count IPv6 addresses, or NULL.
+ * @v6_count: Number of IPv6 addresses.
+ *
+ * Return: true on success, false if memory could not be allocated.
+ */
+bool ip_set_build(struct ip_set *set, const struct in_addr *v4,
+                  size_t v4_count, const struct in6_addr *v6,
+                  size_t v6_count)
+{
+    struct ip_set_header header;
+    size_t n4 = 0, n6 = 0;
+
+    memset(set, 0, sizeof(*set));
+    if (v4 == NULL)
+        v4_count = 0;
+    if (v6 == NULL)
+        v6_count = 0;
+
+    uint32_t *keys4 = sorted_keys4(v4, v4_count, &n4);
+    struct ip_set_key6 *keys6 = sorted_keys6(v6, v6_count, &n6);
+    void *image = NULL;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ip_set_magic, sizeof(header.magic));
+    header.byte_order = IP_SET_BYTE_ORDER;
+    header.v4_count = n4;
+    header.v6_count = n6;
+    if (keys4 != NULL && keys6 != NULL && set_layout(&header))
+        image = aligned_alloc(IP_SET_ALIGN, (size_t)header.image_size);
+    if (image != NULL) {
+        unsigned char *base = image;
+
+        memset(image, 0, (size_t)header.image_size);
+        memcpy(image, &header, sizeof(header));
+        eytzinger_fill4((uint32_t *)(void *)(base + header.v4_offset),
+                        keys4, 0, 1, n4);
+        eytzinger_fill6((struct ip_set_key6 *)(void *)
+                        (base + header.v6_offset), keys6, 0, 1, n6);
+        set_attach(set, image, false);
+    }
+    free(keys4);
+    free(keys6);
+    return image != NULL;
+}
+
+/**
+ * ip_set_free - Release a set from ip_set_build() or ip_set_open().
+ * @set: Set to release; it is left empty.
+ */
+void ip_set_free(struct ip_set *set)
+{
+    if (set->mapped)
+        munmap(set->image, set->image_size);
+    else
+        free(set->image);
+    memset(set, 0, sizeof(*set));
+}
+
+/**
+ * search4 - Find the first key not below @x.
+ * @tree: IPv4 tree.
+ * @n: Number of keys.
+ * @x: Key to search for.
+ *
+ * Prefetches the node four levels down, whose sixteen 4-byte siblings share
+ * one cache line.
+ *
+ * Return: index of that key in @tree, or 0 if every key is below @x.
+ */
+static inline size_t search4(const uint32_t *tree, size_t n, uint32_t x)
+{
+    size_t k = 1;
+
+    while (k <= n) {
+        __builtin_prefetch(tree + 16 * k);
+        k = 2 * k + (tree[k] < x);
+    }
+    return k >> __builtin_ffsll((long long)~k);
+}
+
+/* IPv6 counterpart of search4(); four keys share a line. */
+static inline size_t search6(const struct ip_set_key6 *tree, size_t n,
+                             struct ip_set_key6 x)
+{
+    size_t k = 1;
+
+    while (k <= n) {
+        __builtin_prefetch(tree + 4 * k);
+        k = 2 * k + key6_less(tree[k], x);
+    }
+    return k >> __builtin_ffsll((long long)~k);
+}
+
+/**
+ * ip_set_contains_ipv4 - Test an IPv4 address for membership.
+ * @set: Set to search.
+ * @addr: Address in network byte order.
+ *
+ * Return: true if @addr is in @set.
+ */
+bool ip_set_contains_ipv4(const struct ip_set *set,
+                          const struct in_addr *addr)
+{
+    uint32_t x = ntohl(addr->s_addr);
+    size_t k = search4(set->v4, set->v4_count, x);
+
+    return k != 0 && set->v4[k] == x;
+}
+
+/**
+ * ip_set_contains_ipv6 - Test an IPv6 address for membership.
+ * @set: Set to search.
+ * @addr: Address in network byte order.
+ *
+ * Return: true if @addr is in @set.
+ */
+bool ip_set_contains_ipv6(const struct ip_set *set,
+                          const struct in6_addr *addr)
+{
+    struct ip_set_key6 x = key6_of(addr);
+    size_t k = search6(set->v6, set->v6_count, x);
+
+    return k != 0 && set->v6[k].hi == x.hi && set->v6[k].lo == x.lo;
+}
+
+/**
+ * ip_set_contains - Test an address of either family for membership.
+ * @set: Set to search.
+ * @addr: Parsed address.
+ *
+ * Return: true if @addr is in @set; false for an unknown family.
+ */
+bool ip_set_contains(const struct ip_set *set, const struct ip_address *addr)
+{
+    if (addr->family == AF_INET)
+        return ip_set_contains_ipv4(set, &addr->v4);
+    if (addr->family == AF_INET6)
+        return ip_set_contains_ipv6(set, &addr->v6);
+    return false;
+}
+
+/**
+ * popcount_bitmap - Count the members recorded in a bitmap.
+ * @bitmap: Bitmap of @count bits.
+ * @count: Number of bits.
+ *
+ * Return: number of set bits.
+ */
+static size_t popcount_bitmap(const uint8_t *bitmap, size_t count)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < count / 8; i++)
+        n += (size_t)__builtin_popcount(bitmap[i]);
+    if (count % 8 != 0)
+        n += (size_t)__builtin_popcount(bitmap[count / 8] &
+                                        ((1u << (count % 8)) - 1));
+    return n;
+}
+
+/**
+ * ip_set_contains_ipv4_batch - Test an array of IPv4 addresses.
+ * @set: Set to search.
+ * @addrs: Array of @count addresses.
+ * @count: Number of addresses.
+ * @bitmap: Output membership bitmap of (@count + 7) / 8 bytes, LSB first.
+ *
+ * The SIMD kernel handles whole groups of eight; the scalar search finishes
+ * whatever it leaves, including every address when it is unavailable.
+ *
+ * Return: number of addresses found.
+ */
+size_t ip_set_contains_ipv4_batch(const struct ip_set *set,
+                                  const struct in_addr *addrs, size_t count,
+                                  uint8_t *bitmap)
+{
+    size_t done = ipv4_simd_set_search(set->v4, set->v4_count, addrs, count,
+                                       bitmap);
+    unsigned int bits = 0;
+
+    for (size_t i = done; i < count; i++) {
+        bits |= (unsigned int)ip_set_contains_ipv4(set, &addrs[i]) << (i % 8);
+        if (i % 8 == 7) {
+            bitmap[i / 8] = (uint8_t)bits;
+            bits = 0;
+        }
+    }
+    if (count % 8 != 0)
+        bitmap[count / 8] = (uint8_t)bits;
+    return popcount_bitmap(bitmap, count);
+}
+
+/**
+ * ip_set_contains_ipv6_batch - Test an array of IPv6 addresses.
+ * @set: Set to search.
+ * @addrs: Array of @count addresses.
+ * @count: Number of addresses.
+ * @bitmap: Output membership bitmap of (@count + 7) / 8 bytes, LSB first.
+ *
+ * Return: number of addresses found.
+ */
+size_t ip_set_contains_ipv6_batch(const struct ip_set *set,
+                                  const struct in6_addr *addrs, size_t count,
+                                  uint8_t *bitmap)
+{
+    unsigned int bits = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        bits |= (unsigned int)ip_set_contains_ipv6(set, &addrs[i]) << (i % 8);
+        if (i % 8 == 7) {
+            bitmap[i / 8] = (uint8_t)bits;
+            bits = 0;
+        }
+    }
+    if (count % 8 != 0)
+        bitmap[count / 8] = (uint8_t)bits;
+    return popcount_bitmap(bitmap, count);
+}
+
+/**
+ * ip_set_save - Write a set to a file that ip_set_open() can map.
+ * @set: Set to write.
+ * @path: File to create or replace.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool ip_set_save(const struct ip_set *set, const char *path)
+{
+    size_t tmp_len = strlen(path) + sizeof(".tmp");
+    char *tmp = malloc(tmp_len);
+
+    if (tmp == NULL)
+        return false;
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f != NULL &&
+        fwrite(set->image, 1, set->image_size, f) == set->image_size &&
+        fflush(f) == 0 && fsync(fileno(f)) == 0;
+
+    if (f != NULL && fclose(f) != 0)
+        ok = false;
+    if (ok && rename(tmp, path) != 0)
+        ok = false;
+    if (!ok && f != NULL) {
+        int saved = errno;
+
+        unlink(tmp);
+        errno = saved;
+    }
+    free(tmp);
+    return ok;
+}
+
+/**
+ * ip_set_attach - Use a set image that is already in memory.
+ * @set: Set to fill; it only refers to @image.
+ * @image: Image written by ip_set_save(), 8-byte aligned.
+ * @size: Number of bytes of @image.
+ *
+ * Only the header is checked. A damaged key array gives wrong answers but
+ * every search stays inside the image.
+ *
+ * Return: true if @image is a valid set image of exactly @size bytes.
+ */
+bool ip_set_attach(struct ip_set *set, const void *image, size_t size)
+{
+    struct ip_set_header header, expect;
+
+    memset(set, 0, sizeof(*set));
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, image, sizeof(header));
+    memset(&expect, 0, sizeof(expect));
+    expect.v4_count = header.v4_count;
+    expect.v6_count = header.v6_count;
+    if (memcmp(header.magic, ip_set_magic, sizeof(header.magic)) != 0 ||
+        header.byte_order != IP_SET_BYTE_ORDER || !set_layout(&expect) ||
+        header.v4_offset != expect.v4_offset ||
+        header.v6_offset != expect.v6_offset ||
+        header.image_size != expect.image_size ||
+        header.image_size != (uint64_t)size)
+        return false;
+    set_attach(set, (void *)image, false);
+    return true;
+}
+
+/**
+ * ip_set_open - Map a file written by ip_set_save().
+ * @set: Set to fill; release it with ip_set_free().
+ * @path: File to map read-only.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool ip_set_open(struct ip_set *set, const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    memset(set, 0, sizeof(*set));
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size < (off_t)sizeof(struct ip_set_header)) {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    void *image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd,
+                       0);
+
+    close(fd);
+    if (image == MAP_FAILED)
+        return false;
+    if (!ip_set_attach(set, image, (size_t)st.st_size)) {
+        munmap(image, (size_t)st.st_size);
+        errno = EINVAL;
+        return false;
+    }
+    set->mapped = true;
+    return true;
+}
@@ -0,0 +1,159 @@
+#ifndef IP_SET_H
+#define IP_SET_H
+
+#include "ip_validator.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* An IPv6 address as a search key: the two halves in host byte order. */
+struct ip_set_key6 {
+    uint64_t hi;
+    uint64_t lo;
+};
+
+/*
+ * Immutable set of single addresses of both families. Keys are stored in
+ * host byte order in Eytzinger (breadth-first) order from index 1, so the
+ * first levels of every search share a few cache lines and each next level
+ * can be prefetched. IPv4 keys take 4 bytes and IPv6 keys 16, with no
+ * per-entry overhead.
+ *
+ * The whole set lives in one block laid out exactly as the file written by
+ * ip_set_save(), and ip_set_open() maps such a file in place.
+ */
+struct ip_set {
+    const uint32_t *v4;         /* @v4_count keys from index 1 */
+    const struct ip_set_key6 *v6;       /* @v6_count keys from index 1 */
+    size_t v4_count;
+    size_t v6_count;
+    void *image;                /* Block holding both arrays */
+    size_t image_size;
+    bool mapped;                /* @image is a file mapping */
+};
+
+/**
+ * ip_set_build - Build a set from parsed addresses.
+ * @set: Set to fill; release it with ip_set_free().
+ * @v4: Array of @v4_count IPv4 addresses in network byte order, or NULL.
+ * @v4_count: Number of IPv4 addresses.
+ * @v6: Array of @v6_count IPv6 addresses in network byte order, or NULL.
+ * @v6_count: Number of IPv6 addresses.
+ *
+ * Duplicates are stored once. The batch validators zero rejected entries,
+ * so drop those before building from their output.
+ *
+ * Return: true on success, false if memory could not be allocated; @set is
+ * then empty.
+ */
+bool ip_set_build(struct ip_set *set, const struct in_addr *v4,
+                  size_t v4_count, const struct in6_addr *v6,
+                  size_t v6_count);
+
+/**
+ * ip_set_free - Release a set from ip_set_build() or ip_set_open().
+ * @set: Set to release; it is left empty.
+ */
+void ip_set_free(struct ip_set *set);
+
+/**
+ * ip_set_contains_ipv4 - Test an IPv4 address for membership.
+ * @set: Set to search.
+ * @addr: Address in network byte order.
+ *
+ * Return: true if @addr is in @set.
+ */
+bool ip_set_contains_ipv4(const struct ip_set *set,
+                          const struct in_addr *addr);
+
+/**
+ * ip_set_contains_ipv6 - Test an IPv6 address for membership.
+ * @set: Set to search.
+ * @addr: Address in network byte order.
+ *
+ * Return: true if @addr is in @set.
+ */
+bool ip_set_contains_ipv6(const struct ip_set *set,
+                          const struct in6_addr *addr);
+
+/**
+ * ip_set_contains - Test an address of either family for membership.
+ * @set: Set to search.
+ * @addr: Parsed address, for example from ip_stream_finish() or ip_scan().
+ *
+ * Return: true if @addr is in @set; false for an unknown family.
+ */
+bool ip_set_contains(const struct ip_set *set, const struct ip_address *addr);
+
+/**
+ * ip_set_contains_ipv4_batch - Test an array of IPv4 addresses.
+ * @set: Set to search.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv4_batch().
+ * @count: Number of addresses.
+ * @bitmap: Output membership bitmap of (@count + 7) / 8 bytes, LSB first,
+ *          laid out like the validity bitmaps of the batch validators.
+ *
+ * With AVX2, eight searches advance together with one gather per tree
+ * level, so their cache misses overlap.
+ *
+ * Return: number of addresses found.
+ */
+size_t ip_set_contains_ipv4_batch(const struct ip_set *set,
+                                  const struct in_addr *addrs, size_t count,
+                                  uint8_t *bitmap);
+
+/**
+ * ip_set_contains_ipv6_batch - Test an array of IPv6 addresses.
+ * @set: Set to search.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv6_batch().
+ * @count: Number of addresses.
+ * @bitmap: Output membership bitmap of (@count + 7) / 8 bytes, LSB first.
+ *
+ * Return: number of addresses found.
+ */
+size_t ip_set_contains_ipv6_batch(const struct ip_set *set,
+                                  const struct in6_addr *addrs, size_t count,
+                                  uint8_t *bitmap);
+
+/**
+ * ip_set_save - Write a set to a file that ip_set_open() can map.
+ * @set: Set to write.
+ * @path: File to create or replace.
+ *
+ * The file is the set's memory block as is: a header followed by the two
+ * key arrays, each 64-byte aligned. It is only readable on machines of the
+ * same byte order. It is written to "@path.tmp", synced and renamed over
+ * @path, so a process that maps @path meanwhile sees the old set or the new
+ * one, never part of a file.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool ip_set_save(const struct ip_set *set, const char *path);
+
+/**
+ * ip_set_open - Map a file written by ip_set_save().
+ * @set: Set to fill; release it with ip_set_free().
+ * @path: File to map read-only.
+ *
+ * Nothing is copied or rebuilt, so opening costs the same for any size and
+ * processes that open the same file share its pages.
+ *
+ * Return: true on success; false with errno set if the file cannot be
+ * mapped, or EINVAL if it is not a valid set image.
+ */
+bool ip_set_open(struct ip_set *set, const char *path);
+
+/**
+ * ip_set_attach - Use a set image that is already in memory.
+ * @set: Set to fill. It only refers to @image, which must outlive it; do
+ *       not pass it to ip_set_free().
+ * @image: Image as written by ip_set_save(), at least 8-byte aligned, for
+ *         example part of a larger mapped file.
+ * @size: Number of bytes of @image.
+ *
+ * Return: true if @image is a valid set image of exactly @size bytes.
+ */
+bool ip_set_attach(struct ip_set *set, const void *image, size_t size);
+
+#endif                          /* IP_SET_H */
@@ -0,0 +1,840 @@
+/*
+ * Vector kernels for the validators, selected once at run time.
+ *
+ * The IPv4 kernel loads the whole dotted quad (at most 15 bytes) into one
+ * 16-byte register, classifies digits and dots with two compares, derives the
+ * octet boundaries from the dot bitmask, gathers every octet's digits into a
+ * fixed hundreds/tens/units layout with a single byte shuffle and converts
+ * all four octets with two multiply-adds.
+ *
+ * The IPv6 kernel classifies the whole text (at most 45 bytes) into hex-digit
+ * and colon bitmasks in 16- or 32-byte blocks and checks the group structure
+ * with shifts and popcounts on those masks: no group longer than four digits,
+ * at most one "::", no stray single colon at either end and the right number
+ * of groups. Hextet values are then assembled from the per-byte nibble values
+ * the same pass produced. Text with an embedded dotted quad is left to the
+ * scalar parser.
+ *
+ * The anchor kernels serve the scanner: they skip over text until the next
+ * byte in the range '0'-':', that is a decimal digit or a colon, one range
+ * compare per byte and one bitmask test per block.
+ *
+ * The set kernel serves ip_set: it walks eight IPv4 keys down an Eytzinger
+ * tree at once, one gather per level, instead of eight dependent loads.
+ */
+
+#include "ip_simd.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IP_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define IP_SIMD_NEON 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+typedef int (*ipv4_kernel_fn)(const char *buf, size_t len,
+                              unsigned char octets[4]);
+typedef int (*ipv6_kernel_fn)(const char *buf, size_t len,
+                              unsigned char bytes[16]);
+typedef size_t (*anchor_kernel_fn)(const char *buf, size_t len);
+typedef size_t (*set4_kernel_fn)(const uint32_t *tree, size_t n,
+                                 const struct in_addr *keys, size_t count,
+                                 uint8_t *bitmap);
+
+/* One consistent set of kernels for a given instruction-set level. */
+struct ip_kernels {
+    ipv4_kernel_fn ipv4;
+    ipv6_kernel_fn ipv6;
+    anchor_kernel_fn anchor;
+    set4_kernel_fn set4;
+    const char *name;
+};
+
+/* Classified IPv6 text: per-byte nibble values plus structural bitmasks. */
+struct ipv6_blocks {
+    unsigned char nibbles[68];  /* Four bytes of zero padding, then text. */
+    uint64_t hex;
+    uint64_t colon;
+    uint64_t dot;
+};
+
+/* Offset of the first text byte inside ipv6_blocks.nibbles. */
+#define IPV6_NIBBLE_PAD 4
+
+/**
+ * ipv4_kernel_none - Placeholder kernel used when vectors are unavailable.
+ * @buf: Unused.
+ * @len: Unused.
+ * @octets: Unused.
+ *
+ * Return: -1, deferring every input to the scalar parser.
+ */
+static int ipv4_kernel_none(const char *buf, size_t len,
+                            unsigned char octets[4])
+{
+    (void)buf;
+    (void)len;
+    (void)octets;
+    return -1;
+}
+
+/**
+ * ipv6_kernel_none - Placeholder kernel used when vectors are unavailable.
+ * @buf: Unused.
+ * @len: Unused.
+ * @bytes: Unused.
+ *
+ * Return: -1, deferring every input to the scalar parser.
+ */
+static int ipv6_kernel_none(const char *buf, size_t len,
+                            unsigned char bytes[16])
+{
+    (void)buf;
+    (void)len;
+    (void)bytes;
+    return -1;
+}
+
+/**
+ * anchor_find_none - Portable search for the next digit or colon.
+ * @buf: Text to search.
+ * @len: Number of bytes of @buf.
+ *
+ * Also finishes the tail the vector kernels leave after their last block.
+ *
+ * Return: offset of the first byte in '0'-':', or @len if there is none.
+ */
+static size_t anchor_find_none(const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)(buf[i] - '0') <= ':' - '0')
+            return i;
+    }
+    return len;
+}
+
+/**
+ * set4_search_none - Placeholder set kernel used without gathers.
+ * @tree: Unused.
+ * @n: Unused.
+ * @keys: Unused.
+ * @count: Unused.
+ * @bitmap: Unused.
+ *
+ * Return: 0, leaving every key to the scalar search.
+ */
+static size_t set4_search_none(const uint32_t *tree, size_t n,
+                               const struct in_addr *keys, size_t count,
+                               uint8_t *bitmap)
+{
+    (void)tree;
+    (void)n;
+    (void)keys;
+    (void)count;
+    (void)bitmap;
+    return 0;
+}
+
+#if defined(IP_SIMD_X86) || defined(IP_SIMD_NEON)
+/**
+ * ipv4_layout - Derive octet boundaries from the digit and dot bitmasks.
+ * @digits: Bit i set when byte i is a decimal digit.
+ * @dots: Bit i set when byte i is a dot.
+ * @len: Number of meaningful bytes.
+ * @starts: Output start offset of each octet.
+ * @ends: Output exclusive end offset of each octet.
+ *
+ * Return: 1 if the layout is four octets of one to three digits, 0 if the
+ * text is malformed, -1 if an octet is longer than three digits (only
+ * possible with leading zeros, which the scalar parser arbitrates).
+ */
+static int ipv4_layout(unsigned int digits, unsigned int dots, size_t len,
+                       int starts[4], int ends[4])
+{
+    unsigned int lenmask = (1u << len) - 1;
+
+    if ((digits | dots) != lenmask || __builtin_popcount(dots) != 3)
+        return 0;
+
+    ends[0] = __builtin_ctz(dots);
+    dots &= dots - 1;
+    ends[1] = __builtin_ctz(dots);
+    dots &= dots - 1;
+    ends[2] = __builtin_ctz(dots);
+    ends[3] = (int)len;
+
+    starts[0] = 0;
+    starts[1] = ends[0] + 1;
+    starts[2] = ends[1] + 1;
+    starts[3] = ends[2] + 1;
+
+    /* Octet lengths must all be 1..3; test them together. */
+    unsigned int bad = 0;
+    unsigned int empty = 0;
+    for (int k = 0; k < 4; k++) {
+        unsigned int olen = (unsigned int)(ends[k] - starts[k]);
+        bad |= olen - 1 >= 3;
+        empty |= olen == 0;
+    }
+    if (bad)
+        return empty ? 0 : -1;
+    return 1;
+}
+#endif
+
+#if defined(IP_SIMD_X86) || defined(IP_SIMD_NEON)
+/**
+ * ipv6_hextet - Assemble one group from its nibble values.
+ * @blocks: Classified text.
+ * @end: Index of the group's last digit.
+ * @digits: Number of digits in the group, 1 to 4.
+ *
+ * Return: the 16-bit group value.
+ */
+static unsigned int ipv6_hextet(const struct ipv6_blocks *blocks, int end,
+                                int digits)
+{
+    const unsigned char *n = &blocks->nibbles[IPV6_NIBBLE_PAD + end - 3];
+    unsigned int value = 0;
+
+    /* Fixed four-nibble window ending at @end; earlier bytes drop out. */
+    for (int j = 0; j < 4; j++)
+        value = (value << 4) | (j >= 4 - digits ? n[j] : 0u);
+    return value;
+}
+
+/**
+ * ipv6_from_masks - Check IPv6 group structure and build the address.
+ * @blocks: Classified text.
+ * @len: Number of meaningful bytes, 1 to 45.
+ * @bytes: Output address in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 if the text holds a dot and must go
+ * to the scalar parser.
+ */
+static int ipv6_from_masks(const struct ipv6_blocks *blocks, size_t len,
+                           unsigned char bytes[16])
+{
+    uint64_t lenmask = (UINT64_C(1) << len) - 1;
+    uint64_t colon = blocks->colon & lenmask;
+    uint64_t hex = blocks->hex & lenmask;
+
+    if (blocks->dot & lenmask)
+        return -1;
+    if ((hex | colon) != lenmask)
+        return 0;
+
+    /* A colon at either end must be part of a "::". */
+    if ((colon & 1) && !(colon & 2))
+        return 0;
+    if ((colon >> (len - 1)) & 1) {
+        if (len < 2 || !((colon >> (len - 2)) & 1))
+            return 0;
+    }
+
+    uint64_t doubles = colon & (colon >> 1);
+    if (doubles & (colon >> 2))
+        return 0;               /* ":::" */
+    if (__builtin_popcountll(doubles) > 1)
+        return 0;               /* Multiple :: not allowed */
+
+    /* Five consecutive digits anywhere means a group is too long. */
+    if (hex & (hex >> 1) & (hex >> 2) & (hex >> 3) & (hex >> 4))
+        return 0;
+
+    uint64_t starts = hex & ~(hex << 1);
+    uint64_t ends = hex & ~(hex >> 1);
+    int groups = __builtin_popcountll(starts);
+    bool compressed = doubles != 0;
+
+    if (compressed ? groups >= 8 : groups != 8)
+        return 0;
+
+    int before = groups;
+    if (compressed) {
+        uint64_t below = doubles - 1;
+        before = __builtin_popcountll(starts & below);
+    }
+
+    memset(bytes, 0, 16);
+    for (int g = 0; g < groups; g++) {
+        int first = __builtin_ctzll(starts);
+        int last = __builtin_ctzll(ends);
+        unsigned int value = ipv6_hextet(blocks, last, last - first + 1);
+        int slot = g < before ? g : 8 - groups + g;
+
+        bytes[slot * 2] = (unsigned char)(value >> 8);
+        bytes[slot * 2 + 1] = (unsigned char)value;
+        starts &= starts - 1;
+        ends &= ends - 1;
+    }
+    return 1;
+}
+#endif
+
+#if defined(IP_SIMD_X86)
+/**
+ * ipv4_kernel_sse41 - SSSE3/SSE4.1 dotted-quad kernel.
+ * @buf: Start of the candidate text.
+ * @len: Number of bytes of @buf, 1 to 15.
+ * @octets: Output octets in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 to defer to the scalar parser.
+ */
+__attribute__((target("ssse3,sse4.1")))
+static int ipv4_kernel_sse41(const char *buf, size_t len,
+                             unsigned char octets[4])
+{
+    char block[16] = { 0 };
+    int starts[4], ends[4];
+
+    memcpy(block, buf, len);
+    __m128i v = _mm_loadu_si128((const __m128i *)block);
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(9)), t);
+    __m128i is_dot = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+    unsigned int lenmask = (1u << len) - 1;
+    unsigned int digits = (unsigned int)_mm_movemask_epi8(is_digit) & lenmask;
+    unsigned int dots = (unsigned int)_mm_movemask_epi8(is_dot) & lenmask;
+
+    int layout = ipv4_layout(digits, dots, len, starts, ends);
+    if (layout != 1)
+        return layout;
+
+    /*
+     * Lane 4k+j (j < 3) takes byte end_k - 3 + j; lanes that fall before the
+     * octet start, and every fourth lane, get the high bit set so the
+     * shuffle writes zero there.
+     */
+    __m128i e = _mm_setr_epi32(ends[0] * 0x01010101, ends[1] * 0x01010101,
+                               ends[2] * 0x01010101, ends[3] * 0x01010101);
+    __m128i s = _mm_setr_epi32(starts[0] * 0x01010101,
+                               starts[1] * 0x01010101,
+                               starts[2] * 0x01010101,
+                               starts[3] * 0x01010101);
+    __m128i idx = _mm_add_epi8(e, _mm_setr_epi8(-3, -2, -1, -16, -3, -2, -1,
+                                                -16, -3, -2, -1, -16, -3, -2,
+                                                -1, -16));
+    idx = _mm_or_si128(idx, _mm_cmpgt_epi8(s, idx));
+
+    __m128i lanes = _mm_shuffle_epi8(t, idx);
+    __m128i pairs = _mm_maddubs_epi16(lanes,
+                                      _mm_setr_epi8(100, 10, 1, 0, 100, 10,
+                                                    1, 0, 100, 10, 1, 0,
+                                                    100, 10, 1, 0));
+    __m128i values = _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+
+    if (_mm_movemask_epi8(_mm_cmpgt_epi32(values, _mm_set1_epi32(255))))
+        return 0;
+
+    __m128i packed = _mm_packus_epi32(values, values);
+    packed = _mm_packus_epi16(packed, packed);
+    int word = _mm_cvtsi128_si32(packed);
+    memcpy(octets, &word, 4);
+    return 1;
+}
+#endif
+
+#if defined(IP_SIMD_X86)
+/**
+ * ipv6_classify_sse2 - Classify one 16-byte block of IPv6 text.
+ * @v: Text bytes.
+ * @nibbles: Output for the 16 per-byte nibble values.
+ * @hex: Output hex-digit bitmask.
+ * @colon: Output colon bitmask.
+ * @dot: Output dot bitmask.
+ */
+__attribute__((target("sse2")))
+static void ipv6_classify_sse2(__m128i v, unsigned char *nibbles,
+                               unsigned int *hex, unsigned int *colon,
+                               unsigned int *dot)
+{
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i a = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+                             _mm_set1_epi8('a'));
+    __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+    __m128i alpha = _mm_add_epi8(a, _mm_set1_epi8(10));
+    __m128i nib = _mm_or_si128(_mm_and_si128(is_digit, d),
+                               _mm_andnot_si128(is_digit, alpha));
+    __m128i is_colon = _mm_cmpeq_epi8(v, _mm_set1_epi8(':'));
+    __m128i is_dot = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+
+    _mm_storeu_si128((__m128i *)(void *)nibbles, nib);
+    *hex = (unsigned int)_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha));
+    *colon = (unsigned int)_mm_movemask_epi8(is_colon);
+    *dot = (unsigned int)_mm_movemask_epi8(is_dot);
+}
+
+/**
+ * ipv6_kernel_sse2 - IPv6 kernel classifying three 16-byte blocks.
+ * @buf: Start of the candidate text.
+ * @len: Number of bytes of @buf, 1 to 45.
+ * @bytes: Output address in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 to defer to the scalar parser.
+ */
+__attribute__((target("sse2")))
+static int ipv6_kernel_sse2(const char *buf, size_t len,
+                            unsigned char bytes[16])
+{
+    char text[48] = { 0 };
+    struct ipv6_blocks blocks;
+
+    memcpy(text, buf, len);
+    memset(blocks.nibbles, 0, IPV6_NIBBLE_PAD);
+    blocks.hex = blocks.colon = blocks.dot = 0;
+    for (int b = 0; b < 3; b++) {
+        unsigned int hex, colon, dot;
+        __m128i v = _mm_loadu_si128((const __m128i *)(void *)&text[b * 16]);
+
+        ipv6_classify_sse2(v, &blocks.nibbles[IPV6_NIBBLE_PAD + b * 16],
+                           &hex, &colon, &dot);
+        blocks.hex |= (uint64_t)hex << (b * 16);
+        blocks.colon |= (uint64_t)colon << (b * 16);
+        blocks.dot |= (uint64_t)dot << (b * 16);
+    }
+    return ipv6_from_masks(&blocks, len, bytes);
+}
+
+/**
+ * ipv6_kernel_avx2 - IPv6 kernel classifying two 32-byte blocks.
+ * @buf: Start of the candidate text.
+ * @len: Number of bytes of @buf, 1 to 45.
+ * @bytes: Output address in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 to defer to the scalar parser.
+ */
+__attribute__((target("avx2")))
+static int ipv6_kernel_avx2(const char *buf, size_t len,
+                            unsigned char bytes[16])
+{
+    char text[64] = { 0 };
+    struct ipv6_blocks blocks;
+
+    memcpy(text, buf, len);
+    memset(blocks.nibbles, 0, IPV6_NIBBLE_PAD);
+    blocks.hex = blocks.colon = blocks.dot = 0;
+    for (int b = 0; b < 2; b++) {
+        const __m256i zero_char = _mm256_set1_epi8('0');
+        const __m256i lower_a = _mm256_set1_epi8('a');
+        __m256i v = _mm256_loadu_si256((const __m256i *)(void *)
+                                       &text[b * 32]);
+        __m256i d = _mm256_sub_epi8(v, zero_char);
+        __m256i a = _mm256_sub_epi8(_mm256_or_si256(v,
+                                                    _mm256_set1_epi8(0x20)),
+                                    lower_a);
+        __m256i is_digit =
+            _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+        __m256i is_alpha =
+            _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8(5)), a);
+        __m256i is_colon = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'));
+        __m256i is_dot = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'));
+        __m256i alpha = _mm256_add_epi8(a, _mm256_set1_epi8(10));
+        __m256i nib = _mm256_blendv_epi8(alpha, d, is_digit);
+        uint32_t hex = (uint32_t)
+            _mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha));
+        uint32_t colon = (uint32_t)_mm256_movemask_epi8(is_colon);
+        uint32_t dot = (uint32_t)_mm256_movemask_epi8(is_dot);
+
+        _mm256_storeu_si256((__m256i *)(void *)
+                            &blocks.nibbles[IPV6_NIBBLE_PAD + b * 32], nib);
+        blocks.hex |= (uint64_t)hex << (b * 32);
+        blocks.colon |= (uint64_t)colon << (b * 32);
+        blocks.dot |= (uint64_t)dot << (b * 32);
+    }
+    return ipv6_from_masks(&blocks, len, bytes);
+}
+#endif
+
+#if defined(IP_SIMD_NEON)
+/**
+ * neon_movemask - Collapse a byte-wise compare result into a 16-bit mask.
+ * @cmp: Vector whose lanes are 0x00 or 0xff.
+ *
+ * Return: bit i set when lane i is 0xff.
+ */
+static unsigned int neon_movemask(uint8x16_t cmp)
+{
+    static const uint8_t weights[16] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+    };
+    uint8x16_t bits = vandq_u8(cmp, vld1q_u8(weights));
+
+    return (unsigned int)vaddv_u8(vget_low_u8(bits)) |
+        ((unsigned int)vaddv_u8(vget_high_u8(bits)) << 8);
+}
+
+/**
+ * ipv4_kernel_neon - AdvSIMD dotted-quad kernel.
+ * @buf: Start of the candidate text.
+ * @len: Number of bytes of @buf, 1 to 15.
+ * @octets: Output octets in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 to defer to the scalar parser.
+ */
+static int ipv4_kernel_neon(const char *buf, size_t len,
+                            unsigned char octets[4])
+{
+    static const int8_t lane_offsets[16] = {
+        -3, -2, -1, -16, -3, -2, -1, -16, -3, -2, -1, -16, -3, -2, -1, -16
+    };
+    static const uint8_t weights[16] = {
+        100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0
+    };
+    uint8_t block[16] = { 0 };
+    int starts[4], ends[4];
+
+    memcpy(block, buf, len);
+    uint8x16_t v = vld1q_u8(block);
+    uint8x16_t t = vsubq_u8(v, vdupq_n_u8('0'));
+    unsigned int lenmask = (1u << len) - 1;
+    unsigned int digits = neon_movemask(vcltq_u8(t, vdupq_n_u8(10))) & lenmask;
+    unsigned int dots = neon_movemask(vceqq_u8(v, vdupq_n_u8('.'))) & lenmask;
+
+    int layout = ipv4_layout(digits, dots, len, starts, ends);
+    if (layout != 1)
+        return layout;
+
+    int32_t end_words[4], start_words[4];
+    for (int k = 0; k < 4; k++) {
+        end_words[k] = ends[k] * 0x01010101;
+        start_words[k] = starts[k] * 0x01010101;
+    }
+    int32x4_t e = vld1q_s32(end_words);
+    int32x4_t s = vld1q_s32(start_words);
+    int8x16_t idx = vaddq_s8(vreinterpretq_s8_s32(e), vld1q_s8(lane_offsets));
+    uint8x16_t before = vcltq_s8(idx, vreinterpretq_s8_s32(s));
+    uint8x16_t sel = vorrq_u8(vreinterpretq_u8_s8(idx), before);
+
+    /* Out-of-range indices (high bit set) read as zero in vqtbl1q. */
+    uint8x16_t lanes = vqtbl1q_u8(t, sel);
+    uint8x16_t w = vld1q_u8(weights);
+    uint16x8_t lo = vmull_u8(vget_low_u8(lanes), vget_low_u8(w));
+    uint16x8_t hi = vmull_u8(vget_high_u8(lanes), vget_high_u8(w));
+    uint16x8_t sums = vpaddq_u16(lo, hi);
+    uint16x8_t values = vpaddq_u16(sums, sums);
+
+    if (vmaxvq_u16(values) > 255)
+        return 0;
+
+    uint8_t narrow[8];
+    vst1_u8(narrow, vmovn_u16(values));
+    memcpy(octets, narrow, 4);
+    return 1;
+}
+#endif
+
+#if defined(IP_SIMD_X86)
+/**
+ * anchor_find_sse2 - Search for the next digit or colon 16 bytes at a time.
+ * @buf: Text to search.
+ * @len: Number of bytes of @buf.
+ *
+ * Return: offset of the first byte in '0'-':', or @len if there is none.
+ */
+__attribute__((target("sse2")))
+static size_t anchor_find_sse2(const char *buf, size_t len)
+{
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i span = _mm_set1_epi8(':' - '0');
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)&buf[i]);
+        __m128i d = _mm_sub_epi8(v, zero_char);
+        __m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(d, span), d);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hit);
+
+        if (mask != 0)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + anchor_find_none(&buf[i], len - i);
+}
+
+/**
+ * anchor_find_avx2 - Search for the next digit or colon 32 bytes at a time.
+ * @buf: Text to search.
+ * @len: Number of bytes of @buf.
+ *
+ * Return: offset of the first byte in '0'-':', or @len if there is none.
+ */
+__attribute__((target("avx2")))
+static size_t anchor_find_avx2(const char *buf, size_t len)
+{
+    const __m256i zero_char = _mm256_set1_epi8('0');
+    const __m256i span = _mm256_set1_epi8(':' - '0');
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)
+                                       &buf[i]);
+        __m256i d = _mm256_sub_epi8(v, zero_char);
+        __m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+
+        if (mask != 0)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + anchor_find_none(&buf[i], len - i);
+}
+#endif
+
+#if defined(IP_SIMD_X86)
+/**
+ * set4_search_avx2 - Search an Eytzinger tree for eight keys at a time.
+ * @tree: Keys in host order and Eytzinger order from index 1.
+ * @n: Number of keys in @tree.
+ * @keys: Addresses to look up, in network order.
+ * @count: Number of @keys.
+ * @bitmap: Output membership bitmap, LSB first; one byte per eight keys.
+ *
+ * Every lane descends floor(log2(n)) + 1 levels. A lane that falls off the
+ * tree early is masked out of the gather and keeps its index, so the usual
+ * k >> ffs(~k) step still finds its lower bound afterwards. AVX2 compares
+ * are signed, so both sides have their sign bit flipped first.
+ *
+ * Return: number of keys handled, a multiple of eight.
+ */
+__attribute__((target("avx2")))
+static size_t set4_search_avx2(const uint32_t *tree, size_t n,
+                               const struct in_addr *keys, size_t count,
+                               uint8_t *bitmap)
+{
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                           11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4,
+                                           11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const __m256i one = _mm256_set1_epi32(1);
+    size_t i = 0;
+
+    /* Indices reach 2n + 1 and gathers take signed 32-bit indices. */
+    if (n == 0 || n >= (size_t)INT32_MAX / 2)
+        return 0;
+
+    const __m256i end = _mm256_set1_epi32((int)n + 1);
+    int depth = 64 - __builtin_clzll((unsigned long long)n);
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(const void *)
+                                       &keys[i]);
+        uint32_t host[8];
+        uint32_t k[8];
+        unsigned int bits = 0;
+
+        x = _mm256_shuffle_epi8(x, bswap);
+        _mm256_storeu_si256((__m256i *)(void *)host, x);
+        x = _mm256_xor_si256(x, sign);
+
+        __m256i idx = one;
+
+        for (int d = 0; d < depth; d++) {
+            __m256i live = _mm256_cmpgt_epi32(end, idx);
+            __m256i t = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+                                                    (const int *)tree, idx,
+                                                    live, 4);
+            __m256i lt = _mm256_cmpgt_epi32(x, _mm256_xor_si256(t, sign));
+            __m256i next = _mm256_sub_epi32(_mm256_add_epi32(idx, idx), lt);
+
+            idx = _mm256_blendv_epi8(idx, next, live);
+        }
+        _mm256_storeu_si256((__m256i *)(void *)k, idx);
+        for (int l = 0; l < 8; l++) {
+            uint32_t lb = k[l] >> __builtin_ffs((int)~k[l]);
+
+            bits |= (unsigned int)(lb != 0 && tree[lb] == host[l]) << l;
+        }
+        bitmap[i / 8] = (uint8_t)bits;
+    }
+    return i;
+}
+#endif
+
+#if defined(IP_SIMD_NEON)
+/**
+ * anchor_find_neon - Search for the next digit or colon 16 bytes at a time.
+ * @buf: Text to search.
+ * @len: Number of bytes of @buf.
+ *
+ * Return: offset of the first byte in '0'-':', or @len if there is none.
+ */
+static size_t anchor_find_neon(const char *buf, size_t len)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)&buf[i]);
+        uint8x16_t d = vsubq_u8(v, vdupq_n_u8('0'));
+        unsigned int mask = neon_movemask(vcleq_u8(d, vdupq_n_u8(':' - '0')));
+
+        if (mask != 0)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + anchor_find_none(&buf[i], len - i);
+}
+
+/**
+ * ipv6_kernel_neon - AdvSIMD IPv6 kernel classifying three 16-byte blocks.
+ * @buf: Start of the candidate text.
+ * @len: Number of bytes of @buf, 1 to 45.
+ * @bytes: Output address in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 to defer to the scalar parser.
+ */
+static int ipv6_kernel_neon(const char *buf, size_t len,
+                            unsigned char bytes[16])
+{
+    uint8_t text[48] = { 0 };
+    struct ipv6_blocks blocks;
+
+    memcpy(text, buf, len);
+    memset(blocks.nibbles, 0, IPV6_NIBBLE_PAD);
+    blocks.hex = blocks.colon = blocks.dot = 0;
+    for (int b = 0; b < 3; b++) {
+        uint8x16_t v = vld1q_u8(&text[b * 16]);
+        uint8x16_t d = vsubq_u8(v, vdupq_n_u8('0'));
+        uint8x16_t is_digit = vcltq_u8(d, vdupq_n_u8(10));
+        uint8x16_t a = vsubq_u8(vorrq_u8(v, vdupq_n_u8(0x20)),
+                                vdupq_n_u8('a'));
+        uint8x16_t is_alpha = vcltq_u8(a, vdupq_n_u8(6));
+        uint8x16_t nib = vbslq_u8(is_digit, d, vaddq_u8(a, vdupq_n_u8(10)));
+
+        vst1q_u8(&blocks.nibbles[IPV6_NIBBLE_PAD + b * 16], nib);
+        blocks.hex |= (uint64_t)neon_movemask(vorrq_u8(is_digit, is_alpha))
+            << (b * 16);
+        blocks.colon |= (uint64_t)neon_movemask(vceqq_u8(v, vdupq_n_u8(':')))
+            << (b * 16);
+        blocks.dot |= (uint64_t)neon_movemask(vceqq_u8(v, vdupq_n_u8('.')))
+            << (b * 16);
+    }
+    return ipv6_from_masks(&blocks, len, bytes);
+}
+#endif
+
+static const struct ip_kernels kernels_none = {
+    ipv4_kernel_none, ipv6_kernel_none, anchor_find_none, set4_search_none,
+    "scalar"
+};
+
+#if defined(IP_SIMD_X86)
+static const struct ip_kernels kernels_sse2 = {
+    ipv4_kernel_none, ipv6_kernel_sse2, anchor_find_sse2, set4_search_none,
+    "sse2"
+};
+
+static const struct ip_kernels kernels_sse41 = {
+    ipv4_kernel_sse41, ipv6_kernel_sse2, anchor_find_sse2, set4_search_none,
+    "sse4.1"
+};
+
+static const struct ip_kernels kernels_avx2 = {
+    ipv4_kernel_sse41, ipv6_kernel_avx2, anchor_find_avx2, set4_search_avx2,
+    "avx2"
+};
+#elif defined(IP_SIMD_NEON)
+static const struct ip_kernels kernels_neon = {
+    ipv4_kernel_neon, ipv6_kernel_neon, anchor_find_neon, set4_search_none,
+    "neon"
+};
+#endif
+
+/**
+ * ip_kernels_best - Pick the best kernel set the running CPU supports.
+ *
+ * Return: kernel set; kernels_none when no vector path applies.
+ */
+static const struct ip_kernels *ip_kernels_best(void)
+{
+#if defined(IP_SIMD_X86)
+    __builtin_cpu_init();
+    bool sse41 = __builtin_cpu_supports("ssse3") &&
+        __builtin_cpu_supports("sse4.1");
+
+    if (sse41 && __builtin_cpu_supports("avx2"))
+        return &kernels_avx2;
+    if (sse41)
+        return &kernels_sse41;
+    if (__builtin_cpu_supports("sse2"))
+        return &kernels_sse2;
+#elif defined(IP_SIMD_NEON)
+#if defined(__linux__) && defined(HWCAP_ASIMD)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMD)
+        return &kernels_neon;
+#else
+    return &kernels_neon;
+#endif
+#endif
+    return &kernels_none;
+}
+
+/* Active kernel set; NULL until resolved on first use. */
+static _Atomic(const struct ip_kernels *) active_kernels;
+
+/**
+ * ip_kernels_active - Return the active kernel set, resolving it once.
+ *
+ * Return: kernel set in use.
+ */
+static inline const struct ip_kernels *ip_kernels_active(void)
+{
+    const struct ip_kernels *k = atomic_load_explicit(&active_kernels,
+                                                      memory_order_acquire);
+
+    if (k == NULL) {
+        const struct ip_kernels *expected = NULL;
+
+        k = ip_kernels_best();
+        /* Lose gracefully to a concurrent ip_simd_select(). */
+        if (!atomic_compare_exchange_strong_explicit(&active_kernels,
+                                                     &expected, k,
+                                                     memory_order_acq_rel,
+                                                     memory_order_acquire))
+            k = expected;
+    }
+    return k;
+}
+
+int ipv4_simd_parse(const char *buf, size_t len, unsigned char octets[4])
+{
+    return ip_kernels_active()->ipv4(buf, len, octets);
+}
+
+int ipv6_simd_parse(const char *buf, size_t len, unsigned char bytes[16])
+{
+    return ip_kernels_active()->ipv6(buf, len, bytes);
+}
+
+size_t ip_simd_find_anchor(const char *buf, size_t len)
+{
+    return ip_kernels_active()->anchor(buf, len);
+}
+
+size_t ipv4_simd_set_search(const uint32_t *tree, size_t n,
+                            const struct in_addr *keys, size_t count,
+                            uint8_t *bitmap)
+{
+    return ip_kernels_active()->set4(tree, n, keys, count, bitmap);
+}
+
+const char *ip_simd_select(bool enable)
+{
+    const struct ip_kernels *k = enable ? ip_kernels_best() : &kernels_none;
+
+    atomic_store_explicit(&active_kernels, k, memory_order_release);
+    return k->name;
+}
+
+const char *ip_simd_name(void)
+{
+    return ip_kernels_active()->name;
+}
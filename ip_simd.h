@@ -0,0 +1,88 @@
+#ifndef IP_SIMD_H
+#define IP_SIMD_H
+
+/*
+ * Internal interface to the vector kernels. Each kernel returns 1 when it
+ * accepted the input, 0 when it rejected it, and -1 when it cannot decide and
+ * the scalar path must run. The kernels are only called with lengths the
+ * scalar entry points have already bounds-checked.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netinet/in.h>
+
+/**
+ * ipv4_simd_parse - Parse a dotted quad with the active vector kernel.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine, 1 to 15.
+ * @octets: Output array that receives the four octets in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 if the caller must fall back to the
+ * scalar parser (no vector unit, or an octet longer than three digits).
+ */
+int ipv4_simd_parse(const char *buf, size_t len, unsigned char octets[4]);
+
+/**
+ * ipv6_simd_parse - Parse IPv6 text with the active vector kernel.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine, 1 to 45.
+ * @bytes: Output array that receives the 16 address bytes in network order.
+ *
+ * Return: 1 if valid, 0 if invalid, -1 if the caller must fall back to the
+ * scalar parser (no vector unit, or an embedded dotted-quad suffix).
+ */
+int ipv6_simd_parse(const char *buf, size_t len, unsigned char bytes[16]);
+
+/**
+ * ip_simd_find_anchor - Find the next byte that can anchor an address.
+ * @buf: Text to search; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to search.
+ *
+ * Every IPv4 address starts with a decimal digit and every IPv6 address has a
+ * digit or a colon within its first five bytes, so the scanner only has to
+ * look near these bytes.
+ *
+ * Return: offset of the first decimal digit or ':' in @buf, or @len if there
+ * is none.
+ */
+size_t ip_simd_find_anchor(const char *buf, size_t len);
+
+/**
+ * ipv4_simd_set_search - Test IPv4 keys for membership in an Eytzinger tree.
+ * @tree: @n keys in host byte order, laid out in Eytzinger order from index
+ *        1; index 0 is unused.
+ * @n: Number of keys in @tree.
+ * @keys: Addresses to look up, in network byte order.
+ * @count: Number of @keys.
+ * @bitmap: Output membership bitmap, LSB first.
+ *
+ * Handles keys from the start of @keys in blocks of eight and writes one
+ * whole @bitmap byte per block.
+ *
+ * Return: number of leading keys handled, a multiple of eight; the caller
+ * searches the rest. 0 when no gather instructions are available.
+ */
+size_t ipv4_simd_set_search(const uint32_t *tree, size_t n,
+                            const struct in_addr *keys, size_t count,
+                            uint8_t *bitmap);
+
+/**
+ * ip_simd_select - Choose between the vector kernels and the scalar path.
+ * @enable: true to use the best kernel the CPU supports, false to force the
+ *          scalar path.
+ *
+ * Return: name of the kernel set now in use.
+ */
+const char *ip_simd_select(bool enable);
+
+/**
+ * ip_simd_name - Name the kernel set currently in use.
+ *
+ * Return: "avx2", "sse4.1", "sse2", "neon" or "scalar".
+ */
+const char *ip_simd_name(void);
+
+#endif                          /* IP_SIMD_H */
@@ -0,0 +1,75 @@
+/*
+ * Outcome counters of the default parsers.
+ *
+ * Each thread counts into its own plain counters and adds them to the
+ * shared totals every IP_STATS_BATCH calls with relaxed atomic additions, so
+ * threads validating in parallel do not contend for the counter cache lines
+ * on every call. Snapshots read the totals with relaxed loads; they are exact
+ * once every thread has flushed.
+ */
+
+#include "ip_validator.h"
+#include "ip_stats.h"
+
+#include <string.h>
+
+#ifdef IP_VALIDATOR_STATS
+
+#include <stdatomic.h>
+
+_Thread_local struct ip_stats_pending ip_stats_pending;
+
+static _Atomic uint64_t ipv4_totals[IP_ERR_COUNT];
+static _Atomic uint64_t ipv6_totals[IP_ERR_COUNT];
+
+/**
+ * ip_stats_publish - Add the calling thread's pending counts to the totals.
+ */
+void ip_stats_publish(void)
+{
+    struct ip_stats_pending *p = &ip_stats_pending;
+
+    for (int i = 0; i < IP_ERR_COUNT; i++) {
+        if (p->ipv4[i] != 0)
+            atomic_fetch_add_explicit(&ipv4_totals[i], p->ipv4[i],
+                                      memory_order_relaxed);
+        if (p->ipv6[i] != 0)
+            atomic_fetch_add_explicit(&ipv6_totals[i], p->ipv6[i],
+                                      memory_order_relaxed);
+    }
+    memset(p, 0, sizeof(*p));
+}
+
+#endif                          /* IP_VALIDATOR_STATS */
+
+/**
+ * ip_validator_stats_snapshot - Read the outcome counters.
+ * @stats: Output totals over all threads.
+ *
+ * Return: true if counting is compiled in, otherwise false.
+ */
+bool ip_validator_stats_snapshot(struct ip_validator_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+#ifdef IP_VALIDATOR_STATS
+    for (int i = 0; i < IP_ERR_COUNT; i++) {
+        stats->ipv4[i] = atomic_load_explicit(&ipv4_totals[i],
+                                              memory_order_relaxed);
+        stats->ipv6[i] = atomic_load_explicit(&ipv6_totals[i],
+                                              memory_order_relaxed);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * ip_validator_stats_flush - Publish the calling thread's pending counts.
+ */
+void ip_validator_stats_flush(void)
+{
+#ifdef IP_VALIDATOR_STATS
+    ip_stats_publish();
+#endif
+}
@@ -0,0 +1,63 @@
+#ifndef IP_STATS_H
+#define IP_STATS_H
+
+/*
+ * Internal hooks behind ip_validator_stats_snapshot(). Without
+ * IP_VALIDATOR_STATS the hooks compile to nothing, so the parsers carry no
+ * cost. With it, an accepted address costs one thread-local increment and a
+ * rejection also replays the text once through ip_ipv4_error() or
+ * ip_ipv6_error() to find the reason.
+ */
+
+#include "ip_validator.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef IP_VALIDATOR_STATS
+
+/* Calls a thread counts before adding its counts to the shared totals. */
+#define IP_STATS_BATCH 256
+
+/* Counts of the calling thread not yet added to the shared totals. */
+struct ip_stats_pending {
+    uint32_t ipv4[IP_ERR_COUNT];
+    uint32_t ipv6[IP_ERR_COUNT];
+    unsigned int calls;
+};
+
+extern _Thread_local struct ip_stats_pending ip_stats_pending;
+
+/**
+ * ip_stats_publish - Add the calling thread's pending counts to the totals.
+ */
+void ip_stats_publish(void);
+
+/**
+ * ip_stats_count - Record the outcome of one default-parser call.
+ * @family: AF_INET or AF_INET6.
+ * @buf: Text that was examined.
+ * @len: Number of bytes of @buf.
+ * @ok: Parser verdict.
+ */
+static inline void ip_stats_count(int family, const char *buf, size_t len,
+                                  bool ok)
+{
+    struct ip_stats_pending *p = &ip_stats_pending;
+
+    if (family == AF_INET)
+        p->ipv4[ok ? IP_OK : ip_ipv4_error(buf, len)]++;
+    else
+        p->ipv6[ok ? IP_OK : ip_ipv6_error(buf, len)]++;
+    if (++p->calls == IP_STATS_BATCH)
+        ip_stats_publish();
+}
+
+#else
+
+#define ip_stats_count(family, buf, len, ok) ((void)0)
+
+#endif                          /* IP_VALIDATOR_STATS */
+
+#endif                          /* IP_STATS_H */
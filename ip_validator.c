@@ -1,212 +1,596 @@
-#include <ctype.h>
+#include "ip_validator.h"
+#include "ip_validator_inline.h"
+#include "ip_charclass.h"
+#include "ip_dfa.h"
+#include "ip_simd.h"
+#include "ip_stats.h"
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
 #include <arpa/inet.h>
+#include <net/if.h>
+
+#define CC_DIGIT(v) (IP_CC_DIGIT | IP_CC_HEX | IP_CC_WORD | (v))
+#define CC_ALPHA(v) (IP_CC_HEX | IP_CC_WORD | (v))
+#define CC_WORD IP_CC_WORD
+
+/*
+ * Byte classes for the parsers; see ip_charclass.h. Built entirely from
+ * designated initializers, so the table lives in read-only data and every
+ * byte outside the listed ones has no class.
+ */
+const uint16_t ip_char_class[256] = {
+    ['0'] = CC_DIGIT(0), ['1'] = CC_DIGIT(1), ['2'] = CC_DIGIT(2),
+    ['3'] = CC_DIGIT(3), ['4'] = CC_DIGIT(4), ['5'] = CC_DIGIT(5),
+    ['6'] = CC_DIGIT(6), ['7'] = CC_DIGIT(7), ['8'] = CC_DIGIT(8),
+    ['9'] = CC_DIGIT(9),
+    ['a'] = CC_ALPHA(10), ['b'] = CC_ALPHA(11), ['c'] = CC_ALPHA(12),
+    ['d'] = CC_ALPHA(13), ['e'] = CC_ALPHA(14), ['f'] = CC_ALPHA(15),
+    ['A'] = CC_ALPHA(10), ['B'] = CC_ALPHA(11), ['C'] = CC_ALPHA(12),
+    ['D'] = CC_ALPHA(13), ['E'] = CC_ALPHA(14), ['F'] = CC_ALPHA(15),
+    ['g'] = CC_WORD, ['h'] = CC_WORD, ['i'] = CC_WORD, ['j'] = CC_WORD,
+    ['k'] = CC_WORD, ['l'] = CC_WORD, ['m'] = CC_WORD, ['n'] = CC_WORD,
+    ['o'] = CC_WORD, ['p'] = CC_WORD, ['q'] = CC_WORD, ['r'] = CC_WORD,
+    ['s'] = CC_WORD, ['t'] = CC_WORD, ['u'] = CC_WORD, ['v'] = CC_WORD,
+    ['w'] = CC_WORD, ['x'] = CC_WORD, ['y'] = CC_WORD, ['z'] = CC_WORD,
+    ['G'] = CC_WORD, ['H'] = CC_WORD, ['I'] = CC_WORD, ['J'] = CC_WORD,
+    ['K'] = CC_WORD, ['L'] = CC_WORD, ['M'] = CC_WORD, ['N'] = CC_WORD,
+    ['O'] = CC_WORD, ['P'] = CC_WORD, ['Q'] = CC_WORD, ['R'] = CC_WORD,
+    ['S'] = CC_WORD, ['T'] = CC_WORD, ['U'] = CC_WORD, ['V'] = CC_WORD,
+    ['W'] = CC_WORD, ['X'] = CC_WORD, ['Y'] = CC_WORD, ['Z'] = CC_WORD,
+    ['_'] = CC_WORD,
+    ['.'] = IP_CC_DOT,
+    [':'] = IP_CC_COLON,
+    ['%'] = IP_CC_PERCENT,
+};
+
+/*
+ * Parsing policies. Each combination of IP_PARSE_* flags gets its own parser,
+ * chosen once by ip_ipv4_parser() or ip_ipv6_parser(), so the default policy
+ * runs the plain parse_*_address() code and the stricter or looser ones add
+ * their checks around the shared parse instead of inside its byte loop.
+ */
+
+#define IP_PARSE_ALL (IP_PARSE_NO_LEADING_ZEROS | IP_PARSE_ALLOW_ZONE | \
+                      IP_PARSE_NO_EMBEDDED_IPV4 | IP_PARSE_INET_ATON)
+
+/**
+ * octets_text_len - Length of four octets written without leading zeros.
+ * @o: The four octets.
+ *
+ * A dotted quad that parsed to @o has leading zeros exactly when it is
+ * longer than this, so the check needs no second look at the text.
+ *
+ * Return: length of the shortest dotted-quad text for @o.
+ */
+static inline size_t octets_text_len(const unsigned char o[4])
+{
+    size_t len = 3;
 
-/* Maximum dotted-quad length including NUL */
-#define MAX_SIZE_IPV4 16
+    for (int i = 0; i < 4; i++)
+        len += 1 + (o[i] >= 10) + (o[i] >= 100);
+    return len;
+}
 
 /**
- * parse_int - Parse a decimal substring into an integer.
- * @str: Source string containing digits.
- * @start: Inclusive starting index within @str.
- * @end: Exclusive ending index within @str.
- * @result: Output pointer that receives the parsed value.
+ * parse_ipv4_no_leading_zeros - IPv4 parser for IP_PARSE_NO_LEADING_ZEROS.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @addr: Output that receives the address in network byte order.
  *
- * Return: true on success, false if the substring is empty, contains
- * non-digits, or would overflow the IPv4 octet range.
+ * Return: true if the text was valid and @addr was written, false otherwise.
  */
-static bool parse_int(const char *str, int start, int end, int *result)
+static bool parse_ipv4_no_leading_zeros(const char *buf, size_t len,
+                                        struct in_addr *addr)
 {
-    if (start >= end || str == NULL || *str == '\0')
+    unsigned char octets[4];
+
+    if (addr == NULL || !ipv4_parse_octets(buf, len, octets) ||
+        len != octets_text_len(octets))
         return false;
 
-    *result = 0;
-    for (int i = start; i < end; i++) {
-        if (!isdigit(str[i]))
+    memcpy(addr, octets, sizeof(octets));
+    return true;
+}
+
+/**
+ * parse_ipv4_inet_aton - IPv4 parser for IP_PARSE_INET_ATON.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @addr: Output that receives the address in network byte order.
+ *
+ * Accepts what glibc's inet_aton() accepts, without its tolerance for
+ * trailing whitespace: one to four parts in decimal, octal with a leading
+ * "0" or hex with a leading "0x", where the last part fills all the bytes
+ * the earlier ones leave, so "127.1" is 127.0.0.1.
+ *
+ * Return: true if the text was valid and @addr was written, false otherwise.
+ */
+static bool parse_ipv4_inet_aton(const char *buf, size_t len,
+                                 struct in_addr *addr)
+{
+    static const uint32_t last_max[4] = {
+        0xffffffff, 0xffffff, 0xffff, 0xff
+    };
+    uint32_t value = 0;
+    int parts = 0;
+    size_t i = 0;
+
+    if (addr == NULL || buf == NULL)
+        return false;
+    for (;;) {
+        uint64_t v = 0;
+        unsigned int base = 10;
+        bool digits = true;
+
+        if (i == len || !(ip_cc(buf[i]) & IP_CC_DIGIT))
             return false;
+        if (buf[i] == '0') {
+            base = 8;
+            i++;
+            if (i < len && (buf[i] == 'x' || buf[i] == 'X')) {
+                base = 16;
+                digits = false;
+                i++;
+            }
+        }
+        for (; i < len; i++) {
+            unsigned int cls = ip_cc(buf[i]);
 
-        /* Check for overflow before multiplication */
-        if (*result > 25 || (*result == 25 && (str[i] - '0') > 5)) {
+            if (!(cls & IP_CC_HEX) || (cls & IP_CC_VALUE_MASK) >= base)
+                break;
+            v = v * base + (cls & IP_CC_VALUE_MASK);
+            digits = true;
+            if (v > UINT32_MAX)
+                return false;
+        }
+        if (!digits)
             return false;
+        if (i == len) {
+            if (v > last_max[parts])
+                return false;
+            value |= (uint32_t)v;
+            break;
         }
-        *result = *result * 10 + (str[i] - '0');
+        if (buf[i] != '.' || parts == 3 || v > 0xff)
+            return false;
+        value |= (uint32_t)v << (24 - 8 * parts);
+        parts++;
+        i++;
     }
+
+    unsigned char octets[4] = {
+        (unsigned char)(value >> 24), (unsigned char)(value >> 16),
+        (unsigned char)(value >> 8), (unsigned char)value
+    };
+
+    memcpy(addr, octets, sizeof(octets));
     return true;
 }
 
 /**
- * is_valid_ipv4_address - Validate dotted-quad IPv4 text representation.
- * @str: Null-terminated string to examine.
+ * ipv6_zone_valid - Check the zone ID that follows a '%'.
+ * @zone: First byte after the '%'.
+ * @len: Number of zone bytes.
+ *
+ * A zone is an interface name or index: 1 to IF_NAMESIZE - 1 visible ASCII
+ * bytes other than '%' and '/'.
  *
- * Return: true if @str is a syntactically valid IPv4 address, otherwise false.
+ * Return: true if the zone is acceptable.
  */
-bool is_valid_ipv4_address(const char *str)
+static bool ipv6_zone_valid(const char *zone, size_t len)
 {
-    if (str == NULL)
+    if (len == 0 || len >= IF_NAMESIZE)
         return false;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)zone[i];
+
+        if (ch <= ' ' || ch >= 0x7f || ch == '%' || ch == '/')
+            return false;
+    }
+    return true;
+}
 
-    size_t len = strnlen(str, MAX_SIZE_IPV4);
-    int octet_count = 0;
-    size_t octet_start = 0;
-    int octet_value;
+/**
+ * ipv6_split_zone - Separate an IPv6 address from its zone ID.
+ * @buf: Start of the candidate text.
+ * @len: Number of bytes of @buf.
+ * @addr_len: Output length of the address part; @len when there is no zone.
+ *
+ * Return: false if a '%' is followed by an unacceptable zone.
+ */
+static inline bool ipv6_split_zone(const char *buf, size_t len,
+                                   size_t *addr_len)
+{
+    const char *pct = memchr(buf, '%', len);
 
-    for (size_t i = 0; i <= len; i++) {
-        if (str[i] == '.' || str[i] == '\0') {
-            /* Found end of octet */
-            if (i == octet_start) {
-                /* Empty octet */
-                return false;
-            }
+    *addr_len = len;
+    if (pct == NULL)
+        return true;
+    *addr_len = (size_t)(pct - buf);
+    return ipv6_zone_valid(pct + 1, len - *addr_len - 1);
+}
 
-            if (!parse_int(str, (int)octet_start, (int)i, &octet_value)) {
-                return false;
-            }
+/**
+ * ipv6_parse_policy - IPv6 parser body shared by every policy.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @addr: Output that receives the address in network byte order.
+ * @flags: IP_PARSE_* flags; always a constant, so each instantiation keeps
+ *         only the checks its policy needs.
+ *
+ * Return: true if the text was valid and @addr was written, false otherwise.
+ */
+static inline bool ipv6_parse_policy(const char *buf, size_t len,
+                                     struct in6_addr *addr,
+                                     unsigned int flags)
+{
+    unsigned char bytes[16];
 
-            /* Check range 0-255 */
-            if (octet_value > 255) {
-                return false;
-            }
+    if (addr == NULL || buf == NULL)
+        return false;
+    if ((flags & IP_PARSE_ALLOW_ZONE) && !ipv6_split_zone(buf, len, &len))
+        return false;
+    if (!ipv6_parse_bytes(buf, len, bytes))
+        return false;
+    if (flags & (IP_PARSE_NO_EMBEDDED_IPV4 | IP_PARSE_NO_LEADING_ZEROS)) {
+        /*
+         * A dotted-quad suffix is everything after the last ':', which valid
+         * text always has. Octets may carry any number of leading zeros, so
+         * the '.' can be more than four bytes from the end.
+         */
+        size_t quad = len;
 
-            octet_count++;
-            octet_start = i + 1;
+        while (buf[quad - 1] != ':')
+            quad--;
+        bool dotted = memchr(buf + quad, '.', len - quad) != NULL;
 
-            if (str[i] == '\0')
-                break;
-        } else if (!isdigit((unsigned char)str[i])) {
-            /* Invalid character */
+        if (dotted && (flags & IP_PARSE_NO_EMBEDDED_IPV4))
+            return false;
+        if (dotted && (flags & IP_PARSE_NO_LEADING_ZEROS) &&
+            len - quad != octets_text_len(bytes + 12))
             return false;
-        }
     }
 
-    /* Must have exactly 4 octets */
-    return octet_count == 4;
+    memcpy(addr, bytes, sizeof(bytes));
+    return true;
 }
 
+#define IPV6_POLICY(name, flags) \
+    static bool name(const char *buf, size_t len, struct in6_addr *addr) \
+    { \
+        return ipv6_parse_policy(buf, len, addr, (flags)); \
+    }
+
+IPV6_POLICY(parse_ipv6_nlz, IP_PARSE_NO_LEADING_ZEROS)
+IPV6_POLICY(parse_ipv6_zone, IP_PARSE_ALLOW_ZONE)
+IPV6_POLICY(parse_ipv6_zone_nlz,
+            IP_PARSE_ALLOW_ZONE | IP_PARSE_NO_LEADING_ZEROS)
+IPV6_POLICY(parse_ipv6_no_v4, IP_PARSE_NO_EMBEDDED_IPV4)
+IPV6_POLICY(parse_ipv6_no_v4_nlz,
+            IP_PARSE_NO_EMBEDDED_IPV4 | IP_PARSE_NO_LEADING_ZEROS)
+IPV6_POLICY(parse_ipv6_zone_no_v4,
+            IP_PARSE_ALLOW_ZONE | IP_PARSE_NO_EMBEDDED_IPV4)
+IPV6_POLICY(parse_ipv6_zone_no_v4_nlz,
+            IP_PARSE_ALLOW_ZONE | IP_PARSE_NO_EMBEDDED_IPV4 |
+            IP_PARSE_NO_LEADING_ZEROS)
+
+/* Indexed by the IPv6 flags: NO_LEADING_ZEROS, ALLOW_ZONE, NO_EMBEDDED_IPV4. */
+static const ip_parse_ipv6_fn ipv6_parsers[8] = {
+    parse_ipv6_address, parse_ipv6_nlz,
+    parse_ipv6_zone, parse_ipv6_zone_nlz,
+    parse_ipv6_no_v4, parse_ipv6_no_v4_nlz,
+    parse_ipv6_zone_no_v4, parse_ipv6_zone_no_v4_nlz,
+};
+
 /**
- * hex_digit_value - Convert a hexadecimal character to its numeric value.
- * @ch: Character to convert.
+ * ip_ipv4_parser - Choose the IPv4 parser for a policy.
+ * @flags: Bitwise OR of IP_PARSE_* flags.
  *
- * Return: Numeric value 0-15 on success, or -1 if @ch is not hexadecimal.
+ * Return: parser for the policy, or NULL if @flags has unknown bits.
  */
-static int hex_digit_value(char ch)
+ip_parse_ipv4_fn ip_ipv4_parser(unsigned int flags)
 {
-    if ('0' <= ch && ch <= '9')
-        return ch - '0';
-    if ('a' <= ch && ch <= 'f')
-        return ch - 'a' + 10;
-    if ('A' <= ch && ch <= 'F')
-        return ch - 'A' + 10;
-    return -1;
+    if (flags & ~IP_PARSE_ALL)
+        return NULL;
+    if (flags & IP_PARSE_INET_ATON)
+        return parse_ipv4_inet_aton;
+    if (flags & IP_PARSE_NO_LEADING_ZEROS)
+        return parse_ipv4_no_leading_zeros;
+    return parse_ipv4_address;
 }
 
 /**
- * is_valid_ipv6_address - Validate IPv6 text representation.
- * @str: Null-terminated string to examine.
+ * ip_ipv6_parser - Choose the IPv6 parser for a policy.
+ * @flags: Bitwise OR of IP_PARSE_* flags.
  *
- * Return: true if @str is a syntactically valid IPv6 address, otherwise false.
+ * Return: parser for the policy, or NULL if @flags has unknown bits.
  */
-bool is_valid_ipv6_address(const char *str)
+ip_parse_ipv6_fn ip_ipv6_parser(unsigned int flags)
 {
-    if (str == NULL || *str == '\0')
-        return false;
+    if (flags & ~IP_PARSE_ALL)
+        return NULL;
+    return ipv6_parsers[flags & (IP_PARSE_NO_LEADING_ZEROS |
+                                 IP_PARSE_ALLOW_ZONE |
+                                 IP_PARSE_NO_EMBEDDED_IPV4)];
+}
 
-    const char *src = str;
-    const char *src_endp = str + strnlen(str, INET6_ADDRSTRLEN);
-    int group_count = 0;
-    bool has_compression = false;
-    const char *curtok;
-    size_t xdigits_seen = 0;
-    unsigned int val = 0;
+/**
+ * parse_ipv6_address_zone - Parse IPv6 text with an optional zone ID.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @flags: IP_PARSE_* policy for the address part.
+ * @addr: Output that receives the address in network byte order.
+ * @zone: Output location of the zone within @buf.
+ *
+ * Return: true if the text was valid and @addr and @zone were written.
+ */
+bool parse_ipv6_address_zone(const char *buf, size_t len, unsigned int flags,
+                             struct in6_addr *addr, struct ip_zone *zone)
+{
+    ip_parse_ipv6_fn parse = ip_ipv6_parser(flags & ~IP_PARSE_ALLOW_ZONE);
+    size_t addr_len;
 
-    /* Leading :: requires some special handling. */
-    if (src == src_endp)
+    if (parse == NULL || buf == NULL || zone == NULL ||
+        !ipv6_split_zone(buf, len, &addr_len) ||
+        !parse(buf, addr_len, addr))
         return false;
-    if (*src == ':') {
-        ++src;
-        if (src == src_endp || *src != ':')
-            return false;
+
+    zone->offset = addr_len < len ? addr_len + 1 : len;
+    zone->len = len - zone->offset;
+    return true;
+}
+
+/*
+ * The batch loops below gather eight results into one validity byte before
+ * storing it, so the bitmap is written with plain byte stores and no
+ * read-modify-write of the output.
+ */
+
+/**
+ * flush_validity - Store the final, possibly partial validity byte.
+ * @validity: Output bitmap.
+ * @count: Total number of candidates.
+ * @bits: Accumulated bits of the trailing partial byte.
+ */
+static void flush_validity(uint8_t *validity, size_t count, unsigned int bits)
+{
+    if (count % 8 != 0)
+        validity[count / 8] = (uint8_t)bits;
+}
+
+/**
+ * is_valid_ipv4_batch - Validate an array of dotted-quad slices.
+ * @bufs: Candidate text pointers.
+ * @lens: Candidate lengths.
+ * @count: Number of candidates.
+ * @validity: Output bitmap, LSB first.
+ * @addrs: Optional parsed outputs; rejected entries are zeroed.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv4_batch(const char *const *bufs, const size_t *lens,
+                           size_t count, uint8_t *validity,
+                           struct in_addr *addrs)
+{
+    static const struct in_addr zero4;
+    size_t valid = 0;
+    unsigned int bits = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        struct in_addr addr;
+        bool ok = parse_ipv4_address(bufs[i], lens[i], &addr);
+
+        if (addrs != NULL)
+            addrs[i] = ok ? addr : zero4;
+        valid += ok;
+        bits |= (unsigned int)ok << (i % 8);
+        if (i % 8 == 7) {
+            validity[i / 8] = (uint8_t)bits;
+            bits = 0;
+        }
     }
+    flush_validity(validity, count, bits);
+    return valid;
+}
 
-    curtok = src;
+/**
+ * is_valid_ipv6_batch - Validate an array of IPv6 text slices.
+ * @bufs: Candidate text pointers.
+ * @lens: Candidate lengths.
+ * @count: Number of candidates.
+ * @validity: Output bitmap, LSB first.
+ * @addrs: Optional parsed outputs; rejected entries are zeroed.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv6_batch(const char *const *bufs, const size_t *lens,
+                           size_t count, uint8_t *validity,
+                           struct in6_addr *addrs)
+{
+    static const struct in6_addr zero6;
+    size_t valid = 0;
+    unsigned int bits = 0;
 
-    while (src < src_endp) {
-        int ch = *src++;
-        int digit = hex_digit_value(ch);
-        if (digit >= 0) {
-            if (xdigits_seen == 4)
-                return false;
-            val <<= 4;
-            val |= (unsigned int)digit;
-            if (val > 0xffff)
-                return false;
-            ++xdigits_seen;
-            continue;
+    for (size_t i = 0; i < count; i++) {
+        struct in6_addr addr;
+        bool ok = parse_ipv6_address(bufs[i], lens[i], &addr);
+
+        if (addrs != NULL)
+            addrs[i] = ok ? addr : zero6;
+        valid += ok;
+        bits |= (unsigned int)ok << (i % 8);
+        if (i % 8 == 7) {
+            validity[i / 8] = (uint8_t)bits;
+            bits = 0;
         }
-        if (ch == ':') {
-            curtok = src;
-            if (xdigits_seen == 0) {
-                if (has_compression)
-                    return false;   /* Multiple :: not allowed */
-                has_compression = true;
-                continue;
-            } else if (src == src_endp) {
-                return false;
-            }
+    }
+    flush_validity(validity, count, bits);
+    return valid;
+}
 
-            group_count++;
-            if (group_count > 8)
-                return false;
+/**
+ * is_valid_ipv4_batch_arrow - Validate an Arrow string column of IPv4 text.
+ * @offsets: Arrow offsets buffer of @count + 1 entries.
+ * @data: Arrow value data buffer.
+ * @count: Number of candidates.
+ * @validity: Output bitmap, LSB first.
+ * @addrs: Optional parsed outputs; rejected entries are zeroed.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv4_batch_arrow(const int32_t *offsets, const char *data,
+                                 size_t count, uint8_t *validity,
+                                 struct in_addr *addrs)
+{
+    static const struct in_addr zero4;
+    size_t valid = 0;
+    unsigned int bits = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        struct in_addr addr;
+        int32_t start = offsets[i];
+        int32_t end = offsets[i + 1];
+        bool ok = end >= start &&
+            parse_ipv4_address(data + start, (size_t)(end - start), &addr);
 
-            xdigits_seen = 0;
-            val = 0;
-            continue;
+        if (addrs != NULL)
+            addrs[i] = ok ? addr : zero4;
+        valid += ok;
+        bits |= (unsigned int)ok << (i % 8);
+        if (i % 8 == 7) {
+            validity[i / 8] = (uint8_t)bits;
+            bits = 0;
         }
-        if (ch == '.' && xdigits_seen > 0) {
-            /* IPv4 suffix - validate it separately */
-            const char *ipv4_start = curtok;
-            int dots = 0;
-            const char *p = curtok;
-
-            /* Count dots and validate basic IPv4 format */
-            while (p < src_endp) {
-                if (*p == '.')
-                    dots++;
-                else if (!isdigit((unsigned char)*p))
-                    return false;
-                p++;
-            }
+    }
+    flush_validity(validity, count, bits);
+    return valid;
+}
 
-            if (dots != 3)
-                return false;
+/**
+ * is_valid_ipv6_batch_arrow - Validate an Arrow string column of IPv6 text.
+ * @offsets: Arrow offsets buffer of @count + 1 entries.
+ * @data: Arrow value data buffer.
+ * @count: Number of candidates.
+ * @validity: Output bitmap, LSB first.
+ * @addrs: Optional parsed outputs; rejected entries are zeroed.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv6_batch_arrow(const int32_t *offsets, const char *data,
+                                 size_t count, uint8_t *validity,
+                                 struct in6_addr *addrs)
+{
+    static const struct in6_addr zero6;
+    size_t valid = 0;
+    unsigned int bits = 0;
 
-            /* Simple IPv4 validation */
-            if (!is_valid_ipv4_address(ipv4_start))
-                return false;
+    for (size_t i = 0; i < count; i++) {
+        struct in6_addr addr;
+        int32_t start = offsets[i];
+        int32_t end = offsets[i + 1];
+        bool ok = end >= start &&
+            parse_ipv6_address(data + start, (size_t)(end - start), &addr);
 
-            group_count += 2;   /* IPv4 takes 2 groups worth */
-            xdigits_seen = 0;
-            break;
+        if (addrs != NULL)
+            addrs[i] = ok ? addr : zero6;
+        valid += ok;
+        bits |= (unsigned int)ok << (i % 8);
+        if (i % 8 == 7) {
+            validity[i / 8] = (uint8_t)bits;
+            bits = 0;
         }
-        return false;
     }
+    flush_validity(validity, count, bits);
+    return valid;
+}
 
-    if (xdigits_seen > 0) {
-        group_count++;
-        if (group_count > 8)
-            return false;
+/**
+ * ip_stream_init - Prepare a context for incremental validation.
+ * @ctx: Context to initialise.
+ * @family: AF_INET, AF_INET6, or AF_UNSPEC for either.
+ */
+void ip_stream_init(struct ip_stream *ctx, int family)
+{
+    ctx->len = 0;
+    ctx->v4_live = family != AF_INET6;
+    ctx->v6_live = family != AF_INET;
+    ipv4_dfa_init(&ctx->v4);
+    ipv6_dfa_init(&ctx->v6);
+}
+
+/**
+ * ip_stream_feed - Consume the next piece of a candidate address.
+ * @ctx: Context set up by ip_stream_init().
+ * @buf: Next bytes of the candidate; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to consume.
+ *
+ * Both recognisers run on the same byte-class lookup and each drops out as
+ * soon as it rejects, so a single-family context costs one DFA step per byte.
+ *
+ * Return: false once no continuation can be valid, true otherwise.
+ */
+bool ip_stream_feed(struct ip_stream *ctx, const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len && (ctx->v4_live || ctx->v6_live); i++) {
+        unsigned int cls = ip_cc(buf[i]);
+
+        ctx->len++;
+        if (ctx->v4_live)
+            ctx->v4_live = ctx->len < MAX_SIZE_IPV4 &&
+                ipv4_dfa_step(&ctx->v4, cls);
+        if (ctx->v6_live)
+            ctx->v6_live = ctx->len < INET6_ADDRSTRLEN &&
+                ipv6_dfa_step(&ctx->v6, cls);
     }
+    return ctx->v4_live || ctx->v6_live;
+}
 
-    /* Check if we have the right number of groups */
-    if (has_compression) {
-        if (group_count >= 8)
-            return false;
-    } else {
-        if (group_count != 8)
-            return false;
+/**
+ * ip_stream_finish - Judge the text fed to a context.
+ * @ctx: Context set up by ip_stream_init() and fed with ip_stream_feed().
+ * @addr: Optional output receiving the family and address. May be NULL.
+ *
+ * Return: true if the text is a valid address of an accepted family.
+ */
+bool ip_stream_finish(struct ip_stream *ctx, struct ip_address *addr)
+{
+    bool v4 = ctx->v4_live && ipv4_dfa_finish(&ctx->v4);
+    bool v6 = !v4 && ctx->v6_live && ipv6_dfa_finish(&ctx->v6);
+
+    /* Finishing expands the "::" gap in place, so it must not run twice. */
+    ctx->v4_live = false;
+    ctx->v6_live = false;
+    if (addr != NULL && v4) {
+        addr->family = AF_INET;
+        memcpy(&addr->v4, ctx->v4.octets, sizeof(ctx->v4.octets));
+    } else if (addr != NULL && v6) {
+        addr->family = AF_INET6;
+        memcpy(&addr->v6, ctx->v6.bytes, sizeof(ctx->v6.bytes));
     }
+    return v4 || v6;
+}
 
-    return true;
+/**
+ * ip_validator_use_simd - Enable or disable the vector kernels.
+ * @enable: true to use the best kernel the CPU supports, false to force the
+ *          scalar path.
+ *
+ * Return: name of the kernel set now in use.
+ */
+const char *ip_validator_use_simd(bool enable)
+{
+    return ip_simd_select(enable);
+}
+
+/**
+ * ip_validator_simd_name - Name the kernel set currently in use.
+ *
+ * Return: "avx2", "sse4.1", "sse2", "neon" or "scalar".
+ */
+const char *ip_validator_simd_name(void)
+{
+    return ip_simd_name();
 }
@@ -2,6 +2,73 @@
 #define IP_VALIDATOR_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/*
+ * Define IP_VALIDATOR_INLINE before the first include of this header, or on
+ * the command line, to get the is_valid_*_address*() and parse_*_address()
+ * functions as static inline definitions from ip_validator_inline.h. Callers
+ * still link the library for everything else.
+ */
+#ifdef IP_VALIDATOR_INLINE
+#define IP_VALIDATOR_API static inline
+#else
+#define IP_VALIDATOR_API
+#endif
+
+/*
+ * Parser states kept between ip_stream_feed() calls. The members are private
+ * to the library; they are declared here only so a context can live on the
+ * caller's stack or inside a connection structure.
+ */
+struct ipv4_dfa {
+    unsigned char octets[4];
+    unsigned int value;         /* Octet in progress */
+    int octet_count;            /* Octets completed */
+    bool digits;                /* Octet in progress has a digit */
+};
+
+struct ipv6_dfa {
+    unsigned char bytes[16];
+    int state;
+    int group_count;
+    bool has_compression;
+    int compression_at;
+    size_t xdigits_seen;
+    unsigned int val;           /* Group value read as hex */
+    unsigned int dval;          /* Same digits read as decimal */
+    bool decimal;               /* Group so far is all decimal digits */
+    int octet_count;
+    size_t suffix_len;
+};
+
+/* Resumable validator context; see ip_stream_init(). */
+struct ip_stream {
+    size_t len;                 /* Bytes consumed so far */
+    bool v4_live;               /* Input may still become IPv4 */
+    bool v6_live;               /* Input may still become IPv6 */
+    struct ipv4_dfa v4;
+    struct ipv6_dfa v6;
+};
+
+/* Location of an IPv6 zone ID inside the text it was parsed from. */
+struct ip_zone {
+    size_t offset;              /* First byte after the '%' */
+    size_t len;                 /* Zone length; 0 when there is no zone */
+};
+
+/* A parsed address of either family. */
+struct ip_address {
+    int family;                 /* AF_INET or AF_INET6 */
+    union {
+        struct in_addr v4;
+        struct in6_addr v6;
+    };
+};
 
 /**
  * is_valid_ipv4_address - Validate dotted-decimal IPv4 text.
@@ -9,7 +76,20 @@
  *
  * Return: true if @str represents a syntactically valid IPv4 address, false otherwise.
  */
-bool is_valid_ipv4_address(const char *str);
+IP_VALIDATOR_API bool is_valid_ipv4_address(const char *str);
+
+/**
+ * is_valid_ipv4_address_len - Validate a length-delimited dotted-quad slice.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * Never reads past @buf[@len - 1], so slices of larger buffers can be checked
+ * in place.
+ *
+ * Return: true if the @len bytes at @buf represent a syntactically valid IPv4
+ * address, false otherwise.
+ */
+IP_VALIDATOR_API bool is_valid_ipv4_address_len(const char *buf, size_t len);
 
 /**
  * is_valid_ipv6_address - Validate textual IPv6 representation.
@@ -17,6 +97,415 @@ bool is_valid_ipv4_address(const char *str);
  *
  * Return: true if @str represents a syntactically valid IPv6 address, false otherwise.
  */
-bool is_valid_ipv6_address(const char *str);
+IP_VALIDATOR_API bool is_valid_ipv6_address(const char *str);
+
+/**
+ * is_valid_ipv6_address_len - Validate a length-delimited IPv6 text slice.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * Never reads past @buf[@len - 1], so slices of larger buffers can be checked
+ * in place.
+ *
+ * Return: true if the @len bytes at @buf represent a syntactically valid IPv6
+ * address, false otherwise.
+ */
+IP_VALIDATOR_API bool is_valid_ipv6_address_len(const char *buf, size_t len);
+
+/**
+ * parse_ipv4_address - Validate and convert dotted-quad text in one pass.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @addr: Output that receives the 4-byte address in network byte order.
+ *
+ * Accepts exactly what is_valid_ipv4_address_len() accepts. @addr is left
+ * untouched when the text is rejected.
+ *
+ * Return: true if the text was valid and @addr was written, false otherwise.
+ */
+IP_VALIDATOR_API bool parse_ipv4_address(const char *buf, size_t len,
+                                         struct in_addr *addr);
+
+/**
+ * parse_ipv6_address - Validate and convert IPv6 text in one pass.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @addr: Output that receives the 16-byte address in network byte order.
+ *
+ * Accepts exactly what is_valid_ipv6_address_len() accepts, including an
+ * embedded dotted-quad suffix. @addr is left untouched when the text is
+ * rejected.
+ *
+ * Return: true if the text was valid and @addr was written, false otherwise.
+ */
+IP_VALIDATOR_API bool parse_ipv6_address(const char *buf, size_t len,
+                                         struct in6_addr *addr);
+
+/*
+ * Parsing policies for ip_ipv4_parser() and ip_ipv6_parser(). Flags that do
+ * not concern a family are ignored by that family's parsers, so one policy
+ * word can serve both.
+ */
+enum ip_parse_flags {
+    IP_PARSE_NO_LEADING_ZEROS = 1 << 0, /* Reject "010.1.1.1", as inet_pton()
+                                           does; also in embedded quads */
+    IP_PARSE_ALLOW_ZONE = 1 << 1,       /* IPv6: accept and skip a zone ID,
+                                           as in "fe80::1%eth0" */
+    IP_PARSE_NO_EMBEDDED_IPV4 = 1 << 2, /* IPv6: reject a dotted-quad
+                                           suffix such as "::ffff:1.2.3.4" */
+    IP_PARSE_INET_ATON = 1 << 3,        /* IPv4: accept inet_aton() forms such
+                                           as "127.1" and "0x7f.0.0.1" */
+};
+
+/* A parser for one policy; same contract as parse_ipv4_address(). */
+typedef bool (*ip_parse_ipv4_fn)(const char *buf, size_t len,
+                                 struct in_addr *addr);
+
+/* A parser for one policy; same contract as parse_ipv6_address(). */
+typedef bool (*ip_parse_ipv6_fn)(const char *buf, size_t len,
+                                 struct in6_addr *addr);
+
+/**
+ * ip_ipv4_parser - Choose the IPv4 parser for a policy.
+ * @flags: Bitwise OR of IP_PARSE_* flags; 0 for the default policy.
+ *
+ * Every policy has its own parser, so the choice is made once rather than
+ * tested for every byte. The default policy returns parse_ipv4_address()
+ * itself. IP_PARSE_INET_ATON reads a leading "0" as octal, as inet_aton()
+ * does, and so overrides IP_PARSE_NO_LEADING_ZEROS.
+ *
+ * Return: parser for the policy, or NULL if @flags has unknown bits.
+ */
+ip_parse_ipv4_fn ip_ipv4_parser(unsigned int flags);
+
+/**
+ * ip_ipv6_parser - Choose the IPv6 parser for a policy.
+ * @flags: Bitwise OR of IP_PARSE_* flags; 0 for the default policy.
+ *
+ * The default policy returns parse_ipv6_address() itself. A zone accepted
+ * under IP_PARSE_ALLOW_ZONE is 1 to IF_NAMESIZE - 1 visible ASCII bytes
+ * other than '%' and '/'.
+ *
+ * Return: parser for the policy, or NULL if @flags has unknown bits.
+ */
+ip_parse_ipv6_fn ip_ipv6_parser(unsigned int flags);
+
+/**
+ * parse_ipv6_address_zone - Parse IPv6 text with an optional zone ID.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @flags: IP_PARSE_* policy for the address part; a zone is always allowed.
+ * @addr: Output that receives the address in network byte order.
+ * @zone: Output location of the zone within @buf, for example "eth0" in
+ *        "fe80::1%eth0". Nothing is copied; the zone is valid as long as
+ *        @buf is.
+ *
+ * Zones are checked as under IP_PARSE_ALLOW_ZONE. @addr and @zone are left
+ * untouched when the text is rejected.
+ *
+ * Return: true if the text was valid and @addr and @zone were written, false
+ * if it was rejected or @flags has unknown bits.
+ */
+bool parse_ipv6_address_zone(const char *buf, size_t len, unsigned int flags,
+                             struct in6_addr *addr, struct ip_zone *zone);
+
+/**
+ * ip_zone_index - Resolve a zone ID to an interface index.
+ * @buf: Text the zone was parsed from.
+ * @zone: Zone location from parse_ipv6_address_zone().
+ *
+ * A numeric zone is its own index. A name is resolved with if_nametoindex()
+ * the first time a thread asks and served from a per-thread cache after
+ * that; names that do not resolve are not cached.
+ *
+ * Return: interface index, or 0 if there is no zone or the name is unknown.
+ */
+unsigned int ip_zone_index(const char *buf, const struct ip_zone *zone);
+
+/**
+ * ip_zone_cache_flush - Forget every cached zone name.
+ *
+ * Call after interfaces are renamed or removed. Every thread's cache is
+ * invalidated and refilled on its next lookup.
+ */
+void ip_zone_cache_flush(void);
+
+/**
+ * is_valid_ipv4_batch - Validate an array of dotted-quad slices.
+ * @bufs: Array of @count pointers to candidate text.
+ * @lens: Array of @count slice lengths matching @bufs.
+ * @count: Number of candidates.
+ * @validity: Output bitmap of (@count + 7) / 8 bytes; bit i (LSB first, as in
+ *            an Arrow validity buffer) is set when candidate i is valid.
+ * @addrs: Optional array of @count outputs receiving the parsed addresses;
+ *         entries for rejected candidates are zeroed. May be NULL.
+ *
+ * Unused high bits of the final @validity byte are cleared.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv4_batch(const char *const *bufs, const size_t *lens,
+                           size_t count, uint8_t *validity,
+                           struct in_addr *addrs);
+
+/**
+ * is_valid_ipv6_batch - Validate an array of IPv6 text slices.
+ * @bufs: Array of @count pointers to candidate text.
+ * @lens: Array of @count slice lengths matching @bufs.
+ * @count: Number of candidates.
+ * @validity: Output bitmap of (@count + 7) / 8 bytes, LSB first.
+ * @addrs: Optional array of @count outputs receiving the parsed addresses;
+ *         entries for rejected candidates are zeroed. May be NULL.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv6_batch(const char *const *bufs, const size_t *lens,
+                           size_t count, uint8_t *validity,
+                           struct in6_addr *addrs);
+
+/**
+ * is_valid_ipv4_batch_arrow - Validate an Arrow string column of IPv4 text.
+ * @offsets: Arrow offsets buffer of @count + 1 entries; candidate i spans
+ *           @data[@offsets[i]] to @data[@offsets[i + 1]].
+ * @data: Arrow value data buffer.
+ * @count: Number of candidates.
+ * @validity: Output bitmap of (@count + 7) / 8 bytes, LSB first.
+ * @addrs: Optional array of @count parsed addresses; rejected entries are
+ *         zeroed. May be NULL.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv4_batch_arrow(const int32_t *offsets, const char *data,
+                                 size_t count, uint8_t *validity,
+                                 struct in_addr *addrs);
+
+/**
+ * is_valid_ipv6_batch_arrow - Validate an Arrow string column of IPv6 text.
+ * @offsets: Arrow offsets buffer of @count + 1 entries.
+ * @data: Arrow value data buffer.
+ * @count: Number of candidates.
+ * @validity: Output bitmap of (@count + 7) / 8 bytes, LSB first.
+ * @addrs: Optional array of @count parsed addresses; rejected entries are
+ *         zeroed. May be NULL.
+ *
+ * Return: number of valid candidates.
+ */
+size_t is_valid_ipv6_batch_arrow(const int32_t *offsets, const char *data,
+                                 size_t count, uint8_t *validity,
+                                 struct in6_addr *addrs);
+
+/**
+ * format_ipv4_address - Write the dotted-quad text of an IPv4 address.
+ * @addr: Address in network byte order, for example from parse_ipv4_address().
+ * @buf: Output buffer; receives NUL-terminated text.
+ * @size: Size of @buf; INET_ADDRSTRLEN always suffices.
+ *
+ * Octets are written in decimal without leading zeros, as by inet_ntop().
+ *
+ * Return: length of the text, not counting the terminating NUL, or 0 if
+ * @size is too small; @buf is then left untouched.
+ */
+size_t format_ipv4_address(const struct in_addr *addr, char *buf,
+                           size_t size);
+
+/**
+ * format_ipv4_batch_arrow - Format IPv4 addresses as an Arrow string column.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv4_batch().
+ * @count: Number of addresses.
+ * @offsets: Output Arrow offsets buffer of @count + 1 entries; the text of
+ *           address i spans @data[@offsets[i]] to @data[@offsets[i + 1]].
+ * @data: Output Arrow value data buffer, not NUL-terminated; @count *
+ *        INET_ADDRSTRLEN bytes always suffice.
+ *
+ * Return: number of bytes written to @data.
+ */
+size_t format_ipv4_batch_arrow(const struct in_addr *addrs, size_t count,
+                               int32_t *offsets, char *data);
+
+/**
+ * format_ipv6_address - Write the canonical text of an IPv6 address.
+ * @addr: Address in network byte order, for example from parse_ipv6_address().
+ * @buf: Output buffer; receives NUL-terminated text.
+ * @size: Size of @buf; INET6_ADDRSTRLEN always suffices.
+ *
+ * The text is the RFC 5952 canonical form: lower-case hex digits without
+ * leading zeros, the longest run of two or more zero groups (the first on a
+ * tie) written as "::", and dotted-quad notation for IPv4-mapped addresses.
+ * Two spellings of one address therefore format identically. Unlike glibc's
+ * inet_ntop(), deprecated IPv4-compatible addresses are printed in hex.
+ *
+ * Return: length of the text, not counting the terminating NUL, or 0 if
+ * @size is too small; @buf is then left untouched.
+ */
+size_t format_ipv6_address(const struct in6_addr *addr, char *buf,
+                           size_t size);
+
+/**
+ * format_ipv6_batch_arrow - Format IPv6 addresses as an Arrow string column.
+ * @addrs: Array of @count addresses, for example from is_valid_ipv6_batch().
+ * @count: Number of addresses.
+ * @offsets: Output Arrow offsets buffer of @count + 1 entries; the text of
+ *           address i spans @data[@offsets[i]] to @data[@offsets[i + 1]].
+ * @data: Output Arrow value data buffer, not NUL-terminated; @count *
+ *        INET6_ADDRSTRLEN bytes always suffice.
+ *
+ * Each entry is the text format_ipv6_address() writes.
+ *
+ * Return: number of bytes written to @data.
+ */
+size_t format_ipv6_batch_arrow(const struct in6_addr *addrs, size_t count,
+                               int32_t *offsets, char *data);
+
+/**
+ * ip_stream_init - Prepare a context for incremental validation.
+ * @ctx: Context to initialise.
+ * @family: AF_INET or AF_INET6 to accept only that family, or AF_UNSPEC to
+ *          accept either.
+ *
+ * The text of one candidate address is then passed to ip_stream_feed() in as
+ * many pieces as it arrives in, for example straight from successive recv()
+ * buffers, and judged by ip_stream_finish(). No byte is copied or revisited.
+ */
+void ip_stream_init(struct ip_stream *ctx, int family);
+
+/**
+ * ip_stream_feed - Consume the next piece of a candidate address.
+ * @ctx: Context set up by ip_stream_init().
+ * @buf: Next bytes of the candidate; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to consume; may be zero.
+ *
+ * Accepts exactly the inputs the length-delimited validators accept: the
+ * concatenation of every piece fed is judged as one slice.
+ *
+ * Return: false once no continuation of the text fed so far can be a valid
+ * address; later pieces are then ignored. true otherwise.
+ */
+bool ip_stream_feed(struct ip_stream *ctx, const char *buf, size_t len);
+
+/**
+ * ip_stream_finish - Judge the text fed to a context.
+ * @ctx: Context set up by ip_stream_init() and fed with ip_stream_feed().
+ * @addr: Optional output receiving the family and address. May be NULL.
+ *
+ * @ctx must be passed to ip_stream_init() again before it is reused. @addr is
+ * left untouched when the text is rejected.
+ *
+ * Return: true if the text is a valid address of an accepted family.
+ */
+bool ip_stream_finish(struct ip_stream *ctx, struct ip_address *addr);
+
+/*
+ * Why text was rejected, as reported by ip_ipv4_error() and ip_ipv6_error().
+ * The first check that fails decides the code, in the order the parsers
+ * apply them.
+ */
+enum ip_error {
+    IP_OK,                      /* Valid address */
+    IP_ERR_EMPTY,               /* NULL or zero-length input */
+    IP_ERR_TOO_LONG,            /* Longer than any address of the family */
+    IP_ERR_BAD_CHAR,            /* Byte that cannot appear here */
+    IP_ERR_EMPTY_OCTET,         /* IPv4: "1..2.3", ".1.2.3.4" or "1.2.3." */
+    IP_ERR_OCTET_RANGE,         /* IPv4: octet above 255 */
+    IP_ERR_OCTET_COUNT,         /* IPv4: not exactly four octets */
+    IP_ERR_EMPTY_GROUP,         /* IPv6: lone ':' at either end, or ":::" */
+    IP_ERR_GROUP_TOO_LONG,      /* IPv6: group of more than 4 hex digits */
+    IP_ERR_MULTIPLE_COMPRESSION,        /* IPv6: "::" more than once */
+    IP_ERR_GROUP_COUNT,         /* IPv6: too many or too few groups */
+    IP_ERR_BAD_IPV4_SUFFIX,     /* IPv6: malformed or misplaced dotted quad */
+    IP_ERR_COUNT                /* Number of codes, not a code */
+};
+
+/**
+ * ip_ipv4_error - Explain why dotted-quad text is rejected.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * Replays the scalar recogniser and stops at the first failing byte, so it
+ * costs a little more than a plain check. Call it after
+ * is_valid_ipv4_address_len() or parse_ipv4_address() has said no.
+ *
+ * Return: IP_OK if those functions accept the text, otherwise the reason.
+ */
+enum ip_error ip_ipv4_error(const char *buf, size_t len);
+
+/**
+ * ip_ipv6_error - Explain why IPv6 text is rejected.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * The IPv6 counterpart of ip_ipv4_error(), for is_valid_ipv6_address_len()
+ * and parse_ipv6_address().
+ *
+ * Return: IP_OK if those functions accept the text, otherwise the reason.
+ */
+enum ip_error ip_ipv6_error(const char *buf, size_t len);
+
+/**
+ * ip_error_name - Name a rejection reason.
+ * @err: Code from ip_ipv4_error() or ip_ipv6_error().
+ *
+ * Return: short lower-case name such as "octet-range", or "unknown".
+ */
+const char *ip_error_name(enum ip_error err);
+
+/*
+ * Outcome counts of the default parsers: is_valid_ipv4_address(),
+ * is_valid_ipv6_address(), their _len and parse_ variants and the batch
+ * functions. Slot IP_OK counts accepted text; every other slot counts text
+ * rejected for that reason. Policy parsers, the stream context and the
+ * scanner are not counted, nor are parse_ calls given a NULL output, which
+ * are rejected before the text is examined.
+ */
+struct ip_validator_stats {
+    uint64_t ipv4[IP_ERR_COUNT];
+    uint64_t ipv6[IP_ERR_COUNT];
+};
+
+/**
+ * ip_validator_stats_snapshot - Read the outcome counters.
+ * @stats: Output totals over all threads.
+ *
+ * Counting is compiled in only when the library is built with
+ * IP_VALIDATOR_STATS defined (make STATS=1). Each thread counts privately
+ * and adds its counts to the shared totals every few hundred calls, so a
+ * snapshot may miss the latest calls of running threads; see
+ * ip_validator_stats_flush().
+ *
+ * Return: true if counting is compiled in; otherwise @stats is zeroed and
+ * false is returned.
+ */
+bool ip_validator_stats_snapshot(struct ip_validator_stats *stats);
+
+/**
+ * ip_validator_stats_flush - Publish the calling thread's pending counts.
+ *
+ * Call before a thread exits, or before taking a snapshot that must include
+ * this thread's last calls. Does nothing when counting is not compiled in.
+ */
+void ip_validator_stats_flush(void);
+
+/**
+ * ip_validator_use_simd - Enable or disable the vector kernels.
+ * @enable: true to use the best kernel the running CPU supports (the default),
+ *          false to force the portable scalar path.
+ *
+ * The kernel is otherwise chosen automatically from CPUID/HWCAP on first use.
+ * Both paths accept exactly the same inputs; this switch exists for
+ * benchmarking and differential testing.
+ *
+ * Return: name of the kernel set now in use.
+ */
+const char *ip_validator_use_simd(bool enable);
+
+/**
+ * ip_validator_simd_name - Name the kernel set currently in use.
+ *
+ * Return: "avx2", "sse4.1", "sse2", "neon" or "scalar".
+ */
+const char *ip_validator_simd_name(void);
+
+#ifdef IP_VALIDATOR_INLINE
+#include "ip_validator_inline.h"
+#endif
 
 #endif                          /* IP_VALIDATOR_H */
@@ -0,0 +1,253 @@
+#ifndef IP_VALIDATOR_INLINE_H
+#define IP_VALIDATOR_INLINE_H
+
+/*
+ * Single-address entry points. ip_validator.c includes this file to define
+ * them as ordinary library functions. A file that defines
+ * IP_VALIDATOR_INLINE before including ip_validator.h gets them as static
+ * inline functions instead, through the same definitions, so its calls can be
+ * inlined into loops and specialised on constant lengths. The character
+ * table, the vector kernels and the counters stay in the library.
+ */
+
+#include "ip_validator.h"
+#include "ip_charclass.h"
+#include "ip_dfa.h"
+#include "ip_simd.h"
+#include "ip_stats.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <netinet/in.h>
+
+/**
+ * ipv4_parse_octets_scalar - Byte-at-a-time dotted-quad parser.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine, already bounds-checked.
+ * @octets: Output array that receives the four octets in network order.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv4
+ * address, otherwise false.
+ */
+static inline bool ipv4_parse_octets_scalar(const char *buf, size_t len,
+                                            unsigned char octets[4])
+{
+    struct ipv4_dfa m;
+
+    ipv4_dfa_init(&m);
+    for (size_t i = 0; i < len; i++) {
+        if (!ipv4_dfa_step(&m, ip_cc(buf[i])))
+            return false;
+    }
+    if (!ipv4_dfa_finish(&m))
+        return false;
+
+    memcpy(octets, m.octets, sizeof(m.octets));
+    return true;
+}
+
+/**
+ * ipv4_parse_octets - Parse a length-delimited dotted-quad slice.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @octets: Output array that receives the four octets in network order.
+ *
+ * Tries the vector kernel first and falls back to the scalar parser when no
+ * kernel is available or the kernel cannot decide. Never reads past
+ * @buf[@len - 1]. @octets may be partially written on failure.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv4
+ * address, otherwise false.
+ */
+static inline bool ipv4_parse_octets(const char *buf, size_t len,
+                                     unsigned char octets[4])
+{
+    if (buf == NULL || len == 0 || len >= MAX_SIZE_IPV4)
+        return false;
+
+    int verdict = ipv4_simd_parse(buf, len, octets);
+    if (verdict >= 0)
+        return verdict == 1;
+
+    return ipv4_parse_octets_scalar(buf, len, octets);
+}
+
+/**
+ * parse_ipv4_address - Validate and convert a dotted-quad slice in one pass.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @addr: Output that receives the address in network byte order.
+ *
+ * @addr is left untouched when the text is rejected.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv4
+ * address, otherwise false.
+ */
+IP_VALIDATOR_API bool parse_ipv4_address(const char *buf, size_t len,
+                                         struct in_addr *addr)
+{
+    unsigned char octets[4];
+
+    /* A NULL @addr is a caller error, not an outcome of the text. */
+    if (addr == NULL)
+        return false;
+
+    bool ok = ipv4_parse_octets(buf, len, octets);
+
+    ip_stats_count(AF_INET, buf, len, ok);
+    if (!ok)
+        return false;
+
+    memcpy(addr, octets, sizeof(octets));
+    return true;
+}
+
+/**
+ * is_valid_ipv4_address_len - Validate a length-delimited dotted-quad slice.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv4
+ * address, otherwise false.
+ */
+IP_VALIDATOR_API bool is_valid_ipv4_address_len(const char *buf, size_t len)
+{
+    unsigned char octets[4];
+    bool ok = ipv4_parse_octets(buf, len, octets);
+
+    ip_stats_count(AF_INET, buf, len, ok);
+    return ok;
+}
+
+/**
+ * is_valid_ipv4_address - Validate dotted-quad IPv4 text representation.
+ * @str: Null-terminated string to examine.
+ *
+ * Return: true if @str is a syntactically valid IPv4 address, otherwise false.
+ */
+IP_VALIDATOR_API bool is_valid_ipv4_address(const char *str)
+{
+    if (str == NULL)
+        return false;
+
+    return is_valid_ipv4_address_len(str, strnlen(str, MAX_SIZE_IPV4));
+}
+
+/**
+ * ipv6_parse_bytes_scalar - Single-pass IPv6 recogniser.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine, already bounds-checked.
+ * @bytes: Output array that receives the 16 address bytes in network order.
+ *
+ * Runs ipv6_dfa_step() over the slice; each byte is looked up and consumed
+ * exactly once.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv6
+ * address, otherwise false.
+ */
+static inline bool ipv6_parse_bytes_scalar(const char *buf, size_t len,
+                                           unsigned char bytes[16])
+{
+    struct ipv6_dfa m;
+
+    ipv6_dfa_init(&m);
+    for (size_t i = 0; i < len; i++) {
+        if (!ipv6_dfa_step(&m, ip_cc(buf[i])))
+            return false;
+    }
+    if (!ipv6_dfa_finish(&m))
+        return false;
+
+    memcpy(bytes, m.bytes, sizeof(m.bytes));
+    return true;
+}
+
+/**
+ * ipv6_parse_bytes - Parse a length-delimited IPv6 text slice.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @bytes: Output array that receives the 16 address bytes in network order.
+ *
+ * Tries the vector kernel first and falls back to the scalar recogniser when
+ * no kernel is available or the text carries a dotted-quad suffix. Never
+ * reads past @buf[@len - 1]. @bytes may be partially written on failure.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv6
+ * address, otherwise false.
+ */
+static inline bool ipv6_parse_bytes(const char *buf, size_t len,
+                                    unsigned char bytes[16])
+{
+    if (buf == NULL || len == 0 || len >= INET6_ADDRSTRLEN)
+        return false;
+
+    int verdict = ipv6_simd_parse(buf, len, bytes);
+    if (verdict >= 0)
+        return verdict == 1;
+
+    return ipv6_parse_bytes_scalar(buf, len, bytes);
+}
+
+/**
+ * parse_ipv6_address - Validate and convert an IPv6 text slice in one pass.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ * @addr: Output that receives the address in network byte order.
+ *
+ * @addr is left untouched when the text is rejected.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv6
+ * address, otherwise false.
+ */
+IP_VALIDATOR_API bool parse_ipv6_address(const char *buf, size_t len,
+                                         struct in6_addr *addr)
+{
+    unsigned char bytes[16];
+
+    /* A NULL @addr is a caller error, not an outcome of the text. */
+    if (addr == NULL)
+        return false;
+
+    bool ok = ipv6_parse_bytes(buf, len, bytes);
+
+    ip_stats_count(AF_INET6, buf, len, ok);
+    if (!ok)
+        return false;
+
+    memcpy(addr, bytes, sizeof(bytes));
+    return true;
+}
+
+/**
+ * is_valid_ipv6_address_len - Validate a length-delimited IPv6 text slice.
+ * @buf: Start of the candidate text; need not be NUL-terminated.
+ * @len: Number of bytes of @buf to examine.
+ *
+ * Return: true if the @len bytes at @buf are a syntactically valid IPv6
+ * address, otherwise false.
+ */
+IP_VALIDATOR_API bool is_valid_ipv6_address_len(const char *buf, size_t len)
+{
+    unsigned char bytes[16];
+    bool ok = ipv6_parse_bytes(buf, len, bytes);
+
+    ip_stats_count(AF_INET6, buf, len, ok);
+    return ok;
+}
+
+/**
+ * is_valid_ipv6_address - Validate IPv6 text representation.
+ * @str: Null-terminated string to examine.
+ *
+ * Return: true if @str is a syntactically valid IPv6 address, otherwise false.
+ */
+IP_VALIDATOR_API bool is_valid_ipv6_address(const char *str)
+{
+    if (str == NULL)
+        return false;
+
+    return is_valid_ipv6_address_len(str, strnlen(str, INET6_ADDRSTRLEN));
+}
+
+#endif                          /* IP_VALIDATOR_INLINE_H */
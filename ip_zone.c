@@ -0,0 +1,125 @@
+/*
+ * Zone ID resolution.
+ *
+ * if_nametoindex() costs a socket and an ioctl per call, so resolved names
+ * are kept in a small direct-mapped cache per thread. Threads never share or
+ * lock a cache; a global generation number, bumped by ip_zone_cache_flush(),
+ * tells each thread when to drop what it holds.
+ */
+
+#include "ip_validator.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include <net/if.h>
+
+/* Cache slots per thread; a power of two. */
+#define ZONE_CACHE_SLOTS 16
+
+struct zone_cache_entry {
+    char name[IF_NAMESIZE];     /* NUL-terminated interface name */
+    unsigned int index;         /* 0 marks an empty slot */
+};
+
+struct zone_cache {
+    unsigned int generation;    /* zone_generation the slots belong to */
+    struct zone_cache_entry slots[ZONE_CACHE_SLOTS];
+};
+
+/* Starts at 1 so a thread's zero-initialised cache reads as stale. */
+static _Atomic unsigned int zone_generation = 1;
+
+static _Thread_local struct zone_cache zone_cache;
+
+/**
+ * zone_hash - Pick the cache slot for a zone name.
+ * @name: Zone bytes.
+ * @len: Number of bytes of @name.
+ *
+ * Return: slot index below ZONE_CACHE_SLOTS.
+ */
+static unsigned int zone_hash(const char *name, size_t len)
+{
+    uint32_t h = 2166136261u;   /* FNV-1a */
+
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h & (ZONE_CACHE_SLOTS - 1);
+}
+
+/**
+ * zone_numeric - Read a zone made only of decimal digits.
+ * @name: Zone bytes.
+ * @len: Number of bytes of @name.
+ * @index: Output index.
+ *
+ * Return: true if the zone is numeric and fits an interface index.
+ */
+static bool zone_numeric(const char *name, size_t len, unsigned int *index)
+{
+    unsigned long v = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        if (name[i] < '0' || name[i] > '9')
+            return false;
+        v = v * 10 + (unsigned long)(name[i] - '0');
+        if (v > UINT32_MAX)
+            return false;
+    }
+    *index = (unsigned int)v;
+    return true;
+}
+
+/**
+ * ip_zone_index - Resolve a zone ID to an interface index.
+ * @buf: Text the zone was parsed from.
+ * @zone: Zone location from parse_ipv6_address_zone().
+ *
+ * Return: interface index, or 0 if there is no zone or the name is unknown.
+ */
+unsigned int ip_zone_index(const char *buf, const struct ip_zone *zone)
+{
+    const char *name = buf + zone->offset;
+    size_t len = zone->len;
+    unsigned int index;
+
+    if (len == 0 || len >= IF_NAMESIZE)
+        return 0;
+    if (zone_numeric(name, len, &index))
+        return index;
+
+    struct zone_cache *cache = &zone_cache;
+    unsigned int generation = atomic_load_explicit(&zone_generation,
+                                                   memory_order_acquire);
+
+    if (cache->generation != generation) {
+        memset(cache->slots, 0, sizeof(cache->slots));
+        cache->generation = generation;
+    }
+
+    struct zone_cache_entry *e = &cache->slots[zone_hash(name, len)];
+
+    if (e->index != 0 && memcmp(e->name, name, len) == 0 &&
+        e->name[len] == '\0')
+        return e->index;
+
+    char text[IF_NAMESIZE];
+
+    memcpy(text, name, len);
+    text[len] = '\0';
+    index = if_nametoindex(text);
+    if (index != 0) {
+        memcpy(e->name, text, len + 1);
+        e->index = index;
+    }
+    return index;
+}
+
+/**
+ * ip_zone_cache_flush - Forget every cached zone name.
+ */
+void ip_zone_cache_flush(void)
+{
+    atomic_fetch_add_explicit(&zone_generation, 1, memory_order_release);
+}